@@ -266,7 +266,8 @@ open_c:
     ppdev->buf = base;
     ppdev->buffer_space = space;
     pclist_dev->common.orig_spec_op = dev_proc(ppdev, dev_spec_op);
-    clist_init_io_procs(pclist_dev, ppdev->BLS_force_memory);
+    clist_init_io_procs(pclist_dev, ppdev->BLS_force_memory,
+                        ppdev->BandListCompression);
     clist_init_params(pclist_dev, base, space, target,
                       ppdev->printer_procs.buf_procs,
                       space_params->band,
@@ -309,6 +310,9 @@ open_c:
             ppdev->buffer_space = 0;
             *the_memory = 0;
         }
+    } else {
+        /* The buffer counts against the memory budget until tear down. */
+        gs_lib_ctx_budget_charge(pdev->memory, ppdev->buffer_space);
     }
     return code;
 }
@@ -328,6 +332,7 @@ gdev_prn_tear_down(gx_device *pdev, byte **the_memory)
         (*gs_clist_device_procs.close_device)( (gx_device *)pcldev );
         *the_memory = ppdev->buf;
         ppdev->buf = 0;
+        gs_lib_ctx_budget_uncharge(pdev->memory, ppdev->buffer_space);
         ppdev->buffer_space = 0;
         was_command_list = true;
 
@@ -682,6 +687,19 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
         }
         return param_write_string(plist, "BandListStorage", &bls);
     }
+    if (strcmp(Param, "BandListCompression") == 0) {
+        gs_param_string blc;
+
+        param_string_from_string(blc,
+            (ppdev->BandListCompression == clist_compression_fast ? "fast" : "default"));
+        return param_write_string(plist, "BandListCompression", &blc);
+    }
+    if (strcmp(Param, "BandProfileFile") == 0) {
+        gs_param_string bpf;
+
+        param_string_from_transient_string(bpf, ppdev->BandProfileFile);
+        return param_write_string(plist, "BandProfileFile", &bpf);
+    }
     if (strcmp(Param, "OutputFile") == 0) {
         gs_param_string ofns;
 
@@ -715,6 +733,8 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
     int code = gx_default_get_params(pdev, plist);
     gs_param_string ofns;
     gs_param_string bls;
+    gs_param_string blc;
+    gs_param_string bpf;
     gs_param_string saved_pages;
     bool pageneutralcolor = false;
 
@@ -747,6 +767,13 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
     }
     if( (code = param_write_string(plist, "BandListStorage", &bls)) < 0 )
         return code;
+    param_string_from_string(blc,
+        (ppdev->BandListCompression == clist_compression_fast ? "fast" : "default"));
+    if( (code = param_write_string(plist, "BandListCompression", &blc)) < 0 )
+        return code;
+    param_string_from_transient_string(bpf, ppdev->BandProfileFile);
+    if( (code = param_write_string(plist, "BandProfileFile", &bpf)) < 0 )
+        return code;
 
     ofns.data = (const byte *)ppdev->fname,
         ofns.size = strlen(ppdev->fname),
@@ -794,6 +821,9 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     gdev_space_params save_sp;
     gs_param_string ofs;
     gs_param_string bls;
+    gs_param_string blc;
+    clist_compression_t blc_method = ppdev->BandListCompression;
+    gs_param_string bpf;
     gs_param_dict mdict;
     gs_param_string saved_pages;
     bool pageneutralcolor = false;
@@ -850,6 +880,46 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
             bls.data = 0;
             break;
     }
+    switch (code = param_read_string(plist, (param_name = "BandListCompression"), &blc)) {
+        case 0:
+            if (bytes_compare(blc.data, blc.size, (const byte *)"fast", 4) == 0) {
+                blc_method = clist_compression_fast;
+                break;
+            }
+            if (bytes_compare(blc.data, blc.size, (const byte *)"default", 7) == 0) {
+                blc_method = clist_compression_default;
+                break;
+            }
+            code = gs_note_error(gs_error_rangecheck);
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+            /* fall through */
+        case 1:
+            break;
+    }
+
+    switch (code = param_read_string(plist, (param_name = "BandProfileFile"), &bpf)) {
+        case 0:
+            if (pdev->LockSafetyParams &&
+                    bytes_compare(bpf.data, bpf.size,
+                        (const byte *)ppdev->BandProfileFile,
+                        strlen(ppdev->BandProfileFile)))
+                code = gs_note_error(gs_error_invalidaccess);
+            else if (bpf.size >= sizeof(ppdev->BandProfileFile))
+                code = gs_note_error(gs_error_limitcheck);
+            if (code >= 0)
+                break;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+            /* fall through */
+        case 1:
+            bpf.data = 0;
+            break;
+    }
 
     switch (code = param_read_string(plist, (param_name = "OutputFile"), &ofs)) {
         case 0:
@@ -950,10 +1020,21 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         ppdev->Duplex = duplex;
         ppdev->Duplex_set = duplex_set;
     }
+    if (nthreads != ppdev->num_render_threads_requested) {
+        /* Keep as many idle worker threads as we will render bands with */
+        code = gs_lib_ctx_set_num_worker_threads(pdev->memory, nthreads);
+        if (code < 0)
+            return code;
+    }
     ppdev->num_render_threads_requested = nthreads;
     if (bls.data != 0) {
         ppdev->BLS_force_memory = (bls.data[0] == 'm');
     }
+    ppdev->BandListCompression = blc_method;
+    if (bpf.data != 0) {
+        memcpy(ppdev->BandProfileFile, bpf.data, bpf.size);
+        ppdev->BandProfileFile[bpf.size] = 0;
+    }
 
     /* If necessary, free and reallocate the printer memory. */
     /* Formerly, would not reallocate if device is not open: */
@@ -1124,12 +1205,22 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                                                        ppdev->bg_print.thread_id, true);
                     ppdev->bg_print.device = NULL;
                 }
+                /* Collect the band playback statistics, if requested */
+                if (PRINTER_IS_CLIST(ppdev) && ppdev->BandProfileFile[0] != 0 &&
+                    (code = clist_band_profile_begin(pdev)) < 0)
+                    return code;
                 /* Here's where we actually let the device's print_page_copies work */
                 /* Print the accumulated page description. */
                 outcode = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
                                                           num_copies);
                 gp_fflush(ppdev->file);
                 errcode = (gp_ferror(ppdev->file) ? gs_note_error(gs_error_ioerror) : 0);
+                if (PRINTER_IS_CLIST(ppdev) &&
+                    ((gx_device_clist_common *)ppdev)->band_profile != NULL) {
+                    code = clist_band_profile_end(pdev, ppdev->BandProfileFile);
+                    if (errcode == 0)
+                        errcode = code;
+                }
                 /* NB: background printing does this differently in its thread */
                 closecode = gdev_prn_close_printer(pdev);
 
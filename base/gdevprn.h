@@ -143,6 +143,8 @@ typedef struct bg_print_s {
         bool bg_print_requested;	/* request background printing of page from clist */\
         bg_print_t bg_print;            /* background printing data shared with thread */\
         int num_render_threads_requested;	/* for multiple band rendering threads */\
+        clist_compression_t BandListCompression;	/* compressor for a RAM band list */\
+        char BandProfileFile[prn_fname_sizeof];	/* band playback statistics, if not empty */\
         gx_saved_pages_list *saved_pages_list;	/* list when we are saving pages instead of printing */\
         gx_device_procs save_procs_while_delaying_erasepage	/* save device procs while delaying erasepage. */
 
@@ -311,6 +313,8 @@ extern const gx_device_procs prn_bg_procs;
         0/*false*/,	/* bg_print_requested */\
         {  0/*sema*/, 0/*device*/, 0/*thread_id*/, 0/*num_copies*/, 0/*return_code*/ }, /* bg_print */\
         0, 		/* num_render_threads_requested */\
+        clist_compression_default,	/* BandListCompression */\
+        { 0 },		/* BandProfileFile */\
         0,              /* saved_pages_list */\
         { 0 }           /* save_procs_while_delaying_erasepage */
 #define prn_device_body_rest_(print_page)\
@@ -431,6 +431,16 @@ gp_file *gp_open_scratch_file_rm(const gs_memory_t *mem,
                                        char         fname[gp_file_name_sizeof],
                                  const char        *mode);
 
+/* Map the first size bytes of an open file into memory, read only.
+ * Returns NULL if the platform (or the file) doesn't support this, in
+ * which case the caller must read the file as usual. The mapping is
+ * unaffected by later writes that extend the file. *phandle must be
+ * passed back to gp_funmap. */
+void *gp_fmap(gp_file *f, gs_offset_t size, void **phandle);
+
+/* Release a mapping made by gp_fmap */
+void gp_funmap(void *addr, gs_offset_t size, void *handle);
+
 /* Unlink utf-8 filename, subject to 'control' path permissions */
 int gp_unlink(gs_memory_t *mem, const char *fname);
 
@@ -637,6 +647,10 @@ int gp_pread_impl(char *buf, size_t count, gs_offset_t offset, FILE *f);
 
 int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f);
 
+void *gp_fmap_impl(FILE *f, gs_offset_t size, void **phandle);
+
+void gp_funmap_impl(void *addr, gs_offset_t size, void *handle);
+
 gs_offset_t gp_ftell_impl(FILE *f);
 
 int gp_fseek_impl(FILE *strm, gs_offset_t offset, int origin);
@@ -32,6 +32,9 @@
 #include "dirent_.h"
 #include "unistd_.h"
 #include <stdlib.h>             /* for mkstemp/mktemp */
+#if !defined(GS_NO_FILESYSTEM) && defined(HAVE_MMAP) && HAVE_MMAP == 1
+#  include <sys/mman.h>
+#endif
 
 #if !defined(HAVE_FSEEKO)
 #define ftello ftell
@@ -245,6 +248,30 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
 #endif
 }
 
+void *gp_fmap_impl(FILE *f, gs_offset_t size, void **phandle)
+{
+#if !defined(GS_NO_FILESYSTEM) && defined(HAVE_MMAP) && HAVE_MMAP == 1
+    void *addr;
+
+    if ((uint64_t)size > (size_t)-1)
+        return NULL;		/* too big for the address space */
+    addr = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (addr == MAP_FAILED)
+        return NULL;
+    *phandle = NULL;
+    return addr;
+#else
+    return NULL;
+#endif
+}
+
+void gp_funmap_impl(void *addr, gs_offset_t size, void *handle)
+{
+#if !defined(GS_NO_FILESYSTEM) && defined(HAVE_MMAP) && HAVE_MMAP == 1
+    munmap(addr, (size_t)size);
+#endif
+}
+
 /* Set a file into binary or text mode. */
 int
 gp_setmode_binary_impl(FILE * pfile, bool mode)
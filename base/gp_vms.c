@@ -311,6 +311,15 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return -1;
 }
 
+void *gp_fmap_impl(FILE *f, gs_offset_t size, void **phandle)
+{
+    return NULL;
+}
+
+void gp_funmap_impl(void *addr, gs_offset_t size, void *handle)
+{
+}
+
 /* Set a file into binary or text mode. */
 int
 gp_setmode_binary_impl(FILE * pfile, bool binary)
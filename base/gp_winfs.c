@@ -153,6 +153,35 @@ int gp_pwrite_impl(const char *buf, size_t count, gs_offset_t offset, FILE *f)
     return ret;
 }
 
+/* Map the start of a FILE into memory, read only */
+void *gp_fmap_impl(FILE *f, gs_offset_t size, void **phandle)
+{
+    HANDLE hnd = (HANDLE)_get_osfhandle(fileno(f));
+    HANDLE map;
+    void *addr;
+
+    if (hnd == INVALID_HANDLE_VALUE || (uint64_t)size > (SIZE_T)-1)
+        return NULL;
+
+    map = CreateFileMapping(hnd, NULL, PAGE_READONLY,
+                            (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (map == NULL)
+        return NULL;
+    addr = MapViewOfFile(map, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+    if (addr == NULL) {
+        CloseHandle(map);
+        return NULL;
+    }
+    *phandle = (void *)map;
+    return addr;
+}
+
+void gp_funmap_impl(void *addr, gs_offset_t size, void *handle)
+{
+    UnmapViewOfFile(addr);
+    CloseHandle((HANDLE)handle);
+}
+
 /* --------- 64 bit file access ----------- */
 /* MSVC versions before 8 doen't provide big files.
    MSVC 8 doesn't distinguish big and small files,
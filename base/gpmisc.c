@@ -854,6 +854,25 @@ gp_open_scratch_file_rm(const gs_memory_t *mem,
     return do_open_scratch_file(mem, prefix, fname, mode, 1);
 }
 
+void *
+gp_fmap(gp_file *f, gs_offset_t size, void **phandle)
+{
+    FILE *file = gp_get_file(f);
+
+    *phandle = NULL;
+    if (file == NULL || size <= 0)
+        return NULL;
+    gp_fflush(f);
+    return gp_fmap_impl(file, size, phandle);
+}
+
+void
+gp_funmap(void *addr, gs_offset_t size, void *handle)
+{
+    if (addr != NULL)
+        gp_funmap_impl(addr, size, handle);
+}
+
 int
 gp_stat(const gs_memory_t *mem, const char *path, struct stat *buf)
 {
@@ -24,6 +24,7 @@
 #include "gxalloc.h"
 #include "stream.h"		/* for clearing stream list */
 #include "malloc_.h" /* For MEMENTO */
+#include "gsmprof.h"
 
 #if GS_USE_MEMORY_HEADER_ID
 gs_id hdr_id = 0;
@@ -92,6 +93,14 @@ alloc_size_is_ok(gs_memory_type_ptr_t stype)
 #  define ALLOC_CHECK_SIZE(mem,stype) DO_NOTHING
 #endif
 
+/* Count an allocation in the profile; we don't follow these objects' lives. */
+#define alloc_profile(imem, obj, size, cname)\
+  BEGIN\
+    if ((obj) != 0)\
+      gs_memory_profile_alloc((gs_memory_t *)(imem), gs_memory_profile_gc,\
+                              NULL, size, cname);\
+  END
+
 /*
  * The structure descriptor for allocators.  Even though allocators
  * are allocated outside GC space, they reference objects within it.
@@ -933,6 +942,7 @@ ialloc_reset_free(gs_ref_memory_t * mem)
     for (i = 0, p = &mem->freelists[0]; i < num_freelists; i++, p++)
         *p = 0;
     mem->largest_free_size = 0;
+    alloc_forget_clean(mem);
 }
 
 /*
@@ -1184,6 +1194,7 @@ i_alloc_bytes(gs_memory_t * mem, size_t ssize, client_name_t cname)
 #if IGC_PTR_STABILITY_CHECK
         obj[-1].d.o.space_id = imem->space_id;
 #endif
+    alloc_profile(imem, obj, size, cname);
     return (byte *) obj;
 }
 static byte *
@@ -1206,6 +1217,7 @@ i_alloc_bytes_immovable(gs_memory_t * mem, size_t ssize, client_name_t cname)
     if (obj == 0)
         return 0;
     alloc_trace("|+b.", imem, cname, NULL, size, obj);
+    alloc_profile(imem, obj, size, cname);
     return (byte *) obj;
 }
 static void *
@@ -1239,6 +1251,7 @@ i_alloc_struct(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
 #if IGC_PTR_STABILITY_CHECK
         obj[-1].d.o.space_id = imem->space_id;
 #endif
+    alloc_profile(imem, obj, size, cname);
     return obj;
 }
 static void *
@@ -1257,6 +1270,7 @@ i_alloc_struct_immovable(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
     ALLOC_CHECK_SIZE(mem,pstype);
     obj = alloc_obj(imem, size, pstype, ALLOC_IMMOVABLE | ALLOC_DIRECT, cname);
     alloc_trace("|+<.", imem, cname, pstype, size, obj);
+    alloc_profile(imem, obj, size, cname);
     return obj;
 }
 
@@ -1307,6 +1321,7 @@ i_alloc_byte_array(gs_memory_t * mem, size_t num_elements, size_t elt_size,
                alloc_trace_space(imem), client_name_string(cname),
                num_elements * elt_size,
                num_elements, elt_size, (intptr_t)obj);
+    alloc_profile(imem, obj, lsize, cname);
     return (byte *) obj;
 }
 static byte *
@@ -1334,6 +1349,7 @@ i_alloc_byte_array_immovable(gs_memory_t * mem, size_t num_elements,
                alloc_trace_space(imem), client_name_string(cname),
                num_elements * elt_size,
                num_elements, elt_size, (intptr_t)obj);
+    alloc_profile(imem, obj, lsize, cname);
     return (byte *) obj;
 }
 static void *
@@ -1368,6 +1384,7 @@ i_alloc_struct_array(gs_memory_t * mem, size_t num_elements,
                struct_type_name_string(pstype),
                num_elements * pstype->ssize,
                num_elements, pstype->ssize, (intptr_t)obj);
+    alloc_profile(imem, obj, lsize, cname);
     return (char *)obj;
 }
 static void *
@@ -1395,6 +1412,7 @@ i_alloc_struct_array_immovable(gs_memory_t * mem, size_t num_elements,
                struct_type_name_string(pstype),
                num_elements * pstype->ssize,
                num_elements, pstype->ssize, (intptr_t)obj);
+    alloc_profile(imem, obj, lsize, cname);
     return (char *)obj;
 }
 static void *
@@ -1647,6 +1665,7 @@ top:
         gs_alloc_fill(str, gs_alloc_fill_alloc, nbytes);
         str += HDR_ID_OFFSET;
         ASSIGN_HDR_ID(str);
+        alloc_profile(imem, str, nbytes - HDR_ID_OFFSET, cname);
         return str;
     }
     /* Try the next clump. */
@@ -1707,6 +1726,7 @@ i_alloc_string_immovable(gs_memory_t * mem, size_t nbytes, client_name_t cname)
     gs_alloc_fill(str, gs_alloc_fill_alloc, nbytes);
     str += HDR_ID_OFFSET;
     ASSIGN_HDR_ID(str);
+    alloc_profile(imem, str, nbytes - HDR_ID_OFFSET, cname);
 
     return str;
 }
@@ -1816,7 +1836,16 @@ i_status(gs_memory_t * mem, gs_memory_status_t * pstat)
     /* Add up unallocated space within each clump. */
     /* Also keep track of space allocated to inner clumps, */
     /* which are included in previous_status.allocated. */
-    for (cp = clump_splay_walk_init(&sw, imem); cp != NULL; cp = clump_splay_walk_fwd(&sw))
+    /* Clumps that are clean since the last save scan */
+    /* have already been added up. */
+    if (imem->clean_valid) {
+        unused += imem->clean_unused;
+        inner += imem->clean_inner;
+        cp = imem->dirty;
+    } else
+        cp = clump_splay_walk_init(&sw, imem);
+    for (; cp != NULL;
+         cp = (imem->clean_valid ? cp->dirty_next : clump_splay_walk_fwd(&sw)))
     {
         unused += cp->ctop - cp->cbot;
         if (cp->outer)
@@ -2109,6 +2138,7 @@ consolidate_clump_free(clump_t *cp, gs_ref_memory_t *mem)
                    (intptr_t)cp, (intptr_t)cp->cbot, (intptr_t)begin_free,
                    (intptr_t)((byte *)cp->cbot - (byte *)begin_free));
         cp->cbot = (byte *) begin_free;
+        alloc_dirty_clump(mem, cp);
     }
 }
 
@@ -2331,6 +2361,7 @@ trim_obj(gs_ref_memory_t *mem, obj_header_t *obj, obj_size_t size, clump_t *cp)
 #endif
                 {
                     cp->cbot = (byte *)excess_pre;
+                    alloc_dirty_clump(mem, cp);
                     return;
                 }
         }
@@ -2429,6 +2460,28 @@ alloc_link_clump(clump_t * cp, gs_ref_memory_t * imem)
 {
     splay_insert(cp, imem);
     SANITY_CHECK(cp);
+    alloc_dirty_clump(imem, cp);
+}
+
+/* Put a clump on the dirty list, so that the next save scan looks at it. */
+/* There is no list unless the allocator is keeping track of clean clumps. */
+void
+alloc_dirty_clump(gs_ref_memory_t * mem, clump_t * cp)
+{
+    if (mem->clean_valid && !cp->c_dirty) {
+        cp->c_dirty = true;
+        cp->dirty_next = mem->dirty;
+        mem->dirty = cp;
+    }
+}
+
+/* Stop keeping track of clean clumps until the next full save scan. */
+/* The c_dirty flags may be stale afterwards; the full scan resets them. */
+void
+alloc_forget_clean(gs_ref_memory_t * mem)
+{
+    mem->dirty = 0;
+    mem->clean_valid = false;
 }
 
 /* Add a clump for ordinary allocation. */
@@ -2521,6 +2574,8 @@ alloc_init_clump(clump_t * cp, byte * bot, byte * top, bool has_strings,
     cp->has_refs = false;
     cp->sbase = cdata;
     cp->c_alone = false; /* should be set correctly by caller */
+    cp->c_dirty = false;
+    cp->dirty_next = 0;
     if (has_strings && top - cdata >= string_space_quantum + sizeof(long) - 1) {
         /*
          * We allocate a large enough string marking and reloc table
@@ -2578,6 +2633,8 @@ alloc_open_clump(gs_ref_memory_t * mem)
         dmprintf_clump((const gs_memory_t *)mem, "opening clump", mem->cc);
     }
 #endif
+    if (mem->cc)
+        alloc_dirty_clump(mem, mem->cc);
 }
 
 #ifdef DEBUG
@@ -2612,6 +2669,7 @@ alloc_unlink_clump(clump_t * cp, gs_ref_memory_t * mem)
     }
 #endif
     (void)clump_splay_remove(cp, mem);
+    alloc_forget_clean(mem);
     if (mem->cc == cp) {
         mem->cc = NULL;
     }
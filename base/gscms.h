@@ -458,6 +458,7 @@ typedef struct gsicc_link_cache_s {
     gx_monitor_t *lock;		/* handle for the monitor */
     bool cache_full;		/* flag that some thread needs a cache slot */
     gx_semaphore_t *full_wait;	/* semaphore for waiting when the cache is full */
+    gs_lib_ctx_budget_client_t *budget;	/* our share of the memory budget */
 } gsicc_link_cache_t;
 
 /* A linked list structure to keep DeviceN ICC profiles
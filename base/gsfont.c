@@ -244,9 +244,10 @@ gs_font_dir *
 gs_font_dir_alloc2_limits(gs_memory_t * struct_mem, gs_memory_t * bits_mem,
                      uint smax, uint bmax, uint mmax, uint cmax, uint upper)
 {
+    /* Immovable, since the memory budget keeps a pointer to it. */
     gs_font_dir *pdir =
-        gs_alloc_struct(struct_mem, gs_font_dir, &st_font_dir,
-                        "font_dir_alloc(dir)");
+        gs_alloc_struct_immovable(struct_mem, gs_font_dir, &st_font_dir,
+                                  "font_dir_alloc(dir)");
     int code;
 
     if (pdir == 0)
@@ -288,6 +289,9 @@ gs_font_dir_finalize(const gs_memory_t *cmem, void *vptr)
         cmem->gs_lib_ctx->font_dir = NULL;
     }
 
+    gs_lib_ctx_budget_unregister(pdir->ccache.budget);
+    pdir->ccache.budget = NULL;
+
     /* free character cache machinery */
     gs_free_object(pdir->memory, pdir->fmcache.mdata, "gs_font_dir_finalize");
     gs_free_object(pdir->memory, pdir->ccache.table, "gs_font_dir_finalize");
@@ -47,6 +47,8 @@
          *  of links.
          */
 #define ICC_CACHE_MAXLINKS (MAX_THREADS*2)	/* allow up to two active links per thread */
+/* A rough guess at the size of a link, for the memory budget. */
+#define ICC_CACHE_LINK_SIZE (1024*1024)
 
 /* Static prototypes */
 
@@ -67,6 +69,8 @@ static void gsicc_get_buff_hash(unsigned char *data, int64_t *hash, unsigned int
 
 static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname);
 
+static size_t icc_linkcache_evict(void *data, size_t wanted);
+
 /* Structure pointer information */
 
 struct_proc_finalize(icc_link_finalize);
@@ -100,8 +104,9 @@ gsicc_cache_new(gs_memory_t *memory)
 
     /* We want this to be maintained in stable_memory.  It should be be effected by the
        save and restores */
-    result = gs_alloc_struct(memory->stable_memory, gsicc_link_cache_t, &st_icc_linkcache,
-                             "gsicc_cache_new");
+    /* Immovable, since the memory budget keeps a pointer to it. */
+    result = gs_alloc_struct_immovable(memory->stable_memory, gsicc_link_cache_t,
+                                       &st_icc_linkcache, "gsicc_cache_new");
     if ( result == NULL )
         return(NULL);
     result->head = NULL;
@@ -121,7 +126,15 @@ gsicc_cache_new(gs_memory_t *memory)
         gs_free_object(memory->stable_memory, result, "gsicc_cache_new");
         return(NULL);
     }
+    result->budget = NULL;
     rc_init_free(result, memory->stable_memory, 1, rc_gsicc_link_cache_free);
+    /* Other threads may only evict links directly if the cache's allocator */
+    /* is thread safe (the locked heap). Caches in a gstate's VM or in a     */
+    /* rendering thread's chunk allocator are trimmed by their own thread.   */
+    result->budget = gs_lib_ctx_budget_register(memory, "ICC link cache",
+                                GS_BUDGET_PRIORITY_ICC,
+                                result->memory->thread_safe_memory == result->memory,
+                                icc_linkcache_evict, result);
     if_debug2m(gs_debug_flag_icc, memory,
                "[icc] Allocating link cache = "PRI_INTPTR" memory = "PRI_INTPTR"\n",
 	       (intptr_t)result, (intptr_t)result->memory);
@@ -147,6 +160,8 @@ icc_linkcache_finalize(const gs_memory_t *mem, void *ptr)
 {
     gsicc_link_cache_t *link_cache = (gsicc_link_cache_t * ) ptr;
 
+    gs_lib_ctx_budget_unregister(link_cache->budget);
+    link_cache->budget = NULL;
     while (link_cache->head != NULL) {
         if (link_cache->head->ref_count != 0) {
             emprintf2(mem, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
@@ -168,6 +183,35 @@ icc_linkcache_finalize(const gs_memory_t *mem, void *ptr)
     }
 }
 
+/* Free links that aren't in use, to give memory back to the memory budget. */
+/* If the cache's allocator is thread safe the budget calls this from any   */
+/* thread, otherwise only from the thread that owns the cache. Either way   */
+/* other threads may be using the cache, so it has to take the lock.        */
+static size_t
+icc_linkcache_evict(void *data, size_t wanted)
+{
+    gsicc_link_cache_t *link_cache = (gsicc_link_cache_t *)data;
+    gsicc_link_t *link;
+    size_t freed = 0;
+    int num_links;
+
+    gx_monitor_enter(link_cache->lock);
+    while (freed < wanted) {
+        for (link = link_cache->head; link != NULL; link = link->next)
+            if (link->ref_count == 0)
+                break;
+        if (link == NULL)
+            break;
+        gsicc_remove_link(link, link_cache->memory);
+        freed += ICC_CACHE_LINK_SIZE;
+    }
+    num_links = link_cache->num_links;
+    gx_monitor_leave(link_cache->lock);
+    gs_lib_ctx_budget_set_used(link_cache->budget,
+                               (size_t)num_links * ICC_CACHE_LINK_SIZE);
+    return freed;
+}
+
 /* This is a special allocation for a link that is used by devices for
    doing color management on post rendered data.  It is not tied into the
    profile cache like gsicc_alloc_link. Also it goes ahead and creates
@@ -840,8 +884,12 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
 {
     gs_memory_t *cache_mem = icc_link_cache->memory;
     gsicc_link_t *link;
+    int num_links;
 
     *ret_link = NULL;
+    /* Make room in the memory budget. This may free links from this cache */
+    /* (or others), so it has to be done before we take the lock.          */
+    gs_lib_ctx_budget_reserve(icc_link_cache->budget, ICC_CACHE_LINK_SIZE);
     /* First see if we can add a link */
     /* TODO: this should be based on memory usage, not just num_links */
     gx_monitor_enter(icc_link_cache->lock);
@@ -898,8 +946,12 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
         icc_link_cache->head = *ret_link;
         icc_link_cache->num_links++;
     }
+    num_links = icc_link_cache->num_links;
     /* unlock before returning */
     gx_monitor_leave(icc_link_cache->lock);
+    /* The budget takes our lock when it evicts, so don't call it holding ours */
+    gs_lib_ctx_budget_set_used(icc_link_cache->budget,
+                               (size_t)num_links * ICC_CACHE_LINK_SIZE);
     return false;	/* we didn't find it, but return a link to be filled */
 }
 
@@ -22,6 +22,7 @@
 /* Capture stdin/out/err before gs.h redefines them. */
 #include "stdio_.h"
 #include "string_.h" /* memset */
+#include "stdint_.h"
 #include "gp.h"
 #include "gpmisc.h"
 #include "gsicc_manage.h"
@@ -32,6 +33,9 @@
 #include "cal.h"
 #endif
 #include "gsargs.h"
+#include "gxsync.h"
+#include "gdebug.h"
+#include "gsmprof.h"
 
 /* Include the extern for the device list. */
 extern_gs_lib_device_list();
@@ -371,6 +375,9 @@ Failure:
     return -1;
 }
 
+static void gs_lib_ctx_worker_pool_fin(gs_lib_ctx_t *ctx);
+static void gs_lib_ctx_budget_fin(gs_lib_ctx_core_t *core);
+
 static void remove_ctx_pointers(gs_memory_t *mem)
 {
     mem->gs_lib_ctx = NULL;
@@ -396,6 +403,7 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     ctx = mem->gs_lib_ctx;
     ctx_mem = ctx->memory;
 
+    gs_lib_ctx_worker_pool_fin(ctx);
     sjpxd_destroy(mem);
     gscms_destroy(ctx_mem);
     gs_free_object(ctx_mem, ctx->profiledir,
@@ -416,6 +424,7 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     refs = --ctx->core->refs;
     gx_monitor_leave((gx_monitor_t *)(ctx->core->monitor));
     if (refs == 0) {
+        gs_memory_profile_fin(ctx->core);
         gx_monitor_free((gx_monitor_t *)(ctx->core->monitor));
 #ifdef WITH_CAL
         cal_fin(ctx->core->cal_ctx, ctx->core->memory);
@@ -443,6 +452,7 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
             gs_free_object(ctx->core->memory, ctx->core->argv[i], "gs_lib_ctx_arg");
         gs_free_object(ctx->core->memory, ctx->core->argv, "gs_lib_ctx_args");
 
+        gs_lib_ctx_budget_fin(ctx->core);
         gs_free_object(ctx->core->memory, ctx->core, "gs_lib_ctx_fin");
     }
     remove_ctx_pointers(ctx_mem);
@@ -1347,3 +1357,480 @@ int gs_lib_ctx_callout(gs_memory_t *mem, const char *dev_name,
     }
     return -1;
 }
+
+/* ------ Persistent worker threads ------ */
+
+/* A worker is an OS thread that waits to be handed a job, runs it, and
+ * then waits for the next one. The pool keeps up to 'size' idle workers
+ * so that the clist rendering threads (and anyone else who wants them)
+ * don't pay for creating and destroying threads on every page.
+ */
+struct gs_lib_ctx_worker_s {
+    gs_lib_ctx_worker_pool_t *pool;
+    gp_thread_id thread;
+    gx_semaphore_t *start;	/* signalled when there is a job, or on quit */
+    gx_semaphore_t *done;	/* signalled when the job has been run */
+    void (*proc)(void *);
+    void *arg;
+    bool quit;
+    gs_lib_ctx_worker_t *next;	/* in the idle list */
+};
+
+struct gs_lib_ctx_worker_pool_s {
+    gs_memory_t *memory;
+    gx_monitor_t *lock;
+    int size;			/* max number of idle workers to keep */
+    int num_idle;
+    gs_lib_ctx_worker_t *idle;
+};
+
+static void
+gs_lib_ctx_worker_main(void *arg)
+{
+    gs_lib_ctx_worker_t *worker = (gs_lib_ctx_worker_t *)arg;
+
+    for (;;) {
+        gx_semaphore_wait(worker->start);
+        if (worker->quit)
+            break;
+        worker->proc(worker->arg);
+        gx_semaphore_signal(worker->done);
+    }
+}
+
+static void
+gs_lib_ctx_worker_free(gs_lib_ctx_worker_t *worker)
+{
+    gs_memory_t *mem = worker->pool->memory;
+
+    if (worker->thread != NULL) {
+        worker->quit = true;
+        gx_semaphore_signal(worker->start);
+        gp_thread_finish(worker->thread);
+    }
+    gx_semaphore_free(worker->start);
+    gx_semaphore_free(worker->done);
+    gs_free_object(mem, worker, "gs_lib_ctx_worker_free");
+}
+
+static gs_lib_ctx_worker_pool_t *
+gs_lib_ctx_worker_pool(const gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx;
+    gs_lib_ctx_worker_pool_t *pool;
+
+    if (mem == NULL || mem->gs_lib_ctx == NULL)
+        return NULL;
+    ctx = mem->gs_lib_ctx;
+    if (ctx->worker_pool != NULL)
+        return ctx->worker_pool;
+    pool = (gs_lib_ctx_worker_pool_t *)gs_alloc_bytes_immovable(ctx->memory,
+                                  sizeof(*pool), "gs_lib_ctx_worker_pool");
+    if (pool == NULL)
+        return NULL;
+    memset(pool, 0, sizeof(*pool));
+    pool->memory = ctx->memory;
+    pool->lock = gx_monitor_label(gx_monitor_alloc(ctx->memory), "worker_pool");
+    if (pool->lock == NULL) {
+        gs_free_object(ctx->memory, pool, "gs_lib_ctx_worker_pool");
+        return NULL;
+    }
+    ctx->worker_pool = pool;
+    return pool;
+}
+
+int
+gs_lib_ctx_set_num_worker_threads(const gs_memory_t *mem, int num)
+{
+    gs_lib_ctx_worker_pool_t *pool = gs_lib_ctx_worker_pool(mem);
+    gs_lib_ctx_worker_t *excess = NULL;
+
+    if (pool == NULL)
+        return_error(gs_error_VMerror);
+    if (num < 0)
+        num = 0;
+    gx_monitor_enter(pool->lock);
+    pool->size = num;
+    while (pool->num_idle > num) {
+        gs_lib_ctx_worker_t *worker = pool->idle;
+
+        pool->idle = worker->next;
+        pool->num_idle--;
+        worker->next = excess;
+        excess = worker;
+    }
+    gx_monitor_leave(pool->lock);
+    /* Don't hold the lock while we wait for the threads to exit */
+    while (excess != NULL) {
+        gs_lib_ctx_worker_t *next = excess->next;
+
+        gs_lib_ctx_worker_free(excess);
+        excess = next;
+    }
+    return 0;
+}
+
+int
+gs_lib_ctx_start_worker(const gs_memory_t *mem, void (*proc)(void *), void *arg,
+                        gs_lib_ctx_worker_t **pworker)
+{
+    gs_lib_ctx_worker_pool_t *pool = gs_lib_ctx_worker_pool(mem);
+    gs_lib_ctx_worker_t *worker;
+    int code;
+
+    *pworker = NULL;
+    if (pool == NULL)
+        return_error(gs_error_VMerror);
+    gx_monitor_enter(pool->lock);
+    worker = pool->idle;
+    if (worker != NULL) {
+        pool->idle = worker->next;
+        pool->num_idle--;
+    }
+    gx_monitor_leave(pool->lock);
+
+    if (worker == NULL) {
+        worker = (gs_lib_ctx_worker_t *)gs_alloc_bytes_immovable(pool->memory,
+                                  sizeof(*worker), "gs_lib_ctx_start_worker");
+        if (worker == NULL)
+            return_error(gs_error_VMerror);
+        memset(worker, 0, sizeof(*worker));
+        worker->pool = pool;
+        worker->start = gx_semaphore_label(gx_semaphore_alloc(pool->memory), "worker_start");
+        worker->done = gx_semaphore_label(gx_semaphore_alloc(pool->memory), "worker_done");
+        if (worker->start == NULL || worker->done == NULL) {
+            gs_lib_ctx_worker_free(worker);
+            return_error(gs_error_VMerror);
+        }
+        code = gp_thread_start(gs_lib_ctx_worker_main, worker, &worker->thread);
+        if (code < 0) {
+            worker->thread = NULL;
+            gs_lib_ctx_worker_free(worker);
+            return code;
+        }
+        gp_thread_label(worker->thread, "Worker");
+    }
+    worker->proc = proc;
+    worker->arg = arg;
+    worker->next = NULL;
+    gx_semaphore_signal(worker->start);
+    *pworker = worker;
+    return 0;
+}
+
+void
+gs_lib_ctx_finish_worker(gs_lib_ctx_worker_t *worker)
+{
+    gs_lib_ctx_worker_pool_t *pool;
+
+    if (worker == NULL)
+        return;
+    pool = worker->pool;
+    gx_semaphore_wait(worker->done);
+    gx_monitor_enter(pool->lock);
+    if (pool->num_idle < pool->size) {
+        worker->next = pool->idle;
+        pool->idle = worker;
+        pool->num_idle++;
+        worker = NULL;
+    }
+    gx_monitor_leave(pool->lock);
+    if (worker != NULL)
+        gs_lib_ctx_worker_free(worker);
+}
+
+static void
+gs_lib_ctx_worker_pool_fin(gs_lib_ctx_t *ctx)
+{
+    gs_lib_ctx_worker_pool_t *pool = ctx->worker_pool;
+
+    if (pool == NULL)
+        return;
+    /* All the workers are idle by now, or we'd still be rendering */
+    while (pool->idle != NULL) {
+        gs_lib_ctx_worker_t *next = pool->idle->next;
+
+        gs_lib_ctx_worker_free(pool->idle);
+        pool->idle = next;
+    }
+    gx_monitor_free(pool->lock);
+    gs_free_object(ctx->memory, pool, "gs_lib_ctx_worker_pool_fin");
+    ctx->worker_pool = NULL;
+}
+
+/* ------ Memory budget ------ */
+
+struct gs_lib_ctx_budget_client_s {
+    gs_lib_ctx_budget_t *budget;
+    const char *cname;
+    int priority;
+    bool thread_safe;
+    gs_lib_ctx_budget_evict_t evict;
+    void *data;
+    size_t used;		/* only written by the client, see set_used */
+    size_t pending;		/* bytes to give back at the next reserve */
+    uint pass;			/* last eviction pass that visited us */
+    gs_lib_ctx_budget_client_t *next;	/* in priority order */
+};
+
+struct gs_lib_ctx_budget_s {
+    gs_memory_t *memory;
+    gx_monitor_t *lock;
+    size_t limit;		/* 0 means no limit */
+    size_t fixed;		/* charged memory that can't be evicted */
+    uint pass;
+    gs_lib_ctx_budget_client_t *clients;
+};
+
+static gs_lib_ctx_budget_t *
+gs_lib_ctx_budget(const gs_memory_t *mem)
+{
+    gs_lib_ctx_core_t *core;
+    gs_lib_ctx_budget_t *budget;
+
+    if (mem == NULL || mem->gs_lib_ctx == NULL)
+        return NULL;
+    core = mem->gs_lib_ctx->core;
+    if (core->budget != NULL)
+        return core->budget;
+    gx_monitor_enter((gx_monitor_t *)core->monitor);
+    budget = core->budget;
+    if (budget == NULL) {
+        budget = (gs_lib_ctx_budget_t *)gs_alloc_bytes_immovable(core->memory,
+                                  sizeof(*budget), "gs_lib_ctx_budget");
+        if (budget != NULL) {
+            memset(budget, 0, sizeof(*budget));
+            budget->memory = core->memory;
+            budget->lock = gx_monitor_label(gx_monitor_alloc(core->memory),
+                                            "memory_budget");
+            if (budget->lock == NULL) {
+                gs_free_object(core->memory, budget, "gs_lib_ctx_budget");
+                budget = NULL;
+            }
+            core->budget = budget;
+        }
+    }
+    gx_monitor_leave((gx_monitor_t *)core->monitor);
+    return budget;
+}
+
+static void
+gs_lib_ctx_budget_fin(gs_lib_ctx_core_t *core)
+{
+    gs_lib_ctx_budget_t *budget = core->budget;
+
+    if (budget == NULL)
+        return;
+    /* Anything still registered is about to go away with the allocators. */
+    while (budget->clients != NULL) {
+        gs_lib_ctx_budget_client_t *next = budget->clients->next;
+
+        gs_free_object(budget->memory, budget->clients, "gs_lib_ctx_budget_fin");
+        budget->clients = next;
+    }
+    gx_monitor_free(budget->lock);
+    gs_free_object(budget->memory, budget, "gs_lib_ctx_budget_fin");
+    core->budget = NULL;
+}
+
+/* How far over the limit we would be after adding 'wanted' bytes.
+ * The total is only needed here, so rather than keep it up to date on
+ * every set_used we add up the clients' sizes each time.
+ * Called with the budget locked.
+ */
+static size_t
+budget_excess(const gs_lib_ctx_budget_t *budget, size_t wanted)
+{
+    const gs_lib_ctx_budget_client_t *client;
+    size_t total = budget->fixed + wanted;
+
+    if (budget->limit == 0)
+        return 0;
+    for (client = budget->clients; client != NULL; client = client->next)
+        total += client->used;
+    return (total <= budget->limit ? 0 : total - budget->limit);
+}
+
+/* Ask the clients, lowest priority number first, to give back enough
+ * memory to fit 'wanted' more bytes. The requester (if any) and thread
+ * safe clients are called directly; the others are left a request to
+ * pick up at their next reserve. Evicting can free objects whose own
+ * clients unregister, so we start again from the head of the list after
+ * each call, using 'pass' to visit each client only once.
+ * Called with the budget locked.
+ */
+static void
+budget_evict(gs_lib_ctx_budget_t *budget, gs_lib_ctx_budget_client_t *requester,
+             size_t wanted)
+{
+    uint pass = ++budget->pass;
+    size_t promised = 0;	/* by clients that will evict later */
+    gs_lib_ctx_budget_client_t *client = budget->clients;
+
+    while (client != NULL) {
+        size_t excess = budget_excess(budget, wanted);
+
+        if (excess <= promised)
+            break;
+        excess -= promised;
+        if (client->pass == pass || client->evict == NULL || client->used == 0) {
+            client->pass = pass;
+            client = client->next;
+            continue;
+        }
+        client->pass = pass;
+        if (client == requester || client->thread_safe) {
+            if_debug3m('a', budget->memory, "[a]budget: evicting %s, %"PRIdSIZE" of %"PRIdSIZE" bytes\n",
+                       client->cname, excess, client->used);
+            (*client->evict)(client->data, excess);
+            client = budget->clients;
+        } else {
+            if_debug2m('a', budget->memory, "[a]budget: asking %s for %"PRIdSIZE" bytes\n",
+                       client->cname, excess);
+            if (client->pending < excess)
+                client->pending = excess;
+            promised += min(excess, client->used);
+            client = client->next;
+        }
+    }
+}
+
+int
+gs_lib_ctx_set_memory_budget(const gs_memory_t *mem, size_t limit)
+{
+    gs_lib_ctx_budget_t *budget = gs_lib_ctx_budget(mem);
+
+    if (budget == NULL)
+        return_error(gs_error_VMerror);
+    gx_monitor_enter(budget->lock);
+    budget->limit = limit;
+    budget_evict(budget, NULL, 0);
+    gx_monitor_leave(budget->lock);
+    return 0;
+}
+
+size_t
+gs_lib_ctx_get_memory_budget(const gs_memory_t *mem)
+{
+    gs_lib_ctx_budget_t *budget = gs_lib_ctx_budget(mem);
+
+    return (budget == NULL ? 0 : budget->limit);
+}
+
+gs_lib_ctx_budget_client_t *
+gs_lib_ctx_budget_register(const gs_memory_t *mem, const char *cname,
+                           int priority, bool thread_safe,
+                           gs_lib_ctx_budget_evict_t evict, void *data)
+{
+    gs_lib_ctx_budget_t *budget = gs_lib_ctx_budget(mem);
+    gs_lib_ctx_budget_client_t *client, **pprev;
+
+    if (budget == NULL)
+        return NULL;
+    client = (gs_lib_ctx_budget_client_t *)gs_alloc_bytes_immovable(budget->memory,
+                                  sizeof(*client), "gs_lib_ctx_budget_register");
+    if (client == NULL)
+        return NULL;
+    memset(client, 0, sizeof(*client));
+    client->budget = budget;
+    client->cname = cname;
+    client->priority = priority;
+    client->thread_safe = thread_safe;
+    client->evict = evict;
+    client->data = data;
+    gx_monitor_enter(budget->lock);
+    for (pprev = &budget->clients; *pprev != NULL; pprev = &(*pprev)->next)
+        if ((*pprev)->priority > priority)
+            break;
+    client->next = *pprev;
+    *pprev = client;
+    gx_monitor_leave(budget->lock);
+    return client;
+}
+
+void
+gs_lib_ctx_budget_unregister(gs_lib_ctx_budget_client_t *client)
+{
+    gs_lib_ctx_budget_t *budget;
+    gs_lib_ctx_budget_client_t **pprev;
+
+    if (client == NULL)
+        return;
+    budget = client->budget;
+    gx_monitor_enter(budget->lock);
+    for (pprev = &budget->clients; *pprev != NULL; pprev = &(*pprev)->next)
+        if (*pprev == client) {
+            *pprev = client->next;
+            break;
+        }
+    gx_monitor_leave(budget->lock);
+    gs_free_object(budget->memory, client, "gs_lib_ctx_budget_unregister");
+}
+
+/* This is called on every add to and removal from a cache, so it doesn't
+ * take the lock: only the client writes its own size, and a reader adding
+ * up the sizes (budget_excess) seeing a stale value only makes that one
+ * check a little out.
+ */
+void
+gs_lib_ctx_budget_set_used(gs_lib_ctx_budget_client_t *client, size_t used)
+{
+    if (client == NULL)
+        return;
+    client->used = used;
+}
+
+bool
+gs_lib_ctx_budget_reserve(gs_lib_ctx_budget_client_t *client, size_t wanted)
+{
+    gs_lib_ctx_budget_t *budget;
+    bool ok;
+
+    if (client == NULL)
+        return true;
+    budget = client->budget;
+    if (budget->limit == 0 && client->pending == 0)
+        return true;
+    gx_monitor_enter(budget->lock);
+    if (client->pending != 0) {
+        size_t pending = client->pending;
+
+        /* Give back what we were asked for while we were busy. */
+        client->pending = 0;
+        if (client->evict != NULL && budget_excess(budget, 0) != 0)
+            (*client->evict)(client->data, pending);
+    }
+    if (budget_excess(budget, wanted) != 0)
+        budget_evict(budget, client, wanted);
+    ok = budget_excess(budget, wanted) == 0;
+    gx_monitor_leave(budget->lock);
+    return ok;
+}
+
+void
+gs_lib_ctx_budget_charge(const gs_memory_t *mem, size_t size)
+{
+    gs_lib_ctx_budget_t *budget = gs_lib_ctx_budget(mem);
+
+    if (budget == NULL)
+        return;
+    gx_monitor_enter(budget->lock);
+    budget->fixed += size;
+    if (budget_excess(budget, 0) != 0)
+        budget_evict(budget, NULL, 0);
+    gx_monitor_leave(budget->lock);
+}
+
+void
+gs_lib_ctx_budget_uncharge(const gs_memory_t *mem, size_t size)
+{
+    gs_lib_ctx_budget_t *budget = gs_lib_ctx_budget(mem);
+
+    if (budget == NULL)
+        return;
+    gx_monitor_enter(budget->lock);
+    if (size > budget->fixed)
+        size = budget->fixed;
+    budget->fixed -= size;
+    gx_monitor_leave(budget->lock);
+}
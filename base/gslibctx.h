@@ -29,6 +29,17 @@ typedef struct gs_gc_root_s *gs_gc_root_ptr;
 
 typedef struct gs_fapi_server_s gs_fapi_server;
 
+/* Persistent worker threads, see gs_lib_ctx_start_worker below */
+typedef struct gs_lib_ctx_worker_s gs_lib_ctx_worker_t;
+typedef struct gs_lib_ctx_worker_pool_s gs_lib_ctx_worker_pool_t;
+
+/* The memory budget shared by the caches, see gs_lib_ctx_set_memory_budget */
+typedef struct gs_lib_ctx_budget_s gs_lib_ctx_budget_t;
+typedef struct gs_lib_ctx_budget_client_s gs_lib_ctx_budget_client_t;
+
+/* The allocation profile, see gsmprof.h */
+typedef struct gs_memory_profile_s gs_memory_profile_t;
+
 /* A 'font directory' object (to avoid making fonts global). */
 /* 'directory' is something of a misnomer: this structure */
 /* just keeps track of the defined fonts, and the scaled font and */
@@ -137,6 +148,9 @@ typedef struct {
     int arg_max;
     int argc;
     char **argv;
+
+    gs_lib_ctx_budget_t *budget;  /* shared by the caches of all the clones */
+    gs_memory_profile_t *memory_profile;  /* NULL unless --memory-profile */
 } gs_lib_ctx_core_t;
 
 typedef struct gs_lib_ctx_s
@@ -181,6 +195,7 @@ typedef struct gs_lib_ctx_s
     char *default_device_list;
     int gcsignal;
     void *sjpxd_private; /* optional for use of jpx codec */
+    gs_lib_ctx_worker_pool_t *worker_pool; /* idle threads kept for reuse */
 } gs_lib_ctx_t;
 
 enum {
@@ -209,6 +224,55 @@ void *gs_lib_ctx_get_cms_context( const gs_memory_t *mem );
 void gs_lib_ctx_set_cms_context( const gs_memory_t *mem, void *cms_context );
 int gs_lib_ctx_get_act_on_uel( const gs_memory_t *mem );
 
+/* A pool of worker threads that persist across pages and jobs. Starting a
+ * worker runs 'proc(arg)' on a thread from the pool (creating one if none
+ * is idle); finishing waits for 'proc' to return, then gives the thread
+ * back to the pool, which keeps up to 'num' idle threads (as set by
+ * gs_lib_ctx_set_num_worker_threads) and ends any beyond that.
+ * These are used in the same way as gp_thread_start/gp_thread_finish.
+ */
+int gs_lib_ctx_set_num_worker_threads(const gs_memory_t *mem, int num);
+int gs_lib_ctx_start_worker(const gs_memory_t *mem, void (*proc)(void *), void *arg,
+                            gs_lib_ctx_worker_t **pworker);
+void gs_lib_ctx_finish_worker(gs_lib_ctx_worker_t *worker);
+
+/* A memory budget for the caches of a library instance (and any clones of
+ * it). The pattern, character and ICC link caches, and the interpreter's
+ * user path and form caches, register with it, giving a priority (lower numbers are
+ * asked to give memory back first) and a procedure that frees up to
+ * 'wanted' bytes of cached data and returns the number of bytes it freed.
+ * Clients report their size with set_used, and call reserve before
+ * growing; if that would take the total over the limit, the other clients
+ * are asked to shrink in priority order. Clients that are not thread safe
+ * are only ever asked to shrink from inside their own calls, so for those
+ * the request is remembered and carried out the next time they call
+ * reserve. reserve returns false if the budget is still
+ * exceeded, in which case the caller should avoid growing if it can.
+ * Memory that can't be given back (the clist buffers) is counted with
+ * charge/uncharge. A limit of 0 (the default) means no limit.
+ * A NULL client is accepted (and ignored) by all of these.
+ */
+typedef size_t (*gs_lib_ctx_budget_evict_t)(void *data, size_t wanted);
+
+enum {
+    GS_BUDGET_PRIORITY_PATTERN = 10,
+    GS_BUDGET_PRIORITY_FORM = 12,
+    GS_BUDGET_PRIORITY_UPATH = 15,
+    GS_BUDGET_PRIORITY_CHARS = 20,
+    GS_BUDGET_PRIORITY_ICC = 30
+};
+
+int gs_lib_ctx_set_memory_budget(const gs_memory_t *mem, size_t limit);
+size_t gs_lib_ctx_get_memory_budget(const gs_memory_t *mem);
+gs_lib_ctx_budget_client_t *gs_lib_ctx_budget_register(const gs_memory_t *mem,
+                                   const char *cname, int priority, bool thread_safe,
+                                   gs_lib_ctx_budget_evict_t evict, void *data);
+void gs_lib_ctx_budget_unregister(gs_lib_ctx_budget_client_t *client);
+void gs_lib_ctx_budget_set_used(gs_lib_ctx_budget_client_t *client, size_t used);
+bool gs_lib_ctx_budget_reserve(gs_lib_ctx_budget_client_t *client, size_t wanted);
+void gs_lib_ctx_budget_charge(const gs_memory_t *mem, size_t size);
+void gs_lib_ctx_budget_uncharge(const gs_memory_t *mem, size_t size);
+
 int gs_lib_ctx_register_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 void gs_lib_ctx_deregister_callout(gs_memory_t *mem, gs_callout_fn, void *arg);
 int gs_lib_ctx_callout(gs_memory_t *mem, const char *dev_name,
@@ -16,6 +16,7 @@
 
 /* C heap allocator */
 #include "malloc_.h"
+#include "memory_.h"
 #include "gdebug.h"
 #include "gserrors.h"
 #include "gstypes.h"
@@ -24,6 +25,7 @@
 #include "gsstruct.h"		/* for st_bytes */
 #include "gsmalloc.h"
 #include "gsmemret.h"		/* retrying wrapper */
+#include "gsmprof.h"
 
 /* ------ Heap allocator ------ */
 
@@ -105,6 +107,41 @@ struct gs_malloc_block_s {
 #undef _npad
 };
 
+/*
+ * Add a newly malloc'ed block to the list of allocated blocks, or take
+ * a block off it. The caller must hold the monitor.
+ */
+static void
+heap_link_block(gs_malloc_memory_t *mmem, gs_malloc_block_t *bp, size_t size,
+                client_name_t cname)
+{
+    if (mmem->allocated)
+        mmem->allocated->prev = bp;
+    bp->next = mmem->allocated;
+    bp->prev = 0;
+    bp->size = size;
+    bp->type = &st_bytes;
+    bp->cname = cname;
+    mmem->allocated = bp;
+    mmem->used += size + sizeof(gs_malloc_block_t);
+    if (mmem->used > mmem->max_used)
+        mmem->max_used = mmem->used;
+}
+static void
+heap_unlink_block(gs_malloc_memory_t *mmem, gs_malloc_block_t *bp)
+{
+    if (bp->prev)
+        bp->prev->next = bp->next;
+    if (bp->next)
+        bp->next->prev = bp->prev;
+    if (bp == mmem->allocated) {
+        mmem->allocated = bp->next;
+        if (mmem->allocated)
+            mmem->allocated->prev = NULL;
+    }
+    mmem->used -= bp->size + sizeof(gs_malloc_block_t);
+}
+
 /* Initialize a malloc allocator. */
 static long heap_available(void);
 gs_malloc_memory_t *
@@ -191,8 +228,6 @@ gs_heap_alloc_bytes(gs_memory_t * mem, size_t size, client_name_t cname)
         else if ((ptr = (byte *) Memento_label(malloc(added), cname)) == 0)
             set_msg("failed");
         else {
-            gs_malloc_block_t *bp = (gs_malloc_block_t *) ptr;
-
             /*
              * We would like to check that malloc aligns blocks at least as
              * strictly as the compiler (as defined by ARCH_ALIGN_MEMORY_MOD).
@@ -200,25 +235,17 @@ gs_heap_alloc_bytes(gs_memory_t * mem, size_t size, client_name_t cname)
              * See gsmemory.h for more explanation.
              */
             set_msg(ok_msg);
-            if (mmem->allocated)
-                mmem->allocated->prev = bp;
-            bp->next = mmem->allocated;
-            bp->prev = 0;
-            bp->size = size;
-            bp->type = &st_bytes;
-            bp->cname = cname;
-            mmem->allocated = bp;
-            ptr = (byte *) (bp + 1);
-            mmem->used += size + sizeof(gs_malloc_block_t);
-            if (mmem->used > mmem->max_used)
-                mmem->max_used = mmem->used;
+            heap_link_block(mmem, (gs_malloc_block_t *)ptr, size, cname);
+            ptr = (byte *) ((gs_malloc_block_t *)ptr + 1);
         }
     }
     if (mmem->monitor)
         gx_monitor_leave(mmem->monitor);	/* Done with exclusive access */
     /* We don't want to 'fill' under mutex to keep the window smaller */
-    if (ptr)
+    if (ptr) {
         gs_alloc_fill(ptr, gs_alloc_fill_alloc, size);
+        gs_memory_profile_alloc(mem, gs_memory_profile_heap, ptr, size, cname);
+    }
 #ifdef DEBUG
     if (gs_debug_c('a') || msg != ok_msg)
         dmlprintf6(mem, "[a+]gs_malloc(%s)(%"PRIuSIZE") = "PRI_INTPTR": %s, used=%"PRIuSIZE", max=%"PRIuSIZE"\n",
@@ -305,6 +332,9 @@ gs_heap_resize_object(gs_memory_t * mem, void *obj, size_t new_num_elements,
     if (new_size > old_size)
         gs_alloc_fill((byte *) new_ptr + old_size,
                       gs_alloc_fill_alloc, new_size - old_size);
+    gs_memory_profile_free(mem, obj);
+    gs_memory_profile_alloc(mem, gs_memory_profile_heap, new_ptr + 1,
+                            new_size - sizeof(gs_malloc_block_t), cname);
     return new_ptr + 1;
 }
 static size_t
@@ -330,6 +360,7 @@ gs_heap_free_object(gs_memory_t * mem, void *ptr, client_name_t cname)
                (ptr == 0 ? 0 : ((gs_malloc_block_t *) ptr)[-1].size));
     if (ptr == 0)
         return;
+    gs_memory_profile_free(mem, ptr);
     pstype = ((gs_malloc_block_t *) ptr)[-1].type;
     finalize = pstype->finalize;
     if (finalize != 0) {
@@ -348,16 +379,7 @@ gs_heap_free_object(gs_memory_t * mem, void *ptr, client_name_t cname)
      */
 #if 1
     bp = &((gs_malloc_block_t *)ptr)[-1];
-    if (bp->prev)
-        bp->prev->next = bp->next;
-    if (bp->next)
-        bp->next->prev = bp->prev;
-    if (bp == mmem->allocated) {
-        mmem->allocated = bp->next;
-        if (mmem->allocated)
-            mmem->allocated->prev = NULL;
-    }
-    mmem->used -= bp->size + sizeof(gs_malloc_block_t);
+    heap_unlink_block(mmem, bp);
     if (mmem->monitor)
         gx_monitor_leave(mmem->monitor);	/* Done with exclusive access */
     gs_alloc_fill(bp, gs_alloc_fill_free,
@@ -522,6 +544,377 @@ gs_heap_free_all(gs_memory_t * mem, uint free_mask, client_name_t cname)
         free(mem);
 }
 
+/* ------ Thread caching ------ */
+
+/*
+ * Blocks are cached in size classes that are a quarter of a power of 2
+ * apart (32, 40, 48, 56, 64, 80, ...), so that a block is never more than
+ * 25% larger than the request it serves. Requests larger than the largest
+ * class go straight to the heap.
+ */
+#define THREAD_CACHE_MIN_LOG2 5
+#define THREAD_CACHE_MAX_LOG2 20
+#define THREAD_CACHE_NUM_CLASSES\
+  ((THREAD_CACHE_MAX_LOG2 - THREAD_CACHE_MIN_LOG2) * 4 + 1)
+#define THREAD_CACHE_CLASS_SIZE(c)\
+  ((size_t)(4 + ((c) & 3)) << (THREAD_CACHE_MIN_LOG2 + ((c) >> 2) - 2))
+
+/* The most a cache will hold before it gives blocks back to the heap. */
+#ifndef THREAD_CACHE_LIMIT
+#  define THREAD_CACHE_LIMIT (4 * 1024 * 1024)
+#endif
+
+/* Memento wants to see every block, so doesn't get a cache. */
+#ifdef MEMENTO
+#  define THREAD_CACHE_ENABLED 0
+#else
+#  define THREAD_CACHE_ENABLED 1
+#endif
+
+/* Empty small classes are refilled several blocks at a time. */
+#define THREAD_CACHE_BATCH_BYTES 8192
+#define THREAD_CACHE_MAX_BATCH 16
+
+/*
+ * The blocks in the free lists are ordinary heap blocks, still on the
+ * heap's list of allocated blocks, and are linked through their first
+ * word. Since the smallest class is 32 bytes there is always room.
+ */
+typedef struct gs_malloc_thread_cache_s {
+    gs_memory_common;
+    gs_malloc_memory_t *heap;
+    void *free_list[THREAD_CACHE_NUM_CLASSES];
+    size_t cached;		/* total size of the blocks in the free lists */
+    size_t limit;
+    ulong hits, misses, returns;
+} gs_malloc_thread_cache_t;
+
+static gs_memory_proc_alloc_bytes(thread_cache_alloc_bytes);
+static gs_memory_proc_resize_object(thread_cache_resize_object);
+static gs_memory_proc_free_object(thread_cache_free_object);
+static gs_memory_proc_stable(thread_cache_stable);
+static gs_memory_proc_status(thread_cache_status);
+static gs_memory_proc_free_all(thread_cache_free_all);
+static gs_memory_proc_alloc_struct(thread_cache_alloc_struct);
+static gs_memory_proc_alloc_byte_array(thread_cache_alloc_byte_array);
+static gs_memory_proc_alloc_struct_array(thread_cache_alloc_struct_array);
+static gs_memory_proc_resize_string(thread_cache_resize_string);
+static gs_memory_proc_free_string(thread_cache_free_string);
+static gs_memory_proc_enable_free(thread_cache_enable_free);
+static const gs_memory_procs_t thread_cache_procs =
+{
+    /* Raw memory procedures */
+    thread_cache_alloc_bytes,
+    thread_cache_resize_object,
+    thread_cache_free_object,
+    thread_cache_stable,
+    thread_cache_status,
+    thread_cache_free_all,
+    gs_ignore_consolidate_free,
+    /* Object memory procedures */
+    thread_cache_alloc_bytes,
+    thread_cache_alloc_struct,
+    thread_cache_alloc_struct,
+    thread_cache_alloc_byte_array,
+    thread_cache_alloc_byte_array,
+    thread_cache_alloc_struct_array,
+    thread_cache_alloc_struct_array,
+    gs_heap_object_size,
+    gs_heap_object_type,
+    thread_cache_alloc_bytes,
+    thread_cache_alloc_bytes,
+    thread_cache_resize_string,
+    thread_cache_free_string,
+    gs_heap_register_root,
+    gs_heap_unregister_root,
+    thread_cache_enable_free,
+    gs_heap_set_object_type,
+    gs_heap_defer_frees
+};
+
+/*
+ * Find the size class for a size: the smallest class that will hold it
+ * when allocating, or the largest class it will hold when freeing.
+ * Returns -1 if the size is not cached.
+ */
+static int
+thread_cache_class(size_t size, bool round_up)
+{
+    int log2 = THREAD_CACHE_MIN_LOG2;
+    int c;
+
+    if (size < THREAD_CACHE_CLASS_SIZE(0))
+        return (round_up ? 0 : -1);
+    if (size > THREAD_CACHE_CLASS_SIZE(THREAD_CACHE_NUM_CLASSES - 1))
+        return -1;
+    while ((size >> log2) > 1)
+        log2++;
+    c = (log2 - THREAD_CACHE_MIN_LOG2) * 4 +
+        (int)((size - ((size_t)1 << log2)) >> (log2 - 2));
+    if (round_up && THREAD_CACHE_CLASS_SIZE(c) < size)
+        c++;
+    return c;
+}
+
+/* Get a batch of blocks for an empty class, taking the heap's lock once. */
+static void
+thread_cache_refill(gs_malloc_thread_cache_t *tmem, int c, client_name_t cname)
+{
+    gs_malloc_memory_t *mmem = tmem->heap;
+    size_t size = THREAD_CACHE_CLASS_SIZE(c);
+    size_t added = size + sizeof(gs_malloc_block_t);
+    int n = THREAD_CACHE_BATCH_BYTES / size;
+
+    if (n < 1)
+        n = 1;
+    else if (n > THREAD_CACHE_MAX_BATCH)
+        n = THREAD_CACHE_MAX_BATCH;
+    if (mmem->monitor)
+        gx_monitor_enter(mmem->monitor);	/* Exclusive access */
+    for (; n > 0; n--) {
+        gs_malloc_block_t *bp;
+
+        if (added > mmem->limit || mmem->limit - added < mmem->used)
+            break;
+        bp = (gs_malloc_block_t *)Memento_label(malloc(added), cname);
+        if (bp == NULL)
+            break;
+        heap_link_block(mmem, bp, size, cname);
+        *(void **)(bp + 1) = tmem->free_list[c];
+        tmem->free_list[c] = bp + 1;
+        tmem->cached += size;
+    }
+    if (mmem->monitor)
+        gx_monitor_leave(mmem->monitor);	/* Done with exclusive access */
+}
+
+/*
+ * Give cached blocks back to the heap, largest first, until no more than
+ * 'target' bytes are cached. The blocks are taken off the heap's list
+ * under a single lock, and then freed outside it.
+ */
+static void
+thread_cache_trim(gs_malloc_thread_cache_t *tmem, size_t target)
+{
+    gs_malloc_memory_t *mmem = tmem->heap;
+    void *batch = NULL;
+    void *ptr;
+    int c;
+
+    if (mmem->monitor)
+        gx_monitor_enter(mmem->monitor);	/* Exclusive access */
+    for (c = THREAD_CACHE_NUM_CLASSES - 1; c >= 0 && tmem->cached > target; c--) {
+        while ((ptr = tmem->free_list[c]) != NULL && tmem->cached > target) {
+            gs_malloc_block_t *bp = (gs_malloc_block_t *)ptr - 1;
+
+            tmem->free_list[c] = *(void **)ptr;
+            tmem->cached -= bp->size;
+            heap_unlink_block(mmem, bp);
+            *(void **)ptr = batch;
+            batch = ptr;
+        }
+    }
+    if (mmem->monitor)
+        gx_monitor_leave(mmem->monitor);	/* Done with exclusive access */
+    while ((ptr = batch) != NULL) {
+        batch = *(void **)ptr;
+        free((gs_malloc_block_t *)ptr - 1);
+    }
+    tmem->returns++;
+}
+
+static byte *
+thread_cache_alloc_bytes(gs_memory_t * mem, size_t size, client_name_t cname)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+    int c = thread_cache_class(size, true);
+    gs_malloc_block_t *bp;
+    byte *ptr;
+
+    if (c < 0)
+        return gs_heap_alloc_bytes((gs_memory_t *)tmem->heap, size, cname);
+    if (tmem->free_list[c] != NULL)
+        tmem->hits++;
+    else {
+        tmem->misses++;
+        thread_cache_refill(tmem, c, cname);
+        if (tmem->free_list[c] == NULL)
+            return NULL;
+    }
+    ptr = tmem->free_list[c];
+    tmem->free_list[c] = *(void **)ptr;
+    bp = (gs_malloc_block_t *)ptr - 1;
+    tmem->cached -= bp->size;
+    bp->type = &st_bytes;
+    bp->cname = cname;
+    gs_alloc_fill(ptr, gs_alloc_fill_alloc, bp->size);
+    gs_memory_profile_alloc(mem, gs_memory_profile_heap, ptr, size, cname);
+    return ptr;
+}
+static void *
+thread_cache_alloc_struct(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
+                          client_name_t cname)
+{
+    void *ptr =
+    thread_cache_alloc_bytes(mem, gs_struct_type_size(pstype), cname);
+
+    if (ptr == 0)
+        return 0;
+    ((gs_malloc_block_t *) ptr)[-1].type = pstype;
+    return ptr;
+}
+static byte *
+thread_cache_alloc_byte_array(gs_memory_t * mem, size_t num_elements,
+                              size_t elt_size, client_name_t cname)
+{
+    size_t lsize = (size_t) num_elements * elt_size;
+
+    if (elt_size != 0 && lsize/elt_size != num_elements)
+        return 0;
+    return thread_cache_alloc_bytes(mem, (size_t) lsize, cname);
+}
+static void *
+thread_cache_alloc_struct_array(gs_memory_t * mem, size_t num_elements,
+                                gs_memory_type_ptr_t pstype, client_name_t cname)
+{
+    void *ptr =
+    thread_cache_alloc_byte_array(mem, num_elements,
+                                  gs_struct_type_size(pstype), cname);
+
+    if (ptr == 0)
+        return 0;
+    ((gs_malloc_block_t *) ptr)[-1].type = pstype;
+    return ptr;
+}
+static void *
+thread_cache_resize_object(gs_memory_t * mem, void *obj, size_t new_num_elements,
+                           client_name_t cname)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+
+    return gs_heap_resize_object((gs_memory_t *)tmem->heap, obj,
+                                 new_num_elements, cname);
+}
+static byte *
+thread_cache_resize_string(gs_memory_t * mem, byte * data, size_t old_num,
+                           size_t new_num, client_name_t cname)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+
+    return gs_heap_resize_string((gs_memory_t *)tmem->heap, data, old_num,
+                                 new_num, cname);
+}
+static void
+thread_cache_free_object(gs_memory_t * mem, void *ptr, client_name_t cname)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+    gs_malloc_block_t *bp;
+    struct_proc_finalize((*finalize));
+    int c;
+
+    if (ptr == 0)
+        return;
+    bp = (gs_malloc_block_t *)ptr - 1;
+    c = thread_cache_class(bp->size, false);
+    if (c < 0) {
+        gs_heap_free_object((gs_memory_t *)tmem->heap, ptr, cname);
+        return;
+    }
+    gs_memory_profile_free(mem, ptr);
+    finalize = bp->type->finalize;
+    if (finalize != 0) {
+        if_debug3m('u', mem, "[u]finalizing %s "PRI_INTPTR" (%s)\n",
+                   struct_type_name_string(bp->type),
+                   (intptr_t)ptr, client_name_string(cname));
+        (*finalize) (mem, ptr);
+    }
+    gs_alloc_fill(ptr, gs_alloc_fill_free, bp->size);
+    *(void **)ptr = tmem->free_list[c];
+    tmem->free_list[c] = ptr;
+    tmem->cached += bp->size;
+    if (tmem->cached > tmem->limit)
+        thread_cache_trim(tmem, tmem->limit >> 1);
+}
+static void
+thread_cache_free_string(gs_memory_t * mem, byte * data, size_t nbytes,
+                         client_name_t cname)
+{
+    thread_cache_free_object(mem, data, cname);
+}
+static gs_memory_t *
+thread_cache_stable(gs_memory_t *mem)
+{
+    return mem;
+}
+static void
+thread_cache_status(gs_memory_t * mem, gs_memory_status_t * pstat)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+
+    gs_heap_status((gs_memory_t *)tmem->heap, pstat);
+    pstat->is_thread_safe = false;	/* only the owning thread may use it */
+}
+static void
+thread_cache_enable_free(gs_memory_t * mem, bool enable)
+{
+    if (enable)
+        mem->procs.free_object = thread_cache_free_object,
+            mem->procs.free_string = thread_cache_free_string;
+    else
+        mem->procs.free_object = gs_ignore_free_object,
+            mem->procs.free_string = gs_ignore_free_string;
+}
+static void
+thread_cache_free_all(gs_memory_t * mem, uint free_mask, client_name_t cname)
+{
+    gs_malloc_thread_cache_t *tmem = (gs_malloc_thread_cache_t *)mem;
+
+    if_debug4m('a', mem, "[a]thread cache "PRI_INTPTR": %lu hits, %lu misses, %lu returns\n",
+               (intptr_t)tmem, tmem->hits, tmem->misses, tmem->returns);
+    if (free_mask & FREE_ALL_DATA)
+        thread_cache_trim(tmem, 0);
+    if (free_mask & FREE_ALL_ALLOCATOR)
+        gs_heap_free_object((gs_memory_t *)tmem->heap, tmem, cname);
+}
+
+/* Create a thread cache in front of a heap allocator. */
+int
+gs_malloc_thread_cache_wrap(gs_memory_t **wrapped, gs_memory_t *target)
+{
+    gs_malloc_thread_cache_t *tmem;
+
+    if (!THREAD_CACHE_ENABLED || target->procs.status != gs_heap_status) {
+        *wrapped = target;
+        return 0;
+    }
+    tmem = (gs_malloc_thread_cache_t *)
+        gs_heap_alloc_bytes(target, sizeof(gs_malloc_thread_cache_t),
+                            "gs_malloc_thread_cache_wrap");
+    if (tmem == NULL) {
+        *wrapped = NULL;
+        return_error(gs_error_VMerror);
+    }
+    memset(tmem, 0, sizeof(gs_malloc_thread_cache_t));
+    tmem->stable_memory = (gs_memory_t *)tmem;	/* we are stable */
+    tmem->procs = thread_cache_procs;
+    tmem->gs_lib_ctx = target->gs_lib_ctx;
+    tmem->non_gc_memory = (gs_memory_t *)tmem;	/* and are not subject to GC */
+    tmem->thread_safe_memory = target;		/* but we aren't thread safe */
+    tmem->heap = (gs_malloc_memory_t *)target;
+    tmem->limit = THREAD_CACHE_LIMIT;
+    *wrapped = (gs_memory_t *)tmem;
+    return 0;
+}
+
+/* Release a thread cache, if 'mem' is one. */
+void
+gs_malloc_thread_cache_release(gs_memory_t *mem)
+{
+    if (mem == NULL || mem->procs.status != thread_cache_status)
+        return;
+    gs_memory_free_all(mem, FREE_ALL_EVERYTHING, "gs_malloc_thread_cache_release");
+}
+
 /* ------ Wrapping ------ */
 
 /* Create the retrying and the locked wrapper for the heap allocator. */
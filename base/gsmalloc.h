@@ -68,4 +68,23 @@ gs_malloc_memory_t *gs_malloc_wrapped_contents(gs_memory_t *wrapped);
 /* Free the wrapper, and return the wrapped contents. */
 gs_malloc_memory_t *gs_malloc_unwrap(gs_memory_t *wrapped);
 
+/* ---------------- Thread caching ---------------- */
+
+/*
+ * A thread cache is an allocator, owned by a single thread, that sits in
+ * front of the (locked) heap allocator. Blocks that are freed into it are
+ * kept in free lists by size class and reused without taking the heap's
+ * lock; when it holds too much, a batch of blocks goes back to the heap
+ * under a single lock. The cache itself is NOT thread safe: like a chunk
+ * allocator, it must only be used by one thread at a time.
+ *
+ * If the target is not the heap allocator, no cache is created and
+ * *wrapped is set to the target, which gs_malloc_thread_cache_release
+ * will then leave alone.
+ */
+int gs_malloc_thread_cache_wrap(gs_memory_t **wrapped, gs_memory_t *target);
+
+/* Return all the cached blocks to the heap and free the cache. */
+void gs_malloc_thread_cache_release(gs_memory_t *mem);
+
 #endif /* gsmalloc_INCLUDED */
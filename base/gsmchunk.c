@@ -32,6 +32,7 @@
 #include "malloc_.h" /* For MEMENTO */
 #include "assert_.h"
 #include "gsmdebug.h"
+#include "gsmprof.h"
 
 /* Enable DEBUG_CHUNK to check the validity of the heap at every turn */
 #undef DEBUG_CHUNK
@@ -161,12 +162,38 @@ typedef struct chunk_slab_s {
     struct chunk_slab_s *next;
 } chunk_slab_t;
 
+/*
+ * Freed blocks up to CHUNK_SMALL_MAX bytes don't go into the free trees.
+ * Instead they go onto segregated free lists, one for each block size, so
+ * that a later request that needs a block of the same size (typically for
+ * an object of the same type) gets one in constant time without touching
+ * the trees. The blocks are only put in the trees, and so merged with
+ * their neighbours, when the trees can't satisfy a request without a new
+ * slab. Block sizes are all multiples of obj_align_mod.
+ */
+#define CHUNK_SMALL_MAX 512
+#define CHUNK_SMALL_CLASSES ((CHUNK_SMALL_MAX >> log2_obj_align_mod) + 1)
+
+typedef struct chunk_small_node_s {
+    struct chunk_small_node_s *next;
+} chunk_small_node_t;
+
+typedef struct chunk_small_class_s {
+    chunk_small_node_t *free;   /* free list for this block size */
+    uint count;                 /* number of blocks on the list */
+    ulong hits;                 /* allocations from the list */
+    ulong misses;               /* allocations from the trees */
+    ulong frees;                /* blocks freed onto the list */
+} chunk_small_class_t;
+
 typedef struct gs_memory_chunk_s {
     gs_memory_common;           /* interface outside world sees */
     gs_memory_t *target;        /* base allocator */
     chunk_slab_t *slabs;         /* list of slabs for freeing */
     chunk_free_node_t *free_size;/* free tree */
     chunk_free_node_t *free_loc; /* free tree */
+    chunk_small_class_t small[CHUNK_SMALL_CLASSES]; /* small block free lists */
+    unsigned long small_free;   /* total size of the blocks on the lists */
     chunk_obj_node_t *defer_finalize_list;
     chunk_obj_node_t *defer_free_list;
     unsigned long used;
@@ -208,6 +235,8 @@ gs_memory_chunk_wrap(gs_memory_t **wrapped,      /* chunk allocator init */
     cmem->slabs = NULL;
     cmem->free_size = NULL;
     cmem->free_loc = NULL;
+    memset(cmem->small, 0, sizeof(cmem->small));
+    cmem->small_free = 0;
     cmem->used = 0;
     cmem->max_used = 0;
     cmem->total_free = 0;
@@ -262,6 +291,28 @@ gs_memory_chunk_target(const gs_memory_t *mem)
     return cmem->target;
 }
 
+/* Print the use of the small block free lists, for each block size */
+void
+gs_memory_chunk_dump_classes(const gs_memory_t *mem)
+{
+    const gs_memory_chunk_t *cmem = (const gs_memory_chunk_t *)mem;
+    int i;
+
+    if (mem->procs.status != chunk_status)
+        return;
+    dmlprintf2(cmem->target, "%% Chunk "PRI_INTPTR" small blocks (%lu bytes free):\n",
+               (intptr_t)cmem, cmem->small_free);
+    dmlprintf(cmem->target, "%%    size       hits     misses      frees  on list\n");
+    for (i = 0; i < CHUNK_SMALL_CLASSES; i++) {
+        const chunk_small_class_t *sc = &cmem->small[i];
+
+        if (sc->hits == 0 && sc->misses == 0 && sc->frees == 0)
+            continue;
+        dmlprintf5(cmem->target, "%%  %6u %10lu %10lu %10lu %8u\n",
+                   i << log2_obj_align_mod, sc->hits, sc->misses, sc->frees, sc->count);
+    }
+}
+
 /* -------- Private members --------- */
 
 /* Note that all of the data is 'immovable' and is opaque to the base allocator */
@@ -275,6 +326,7 @@ chunk_mem_node_free_all_slabs(gs_memory_chunk_t *cmem)
 {
     chunk_slab_t *slab, *next;
     gs_memory_t *const target = cmem->target;
+    int i;
 
     for (slab = cmem->slabs; slab != NULL; slab = next) {
         next = slab->next;
@@ -284,6 +336,11 @@ chunk_mem_node_free_all_slabs(gs_memory_chunk_t *cmem)
     cmem->slabs = NULL;
     cmem->free_size = NULL;
     cmem->free_loc = NULL;
+    for (i = 0; i < CHUNK_SMALL_CLASSES; i++) {
+        cmem->small[i].free = NULL;
+        cmem->small[i].count = 0;
+    }
+    cmem->small_free = 0;
     cmem->total_free = 0;
     cmem->used = 0;
 }
@@ -401,9 +458,9 @@ gs_memory_chunk_dump_memory(const gs_memory_t *mem)
         dmlprintf2(cmem->target, "Tree mismatch! %d vs %d\n", count1, count2);
         crash();
     }
-    if (total != cmem->total_free) {
+    if (total != cmem->total_free - cmem->small_free) {
         void (*crash)(void) = NULL;
-        dmlprintf2(cmem->target, "Free size mismatch! %u vs %lu\n", total, cmem->total_free);
+        dmlprintf2(cmem->target, "Free size mismatch! %u vs %lu\n", total, cmem->total_free - cmem->small_free);
         crash();
     }
 }
@@ -753,358 +810,129 @@ static void remove_free(gs_memory_chunk_t *cmem, chunk_free_node_t *node)
 #define SINGLE_OBJECT_CHUNK(size) ((size) > (CHUNK_SIZE>>1))
 #endif
 
-/* All of the allocation routines reduce to this function */
-static byte *
-chunk_obj_alloc(gs_memory_t *mem, uint size, gs_memory_type_ptr_t type, client_name_t cname)
+/* Find the smallest free block that is large enough. Returns the parent
+ * pointer to the block we pick, or NULL if there is none. */
+static chunk_free_node_t **
+chunk_find_free(gs_memory_chunk_t *cmem, uint newsize)
 {
-    gs_memory_chunk_t  *cmem = (gs_memory_chunk_t *)mem;
     chunk_free_node_t **ap, **okp;
     chunk_free_node_t  *a, *b, *c;
-    uint newsize;
-    chunk_obj_node_t *obj = NULL;
-
-    newsize = round_up_to_align(size + SIZEOF_ROUND_ALIGN(chunk_obj_node_t));	/* space we will need */
-    /* When we free this block it might have to go in free - so it had
-     * better be large enough to accommodate a complete free node! */
-    if (newsize < SIZEOF_ROUND_ALIGN(chunk_free_node_t))
-        newsize = SIZEOF_ROUND_ALIGN(chunk_free_node_t);
-    /* Protect against overflow */
-    if (newsize < size)
-        return NULL;
 
-#ifdef DEBUG_SEQ
-    cmem->sequence++;
-#endif
-
-#ifdef DEBUG_CHUNK_PRINT
-#ifdef DEBUG_SEQ
-    dmlprintf4(cmem->target, "Event %x: malloc(chunk="PRI_INTPTR", size=%x, cname=%s)\n",
-               cmem->sequence, (intptr_t)cmem, newsize, cname);
-#else
-    dmlprintf3(cmem->target, "malloc(chunk="PRI_INTPTR", size=%x, cname=%s)\n",
-               (intptr_t)cmem, newsize, cname);
-#endif
-#endif
-
-    /* Large blocks are allocated directly */
-    if (SINGLE_OBJECT_CHUNK(newsize)) {
-        obj = (chunk_obj_node_t *)gs_alloc_bytes_immovable(cmem->target, newsize, cname);
-        if (obj == NULL)
-            return NULL;
-    } else {
-        /* Find the smallest free block that's large enough */
-        /* okp points to the parent pointer to the block we pick */
-        ap = &cmem->free_size;
-        okp = NULL;
-        while ((a = *ap) != NULL) {
-            if (a->size >= newsize) {
-                b = a->left_size;
-                if (b == NULL) {
-                    okp = ap; /* a will do */
-                    break; /* Stop searching */
+    ap = &cmem->free_size;
+    okp = NULL;
+    while ((a = *ap) != NULL) {
+        if (a->size >= newsize) {
+            b = a->left_size;
+            if (b == NULL) {
+                okp = ap; /* a will do */
+                break; /* Stop searching */
+            }
+            if (b->size >= newsize) {
+                c = b->left_size;
+                if (c == NULL) {
+                    okp = &a->left_size; /* b is as good as we're going to get */
+                    break;
                 }
-                if (b->size >= newsize) {
-                    c = b->left_size;
-                    if (c == NULL) {
-                        okp = &a->left_size; /* b is as good as we're going to get */
-                        break;
-                    }
-                    /* Splay:        a             c
-                     *            b     Z   =>  W     b
-                     *          c   Y               X   a
-                     *         W X                     Y Z
-                     */
-                    *ap = c;
-                    a->left_size  = b->right_size;
-                    b->left_size  = c->right_size;
-                    b->right_size = a;
-                    c->right_size = b;
-                    if (c->size >= newsize) {
-                        okp = ap; /* c is the best so far */
-                        ap = &c->left_size;
-                    } else {
-                        okp = &c->right_size; /* b is the best so far */
-                        ap = &b->left_size;
-                    }
+                /* Splay:        a             c
+                 *            b     Z   =>  W     b
+                 *          c   Y               X   a
+                 *         W X                     Y Z
+                 */
+                *ap = c;
+                a->left_size  = b->right_size;
+                b->left_size  = c->right_size;
+                b->right_size = a;
+                c->right_size = b;
+                if (c->size >= newsize) {
+                    okp = ap; /* c is the best so far */
+                    ap = &c->left_size;
                 } else {
-                    c = b->right_size;
-                    if (c == NULL) {
-                        okp = ap; /* a is as good as we are going to get */
-                        break;
-                    }
-                    /* Splay:         a             c
-                     *            b       Z  =>   b   a
-                     *          W   c            W X Y Z
-                     *             X Y
-                     */
-                    *ap = c;
-                    a->left_size  = c->right_size;
-                    b->right_size = c->left_size;
-                    c->left_size  = b;
-                    c->right_size = a;
-                    if (c->size >= newsize) {
-                        okp = ap; /* c is the best so far */
-                        ap = &b->right_size;
-                    } else {
-                        okp = &c->right_size; /* a is the best so far */
-                        ap = &a->left_size;
-                    }
+                    okp = &c->right_size; /* b is the best so far */
+                    ap = &b->left_size;
                 }
             } else {
-                b = a->right_size;
-                if (b == NULL)
-                    break; /* No better match to be found */
-                if (b->size >= newsize) {
-                    c = b->left_size;
-                    if (c == NULL) {
-                        okp = &a->right_size; /* b is as good as we're going to get */
-                        break;
-                    }
-                    /* Splay:      a                c
-                     *         W       b    =>    a   b
-                     *               c   Z       W X Y Z
-                     *              X Y
-                     */
-                    *ap = c;
-                    a->right_size = c->left_size;
-                    b->left_size  = c->right_size;
-                    c->left_size  = a;
-                    c->right_size = b;
-                    if (c->size >= newsize) {
-                        okp = ap; /* c is the best so far */
-                        ap = &a->right_size;
-                    } else {
-                        okp = &c->right_size; /* b is the best so far */
-                        ap = &b->left_size;
-                    }
+                c = b->right_size;
+                if (c == NULL) {
+                    okp = ap; /* a is as good as we are going to get */
+                    break;
+                }
+                /* Splay:         a             c
+                 *            b       Z  =>   b   a
+                 *          W   c            W X Y Z
+                 *             X Y
+                 */
+                *ap = c;
+                a->left_size  = c->right_size;
+                b->right_size = c->left_size;
+                c->left_size  = b;
+                c->right_size = a;
+                if (c->size >= newsize) {
+                    okp = ap; /* c is the best so far */
+                    ap = &b->right_size;
                 } else {
-                    c = b->right_size;
-                    if (c == NULL)
-                        break; /* No better match to be found */
-                    /* Splay:    a                   c
-                     *        W     b      =>     b     Z
-                     *            X   c         a   Y
-                     *               Y Z       W X
-                     */
-                    *ap = c;
-                    a->right_size = b->left_size;
-                    b->right_size = c->left_size;
-                    b->left_size  = a;
-                    c->left_size  = b;
-                    if (c->size >= newsize) {
-                        okp = ap; /* c is the best so far */
-                        ap = &b->right_size;
-                    } else
-                        ap = &c->right_size;
+                    okp = &c->right_size; /* a is the best so far */
+                    ap = &a->left_size;
                 }
             }
-        }
-
-        /* So *okp points to the most appropriate free tree entry. */
-
-        if (okp == NULL) {
-            /* No appropriate free space slot. We need to allocate a new slab. */
-            chunk_slab_t *slab;
-            uint slab_size = newsize + SIZEOF_ROUND_ALIGN(chunk_slab_t);
-            if (slab_size <= (CHUNK_SIZE>>1))
-                slab_size = CHUNK_SIZE;
-            slab = (chunk_slab_t *)gs_alloc_bytes_immovable(cmem->target, slab_size, cname);
-            if (slab == NULL)
-                return NULL;
-            slab->next = cmem->slabs;
-            cmem->slabs = slab;
-
-            obj = (chunk_obj_node_t *)(((byte *)slab) + SIZEOF_ROUND_ALIGN(chunk_slab_t));
-            if (slab_size != newsize + SIZEOF_ROUND_ALIGN(chunk_slab_t)) {
-                insert_free(cmem, (chunk_free_node_t *)(((byte *)obj)+newsize), slab_size - newsize - SIZEOF_ROUND_ALIGN(chunk_slab_t));
-                cmem->total_free += slab_size - newsize - SIZEOF_ROUND_ALIGN(chunk_slab_t);
-            }
         } else {
-            chunk_free_node_t *ok = *okp;
-            obj = (chunk_obj_node_t *)(void *)ok;
-            if (ok->size >= newsize + SIZEOF_ROUND_ALIGN(chunk_free_node_t)) {
-                chunk_free_node_t *tail = (chunk_free_node_t *)(((byte *)ok) + newsize);
-                uint tail_size = ok->size - newsize;
-                remove_free_size_fast(cmem, okp);
-                remove_free_loc(cmem, ok);
-                insert_free(cmem, tail, tail_size);
+            b = a->right_size;
+            if (b == NULL)
+                break; /* No better match to be found */
+            if (b->size >= newsize) {
+                c = b->left_size;
+                if (c == NULL) {
+                    okp = &a->right_size; /* b is as good as we're going to get */
+                    break;
+                }
+                /* Splay:      a                c
+                 *         W       b    =>    a   b
+                 *               c   Z       W X Y Z
+                 *              X Y
+                 */
+                *ap = c;
+                a->right_size = c->left_size;
+                b->left_size  = c->right_size;
+                c->left_size  = a;
+                c->right_size = b;
+                if (c->size >= newsize) {
+                    okp = ap; /* c is the best so far */
+                    ap = &a->right_size;
+                } else {
+                    okp = &c->right_size; /* b is the best so far */
+                    ap = &b->left_size;
+                }
             } else {
-                newsize = ok->size;
-                remove_free_size_fast(cmem, okp);
-                remove_free_loc(cmem, ok);
+                c = b->right_size;
+                if (c == NULL)
+                    break; /* No better match to be found */
+                /* Splay:    a                   c
+                 *        W     b      =>     b     Z
+                 *            X   c         a   Y
+                 *               Y Z       W X
+                 */
+                *ap = c;
+                a->right_size = b->left_size;
+                b->right_size = c->left_size;
+                b->left_size  = a;
+                c->left_size  = b;
+                if (c->size >= newsize) {
+                    okp = ap; /* c is the best so far */
+                    ap = &b->right_size;
+                } else
+                    ap = &c->right_size;
             }
-            cmem->total_free -= newsize;
         }
     }
 
-    if (gs_alloc_debug) {
-        memset((byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t), 0xa1, newsize - SIZEOF_ROUND_ALIGN(chunk_obj_node_t));
-        memset((byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t), 0xac, size);
-    }
-
-    obj->size = newsize; /* actual size */
-    obj->padding = newsize - size; /* actual size - client requested size */
-    obj->type = type;    /* and client desired type */
-    obj->defer_next = NULL;
-
-#ifdef DEBUG_SEQ
-    obj->sequence = cmem->sequence;
-#endif
-    if (gs_debug_c('A'))
-        dmlprintf3(mem, "[a+]chunk_obj_alloc (%s)(%u) = "PRI_INTPTR": OK.\n",
-                   client_name_string(cname), size, (intptr_t) obj);
-#ifdef DEBUG_CHUNK_PRINT
-#ifdef DEBUG_SEQ
-    dmlprintf5(cmem->target, "Event %x: malloced(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
-               obj->sequence, (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
-#else
-    dmlprintf4(cmem->target, "malloced(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
-               (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
-#endif
-#endif
-#ifdef DEBUG_CHUNK
-    gs_memory_chunk_dump_memory(cmem);
-#endif
-
-    return (byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t);
-}
-
-static byte *
-chunk_alloc_bytes_immovable(gs_memory_t * mem, size_t size, client_name_t cname)
-{
-    return chunk_obj_alloc(mem, size, &st_bytes, cname);
-}
-
-static byte *
-chunk_alloc_bytes(gs_memory_t * mem, size_t size, client_name_t cname)
-{
-    return chunk_obj_alloc(mem, size, &st_bytes, cname);
-}
-
-static void *
-chunk_alloc_struct_immovable(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
-                             client_name_t cname)
-{
-    return chunk_obj_alloc(mem, pstype->ssize, pstype, cname);
-}
-
-static void *
-chunk_alloc_struct(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
-                   client_name_t cname)
-{
-    return chunk_obj_alloc(mem, pstype->ssize, pstype, cname);
-}
-
-static byte *
-chunk_alloc_byte_array_immovable(gs_memory_t * mem, size_t num_elements,
-                                 size_t elt_size, client_name_t cname)
-{
-    return chunk_alloc_bytes(mem, num_elements * elt_size, cname);
-}
-
-static byte *
-chunk_alloc_byte_array(gs_memory_t * mem, size_t num_elements, size_t elt_size,
-                   client_name_t cname)
-{
-    return chunk_alloc_bytes(mem, num_elements * elt_size, cname);
-}
-
-static void *
-chunk_alloc_struct_array_immovable(gs_memory_t * mem, size_t num_elements,
-                                   gs_memory_type_ptr_t pstype, client_name_t cname)
-{
-    return chunk_obj_alloc(mem, num_elements * pstype->ssize, pstype, cname);
-}
-
-static void *
-chunk_alloc_struct_array(gs_memory_t * mem, size_t num_elements,
-                         gs_memory_type_ptr_t pstype, client_name_t cname)
-{
-    return chunk_obj_alloc(mem, num_elements * pstype->ssize, pstype, cname);
+    return okp;
 }
 
-static void *
-chunk_resize_object(gs_memory_t * mem, void *ptr, size_t new_num_elements, client_name_t cname)
+/* Put a free block into the free trees, merging it with its neighbours */
+static void
+chunk_free_to_tree(gs_memory_chunk_t *cmem, chunk_obj_node_t *obj)
 {
-    void *new_ptr = NULL;
-
-    if (ptr != NULL) {
-        /* This isn't particularly efficient, but it is rarely used */
-        chunk_obj_node_t *obj = (chunk_obj_node_t *)(((byte *)ptr) - SIZEOF_ROUND_ALIGN(chunk_obj_node_t));
-        size_t new_size = (obj->type->ssize * new_num_elements);
-        size_t old_size = obj->size - obj->padding;
-        /* get the type from the old object */
-        gs_memory_type_ptr_t type = obj->type;
-        gs_memory_chunk_t *cmem = (gs_memory_chunk_t *)mem;
-        size_t save_max_used = cmem->max_used;
-
-        if (new_size == old_size)
-            return ptr;
-        if ((new_ptr = chunk_obj_alloc(mem, new_size, type, cname)) == 0)
-            return NULL;
-        memcpy(new_ptr, ptr, min(old_size, new_size));
-        chunk_free_object(mem, ptr, cname);
-        cmem->max_used = save_max_used;
-        if (cmem->used > cmem->max_used)
-            cmem->max_used = cmem->used;
-    }
-
-    return new_ptr;
-}
-
-static void
-chunk_free_object(gs_memory_t *mem, void *ptr, client_name_t cname)
-{
-    gs_memory_chunk_t * const cmem = (gs_memory_chunk_t *)mem;
-    size_t obj_node_size;
-    chunk_obj_node_t *obj;
-    struct_proc_finalize((*finalize));
-    chunk_free_node_t **ap, **gtp, **ltp;
-    chunk_free_node_t *a, *b, *c;
-
-    if (ptr == NULL)
-        return;
-
-    /* back up to obj header */
-    obj_node_size = SIZEOF_ROUND_ALIGN(chunk_obj_node_t);
-    obj = (chunk_obj_node_t *)(((byte *)ptr) - obj_node_size);
-
-    if (cmem->deferring) {
-        if (obj->defer_next == NULL) {
-            obj->defer_next = cmem->defer_finalize_list;
-            cmem->defer_finalize_list = obj;
-        }
-        return;
-    }
-
-#ifdef DEBUG_CHUNK_PRINT
-#ifdef DEBUG_SEQ
-    cmem->sequence++;
-    dmlprintf6(cmem->target, "Event %x: free(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, num=%x, cname=%s)\n",
-               cmem->sequence, (intptr_t)cmem, (intptr_t)obj, obj->size, obj->sequence, cname);
-#else
-    dmlprintf4(cmem->target, "free(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
-               (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
-#endif
-#endif
-
-    if (obj->type) {
-        finalize = obj->type->finalize;
-        if (finalize != NULL)
-            finalize(mem, ptr);
-    }
-    /* finalize may change the head_**_chunk doing free of stuff */
-
-    if_debug3m('A', cmem->target, "[a-]chunk_free_object(%s) "PRI_INTPTR"(%u)\n",
-               client_name_string(cname), (intptr_t)ptr, obj->size);
-
-    if (SINGLE_OBJECT_CHUNK(obj->size - obj->padding)) {
-        gs_free_object(cmem->target, obj, "chunk_free_object(single object)");
-#ifdef DEBUG_CHUNK
-        gs_memory_chunk_dump_memory(cmem);
-#endif
-        return;
-    }
+    chunk_free_node_t **ap, **gtp, **ltp;
+    chunk_free_node_t *a, *b, *c;
 
     /* We want to find where to insert this free entry into our free tree. We need to know
      * both the point to the left of it, and the point to the right of it, in order to see
@@ -1299,6 +1127,313 @@ chunk_free_object(gs_memory_t *mem, void *ptr, client_name_t cname)
         if (gs_alloc_debug)
             memset(((byte *)objfree) + SIZEOF_ROUND_ALIGN(chunk_free_node_t), 0x9b, objfree->size - SIZEOF_ROUND_ALIGN(chunk_free_node_t));
     }
+}
+
+/* Move all the blocks on the small block free lists into the free trees */
+static void
+chunk_flush_small_free(gs_memory_chunk_t *cmem)
+{
+    int i;
+
+    for (i = 0; i < CHUNK_SMALL_CLASSES; i++) {
+        chunk_small_class_t *sc = &cmem->small[i];
+        uint size = i << log2_obj_align_mod;
+
+        while (sc->free != NULL) {
+            chunk_obj_node_t *obj = (chunk_obj_node_t *)(void *)sc->free;
+
+            sc->free = sc->free->next;
+            obj->size = size;
+            cmem->total_free -= size;   /* chunk_free_to_tree adds it back */
+            chunk_free_to_tree(cmem, obj);
+        }
+        sc->count = 0;
+    }
+    cmem->small_free = 0;
+}
+
+/* All of the allocation routines reduce to this function */
+static byte *
+chunk_obj_alloc(gs_memory_t *mem, uint size, gs_memory_type_ptr_t type, client_name_t cname)
+{
+    gs_memory_chunk_t  *cmem = (gs_memory_chunk_t *)mem;
+    chunk_free_node_t **okp;
+    chunk_small_class_t *sc = NULL;
+    uint newsize;
+    chunk_obj_node_t *obj = NULL;
+
+    newsize = round_up_to_align(size + SIZEOF_ROUND_ALIGN(chunk_obj_node_t));	/* space we will need */
+    /* When we free this block it might have to go in free - so it had
+     * better be large enough to accommodate a complete free node! */
+    if (newsize < SIZEOF_ROUND_ALIGN(chunk_free_node_t))
+        newsize = SIZEOF_ROUND_ALIGN(chunk_free_node_t);
+    /* Protect against overflow */
+    if (newsize < size)
+        return NULL;
+
+#ifdef DEBUG_SEQ
+    cmem->sequence++;
+#endif
+
+#ifdef DEBUG_CHUNK_PRINT
+#ifdef DEBUG_SEQ
+    dmlprintf4(cmem->target, "Event %x: malloc(chunk="PRI_INTPTR", size=%x, cname=%s)\n",
+               cmem->sequence, (intptr_t)cmem, newsize, cname);
+#else
+    dmlprintf3(cmem->target, "malloc(chunk="PRI_INTPTR", size=%x, cname=%s)\n",
+               (intptr_t)cmem, newsize, cname);
+#endif
+#endif
+
+    /* Large blocks are allocated directly */
+    if (SINGLE_OBJECT_CHUNK(newsize)) {
+        obj = (chunk_obj_node_t *)gs_alloc_bytes_immovable(cmem->target, newsize, cname);
+        if (obj == NULL)
+            return NULL;
+    } else if (newsize <= CHUNK_SMALL_MAX &&
+               (sc = &cmem->small[newsize >> log2_obj_align_mod])->free != NULL) {
+        /* Fast path: reuse a small block of exactly this size */
+        obj = (chunk_obj_node_t *)(void *)sc->free;
+        sc->free = sc->free->next;
+        sc->count--;
+        sc->hits++;
+        cmem->small_free -= newsize;
+        cmem->total_free -= newsize;
+    } else {
+        if (sc != NULL)
+            sc->misses++;
+        okp = chunk_find_free(cmem, newsize);
+        if (okp == NULL && cmem->small_free != 0) {
+            /* Rather than take a new slab, give the trees the small blocks */
+            chunk_flush_small_free(cmem);
+            okp = chunk_find_free(cmem, newsize);
+        }
+
+        /* So *okp points to the most appropriate free tree entry. */
+
+        if (okp == NULL) {
+            /* No appropriate free space slot. We need to allocate a new slab. */
+            chunk_slab_t *slab;
+            uint slab_size = newsize + SIZEOF_ROUND_ALIGN(chunk_slab_t);
+            if (slab_size <= (CHUNK_SIZE>>1))
+                slab_size = CHUNK_SIZE;
+            slab = (chunk_slab_t *)gs_alloc_bytes_immovable(cmem->target, slab_size, cname);
+            if (slab == NULL)
+                return NULL;
+            slab->next = cmem->slabs;
+            cmem->slabs = slab;
+
+            obj = (chunk_obj_node_t *)(((byte *)slab) + SIZEOF_ROUND_ALIGN(chunk_slab_t));
+            if (slab_size != newsize + SIZEOF_ROUND_ALIGN(chunk_slab_t)) {
+                insert_free(cmem, (chunk_free_node_t *)(((byte *)obj)+newsize), slab_size - newsize - SIZEOF_ROUND_ALIGN(chunk_slab_t));
+                cmem->total_free += slab_size - newsize - SIZEOF_ROUND_ALIGN(chunk_slab_t);
+            }
+        } else {
+            chunk_free_node_t *ok = *okp;
+            obj = (chunk_obj_node_t *)(void *)ok;
+            if (ok->size >= newsize + SIZEOF_ROUND_ALIGN(chunk_free_node_t)) {
+                chunk_free_node_t *tail = (chunk_free_node_t *)(((byte *)ok) + newsize);
+                uint tail_size = ok->size - newsize;
+                remove_free_size_fast(cmem, okp);
+                remove_free_loc(cmem, ok);
+                insert_free(cmem, tail, tail_size);
+            } else {
+                newsize = ok->size;
+                remove_free_size_fast(cmem, okp);
+                remove_free_loc(cmem, ok);
+            }
+            cmem->total_free -= newsize;
+        }
+    }
+
+    if (gs_alloc_debug) {
+        memset((byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t), 0xa1, newsize - SIZEOF_ROUND_ALIGN(chunk_obj_node_t));
+        memset((byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t), 0xac, size);
+    }
+
+    obj->size = newsize; /* actual size */
+    obj->padding = newsize - size; /* actual size - client requested size */
+    obj->type = type;    /* and client desired type */
+    obj->defer_next = NULL;
+
+#ifdef DEBUG_SEQ
+    obj->sequence = cmem->sequence;
+#endif
+    if (gs_debug_c('A'))
+        dmlprintf3(mem, "[a+]chunk_obj_alloc (%s)(%u) = "PRI_INTPTR": OK.\n",
+                   client_name_string(cname), size, (intptr_t) obj);
+#ifdef DEBUG_CHUNK_PRINT
+#ifdef DEBUG_SEQ
+    dmlprintf5(cmem->target, "Event %x: malloced(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
+               obj->sequence, (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
+#else
+    dmlprintf4(cmem->target, "malloced(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
+               (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
+#endif
+#endif
+#ifdef DEBUG_CHUNK
+    gs_memory_chunk_dump_memory(cmem);
+#endif
+    /* Single object chunks are already in the profile, as the target's. */
+    if (!SINGLE_OBJECT_CHUNK(obj->size - obj->padding))
+        gs_memory_profile_alloc(mem, gs_memory_profile_chunk,
+                                (byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t),
+                                size, cname);
+
+    return (byte *)(obj) + SIZEOF_ROUND_ALIGN(chunk_obj_node_t);
+}
+
+static byte *
+chunk_alloc_bytes_immovable(gs_memory_t * mem, size_t size, client_name_t cname)
+{
+    return chunk_obj_alloc(mem, size, &st_bytes, cname);
+}
+
+static byte *
+chunk_alloc_bytes(gs_memory_t * mem, size_t size, client_name_t cname)
+{
+    return chunk_obj_alloc(mem, size, &st_bytes, cname);
+}
+
+static void *
+chunk_alloc_struct_immovable(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
+                             client_name_t cname)
+{
+    return chunk_obj_alloc(mem, pstype->ssize, pstype, cname);
+}
+
+static void *
+chunk_alloc_struct(gs_memory_t * mem, gs_memory_type_ptr_t pstype,
+                   client_name_t cname)
+{
+    return chunk_obj_alloc(mem, pstype->ssize, pstype, cname);
+}
+
+static byte *
+chunk_alloc_byte_array_immovable(gs_memory_t * mem, size_t num_elements,
+                                 size_t elt_size, client_name_t cname)
+{
+    return chunk_alloc_bytes(mem, num_elements * elt_size, cname);
+}
+
+static byte *
+chunk_alloc_byte_array(gs_memory_t * mem, size_t num_elements, size_t elt_size,
+                   client_name_t cname)
+{
+    return chunk_alloc_bytes(mem, num_elements * elt_size, cname);
+}
+
+static void *
+chunk_alloc_struct_array_immovable(gs_memory_t * mem, size_t num_elements,
+                                   gs_memory_type_ptr_t pstype, client_name_t cname)
+{
+    return chunk_obj_alloc(mem, num_elements * pstype->ssize, pstype, cname);
+}
+
+static void *
+chunk_alloc_struct_array(gs_memory_t * mem, size_t num_elements,
+                         gs_memory_type_ptr_t pstype, client_name_t cname)
+{
+    return chunk_obj_alloc(mem, num_elements * pstype->ssize, pstype, cname);
+}
+
+static void *
+chunk_resize_object(gs_memory_t * mem, void *ptr, size_t new_num_elements, client_name_t cname)
+{
+    void *new_ptr = NULL;
+
+    if (ptr != NULL) {
+        /* This isn't particularly efficient, but it is rarely used */
+        chunk_obj_node_t *obj = (chunk_obj_node_t *)(((byte *)ptr) - SIZEOF_ROUND_ALIGN(chunk_obj_node_t));
+        size_t new_size = (obj->type->ssize * new_num_elements);
+        size_t old_size = obj->size - obj->padding;
+        /* get the type from the old object */
+        gs_memory_type_ptr_t type = obj->type;
+        gs_memory_chunk_t *cmem = (gs_memory_chunk_t *)mem;
+        size_t save_max_used = cmem->max_used;
+
+        if (new_size == old_size)
+            return ptr;
+        if ((new_ptr = chunk_obj_alloc(mem, new_size, type, cname)) == 0)
+            return NULL;
+        memcpy(new_ptr, ptr, min(old_size, new_size));
+        chunk_free_object(mem, ptr, cname);
+        cmem->max_used = save_max_used;
+        if (cmem->used > cmem->max_used)
+            cmem->max_used = cmem->used;
+    }
+
+    return new_ptr;
+}
+
+static void
+chunk_free_object(gs_memory_t *mem, void *ptr, client_name_t cname)
+{
+    gs_memory_chunk_t * const cmem = (gs_memory_chunk_t *)mem;
+    size_t obj_node_size;
+    chunk_obj_node_t *obj;
+    struct_proc_finalize((*finalize));
+
+    if (ptr == NULL)
+        return;
+
+    /* back up to obj header */
+    obj_node_size = SIZEOF_ROUND_ALIGN(chunk_obj_node_t);
+    obj = (chunk_obj_node_t *)(((byte *)ptr) - obj_node_size);
+
+    if (cmem->deferring) {
+        if (obj->defer_next == NULL) {
+            obj->defer_next = cmem->defer_finalize_list;
+            cmem->defer_finalize_list = obj;
+        }
+        return;
+    }
+    gs_memory_profile_free(mem, ptr);
+
+#ifdef DEBUG_CHUNK_PRINT
+#ifdef DEBUG_SEQ
+    cmem->sequence++;
+    dmlprintf6(cmem->target, "Event %x: free(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, num=%x, cname=%s)\n",
+               cmem->sequence, (intptr_t)cmem, (intptr_t)obj, obj->size, obj->sequence, cname);
+#else
+    dmlprintf4(cmem->target, "free(chunk="PRI_INTPTR", addr="PRI_INTPTR", size=%x, cname=%s)\n",
+               (intptr_t)cmem, (intptr_t)obj, obj->size, cname);
+#endif
+#endif
+
+    if (obj->type) {
+        finalize = obj->type->finalize;
+        if (finalize != NULL)
+            finalize(mem, ptr);
+    }
+    /* finalize may change the head_**_chunk doing free of stuff */
+
+    if_debug3m('A', cmem->target, "[a-]chunk_free_object(%s) "PRI_INTPTR"(%u)\n",
+               client_name_string(cname), (intptr_t)ptr, obj->size);
+
+    if (SINGLE_OBJECT_CHUNK(obj->size - obj->padding)) {
+        gs_free_object(cmem->target, obj, "chunk_free_object(single object)");
+#ifdef DEBUG_CHUNK
+        gs_memory_chunk_dump_memory(cmem);
+#endif
+        return;
+    }
+
+    if (obj->size <= CHUNK_SMALL_MAX) {
+        chunk_small_class_t *sc = &cmem->small[obj->size >> log2_obj_align_mod];
+        chunk_small_node_t *node = (chunk_small_node_t *)(void *)obj;
+        uint size = obj->size;
+
+        if (gs_alloc_debug)
+            memset(((byte *)obj) + sizeof(chunk_small_node_t), 0x9c, size - sizeof(chunk_small_node_t));
+        node->next = sc->free;
+        sc->free = node;
+        sc->count++;
+        sc->frees++;
+        cmem->small_free += size;
+        cmem->total_free += size;
+    } else
+        chunk_free_to_tree(cmem, obj);
 
 #ifdef DEBUG_CHUNK
     gs_memory_chunk_dump_memory(cmem);
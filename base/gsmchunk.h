@@ -45,6 +45,9 @@ gs_memory_chunk_unwrap(gs_memory_t *mem);
 /* Retrieve this allocator's target */
 gs_memory_t *gs_memory_chunk_target(const gs_memory_t *cmem);
 
+/* Print the allocation statistics for the small block sizes */
+void gs_memory_chunk_dump_classes(const gs_memory_t *cmem);
+
 #ifdef DEBUG
     void gs_memory_chunk_dump_memory(const gs_memory_t *mem);
 #endif /* DEBUG */
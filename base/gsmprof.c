@@ -0,0 +1,379 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Allocation profile by client name */
+
+#include "malloc_.h"
+#include "memory_.h"
+#include "stdint_.h"
+#include "gx.h"
+#include "gserrors.h"
+#include "gsmprof.h"
+#include "gxsync.h"
+
+/*
+ * The profile's own tables are malloc'ed directly, since allocating them
+ * from any of the profiled allocators would recurse.  Everything is
+ * protected by one lock, as the heap and chunk allocators are used from
+ * the rendering threads.
+ */
+
+/* Lifetime buckets: fewer than 16, 256, 4K, 64K, 1M allocations, more. */
+#define MPROF_LIFETIME_BUCKETS 6
+
+typedef struct mprof_site_s {
+    client_name_t cname;
+    gs_memory_profile_kind_t kind;
+    int64_t count;		/* allocations */
+    int64_t frees;
+    size_t bytes;		/* allocated in total */
+    size_t live;
+    size_t peak;		/* of live */
+    int64_t lifetimes[MPROF_LIFETIME_BUCKETS];
+} mprof_site_t;
+
+typedef struct mprof_object_s {
+    const void *ptr;		/* 0 if the slot is empty */
+    size_t size;
+    int64_t birth;		/* value of the clock when allocated */
+    uint site;
+} mprof_object_t;
+
+typedef struct mprof_kind_s {
+    int64_t count;
+    size_t bytes;
+    size_t live;
+    size_t peak;
+} mprof_kind_t;
+
+struct gs_memory_profile_s {
+    gx_monitor_t *lock;
+    int64_t clock;		/* allocations so far */
+    bool lost;			/* ran out of memory for the tables */
+    mprof_kind_t kinds[gs_memory_profile_num_kinds];
+    /* The sites, with an open hash on (cname, kind) holding index + 1. */
+    mprof_site_t *sites;
+    uint num_sites;
+    uint *site_hash;
+    uint site_mask;
+    /* The live objects, in an open hash on the pointer. */
+    mprof_object_t *objects;
+    size_t num_objects;
+    size_t object_mask;
+};
+
+#define MPROF_NO_SITE max_uint
+
+static const char *const mprof_kind_names[gs_memory_profile_num_kinds] = {
+    "heap", "chunk", "gc"
+};
+
+static inline uint
+mprof_site_hash(client_name_t cname, gs_memory_profile_kind_t kind)
+{
+    uintptr_t v = (uintptr_t)cname >> 2;
+
+    return (uint)((v ^ (v >> 16)) * 2654435761u) + (uint)kind;
+}
+
+static inline size_t
+mprof_object_hash(const void *ptr)
+{
+    uintptr_t v = (uintptr_t)ptr >> 4;
+
+    return (size_t)((v ^ (v >> 16)) * 2654435761u);
+}
+
+/* Find or add the site for (cname, kind). */
+static uint
+mprof_site(gs_memory_profile_t *prof, client_name_t cname,
+           gs_memory_profile_kind_t kind)
+{
+    uint i, s;
+
+    if (prof->site_hash != NULL) {
+        for (i = mprof_site_hash(cname, kind) & prof->site_mask;
+             (s = prof->site_hash[i]) != 0; i = (i + 1) & prof->site_mask)
+            if (prof->sites[s - 1].cname == cname && prof->sites[s - 1].kind == kind)
+                return s - 1;
+    }
+    /* Keep the hash at most half full; the sites array is the same size. */
+    if (prof->site_hash == NULL || (prof->num_sites + 1) * 2 > prof->site_mask + 1) {
+        uint new_size = (prof->site_hash == NULL ? 256 : (prof->site_mask + 1) * 2);
+        uint *new_hash = (uint *)calloc(new_size, sizeof(uint));
+        mprof_site_t *new_sites = (mprof_site_t *)realloc(prof->sites,
+                                                new_size / 2 * sizeof(mprof_site_t));
+
+        if (new_sites != NULL)
+            prof->sites = new_sites;
+        if (new_hash == NULL || new_sites == NULL) {
+            free(new_hash);
+            prof->lost = true;
+            return MPROF_NO_SITE;
+        }
+        free(prof->site_hash);
+        prof->site_hash = new_hash;
+        prof->site_mask = new_size - 1;
+        for (s = 0; s < prof->num_sites; s++) {
+            for (i = mprof_site_hash(prof->sites[s].cname, prof->sites[s].kind) &
+                     prof->site_mask;
+                 prof->site_hash[i] != 0; i = (i + 1) & prof->site_mask)
+                DO_NOTHING;
+            prof->site_hash[i] = s + 1;
+        }
+        for (i = mprof_site_hash(cname, kind) & prof->site_mask;
+             prof->site_hash[i] != 0; i = (i + 1) & prof->site_mask)
+            DO_NOTHING;
+    }
+    s = prof->num_sites++;
+    memset(&prof->sites[s], 0, sizeof(prof->sites[s]));
+    prof->sites[s].cname = cname;
+    prof->sites[s].kind = kind;
+    prof->site_hash[i] = s + 1;
+    return s;
+}
+
+/* Find the slot for a pointer, which is empty if it isn't there. */
+static mprof_object_t *
+mprof_object_slot(gs_memory_profile_t *prof, const void *ptr)
+{
+    size_t i;
+
+    for (i = mprof_object_hash(ptr) & prof->object_mask;
+         prof->objects[i].ptr != 0 && prof->objects[i].ptr != ptr;
+         i = (i + 1) & prof->object_mask)
+        DO_NOTHING;
+    return &prof->objects[i];
+}
+
+/* Make room for one more object, keeping the table at most half full. */
+static bool
+mprof_grow_objects(gs_memory_profile_t *prof)
+{
+    size_t old_size = (prof->objects == NULL ? 0 : prof->object_mask + 1);
+    size_t new_size = (old_size == 0 ? 4096 : old_size * 2);
+    mprof_object_t *old_objects = prof->objects;
+    size_t i;
+
+    if ((prof->num_objects + 1) * 2 <= old_size)
+        return true;
+    prof->objects = (mprof_object_t *)calloc(new_size, sizeof(mprof_object_t));
+    if (prof->objects == NULL) {
+        prof->objects = old_objects;
+        prof->lost = true;
+        return false;
+    }
+    prof->object_mask = new_size - 1;
+    for (i = 0; i < old_size; i++)
+        if (old_objects[i].ptr != 0)
+            *mprof_object_slot(prof, old_objects[i].ptr) = old_objects[i];
+    free(old_objects);
+    return true;
+}
+
+/* Account for the death of an object. */
+static void
+mprof_died(gs_memory_profile_t *prof, const mprof_object_t *obj)
+{
+    mprof_site_t *site = &prof->sites[obj->site];
+    int64_t age = prof->clock - obj->birth;
+    int b;
+
+    for (b = 0; b < MPROF_LIFETIME_BUCKETS - 1 && age >= 16; b++)
+        age >>= 4;
+    site->lifetimes[b]++;
+    site->frees++;
+    site->live -= obj->size;
+    prof->kinds[site->kind].live -= obj->size;
+}
+
+/* Remove an object from the table, moving up any that collided with it. */
+static void
+mprof_remove_object(gs_memory_profile_t *prof, mprof_object_t *obj)
+{
+    size_t mask = prof->object_mask;
+    size_t i = obj - prof->objects, j = i, k;
+
+    for (;;) {
+        prof->objects[i].ptr = 0;
+        do {
+            j = (j + 1) & mask;
+            if (prof->objects[j].ptr == 0) {
+                prof->num_objects--;
+                return;
+            }
+            k = mprof_object_hash(prof->objects[j].ptr) & mask;
+        } while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+        prof->objects[i] = prof->objects[j];
+        i = j;
+    }
+}
+
+void
+gs_memory_profile_note_alloc(const gs_memory_t *mem,
+                             gs_memory_profile_kind_t kind,
+                             const void *ptr, size_t size,
+                             client_name_t cname)
+{
+    gs_memory_profile_t *prof = mem->gs_lib_ctx->core->memory_profile;
+    mprof_kind_t *pk = &prof->kinds[kind];
+    mprof_site_t *site;
+    uint s;
+
+    gx_monitor_enter(prof->lock);
+    prof->clock++;
+    pk->count++;
+    pk->bytes += size;
+    s = mprof_site(prof, cname, kind);
+    if (s == MPROF_NO_SITE)
+        goto out;
+    site = &prof->sites[s];
+    site->count++;
+    site->bytes += size;
+    if (kind != gs_memory_profile_gc && ptr != NULL && mprof_grow_objects(prof)) {
+        mprof_object_t *obj = mprof_object_slot(prof, ptr);
+
+        if (obj->ptr != 0)
+            /* Freed without our hearing about it, e.g. by free_all. */
+            mprof_died(prof, obj);
+        else
+            prof->num_objects++;
+        obj->ptr = ptr;
+        obj->size = size;
+        obj->birth = prof->clock;
+        obj->site = s;
+        site->live += size;
+        if (site->live > site->peak)
+            site->peak = site->live;
+        pk->live += size;
+        if (pk->live > pk->peak)
+            pk->peak = pk->live;
+    }
+out:
+    gx_monitor_leave(prof->lock);
+}
+
+void
+gs_memory_profile_note_free(const gs_memory_t *mem, const void *ptr)
+{
+    gs_memory_profile_t *prof = mem->gs_lib_ctx->core->memory_profile;
+    mprof_object_t *obj;
+
+    if (ptr == NULL)
+        return;
+    gx_monitor_enter(prof->lock);
+    if (prof->objects != NULL) {
+        obj = mprof_object_slot(prof, ptr);
+        /* Objects allocated before profiling started aren't there. */
+        if (obj->ptr != 0) {
+            mprof_died(prof, obj);
+            mprof_remove_object(prof, obj);
+        }
+    }
+    gx_monitor_leave(prof->lock);
+}
+
+int
+gs_memory_profile_enable(gs_memory_t *mem)
+{
+    gs_lib_ctx_core_t *core;
+    gs_memory_profile_t *prof;
+
+    if (mem == NULL || mem->gs_lib_ctx == NULL)
+        return_error(gs_error_unregistered);
+    core = mem->gs_lib_ctx->core;
+    if (core->memory_profile != NULL)
+        return 0;
+    prof = (gs_memory_profile_t *)malloc(sizeof(*prof));
+    if (prof == NULL)
+        return_error(gs_error_VMerror);
+    memset(prof, 0, sizeof(*prof));
+    prof->lock = gx_monitor_label(gx_monitor_alloc(core->memory), "memory_profile");
+    if (prof->lock == NULL) {
+        free(prof);
+        return_error(gs_error_VMerror);
+    }
+    core->memory_profile = prof;
+    return 0;
+}
+
+/* Sort the sites by bytes allocated, most first. */
+static int
+mprof_compare_sites(const void *a, const void *b)
+{
+    const mprof_site_t *sa = (const mprof_site_t *)a;
+    const mprof_site_t *sb = (const mprof_site_t *)b;
+
+    return (sa->bytes < sb->bytes ? 1 : sa->bytes > sb->bytes ? -1 : 0);
+}
+
+static void
+mprof_print(gs_memory_profile_t *prof, const gs_memory_t *mem)
+{
+    int k, b;
+    uint s;
+
+    errprintf(mem, "Allocation profile (lifetimes in allocations):\n");
+    for (k = 0; k < gs_memory_profile_num_kinds; k++) {
+        const mprof_kind_t *pk = &prof->kinds[k];
+
+        errprintf(mem, "  %-5s %12"PRId64" allocations %14"PRIuSIZE" bytes",
+                  mprof_kind_names[k], pk->count, pk->bytes);
+        if (k != gs_memory_profile_gc)
+            errprintf(mem, ", peak live %"PRIuSIZE", at end %"PRIuSIZE,
+                      pk->peak, pk->live);
+        errprintf(mem, "\n");
+    }
+    if (prof->lost)
+        errprintf(mem, "  (incomplete: out of memory for the profile)\n");
+    errprintf(mem, "  %-5s %12s %14s %12s %12s %9s %9s %9s %9s %9s %9s  %s\n",
+              "kind", "allocs", "bytes", "peak live", "at end",
+              "<16", "<256", "<4K", "<64K", "<1M", "more", "client");
+    qsort(prof->sites, prof->num_sites, sizeof(mprof_site_t), mprof_compare_sites);
+    for (s = 0; s < prof->num_sites; s++) {
+        const mprof_site_t *site = &prof->sites[s];
+
+        errprintf(mem, "  %-5s %12"PRId64" %14"PRIuSIZE, mprof_kind_names[site->kind],
+                  site->count, site->bytes);
+        if (site->kind == gs_memory_profile_gc)
+            errprintf(mem, " %12s %12s %9s %9s %9s %9s %9s %9s", "-", "-",
+                      "-", "-", "-", "-", "-", "-");
+        else {
+            errprintf(mem, " %12"PRIuSIZE" %12"PRIuSIZE, site->peak, site->live);
+            for (b = 0; b < MPROF_LIFETIME_BUCKETS; b++)
+                errprintf(mem, " %9"PRId64, site->lifetimes[b]);
+        }
+        errprintf(mem, "  %s\n", (site->cname == NULL ? "(unnamed)" :
+                                   client_name_string(site->cname)));
+    }
+}
+
+void
+gs_memory_profile_fin(gs_lib_ctx_core_t *core)
+{
+    gs_memory_profile_t *prof = core->memory_profile;
+
+    if (prof == NULL)
+        return;
+    /* Stop profiling first: freeing the lock goes through the heap. */
+    core->memory_profile = NULL;
+    mprof_print(prof, core->memory);
+    gx_monitor_free(prof->lock);
+    free(prof->objects);
+    free(prof->site_hash);
+    free(prof->sites);
+    free(prof);
+}
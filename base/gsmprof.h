@@ -0,0 +1,78 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Interface to the allocation profile */
+
+#ifndef gsmprof_INCLUDED
+#  define gsmprof_INCLUDED
+
+#include "gsmemory.h"
+#include "gslibctx.h"
+
+/*
+ * The allocation profile is a cheap alternative to Memento for release
+ * builds: when it is enabled (with --memory-profile), the allocators
+ * report every allocation and free to it, and it keeps, for each client
+ * name, the number of allocations, the bytes allocated, the peak and final
+ * live bytes, and a histogram of object lifetimes.  Lifetimes are measured
+ * in allocations, i.e. the number of other objects allocated while the
+ * object was live.  The profile is printed when the library instance is
+ * finalized.
+ *
+ * Each kind of allocator is profiled separately, since they are stacked:
+ * the clumps of garbage collected memory, and the slabs of the chunk
+ * allocators, come from the heap.  Objects in garbage collected memory
+ * are freed by the garbage collector without the allocator knowing, and
+ * are moved by it, so for those only the allocations are counted.
+ */
+typedef enum {
+    gs_memory_profile_heap,	/* gsmalloc.c */
+    gs_memory_profile_chunk,	/* gsmchunk.c */
+    gs_memory_profile_gc,	/* gsalloc.c, only counted */
+    gs_memory_profile_num_kinds
+} gs_memory_profile_kind_t;
+
+/* Start profiling the allocations of a library instance (and its clones). */
+int gs_memory_profile_enable(gs_memory_t *mem);
+
+/* Print the profile and stop profiling. */
+void gs_memory_profile_fin(gs_lib_ctx_core_t *core);
+
+/* Record an allocation or a free; ptr is not used for the gc kind. */
+void gs_memory_profile_note_alloc(const gs_memory_t *mem,
+                                  gs_memory_profile_kind_t kind,
+                                  const void *ptr, size_t size,
+                                  client_name_t cname);
+void gs_memory_profile_note_free(const gs_memory_t *mem, const void *ptr);
+
+/*
+ * The allocators call these, which cost a test when profiling is off.
+ */
+#define gs_memory_profiling(mem)\
+  ((mem)->gs_lib_ctx != NULL && (mem)->gs_lib_ctx->core->memory_profile != NULL)
+#define gs_memory_profile_alloc(mem, kind, ptr, size, cname)\
+  BEGIN\
+    if (gs_memory_profiling(mem))\
+        gs_memory_profile_note_alloc((const gs_memory_t *)(mem), kind,\
+                                     ptr, size, cname);\
+  END
+#define gs_memory_profile_free(mem, ptr)\
+  BEGIN\
+    if (gs_memory_profiling(mem))\
+        gs_memory_profile_note_free((const gs_memory_t *)(mem), ptr);\
+  END
+
+#endif /* gsmprof_INCLUDED */
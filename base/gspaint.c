@@ -16,12 +16,14 @@
 
 /* Painting procedures for Ghostscript library */
 #include "math_.h"		/* for fabs */
+#include "memory_.h"
 #include "gx.h"
 #include "gpcheck.h"
 #include "gserrors.h"
 #include "gsropt.h"		/* for gxpaint.h */
 #include "gxfixed.h"
 #include "gxmatrix.h"		/* for gs_gstate */
+#include "gscoord.h"
 #include "gspaint.h"
 #include "gspath.h"
 #include "gzpath.h"
@@ -30,7 +32,10 @@
 #include "gzstate.h"
 #include "gxdevice.h"
 #include "gxdevmem.h"
+#include "gxdcolor.h"
+#include "gximask.h"
 #include "gzcpath.h"
+#include "gxclipm.h"
 #include "gxhldevc.h"
 #include "gsutil.h"
 #include "gxscanc.h"
@@ -858,3 +863,270 @@ gs_eofillstroke(gs_gstate * pgs, int *restart)
     pgs->device->sgr.stroke_stored = false;
     return fill_stroke_with_rule(pgs, gx_rule_even_odd, restart);
 }
+
+/* ------ Painting through a mask ------ */
+
+/* Ask a device whether it is a high level (vector) device. */
+static bool
+device_is_high_level(gx_device *dev)
+{
+    char data[] = "HighLevelDevice";
+    dev_param_req_t request;
+    gs_c_param_list list;
+    bool highlevel = false;
+    int code;
+
+    gs_c_param_list_write(&list, dev->memory);
+    request.Param = data;
+    request.list = &list;
+    code = dev_proc(dev, dev_spec_op)(dev, gxdso_get_dev_param, &request,
+                                      sizeof(dev_param_req_t));
+    if (code < 0 && code != gs_error_undefined) {
+        gs_c_param_list_release(&list);
+        return false;
+    }
+    gs_c_param_list_read(&list);
+    code = param_read_bool((gs_param_list *)&list, "HighLevelDevice", &highlevel);
+    gs_c_param_list_release(&list);
+    return (code == 0 && highlevel);
+}
+
+/*
+ * A mask reproduces a fill or stroke exactly only if the path would have
+ * been rendered at device resolution, as opaque marks, in a raster device.
+ * We also leave text (charpath, and painting inside a BuildChar) alone.
+ */
+bool
+gs_paint_mask_ok(gs_gstate * pgs)
+{
+    gx_device *dev = gs_currentdevice_inline(pgs);
+
+    if (pgs->in_charpath || pgs->show_gstate != NULL ||
+        pgs->in_cachedevice != CACHE_DEVICE_NONE || gs_is_null_device(dev))
+        return false;
+    if (alpha_buffer_bits(pgs) > 1)
+        return false;
+    if (dev_proc(dev, dev_spec_op)(dev, gxdso_is_pdf14_device, NULL, 0) > 0)
+        return false;
+    return !device_is_high_level(dev);
+}
+
+int
+gs_paint_mask_box(gs_gstate * pgs, int rule, gs_int_rect * pbox)
+{
+    gs_fixed_rect bbox;
+    gs_fixed_point expand;
+    double x0, y0, x1, y1;
+    int code = gx_path_bbox(pgs->path, &bbox);
+
+    if (code < 0) {
+        /* An empty path paints nothing. */
+        if (code != gs_error_nocurrentpoint)
+            return code;
+        pbox->p.x = pbox->p.y = pbox->q.x = pbox->q.y = 0;
+        return 0;
+    }
+    expand = pgs->fill_adjust;
+    if (rule == 0) {
+        gs_fixed_point sexpand;
+
+        code = gx_stroke_path_expansion(pgs, pgs->path, &sexpand);
+        if (code < 0)
+            return code;
+        /* The expansion doesn't allow for square dash caps. */
+        if (pgs->line_params.dash.pattern_size != 0 &&
+            pgs->line_params.dash_cap == gs_cap_square) {
+            sexpand.x += sexpand.x >> 1;
+            sexpand.y += sexpand.y >> 1;
+        }
+        expand.x += sexpand.x;
+        expand.y += sexpand.y;
+    }
+    /* Allow a margin for stroke adjustment and thin lines. */
+    x0 = floor(fixed2float(bbox.p.x) - fixed2float(expand.x)) - 2;
+    y0 = floor(fixed2float(bbox.p.y) - fixed2float(expand.y)) - 2;
+    x1 = ceil(fixed2float(bbox.q.x) + fixed2float(expand.x)) + 2;
+    y1 = ceil(fixed2float(bbox.q.y) + fixed2float(expand.y)) + 2;
+    if (x0 < min_int || y0 < min_int || x1 > max_int || y1 > max_int)
+        return_error(gs_error_limitcheck);
+    pbox->p.x = (int)x0;
+    pbox->p.y = (int)y0;
+    pbox->q.x = (int)x1;
+    pbox->q.y = (int)y1;
+    return 0;
+}
+
+int
+gs_paint_mask_render(gs_gstate * pgs, int rule, const gs_int_rect * pbox,
+                     byte * data, uint raster)
+{
+    gs_memory_t *mem = pgs->memory;
+    gx_device_memory *mdev;
+    gs_fixed_rect cbox;
+    gs_matrix mat;
+    int code, rcode;
+
+    mdev = gs_alloc_struct(mem, gx_device_memory, &st_device_memory,
+                           "gs_paint_mask_render");
+    if (mdev == 0)
+        return_error(gs_error_VMerror);
+    gs_make_mem_mono_device(mdev, mem, gs_currentdevice_inline(pgs));
+    mdev->width = pbox->q.x - pbox->p.x;
+    mdev->height = pbox->q.y - pbox->p.y;
+    mdev->base = data;
+    mdev->line_pointer_memory = mem;
+    gx_device_retain((gx_device *)mdev, true);
+    code = (*dev_proc(mdev, open_device)) ((gx_device *)mdev);
+    if (code < 0) {
+        gx_device_retain((gx_device *)mdev, false);
+        return code;
+    }
+    if (mdev->raster != raster) {
+        code = gs_note_error(gs_error_rangecheck);
+        goto out;
+    }
+    code = gs_gsave(pgs);
+    if (code < 0)
+        goto out;
+    /* Render into the mask, in its own coordinates and clipped only to it. */
+    gx_set_device_only(pgs, (gx_device *)mdev);
+    code = gx_set_device_color_1(pgs);
+    if (code >= 0) {
+        cbox.p.x = cbox.p.y = 0;
+        cbox.q.x = int2fixed(mdev->width);
+        cbox.q.y = int2fixed(mdev->height);
+        code = gx_clip_to_rectangle(pgs, &cbox);
+    }
+    if (code >= 0)
+        code = gx_path_translate(pgs->path, -int2fixed(pbox->p.x),
+                                 -int2fixed(pbox->p.y));
+    if (code >= 0) {
+        gs_currentmatrix(pgs, &mat);
+        mat.tx -= pbox->p.x;
+        mat.ty -= pbox->p.y;
+        code = gs_setmatrix(pgs, &mat);
+    }
+    if (code >= 0) {
+        if (rule == 0)
+            code = gx_stroke_fill(pgs->path, pgs);
+        else
+            code = gx_fill_path(pgs->path, gs_currentdevicecolor_inline(pgs),
+                                pgs, rule, pgs->fill_adjust.x,
+                                pgs->fill_adjust.y);
+    }
+    rcode = gs_grestore(pgs);
+    if (code >= 0)
+        code = rcode;
+out:
+    (*dev_proc(mdev, close_device)) ((gx_device *)mdev);
+    gx_device_retain((gx_device *)mdev, false);
+    return code;
+}
+
+int
+gs_paint_mask(gs_gstate * pgs, int rule, const byte * data, uint raster,
+              gs_id id, int x, int y, int width, int height)
+{
+    bool overprint = (rule == 0 ? pgs->stroke_overprint : pgs->overprint);
+    bool is_fill_correct = true;
+    gx_clip_path *pcpath;
+    int code;
+
+    if (rule != 0)
+        pgs->device->sgr.stroke_stored = false;
+    if (width <= 0 || height <= 0)
+        return 0;
+    ensure_tag_is_set(pgs, pgs->device, GS_PATH_TAG);	/* NB: may unset_dev_color */
+    code = gx_set_dev_color(pgs);
+    if (code != 0)
+        return code;
+    code = gs_gstate_color_load(pgs);
+    if (code < 0)
+        return code;
+    if (overprint || dev_proc(pgs->device, dev_spec_op)(pgs->device,
+                                       gxdso_overprint_active, NULL, 0)) {
+        gs_overprint_params_t op_params = { 0 };
+
+        /* As in do_stroke, a stroke uses the stroke overprint state. */
+        if (rule == 0 && pgs->is_fill_color) {
+            is_fill_correct = false;
+            pgs->is_fill_color = false;
+        }
+        code = gs_do_set_overprint(pgs);
+        if (code >= 0) {
+            op_params.op_state = (rule == 0 ? OP_STATE_STROKE : OP_STATE_FILL);
+            gs_gstate_update_overprint(pgs, &op_params);
+        }
+    }
+    if (code >= 0)
+        code = gx_effective_clip_path(pgs, &pcpath);
+    if (code >= 0)
+        code = gx_image_fill_masked(pgs->device, data, 0, raster, id,
+                                    x, y, width, height,
+                                    gs_currentdevicecolor_inline(pgs), 1,
+                                    pgs->log_op, pcpath);
+    if (!is_fill_correct)
+        pgs->is_fill_color = true;
+    return code;
+}
+
+int
+gs_paint_masked_bits(gs_gstate * pgs, const byte * data, uint raster,
+                     const byte * mask, uint mask_raster, gs_id id,
+                     int x, int y, int width, int height)
+{
+    gs_memory_t *mem = pgs->memory;
+    gx_device *dev = gs_currentdevice_inline(pgs);
+    gx_device_mask_clip *mcdev;
+    gx_device_clip cdev;
+    gx_device *pdev;
+    gx_strip_bitmap bits;
+    gx_clip_path *pcpath;
+    gs_fixed_rect rect;
+    int code;
+
+    if (width <= 0 || height <= 0)
+        return 0;
+    code = gx_effective_clip_path(pgs, &pcpath);
+    if (code < 0)
+        return code;
+    mcdev = gs_alloc_struct(mem, gx_device_mask_clip, &st_device_mask_clip,
+                            "gs_paint_masked_bits");
+    if (mcdev == 0)
+        return_error(gs_error_VMerror);
+    memset(&bits, 0, sizeof(bits));
+    bits.data = (byte *)mask;
+    bits.raster = mask_raster;
+    bits.size.x = bits.rep_width = width;
+    bits.size.y = bits.rep_height = height;
+    bits.id = id;
+    bits.num_planes = 1;
+    code = gx_mask_clip_initialize(mcdev, &gs_mask_clip_device,
+                                   (const gx_bitmap *)&bits, dev, x, y, mem);
+    if (code < 0) {
+        gx_device_set_target((gx_device_forward *)mcdev, NULL);
+        gs_free_object(mem, mcdev, "gs_paint_masked_bits");
+        return code;
+    }
+    mcdev->tiles = bits;
+    rect.p.x = int2fixed(x);
+    rect.p.y = int2fixed(y);
+    rect.q.x = int2fixed(x + width);
+    rect.q.y = int2fixed(y + height);
+    pdev = gx_make_clip_device_on_stack_if_needed(&cdev, pcpath,
+                                                  (gx_device *)mcdev, &rect);
+    if (pdev != NULL) {
+        /* Only the reduced area is clipped, as in gx_default_fill_mask. */
+        int x0 = max(x, fixed2int(rect.p.x)), y0 = max(y, fixed2int(rect.p.y));
+        int x1 = min(x + width, fixed2int(rect.q.x));
+        int y1 = min(y + height, fixed2int(rect.q.y));
+
+        if (x1 > x0 && y1 > y0)
+            code = dev_proc(pdev, copy_color)(pdev, data + (size_t)(y0 - y) * raster,
+                                              x0 - x, raster, gx_no_bitmap_id,
+                                              x0, y0, x1 - x0, y1 - y0);
+    }
+    gx_device_set_target((gx_device_forward *)mcdev, NULL);
+    gs_free_object(mem, mcdev, "gs_paint_masked_bits");
+    return code;
+}
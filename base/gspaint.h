@@ -21,6 +21,7 @@
 #  define gspaint_INCLUDED
 
 #include "stdpre.h"
+#include "gstypes.h"
 #include "gsgstate.h"
 
 /* Painting */
@@ -32,6 +33,36 @@ int gs_erasepage(gs_gstate *),
     gs_fillstroke(gs_gstate * pgs, int *restart),
     gs_eofillstroke(gs_gstate * pgs, int *restart);
 
+/*
+ * Painting through a mask, for clients that cache the result of painting
+ * a path (the interpreter's user path cache). 'rule' is the fill rule
+ * (gx_rule_winding_number or gx_rule_even_odd), or 0 for a stroke.
+ * gs_paint_mask_ok returns true if painting the mask gives the same result
+ * as painting the current path in the current device and graphics state;
+ * gs_paint_mask_box computes the device box that painting the current path
+ * could touch; gs_paint_mask_render renders the path into a zeroed monobit
+ * mask of that box; gs_paint_mask paints a mask at (x, y) in the current
+ * color, as gs_fill (or gs_stroke, if rule is 0) would have.
+ */
+bool gs_paint_mask_ok(gs_gstate *pgs);
+int gs_paint_mask_box(gs_gstate *pgs, int rule, gs_int_rect *pbox);
+int gs_paint_mask_render(gs_gstate *pgs, int rule, const gs_int_rect *pbox,
+                         byte *data, uint raster);
+int gs_paint_mask(gs_gstate *pgs, int rule, const byte *data, uint raster,
+                  gs_id id, int x, int y, int width, int height);
+
+/*
+ * Paint a rendered bitmap in the device's own color format at (x, y),
+ * through a monobit mask of the same size and through the clipping path,
+ * for clients that cache the result of painting several objects (the
+ * interpreter's form cache). The caller checks that the bits were rendered
+ * for the current device, with gs_paint_mask_ok as above; color mapping,
+ * overprint and the logical operation are not applied again.
+ */
+int gs_paint_masked_bits(gs_gstate *pgs, const byte *data, uint raster,
+                         const byte *mask, uint mask_raster, gs_id id,
+                         int x, int y, int width, int height);
+
 /* Image tracing */
 int gs_imagepath(gs_gstate *, int, int, const byte *);
 
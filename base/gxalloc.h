@@ -152,6 +152,8 @@ struct clump_s {
                                 /*   the outer clump, if any */
     bool has_refs;		/* true if any refs in clump */
     bool c_alone;               /* this clump is for a single allocation */
+    bool c_dirty;               /* on the allocator's dirty list */
+    clump_t *dirty_next;        /* next clump on the dirty list */
     /*
      * Free lists for single bytes in blocks of 1 to 2*N-1 bytes, one per
      * 256 bytes in [csbase..climit), where N is sizeof(uint). The chain
@@ -269,6 +271,12 @@ void alloc_open_clump(gs_ref_memory_t * mem);
 void alloc_link_clump(clump_t *, gs_ref_memory_t *);
 void alloc_unlink_clump(clump_t *, gs_ref_memory_t *);
 
+/* Note that a clump may have changed since the last save scan, */
+/* or forget everything the allocator knows about clean clumps. */
+/* These are exported for save/restore and for the GC. */
+void alloc_dirty_clump(gs_ref_memory_t *, clump_t *);
+void alloc_forget_clean(gs_ref_memory_t *);
+
 /* Free a clump.  This is exported for save/restore and for the GC. */
 void alloc_free_clump(clump_t *, gs_ref_memory_t *);
 
@@ -366,6 +374,19 @@ struct gs_ref_memory_s {
     struct alloc_save_s *saved;
     long total_scanned;
     long total_scanned_after_compacting;
+    /*
+     * Save and restore only look at the clumps that may have changed
+     * since the last save scan.  While clean_valid is true, every clump
+     * not on the dirty list has has_refs false, is not the current
+     * clump, has too little free space for an inner clump, and has its
+     * free space and inner clump size counted in clean_unused and
+     * clean_inner.  Anything that breaks this calls alloc_dirty_clump
+     * or alloc_forget_clean.
+     */
+    clump_t *dirty;		/* clumps changed since the last scan */
+    bool clean_valid;
+    size_t clean_unused;
+    size_t clean_inner;
     struct alloc_save_s *reloc_saved;	/* for GC */
     gs_memory_status_t previous_status;		/* total allocated & used */
                                 /* in outer save levels */
@@ -401,6 +422,23 @@ extern const gs_memory_procs_t gs_ref_memory_procs;
                 }\
         }
 
+/*
+ * Scan only the clumps of an allocator that may have changed since the
+ * last save scan (all of them if the allocator has no clean clumps):
+ *      SCAN_MEM_DIRTY_CLUMPS(mem, cp)
+ *              << code to process clump cp >>
+ *      END_CLUMPS_SCAN
+ * The code must not change the dirty list.
+ */
+#define SCAN_MEM_DIRTY_CLUMPS(mem, cp)\
+        {	clump_splay_walker sw;\
+                clump_t *cp;\
+                bool dirty_only = (mem)->clean_valid;\
+                for (cp = (dirty_only ? (mem)->dirty : clump_splay_walk_init(&sw, mem));\
+                     cp != 0;\
+                     cp = (dirty_only ? cp->dirty_next : clump_splay_walk_fwd(&sw)))\
+                {
+
 /* ================ Debugging ================ */
 
 #ifdef DEBUG
@@ -41,6 +41,15 @@ typedef struct gx_colors_usage_s {
                                 /* executed plane-by-plane on CMYK devices */
     gs_int_rect trans_bbox;	/* transparency bbox allows skipping the pdf14 compositor for some bands */
                                 /* coordinates are band relative, 0 <= p.y < page_band_height */
+    /* The following are only filled in for the bands of a band list, */
+    /* to estimate how long each band will take to render. */
+    int64_t cmd_bytes;		/* bytes of commands played back for the band */
+    int64_t image_bytes;	/* of which image data */
+    int64_t band_cmd_bytes;	/* of which only for this band, 0 if it has */
+                                /* nothing but whole page commands (fillpage) */
+    bool clip_dependent;	/* has commands (paths, shadings, skewed or */
+                                /* interpolated images, clist patterns) whose */
+                                /* pixels may depend on the band's bounds */
 } gx_color_usage_t;
 
 /*
@@ -52,6 +61,7 @@ typedef struct gx_band_page_info_s {
     char bfname[gp_file_name_sizeof];	/* block file name */
     clist_file_ptr bfile;	/* block file, normally 0 */
     const clist_io_procs_t *io_procs;
+    clist_compression_t compression;	/* for the band list files */
     uint tile_cache_size;	/* size of tile cache */
     ulong line_ptrs_offset;      /* Offset of line_ptrs within tile cache */
     int64_t bfile_end_pos;		/* ftell at end of bfile */
@@ -59,7 +69,7 @@ typedef struct gx_band_page_info_s {
                                 /* (actual values, no 0s) */
 } gx_band_page_info_t;
 #define PAGE_INFO_NULL_VALUES\
-  { 0 }, 0, { 0 }, NULL, 0, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES }
+  { 0 }, 0, { 0 }, NULL, 0, clist_compression_default, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES }
 
 /*
  * By convention, the structure member containing the above is called
@@ -63,6 +63,7 @@ static int alloc_char(gs_font_dir *, ulong, cached_char **);
 static int alloc_char_in_chunk(gs_font_dir *, ulong, cached_char **);
 static void hash_remove_cached_char(gs_font_dir *, uint);
 static void shorten_cached_char(gs_font_dir *, cached_char *, uint);
+static size_t char_cache_evict(void *, size_t);
 
 /* ====== Initialization ====== */
 
@@ -107,6 +108,10 @@ gx_char_cache_alloc(gs_memory_t * struct_mem, gs_memory_t * bits_mem,
     pdir->ccache.upper = upper;
     pdir->ccache.table = chars;
     pdir->ccache.table_mask = chsize - 1;
+    if (pdir->ccache.budget == NULL)
+        pdir->ccache.budget = gs_lib_ctx_budget_register(struct_mem, "char cache",
+                                                         GS_BUDGET_PRIORITY_CHARS, false,
+                                                         char_cache_evict, pdir);
     return gx_char_cache_init(pdir);
 }
 
@@ -130,6 +135,7 @@ gx_char_cache_init(register gs_font_dir * dir)
     gx_bits_cache_chunk_init(cck, NULL, 0);
     gx_bits_cache_init((gx_bits_cache *) & dir->ccache, cck);
     dir->ccache.bspace = 0;
+    gs_lib_ctx_budget_set_used(dir->ccache.budget, 0);
     memset((char *)dir->ccache.table, 0,
            (dir->ccache.table_mask + 1) * sizeof(cached_char *));
     for (i = 0, pair = dir->fmcache.mdata;
@@ -398,6 +404,52 @@ purge_fm_pair_char(const gs_memory_t *mem, cached_char * cc, void *vpair)
 }
 #undef cpair
 
+static bool
+purge_all_chars(const gs_memory_t *mem, cached_char * cc, void *dummy)
+{
+    return true;
+}
+
+/* Give memory back to the memory budget: purge all the cached characters, */
+/* and free the chunks that leaves empty. Characters that are still being  */
+/* built aren't in the table yet, so the chunks holding them are kept.     */
+/* The initial chunk (which has no data) always stays in the ring.         */
+static size_t
+char_cache_evict(void *data, size_t wanted)
+{
+    gs_font_dir *dir = (gs_font_dir *)data;
+    gs_memory_t *mem = dir->ccache.bits_memory;
+    char_cache_chunk *anchor = dir->ccache.chunks;
+    char_cache_chunk *prev, *cck;
+    bool rover_freed = false;
+    size_t freed = 0;
+
+    gx_purge_selected_cached_chars(dir, purge_all_chars, NULL);
+    while (anchor->data != NULL)
+        anchor = anchor->next;
+    for (prev = anchor; (cck = prev->next) != anchor;) {
+        if (cck->allocated != 0) {
+            prev = cck;
+            continue;
+        }
+        prev->next = cck->next;
+        if (cck == dir->ccache.chunks)
+            rover_freed = true;
+        dir->ccache.bspace -= cck->size;
+        freed += cck->size;
+        gs_free_object(mem, cck->data, "char_cache_evict(data)");
+        gs_free_object(mem, cck, "char_cache_evict");
+    }
+    if (rover_freed) {
+        dir->ccache.chunks = anchor;
+        dir->ccache.cnext = 0;
+    }
+    gs_lib_ctx_budget_set_used(dir->ccache.budget, dir->ccache.bspace);
+    if_debug2m('k', dir->memory, "[k]evicted %"PRIdSIZE" bytes of chars, %u left\n",
+               freed, dir->ccache.bspace);
+    return freed;
+}
+
 static inline void
 gs_clean_fm_pair_attributes(gs_font_dir * dir, cached_fm_pair * pair)
 {
@@ -928,16 +980,21 @@ alloc_char(gs_font_dir * dir, ulong icdsize, cached_char **pcc)
     if (code < 0)
         return code;
     if (cc == 0) {
-        if (dir->ccache.bspace < dir->ccache.bmax) {	/* Allocate another chunk. */
+        uint cksize = dir->ccache.bmax / 5 + 1;
+        uint tsize = dir->ccache.bmax - dir->ccache.bspace;
+
+        if (cksize > tsize)
+            cksize = tsize;
+        /* The memory budget may not let us grow. This is also where we */
+        /* give memory back to it, if we've been asked to.              */
+        if (!gs_lib_ctx_budget_reserve(dir->ccache.budget, cksize))
+            cksize = 0;
+        if (cksize > 0) {	/* Allocate another chunk. */
             gs_memory_t *mem = dir->ccache.bits_memory;
             char_cache_chunk *cck_prev = dir->ccache.chunks;
             char_cache_chunk *cck;
-            uint cksize = dir->ccache.bmax / 5 + 1;
-            uint tsize = dir->ccache.bmax - dir->ccache.bspace;
             byte *cdata;
 
-            if (cksize > tsize)
-                cksize = tsize;
             if (icdsize + sizeof(cached_char_head) > cksize) {
                 if_debug2m('k', mem,
                            "[k]no cache bits: cdsize+head=%lu, cksize=%u\n",
@@ -963,6 +1020,7 @@ alloc_char(gs_font_dir * dir, ulong icdsize, cached_char **pcc)
             cck_prev->next = cck;
             dir->ccache.bspace += cksize;
             dir->ccache.chunks = cck;
+            gs_lib_ctx_budget_set_used(dir->ccache.budget, dir->ccache.bspace);
         } else {		/* Cycle through existing chunks. */
             char_cache_chunk *cck_init = dir->ccache.chunks;
             char_cache_chunk *cck = cck_init;
@@ -24,6 +24,7 @@
 #include "gxdevmem.h"		/* must precede gxcldev.h */
 #include "gdevprn.h"            /* for BLS_force_memory */
 #include "gxcldev.h"
+#include "gxclpath.h"		/* for cmd_opv_extend */
 #include "gxfmap.h"
 #include "gxpcolor.h"		/* for gx_device_is_pattern_clist */
 
@@ -530,6 +531,7 @@ clist_add_tile(gx_device_clist_writer * cldev, const gx_strip_bitmap * tiles,
     slot->x_reps = slot->y_reps = 1;
     slot->id = tiles->id;
     slot->num_planes = (byte)tiles->num_planes;
+    slot->dict_index = tile_dict_index_unknown;
     if (slot->num_planes != 1)
         depth /= slot->num_planes;
     memset(ts_mask(slot), 0, cldev->tile_band_mask_size);
@@ -558,6 +560,184 @@ clist_add_tile(gx_device_clist_writer * cldev, const gx_strip_bitmap * tiles,
     return 0;
 }
 
+/* ------ Tile dictionary ------ */
+
+/*
+ * Define the limits on the tile dictionary (see gxcldev.h). Bitmaps smaller
+ * than TILE_DICT_MIN_BYTES cost less to write than to look up.
+ */
+#define TILE_DICT_MAX_COUNT 8192
+#define TILE_DICT_MAX_SIZE (4 * 1024 * 1024)
+#define TILE_DICT_MIN_BYTES 32
+
+/* Allocate an empty tile dictionary. */
+static clist_tile_dict_t *
+clist_tile_dict_alloc(gs_memory_t *mem)
+{
+    clist_tile_dict_t *dict;
+    uint hash_size = TILE_DICT_MAX_COUNT * 2;
+
+    dict = (clist_tile_dict_t *)gs_alloc_bytes(mem, sizeof(clist_tile_dict_t),
+                                               "clist_tile_dict_alloc");
+    if (dict == NULL)
+        return NULL;
+    dict->memory = mem;
+    dict->count = 0;
+    dict->max_count = TILE_DICT_MAX_COUNT;
+    dict->size = 0;
+    dict->max_size = TILE_DICT_MAX_SIZE;
+    dict->hash_mask = hash_size - 1;
+    dict->hash_heads = (int *)gs_alloc_byte_array(mem, hash_size, sizeof(int),
+                                                  "clist_tile_dict_alloc(hash)");
+    dict->entries = (clist_tile_dict_entry_t *)
+        gs_alloc_byte_array(mem, dict->max_count, sizeof(clist_tile_dict_entry_t),
+                            "clist_tile_dict_alloc(entries)");
+    if (dict->hash_heads == NULL || dict->entries == NULL) {
+        gs_free_object(mem, dict->hash_heads, "clist_tile_dict_alloc(hash)");
+        gs_free_object(mem, dict->entries, "clist_tile_dict_alloc(entries)");
+        gs_free_object(mem, dict, "clist_tile_dict_alloc");
+        return NULL;
+    }
+    memset(dict->hash_heads, 0xff, hash_size * sizeof(int));	/* all -1 */
+    memset(dict->entries, 0, dict->max_count * sizeof(clist_tile_dict_entry_t));
+    return dict;
+}
+
+/* Free the tile dictionary, if this device owns it. */
+void
+clist_tile_dict_free(gx_device_clist_common *cdev)
+{
+    clist_tile_dict_t *dict = cdev->tile_dict;
+
+    if (dict != NULL && cdev->tile_dict_owned) {
+        gs_memory_t *mem = dict->memory;
+        int i;
+
+        for (i = 0; i < dict->count; i++)
+            gs_free_object(mem, dict->entries[i].data, "clist_tile_dict_free(data)");
+        gs_free_object(mem, dict->entries, "clist_tile_dict_free(entries)");
+        gs_free_object(mem, dict->hash_heads, "clist_tile_dict_free(hash)");
+        gs_free_object(mem, dict, "clist_tile_dict_free");
+    }
+    cdev->tile_dict = NULL;
+    cdev->tile_dict_owned = false;
+}
+
+/* Hash the dimensions and bits of a bitmap (FNV-1a). */
+static uint
+tile_dict_hash(const byte *data, uint raster, uint width_bits, uint height)
+{
+    uint row_bytes = (width_bits + 7) >> 3;
+    uint hash = 2166136261u;
+    uint x, y;
+
+    hash = (hash ^ width_bits) * 16777619u;
+    hash = (hash ^ height) * 16777619u;
+    for (y = 0; y < height; y++, data += raster)
+        for (x = 0; x < row_bytes; x++)
+            hash = (hash ^ data[x]) * 16777619u;
+    return hash;
+}
+
+/*
+ * Return the index of a cached bitmap in the tile dictionary, adding it if
+ * necessary, or tile_dict_index_none if its bits must be written into the
+ * band list. width_bits and height describe the bits as they are written
+ * by cmd_put_bits. The result is remembered in the slot, so we only hash
+ * the bits once per page.
+ */
+static int
+clist_tile_dict_index(gx_device_clist_writer * cldev, tile_slot * pts,
+                      uint width_bits, uint height)
+{
+    clist_tile_dict_t *dict = cldev->tile_dict;
+    const byte *data = ts_bits(cldev, pts);
+    uint raster = pts->cb_raster;
+    uint row_bytes = (width_bits + 7) >> 3;
+    size_t size = (size_t)row_bytes * height;
+    clist_tile_dict_entry_t *pe;
+    byte *bits;
+    uint hash, y;
+    int index;
+
+    if (pts->dict_index != tile_dict_index_unknown)
+        return pts->dict_index;
+    pts->dict_index = tile_dict_index_none;
+    if (size < TILE_DICT_MIN_BYTES ||
+        (cldev->disable_mask & clist_disable_tile_dict) != 0 ||
+        gx_device_is_pattern_clist((gx_device *)cldev))
+        return tile_dict_index_none;
+    if (dict == NULL) {
+        dict = clist_tile_dict_alloc(cldev->memory->non_gc_memory);
+        if (dict == NULL) {
+            /* Not worth failing for: just don't try again. */
+            cldev->disable_mask |= clist_disable_tile_dict;
+            return tile_dict_index_none;
+        }
+        cldev->tile_dict = dict;
+        cldev->tile_dict_owned = true;
+    } else if (!cldev->tile_dict_owned)
+        return tile_dict_index_none;
+    hash = tile_dict_hash(data, raster, width_bits, height);
+    for (index = dict->hash_heads[hash & dict->hash_mask]; index >= 0;
+         index = pe->next) {
+        pe = &dict->entries[index];
+        if (pe->hash != hash || pe->width_bits != width_bits ||
+            pe->height != height)
+            continue;
+        for (y = 0; y < height; y++)
+            if (memcmp(pe->data + y * row_bytes, data + y * raster, row_bytes))
+                break;
+        if (y == height)
+            return (pts->dict_index = index);
+    }
+    if (dict->count == dict->max_count || dict->size + size > dict->max_size)
+        return tile_dict_index_none;
+    bits = gs_alloc_bytes(dict->memory, size, "clist_tile_dict_index");
+    if (bits == NULL)
+        return tile_dict_index_none;
+    bytes_copy_rectangle(bits, row_bytes, data, raster, row_bytes, height);
+    index = dict->count;
+    pe = &dict->entries[index];
+    pe->width_bits = width_bits;
+    pe->height = height;
+    pe->hash = hash;
+    pe->data = bits;
+    pe->next = dict->hash_heads[hash & dict->hash_mask];
+    dict->hash_heads[hash & dict->hash_mask] = index;
+    dict->size += size;
+    dict->count++;
+    if_debug4m('L', cldev->memory,
+               "[L]tile dictionary add index=%d size=%u (%u entries, %lu bytes)\n",
+               index, (uint)size, dict->count, (ulong)dict->size);
+    return (pts->dict_index = index);
+}
+
+/*
+ * Reserve the space for a command that sets a cached bitmap from the tile
+ * dictionary: a cmd_opv_ext_tile_dict command, followed by op_size bytes
+ * for the command that would otherwise be followed by the bits.
+ * pcls == 0 means all bands. Return the size of the second command in
+ * *psize, as cmd_put_bits does, and leave *pdp pointing at it.
+ */
+static int
+cmd_put_tile_dict_ref(gx_device_clist_writer * cldev, gx_clist_state * pcls,
+                      int dict_index, uint op_size, byte ** pdp, uint * psize)
+{
+    uint dsize = 2 + cmd_size_w(dict_index);
+    byte *dp;
+    int code = (pcls != 0 ?
+                set_cmd_put_op(&dp, cldev, pcls, cmd_opv_extend, dsize + op_size) :
+                set_cmd_put_all_op(&dp, cldev, cmd_opv_extend, dsize + op_size));
+
+    if (code < 0)
+        return code;
+    dp[1] = cmd_opv_ext_tile_dict;
+    *pdp = cmd_put_w(dict_index, dp + 2);
+    *psize = op_size;
+    return 0;
+}
+
 /* ------ Driver procedure support ------ */
 
 /* Change the tile parameters (size and depth). */
@@ -695,19 +875,27 @@ clist_change_tile(gx_device_clist_writer * cldev, gx_clist_state * pcls,
                 uint csize;
                 int code;
                 int pdepth = depth;
+                int dict_index;
+
                 if (tiles->num_planes != 1)
                     pdepth /= tiles->num_planes;
 
-                /* put the bits, but don't restrict to a single buffer */
-                code = cmd_put_bits(cldev, pcls, ts_bits(cldev, loc.tile),
+                dict_index = clist_tile_dict_index(cldev, loc.tile,
                                     tiles->rep_width * pdepth,
-                                    tiles->rep_height * tiles->num_planes,
-                                    loc.tile->cb_raster, rsize,
-                                    allow_large_bitmap |
-                                        (cldev->tile_params.size.x > tiles->rep_width ?
-                                             decompress_elsewhere | decompress_spread :
-                                             decompress_elsewhere),
-                                    &dp, &csize);
+                                    tiles->rep_height * tiles->num_planes);
+                if (dict_index >= 0)
+                    code = cmd_put_tile_dict_ref(cldev, pcls, dict_index,
+                                                 rsize, &dp, &csize);
+                else	/* put the bits, but don't restrict to a single buffer */
+                    code = cmd_put_bits(cldev, pcls, ts_bits(cldev, loc.tile),
+                                        tiles->rep_width * pdepth,
+                                        tiles->rep_height * tiles->num_planes,
+                                        loc.tile->cb_raster, rsize,
+                                        allow_large_bitmap |
+                                            (cldev->tile_params.size.x > tiles->rep_width ?
+                                                 decompress_elsewhere | decompress_spread :
+                                                 decompress_elsewhere),
+                                        &dp, &csize);
 
                 if (code < 0)
                     return code;
@@ -786,19 +974,27 @@ clist_change_bits(gx_device_clist_writer * cldev, gx_clist_state * pcls,
             gx_clist_state *bit_pcls = pcls;
             int code;
             int pdepth = depth;
+            int dict_index = tile_dict_index_none;
 
             if (tiles->num_planes != 1)
                     pdepth /= loc.tile->num_planes;
             if (loc.tile->num_bands == CHAR_ALL_BANDS_COUNT)
                 bit_pcls = NULL;
-            /* put the bits, but don't restrict to a single buffer */
-            code = cmd_put_bits(cldev, bit_pcls, ts_bits(cldev, loc.tile),
-                                loc.tile->width * pdepth,
-                                loc.tile->height * loc.tile->num_planes, loc.tile->cb_raster,
-                                rsize,
-                                decompress_elsewhere |
-                                    (cldev->target->BLS_force_memory ? (1 << cmd_compress_cfe) : 0),
-                                &dp, &csize);
+            if (loc.tile->num_planes == 1)
+                dict_index = clist_tile_dict_index(cldev, loc.tile,
+                                                   loc.tile->width * pdepth,
+                                                   loc.tile->height);
+            if (dict_index >= 0)
+                code = cmd_put_tile_dict_ref(cldev, bit_pcls, dict_index,
+                                             rsize, &dp, &csize);
+            else	/* put the bits, but don't restrict to a single buffer */
+                code = cmd_put_bits(cldev, bit_pcls, ts_bits(cldev, loc.tile),
+                                    loc.tile->width * pdepth,
+                                    loc.tile->height * loc.tile->num_planes, loc.tile->cb_raster,
+                                    rsize,
+                                    decompress_elsewhere |
+                                        (cldev->target->BLS_force_memory ? (1 << cmd_compress_cfe) : 0),
+                                    &dp, &csize);
 
             if (code < 0)
                 return code;
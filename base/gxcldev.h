@@ -130,10 +130,8 @@ typedef enum {
   "disable_lop", "invalid", "invalid", "end_page",\
   "delta2_color0", "delta2_color1", "set_copy_color", "set_copy_alpha",
 
-#ifdef DEBUG
 extern const char *const cmd_op_names[16];
 extern const char *const *const cmd_sub_op_names[16];
-#endif
 
 /*
  * Define the size of the largest command, not counting any bitmap or
@@ -297,7 +295,11 @@ struct gx_clist_state_s {
         { 0, 0 }, /* cmd_list */\
         { 0, /* or */\
           0, /* slow rop */\
-          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ } /* trans_bbox */\
+          { { max_int, max_int }, /* p */ { min_int, min_int } /* q */ }, /* trans_bbox */\
+          0, /* cmd_bytes */\
+          0, /* image_bytes */\
+          0, /* band_cmd_bytes */\
+          0 /* clip_dependent */\
         } /* color_usage */
 
 /* Define the size of the command buffer used for reading. */
@@ -641,6 +643,49 @@ int clist_change_tile(gx_device_clist_writer * cldev, gx_clist_state * pcls,
 int clist_change_bits(gx_device_clist_writer * cldev, gx_clist_state * pcls,
                       const gx_strip_bitmap * tiles, int depth);
 
+/*
+ * The tile cache only lasts for a page, so a bitmap that is used on every
+ * page (a logo, a pattern tile or a glyph) would otherwise be written into
+ * the band list of every page that uses it. To avoid this, the writer also
+ * keeps the bitmaps that clist_change_bits and clist_change_tile write
+ * in a tile dictionary that lasts as long as the device is open, keyed by
+ * their contents. A band that doesn't know a bitmap then only gets a
+ * cmd_opv_ext_tile_dict command with the dictionary index, followed by
+ * the usual cmd_opv_set_bits or cmd_opv_set_tile_bits command without
+ * any bits, and the reader copies the bits from the dictionary instead.
+ *
+ * Entries are never changed or removed once they have been added, so the
+ * rendering threads (including the background printing thread) can read
+ * them without locking while the writer adds more. When the dictionary is
+ * full, bitmaps are written into the band list as before. The dictionary
+ * isn't used for pattern clists, or when pages may be kept after the
+ * device is closed (saved pages).
+ *
+ * The bits are stored unpadded, (width_bits + 7) >> 3 bytes per row.
+ */
+#define tile_dict_index_unknown (-1)	/* not looked up yet */
+#define tile_dict_index_none (-2)	/* not in the dictionary */
+typedef struct clist_tile_dict_entry_s {
+    uint width_bits;		/* width of a row in bits */
+    uint height;		/* # of rows (times # of planes) */
+    uint hash;			/* hash of the dimensions and bits */
+    int next;			/* next entry with the same hash index, or -1 */
+    byte *data;
+} clist_tile_dict_entry_t;
+struct clist_tile_dict_s {
+    gs_memory_t *memory;	/* for the dictionary and its entries */
+    int count;			/* # of entries in use */
+    int max_count;		/* size of entries */
+    size_t size;		/* total size of the entries' data */
+    size_t max_size;		/* limit on size */
+    uint hash_mask;		/* size of hash_heads - 1 */
+    int *hash_heads;		/* first entry for each hash index, or -1 */
+    clist_tile_dict_entry_t *entries;
+};
+
+/* Free the tile dictionary, if this device owns it. */
+void clist_tile_dict_free(gx_device_clist_common *cdev);
+
 /* ------ Exported by gxclimag.c ------ */
 
 /*
@@ -667,11 +712,43 @@ typedef enum {
     playback_action_setup
 } clist_playback_action;
 
-/* Play back and rasterize one band. */
+/*
+ * Define the statistics that clist_playback_band gathers for a band when
+ * the device has a band_profile. The time between the starts of successive
+ * commands is charged to the kind of the earlier command, so the times
+ * include reading and decompressing the band list.
+ */
+typedef enum {
+    clist_prof_fill,		/* fill paths, rectangles and trapezoids */
+    clist_prof_stroke,
+    clist_prof_image,
+    clist_prof_copy,		/* copy_mono/color/alpha, e.g. cached glyphs */
+    clist_prof_compositor,
+    clist_prof_other,		/* state changes, path construction, etc. */
+    clist_prof_num_kinds
+} clist_prof_kind_t;
+#define clist_prof_kind_name_strings\
+  "fill", "stroke", "image", "copy", "compositor", "other"
+
+typedef struct clist_band_stats_s {
+    int band_first, band_last;	/* bands played back */
+    int thread;			/* rendering thread index, -1 for the main thread */
+    int64_t start_us;		/* start time, relative to the start of the page */
+    int64_t time_us;		/* total time, including setting up */
+    int64_t kind_us[clist_prof_num_kinds];
+    int64_t image_bytes;	/* image data passed to the image enumerators */
+    uint op_counts[256];	/* by command byte */
+    /* The following are only used during playback. */
+    int64_t last_us;		/* time the current command started */
+    clist_prof_kind_t kind;	/* kind of the current command */
+} clist_band_stats_t;
+
+/* Play back and rasterize one band, gathering stats if stats != NULL. */
 int clist_playback_band(clist_playback_action action,
                         gx_device_clist_reader *cdev,
                         stream *s, gx_device *target,
-                        int x0, int y0, gs_memory_t *mem);
+                        int x0, int y0, gs_memory_t *mem,
+                        clist_band_stats_t *stats);
 
 /* Playback the band file, taking the indicated action w/ its contents. */
 int clist_playback_file_bands(clist_playback_action action,
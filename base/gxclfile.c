@@ -217,6 +217,13 @@ cl_cache_load_slot(CL_CACHE *cache, CL_CACHE_SLOT *slot, int64_t pos, byte *data
  * to be addressed via DELETE_ON_CLOSE under Windows, and immediate unlink
  * after opening under Linux. When running in this mode, we keep our own
  * record of position within the file for the sake of thread safety
+ *
+ * In this mode, when reading starts we also try to map the whole file into
+ * memory (gp_fmap), so that reads are a copy out of the page cache rather
+ * than a system call for each cache slot. Each reader (including the ones
+ * for the rendering threads, cloned with gp_fdup) has its own mapping, so
+ * no locking is needed. If the platform can't map the file, the reads go
+ * through the CL_CACHE as before.
  */
 
 #define ENC_FILE_STR ("encoded_file_ptr_%p")
@@ -229,6 +236,10 @@ typedef struct
     int64_t pos;
     int64_t filesize;		/* filesize maintained by clist_fwrite */
     CL_CACHE *cache;
+    byte *map;			/* the file mapped for reading, or NULL */
+    int64_t map_size;		/* filesize when the file was mapped */
+    void *map_handle;		/* platform handle for gp_funmap */
+    bool map_failed;		/* don't retry gp_fmap until the file changes */
 } IFILE;
 
 static void
@@ -262,13 +273,31 @@ static IFILE *wrap_file(gs_memory_t *mem, gp_file *f, const char *fmode)
     ifile->pos = 0;
     ifile->filesize = 0;
     ifile->cache = cl_cache_alloc(ifile->mem);
+    ifile->map = NULL;
+    ifile->map_size = 0;
+    ifile->map_handle = NULL;
+    ifile->map_failed = false;
     return ifile;
 }
 
+/* Release the mapping (if any), e.g. because the file contents changed */
+static void
+clist_unmap_file(IFILE *ifile)
+{
+    if (ifile->map != NULL) {
+        gp_funmap(ifile->map, ifile->map_size, ifile->map_handle);
+        ifile->map = NULL;
+        ifile->map_size = 0;
+        ifile->map_handle = NULL;
+    }
+    ifile->map_failed = false;
+}
+
 static int clist_close_file(IFILE *ifile)
 {
     int res = 0;
     if (ifile) {
+        clist_unmap_file(ifile);
         if (ifile->f != NULL)
             res = gp_fclose(ifile->f);
         if (ifile->cache != NULL)
@@ -283,7 +312,7 @@ static int clist_close_file(IFILE *ifile)
 static int
 clist_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             clist_file_ptr * pcf, gs_memory_t * mem, gs_memory_t *data_mem,
-            bool ok_to_compress)
+            clist_compression_t compression)
 {
     if (*fname == 0) {
         if (fmode[0] == 'r')
@@ -368,6 +397,8 @@ clist_fwrite_chars(const void *data, uint len, clist_file_ptr cf)
     if (res >= 0)
         icf->pos += len;
     icf->filesize = icf->pos;	/* write truncates file */
+    if (icf->map != NULL || icf->map_failed)
+        clist_unmap_file(icf);	/* writing invalidates the mapping */
     if (!CL_CACHE_NEEDS_INIT(icf->cache)) {
         /* writing invalidates the read cache */
         cl_cache_destroy(icf->cache);
@@ -387,6 +418,22 @@ clist_fread_chars(void *data, uint len, clist_file_ptr cf)
         IFILE *icf = (IFILE *)cf;
         byte *dp = data;
 
+        /* Map the file the first time it is read, if we can */
+        if (icf->map == NULL && !icf->map_failed && icf->filesize > 0) {
+            icf->map = gp_fmap(icf->f, icf->filesize, &icf->map_handle);
+            if (icf->map != NULL)
+                icf->map_size = icf->filesize;
+            else
+                icf->map_failed = true;
+        }
+        if (icf->map != NULL) {
+            if (icf->pos < icf->map_size) {
+                nread = min(len, icf->map_size - icf->pos);	/* limit for EOF */
+                memcpy(data, icf->map + icf->pos, nread);
+                icf->pos += nread;
+            }
+            return nread;
+        }
         /* if we have a cache, check if it needs init, and do it */
         if (CL_CACHE_NEEDS_INIT(icf->cache)) {
             icf->cache = cl_cache_read_init(icf->cache, CL_CACHE_NSLOTS, 1<<CL_CACHE_SLOT_SIZE_LOG2, icf->filesize);
@@ -484,6 +531,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              * new scratch file. */
             char tfname[gp_file_name_sizeof] = {0};
             const gs_memory_t *mem = ocf->f->memory;
+            clist_unmap_file(ocf);
             gp_fclose(ocf->f);
             ocf->f = gp_open_scratch_file_rm(mem, gp_scratch_file_name_prefix, tfname, fmode);
             if (ocf->f == NULL)
@@ -496,6 +544,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
                 if (ocf->cache == NULL)
                     return_error(gs_error_ioerror);
             }
+            clist_unmap_file((IFILE *)cf);
             ((IFILE *)cf)->filesize = 0;
         }
         ((IFILE *)cf)->pos = 0;
@@ -508,6 +557,7 @@ clist_rewind(clist_file_ptr cf, bool discard_data, const char *fname)
              * get the same effect.
              */
 
+            clist_unmap_file((IFILE *)cf);
             /* Opening with "w" mode deletes the contents when closing. */
             f = gp_freopen(fname, gp_fmode_wb, f);
             if (f == NULL) return_error(gs_error_ioerror);
@@ -1147,6 +1147,11 @@ clist_image_plane_data(gx_image_enum_common_t * info,
             if (code < 0)
                 return code;
             memcpy(dp + 1, pie->begin_image_command, len);
+            /* Only unrotated, uninterpolated images map each device row */
+            /* the same way however the band is clipped.                 */
+            if (pie->image.Interpolate ||
+                !(is_xxyy(&pie->matrix) || is_xyyx(&pie->matrix)))
+                re.pcls->color_usage.clip_dependent = true;
 
             /* Mark band's begin_image as known */
             re.pcls->known |= begin_image_known;
@@ -1949,6 +1954,7 @@ cmd_image_plane_data(gx_device_clist_writer * cldev, gx_clist_state * pcls,
     code = set_cmd_put_op(&dp, cldev, pcls, cmd_opv_image_data, len);
     if (code < 0)
         return code;
+    pcls->color_usage.image_bytes += nbytes;
     dp++;
     cmd_put2w(h, bytes_per_plane, &dp);
     for (plane = 0; plane < pie->num_planes; ++plane)
@@ -1994,6 +2000,7 @@ cmd_image_plane_data_mon(gx_device_clist_writer * cldev, gx_clist_state * pcls,
     code = set_cmd_put_op(&dp, cldev, pcls, cmd_opv_image_data, len);
     if (code < 0)
         return code;
+    pcls->color_usage.image_bytes += nbytes;
     dp++;
 
     cmd_put2w(h, bytes_per_plane, &dp);
@@ -31,6 +31,15 @@
 
 typedef void *clist_file_ptr;	/* We can't do any better than this. */
 
+/*
+ * Define the methods for compressing the band list (BandListCompression).
+ * Only the RAM based implementation compresses.
+ */
+typedef enum {
+    clist_compression_default = 0,	/* BAND_LIST_COMPRESSOR chosen at build time */
+    clist_compression_fast		/* fast LZ codec (slzbx.h) */
+} clist_compression_t;
+
 struct clist_io_procs_s {
 
     /* ---------------- Open/close/unlink ---------------- */
@@ -39,12 +48,14 @@ struct clist_io_procs_s {
      * If *fname = 0, generate and store a new scratch file name; otherwise,
      * open an existing file.  Only modes "r" and "w+" are supported,
      * and only binary data (but the caller must append the "b" if needed).
-     * Mode "r" with *fname = 0 is an error.
+     * Mode "r" with *fname = 0 is an error. compression only applies to
+     * new files, existing ones are read back with the method they were
+     * written with.
      */
     int (*fopen)(char fname[gp_file_name_sizeof], const char *fmode,
                     clist_file_ptr * pcf,
                     gs_memory_t * mem, gs_memory_t *data_mem,
-                    bool ok_to_compress);
+                    clist_compression_t compression);
 
     /*
      * Close a file, optionally deleting it.
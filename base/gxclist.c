@@ -215,7 +215,8 @@ const clist_io_procs_t *clist_io_procs_file_global = NULL;
 const clist_io_procs_t *clist_io_procs_memory_global = NULL;
 
 void
-clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory)
+clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory,
+                    clist_compression_t compression)
 {
 #ifdef PACIFY_VALGRIND
     VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_file_global, sizeof(clist_io_procs_file_global));
@@ -227,6 +228,7 @@ clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory)
         pclist_dev->common.page_info.io_procs = clist_io_procs_memory_global;
     else
         pclist_dev->common.page_info.io_procs = clist_io_procs_file_global;
+    pclist_dev->common.page_info.compression = compression;
 }
 
 /* ------ Define the command set and syntax ------ */
@@ -658,10 +660,10 @@ clist_open_output_file(gx_device *dev)
     clist_reset_page(cdev);
     if ((code = cdev->page_info.io_procs->fopen(cdev->page_cfname, fmode, &cdev->page_cfile,
                             cdev->bandlist_memory, cdev->bandlist_memory,
-                            true)) < 0 ||
+                            cdev->page_info.compression)) < 0 ||
         (code = cdev->page_info.io_procs->fopen(cdev->page_bfname, fmode, &cdev->page_bfile,
                             cdev->bandlist_memory, cdev->bandlist_memory,
-                            false)) < 0
+                            cdev->page_info.compression)) < 0
         ) {
         clist_close_output_file(dev);
         cdev->permanent_error = code;
@@ -722,6 +724,8 @@ clist_open(gx_device *dev)
 
     cdev->icc_cache_list_len = 0;
     cdev->icc_cache_list = NULL;
+    cdev->thread_dev_cache_len = 0;
+    cdev->thread_dev_cache = NULL;
     code = clist_open_output_file(dev);
     if ( code >= 0)
         code = clist_emit_page_header(dev);
@@ -755,6 +759,8 @@ clist_close(gx_device *dev)
     cdev->icc_cache_list_len = 0;
     gs_free_object(cdev->memory->thread_safe_memory, cdev->icc_cache_list, "clist_close");
     cdev->icc_cache_list = NULL;
+    clist_free_thread_dev_cache(dev);
+    clist_tile_dict_free((gx_device_clist_common *)dev);
 
     /* So despite the comment above, it seems necessary to free the cache_chunk here,
      * if the device is not being retained.  The code in gx_pattern_cache_free_entry() doesn't
@@ -1400,7 +1406,7 @@ clist_make_accum_device(gs_memory_t *mem, gx_device *target, const char *dname,
         cwdev->procs = gs_clist_device_procs;
         gx_device_copy_color_params((gx_device *)cwdev, target);
         rc_assign(cwdev->target, target, "clist_make_accum_device");
-        clist_init_io_procs(cdev, use_memory_clist);
+        clist_init_io_procs(cdev, use_memory_clist, clist_compression_default);
         cwdev->data = base;
         cwdev->data_size = space;
         memcpy (&(cwdev->buf_procs), buf_procs, sizeof(gx_device_buf_procs_t));
@@ -87,6 +87,8 @@ typedef struct gx_saved_page_s {
     /* as well as color_info (if it is able to change as the 'bit' devices can).            */
     int paramlist_len;
     byte *paramlist;		/* serialized device param list */
+    bool use_device_output_file;	/* print to the device's OutputFile, */
+                                /* not the one in paramlist */
     /* for DeviceN devices, we need the spot colors collected during parsing */
     int num_separations;
     int separation_name_sizes[GX_DEVICE_MAX_SEPARATIONS];
@@ -135,6 +137,8 @@ typedef struct {
     ushort index;		/* index in table (hash table when writing) */
     ushort num_bands;		/* # of 1-bits in the band mask */
     byte num_planes;
+    int dict_index;		/* writing: index in the tile dictionary, */
+    /* or one of the tile_dict_index_ values (see gxcldev.h) */
     /* byte band_mask[]; */
 #define ts_mask(pts) (byte *)((pts) + 1)
     /* byte bits[]; */
@@ -170,6 +174,12 @@ typedef struct cmd_list_s {
  */
 typedef struct gx_clist_state_s gx_clist_state;
 
+/* Playback statistics collected while rendering a page (BandProfileFile). */
+typedef struct clist_band_profile_s clist_band_profile_t;
+
+/* Bitmaps shared by all the pages of a job (see gxcldev.h). */
+typedef struct clist_tile_dict_s clist_tile_dict_t;
+
 #define gx_device_clist_common_members\
         gx_device_forward_common;	/* (see gxdevice.h) */\
                 /* Following must be set before writing or reading. */\
@@ -202,7 +212,13 @@ typedef struct gx_clist_state_s gx_clist_state;
                                            file location. */\
         gsicc_link_cache_t *icc_cache_cl; /* Link cache */\
         int icc_cache_list_len;         /* Length of list of caches, one per rendering thread */\
-        gsicc_link_cache_t **icc_cache_list  /* Link cache list */
+        gsicc_link_cache_t **icc_cache_list;  /* Link cache list */\
+        int thread_dev_cache_len;       /* Length of list of kept rendering thread devices */\
+        gx_device **thread_dev_cache;   /* Rendering thread devices kept between pages */\
+        clist_band_profile_t *band_profile; /* playback statistics for the page, or NULL */\
+        clist_tile_dict_t *tile_dict;   /* bitmaps shared between pages, or NULL */\
+        bool tile_dict_owned;           /* true if this device frees the tile_dict */\
+        int band_profile_thread         /* rendering thread index, -1 for the main thread */
 
 /* Define a structure to hold where the ICC profiles are stored in the clist
    Profiles are added into psuedo bands of the clist, these are bands that exist beyond
@@ -379,8 +395,11 @@ struct gx_device_clist_writer_s {
 #define clist_disable_nonrect_hl_image (1 << 4)
 #define clist_disable_pass_thru_params (1 << 5)	/* disable EXCEPT at top of page */
 #define clist_disable_copy_alpha (1 << 6) /* target does not support copy_alpha */
+#define clist_disable_tile_dict (1 << 7) /* pages may outlive the tile dictionary */
 
 typedef struct clist_render_thread_control_s clist_render_thread_control_t;
+typedef struct clist_band_reorder_slot_s clist_band_reorder_slot_t;
+typedef struct clist_band_unit_s clist_band_unit_t;
 
 /* Define the state of a band list when reading. */
 /* For normal rasterizing, pages and num_pages are both 0. */
@@ -397,7 +416,19 @@ typedef struct gx_device_clist_reader_s {
     byte *main_thread_data;		/* saved data pointer of main thread */
     int curr_render_thread;		/* index into array */
     int thread_lookahead_direction;	/* +1 or -1 */
-    int next_band;			/* may be < 0 or >= num bands when no more remain to render */
+    int next_unit;			/* may be < 0 or >= num_band_units when no more remain to render */
+    int num_reorder_slots;		/* units that may be held rendered, out of order */
+    clist_band_reorder_slot_t *reorder_slots;	/* array of parked units */
+    int num_band_units;			/* work units for the threads, in page order */
+    clist_band_unit_t *band_units;	/* bands, or parts of expensive bands */
+    int *band_first_unit;		/* index of each band's first unit, nbands + 1 entries */
+    void *split_band_buffer;		/* process_page buffer for the split bands */
+    /* Bands with no commands of their own (just fillpage) all render the same */
+    int blank_band_state;		/* 1 if they are all blank_band_pixel, -1 if they */
+                                        /* aren't a single color, 0 if not known yet */
+    bool blank_band_pdf14;		/* blank_band_state is for rendering with pdf14 */
+    byte blank_band_pixel[8];		/* the color of the pixels, depth / 8 bytes */
+                                        /* (or 1 byte of pixels if depth < 8) */
 
 } gx_device_clist_reader;
 
@@ -435,11 +466,21 @@ extern_st(st_device_clist);
 /* The device template itself is never used, only the procedures. */
 extern const gx_device_procs gs_clist_device_procs;
 
-void clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory);
+void clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory,
+                         clist_compression_t compression);
 
 /* Reset (or prepare to append to) the command list after printing a page. */
 int clist_finish_page(gx_device * dev, bool flush);
 
+/*
+ * Collect statistics on the playback of each band of the page about to be
+ * rendered, then append them to a file, as one line of JSON for the page.
+ * Both are called for the main clist device; rendering threads pick up the
+ * profile from it.
+ */
+int clist_band_profile_begin(gx_device *dev);
+int clist_band_profile_end(gx_device *dev, const char *fname);
+
 /* Close the band files and delete their contents. */
 int clist_close_output_file(gx_device *dev);
 
@@ -548,6 +589,10 @@ clist_enable_multi_thread_render(gx_device *dev);
 void
 clist_teardown_render_threads(gx_device *dev);
 
+/* Free the rendering thread devices kept between pages (in gxclthrd.c) */
+void
+clist_free_thread_dev_cache(gx_device *dev);
+
 /* Minimum BufferSpace needed when writing the clist */
 /* This is an exported function because it is used to set up render threads */
 /* and in clist_init_states to make sure the buffer is large enough */
@@ -20,6 +20,7 @@
 #include "gserrors.h"
 #include "gxclmem.h"
 #include "gssprintf.h"
+#include "slzbx.h"
 
 #include "valgrind.h"
 
@@ -180,6 +181,9 @@ int64_t tot_raw;
 int64_t tot_cache_miss;
 int64_t tot_cache_hits;
 int64_t tot_swap_out;
+int64_t tot_compress_blocks;
+int64_t tot_compress_time;	/* nanoseconds */
+int64_t tot_decompress_time;
 
 /*
    The following pointers are here only for helping with a dumb debugger
@@ -190,8 +194,54 @@ const byte *decomp_rd_ptr0, *decomp_rd_limit0;
 byte *decomp_wt_ptr1, *decomp_wt_limit1;
 const byte *decomp_rd_ptr1, *decomp_rd_limit1;
 
+static int64_t
+memfile_time_ns(void)
+{
+    long t[2];
+
+    gp_get_realtime(t);
+    return (int64_t)t[0] * 1000000000 + t[1];
+}
+
 #endif
 
+/* ------------------------- Compressor selection ---------------------- */
+
+/*
+ * The default compressor is chosen at build time (BAND_LIST_COMPRESSOR),
+ * the fast one trades compression ratio for much less CPU time, which
+ * matters since blocks are decompressed again for every band that reads
+ * them.
+ */
+static const stream_template *
+memfile_compressor_template(const MEMFILE *f)
+{
+    return (f->compression == clist_compression_fast ? &s_LZBE_template :
+            clist_compressor_template());
+}
+static const stream_template *
+memfile_decompressor_template(const MEMFILE *f)
+{
+    return (f->compression == clist_compression_fast ? &s_LZBD_template :
+            clist_decompressor_template());
+}
+static void
+memfile_compressor_init(const MEMFILE *f, stream_state *state)
+{
+    if (f->compression == clist_compression_fast)
+        state->templat = &s_LZBE_template;
+    else
+        clist_compressor_init(state);
+}
+static void
+memfile_decompressor_init(const MEMFILE *f, stream_state *state)
+{
+    if (f->compression == clist_compression_fast)
+        state->templat = &s_LZBD_template;
+    else
+        clist_decompressor_init(state);
+}
+
 /* ----------------------------- Memory Allocation --------------------- */
 static void *   /* allocated memory's address, 0 if failure */
 allocateWithReserve(
@@ -238,7 +288,8 @@ allocateWithReserve(
 static int
 memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
               clist_file_ptr /*MEMFILE * */  * pf,
-              gs_memory_t *mem, gs_memory_t *data_mem, bool ok_to_compress)
+              gs_memory_t *mem, gs_memory_t *data_mem,
+              clist_compression_t compression)
 {
     MEMFILE *f = NULL;
     int code = 0;
@@ -297,7 +348,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                 LOG_MEMFILE_BLK *log_block, *new_log_block;
                 int i;
                 int num_log_blocks = (f->log_length + MEMFILE_DATA_SIZE - 1) / MEMFILE_DATA_SIZE;
-                const stream_template *decompress_template = clist_decompressor_template();
+                const stream_template *decompress_template = memfile_decompressor_template(f);
 
                 new_log_block = MALLOC(f, num_log_blocks * sizeof(LOG_MEMFILE_BLK), "memfile_fopen" );
                 if (new_log_block == NULL) {
@@ -325,7 +376,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                     code = gs_note_error(gs_error_VMerror);
                     goto finish;
                 }
-                clist_decompressor_init(f->decompress_state);
+                memfile_decompressor_init(f, f->decompress_state);
                 f->decompress_state->memory = mem;
                 if (decompress_template->set_defaults)
                     (*decompress_template->set_defaults) (f->decompress_state);
@@ -364,15 +415,16 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     if ((code = memfile_set_memory_warning(f, 0)) < 0)
         goto finish;
     /*
-     * Disregard the ok_to_compress flag, since the size threshold gives us
-     * a much better criterion for deciding when compression is appropriate.
+     * Always allow compression, since the size threshold gives us a much
+     * better criterion for deciding when compression is appropriate.
      */
-    f->ok_to_compress = /*ok_to_compress */ true;
+    f->ok_to_compress = true;
+    f->compression = compression;
     f->compress_state = 0;      /* make clean for GC */
     f->decompress_state = 0;
     if (f->ok_to_compress) {
-        const stream_template *compress_template = clist_compressor_template();
-        const stream_template *decompress_template = clist_decompressor_template();
+        const stream_template *compress_template = memfile_compressor_template(f);
+        const stream_template *decompress_template = memfile_decompressor_template(f);
 
         f->compress_state =
             gs_alloc_struct(mem, stream_state, compress_template->stype,
@@ -387,8 +439,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             code = gs_note_error(gs_error_VMerror);
             goto finish;
         }
-        clist_compressor_init(f->compress_state);
-        clist_decompressor_init(f->decompress_state);
+        memfile_compressor_init(f, f->compress_state);
+        memfile_decompressor_init(f, f->decompress_state);
         f->compress_state->memory = mem;
         f->decompress_state->memory = mem;
         if (compress_template->set_defaults)
@@ -408,6 +460,9 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
         tot_cache_miss = 0;
         tot_cache_hits = 0;
         tot_swap_out = 0;
+        tot_compress_blocks = 0;
+        tot_compress_time = 0;
+        tot_decompress_time = 0;
 #endif
 
 finish:
@@ -454,23 +509,20 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
             /* If the file is compressed, free the logical blocks, but not */
             /* the phys_blk info (that is still used by the base memfile   */
             if (f->log_head->phys_blk->data_limit != NULL) {
-                LOG_MEMFILE_BLK *tmpbp, *bp = f->log_head;
-
-                while (bp != NULL) {
-                    tmpbp = bp->link;
-                    FREE(f, bp, "memfile_free_mem(log_blk)");
-                    bp = tmpbp;
-                }
+                /* memfile_fopen copied the logical blocks into one array */
+                FREE(f, f->log_head, "memfile_free_mem(log_blk)");
                 f->log_head = NULL;
 
-                /* Free any internal compressor state. */
+                /* Free the decompressor state (reader instances don't */
+                /* have a compressor). */
                 if (f->compressor_initialized) {
                     if (f->decompress_state->templat->release != 0)
                         (*f->decompress_state->templat->release) (f->decompress_state);
-                    if (f->compress_state->templat->release != 0)
-                        (*f->compress_state->templat->release) (f->compress_state);
                     f->compressor_initialized = false;
                 }
+                gs_free_object(f->memory, f->decompress_state,
+                               "memfile_fclose(decompress_state)");
+                f->decompress_state = NULL;
                 /* free the raw buffers                                           */
                 while (f->raw_head != NULL) {
                     RAW_BUFFER *tmpraw = f->raw_head->fwd;
@@ -615,6 +667,9 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
     long compressed_size;
     byte *start_ptr;
     PHYS_MEMFILE_BLK *newphys;
+#ifdef DEBUG
+    int64_t start_time = memfile_time_ns();
+#endif
 
     /* compress this block */
     f->rd.ptr = (const byte *)(bp->phys_blk->data) - 1;
@@ -671,6 +726,8 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
     }
 #ifdef DEBUG
     tot_compressed += compressed_size;
+    tot_compress_blocks++;
+    tot_compress_time += memfile_time_ns() - start_time;
 #endif
     return (status < 0 ? gs_note_error(gs_error_ioerror) : ecode);
 }                               /* end "compress_log_blk()"                                     */
@@ -904,6 +961,8 @@ memfile_get_pdata(MEMFILE * f)
         }                       /* end allocating the raw buffer pool (first time only)           */
         if (bp->raw_block == NULL) {
 #ifdef DEBUG
+            int64_t start_time = memfile_time_ns();
+
             tot_cache_miss++;   /* count every decompress       */
 #endif
             /* find a raw buffer and decompress                            */
@@ -968,6 +1027,9 @@ memfile_get_pdata(MEMFILE * f)
                 }
             }
             bp->raw_block = f->raw_head;        /* point to raw block           */
+#ifdef DEBUG
+            tot_decompress_time += memfile_time_ns() - start_time;
+#endif
         }
         /* end if( raw_block == NULL ) meaning need to decompress data    */
         else {
@@ -1136,6 +1198,16 @@ memfile_free_mem(MEMFILE * f)
             if_debug2m(':', f->memory, "[:]tot_raw=%lu, tot_compressed=%lu\n",
                        tot_raw, tot_compressed);
     }
+    if (tot_compress_blocks > 0 && tot_compress_time > 0 && tot_decompress_time > 0) {
+        /* To compare the compressors, run the same job with -Z: and */
+        /* -sBandListStorage=memory -sBandListCompression=default|fast */
+        if_debug4m(':', f->memory,
+                   "[:]%s compressor: ratio=%.3f, compress=%.1fMB/s, decompress=%.1fMB/s\n",
+                   (f->compression == clist_compression_fast ? "fast" : "default"),
+                   (double)tot_compressed / (tot_compress_blocks * MEMFILE_DATA_SIZE),
+                   tot_compress_blocks * MEMFILE_DATA_SIZE * 1000.0 / tot_compress_time,
+                   tot_cache_miss * MEMFILE_DATA_SIZE * 1000.0 / tot_decompress_time);
+    }
     if (tot_cache_hits != 0) {
         if_debug3m(':', f->memory, "[:]Cache hits=%lu, cache misses=%lu, swapouts=%lu\n",
                    tot_cache_hits,
@@ -1144,6 +1216,9 @@ memfile_free_mem(MEMFILE * f)
     }
     tot_raw = 0;
     tot_compressed = 0;
+    tot_compress_blocks = 0;
+    tot_compress_time = 0;
+    tot_decompress_time = 0;
     tot_cache_hits = 0;
     tot_cache_miss = 0;
     tot_swap_out = 0;
@@ -60,6 +60,7 @@ do_page_save(gx_device_printer * pdev, gx_saved_page * page, clist_file_ptr *sav
     /* Now serialize and save the rest of the information from the device params */
     /* we count on this to correctly set the color_info, devn_params and icc_struct */
     page->mem = pdev->memory->non_gc_memory;
+    page->use_device_output_file = false;
     gs_c_param_list_write(&paramlist, pdev->memory);
     if ((code = gs_getdeviceparams((gx_device *)pdev, (gs_param_list *)&paramlist)) < 0) {
         goto params_out;
@@ -86,6 +87,7 @@ params_out:
     /* Save other information. */
     /* If this device has spot colors that were added dynamically, we need to pass the names */
     /* through as well. These are from the devn_params->separations->names array.            */
+    page->num_separations = 0;
     if ((pdevn_params = dev_proc(pdev, ret_devn_params)((gx_device *)pdev)) != NULL) {
         int i;
 
@@ -213,9 +215,34 @@ gx_saved_pages_list_new(gx_device_printer *pdev)
     newlist->mem = non_gc_mem;
     newlist->PageCount = pdev->PageCount;	/* PageCount when list created */
     newlist->collated_copies = 1;
+    /* Saved pages may be printed after the device has been closed, or */
+    /* written to a file, so they can't refer to the tile dictionary. */
+    pdev->clist_disable_mask |= clist_disable_tile_dict;
+    if (PRINTER_IS_CLIST(pdev))
+        ((gx_device_clist_writer *)pdev)->disable_mask |= clist_disable_tile_dict;
     return newlist;
 }
 
+/* Link a saved page on to the end of a list */
+static void
+saved_pages_list_append(gx_saved_pages_list *list, gx_saved_pages_list_element *new_list_element,
+                        gx_saved_page *newpage)
+{
+    new_list_element->sequence_number = ++list->count;
+    new_list_element->page = newpage;
+    new_list_element->next = NULL;
+    if (list->tail == NULL) {
+        /* list was empty, start it */
+        new_list_element->prev = NULL;
+        list->head = list->tail = new_list_element;
+    } else {
+        /* place as new tail */
+        new_list_element->prev = list->tail;
+        list->tail->next = new_list_element;
+        list->tail = new_list_element;
+    }
+}
+
 /*
  * Add a new saved page to the end of an in memory list. Refer to the
  * documentation for gx_saved_pages_list. This allocates the saved_
@@ -250,19 +277,7 @@ gx_saved_pages_list_add(gx_device_printer * pdev)
         gs_free_object(list->mem, newpage, "gx_saved_pages_list_add");
         return code;
     }
-    new_list_element->sequence_number = ++list->count;
-    new_list_element->page = newpage;
-    new_list_element->next = NULL;
-    if (list->tail == NULL) {
-        /* list was empty, start it */
-        new_list_element->prev = NULL;
-        list->head = list->tail = new_list_element;
-    } else {
-        /* place as new tail */
-        new_list_element->prev = list->tail;
-        list->tail->next = new_list_element;
-        list->tail = new_list_element;
-    }
+    saved_pages_list_append(list, new_list_element, newpage);
     return 0;			/* success */
 }
 
@@ -293,6 +308,539 @@ gx_saved_pages_list_free(gx_saved_pages_list *list)
 }
 
 
+/* ------ Saved page files ------ */
+
+/*
+ * A saved pages file holds the band lists of the pages on a list, so that
+ * they can be printed by a later run without interpreting the job again.
+ * The header and the per page entries are written field by field, most
+ * significant byte first, but the band list data is written as is, so the
+ * file can only be read back by the same build of Ghostscript, on a device
+ * with the same color representation. The file consists of:
+ *
+ *	magic (8 bytes), version (4), native byte order marker (4), count (4)
+ *
+ * then for each page an entry:
+ *
+ *	dname (32 bytes), cm_name (32),
+ *	num_components, max_components, depth, polarity, gray_index,
+ *	  max_gray, max_color, tag (4 each),
+ *	tile_cache_size (8), bfile_end_pos (8),
+ *	BandWidth (4), BandHeight (4), BandBufferSpace (8), band
+ *	  tile_cache_size (8),
+ *	paramlist_len (4), num_separations (4), cfile_size (8), bfile_size (8)
+ *
+ * followed by the serialized device parameters, the separation names (each
+ * a 4 byte size and the name), the command file and the block file.
+ */
+#define SAVED_PAGES_FILE_MAGIC "GSCLPAGE"
+#define SAVED_PAGES_FILE_VERSION 2
+#define SAVED_PAGES_FILE_BYTE_ORDER 0x01020304
+#define SAVED_PAGES_NAME_SIZE 32
+#define SAVED_PAGES_COPY_SIZE 65536
+
+typedef struct saved_pages_file_entry_s {
+    char dname[SAVED_PAGES_NAME_SIZE];
+    char cm_name[SAVED_PAGES_NAME_SIZE];
+    gx_device_color_info color_info;	/* only the members we write */
+    gs_graphics_type_tag_t tag;
+    int64_t tile_cache_size;
+    int64_t bfile_end_pos;
+    int64_t BandWidth;
+    int64_t BandHeight;
+    int64_t BandBufferSpace;
+    int64_t band_tile_cache_size;
+    int64_t paramlist_len;
+    int64_t num_separations;
+    int64_t cfile_size;
+    int64_t bfile_size;
+} saved_pages_file_entry;
+
+static int
+saved_pages_file_put(gp_file *f, const void *data, uint size)
+{
+    if (size > 0 && gp_fwrite(data, 1, size, f) != size)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+static int
+saved_pages_file_get(gp_file *f, void *data, uint size)
+{
+    if (size > 0 && gp_fread(data, 1, size, f) != size)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+/* Write a signed integer of size (4 or 8) bytes, most significant first. */
+static int
+saved_pages_file_put_int(gp_file *f, int64_t value, int size)
+{
+    byte data[8];
+    uint64_t v = (uint64_t)value;
+    int i;
+
+    for (i = size - 1; i >= 0; i--, v >>= 8)
+        data[i] = (byte)v;
+    return saved_pages_file_put(f, data, size);
+}
+
+/* Read a signed integer written by saved_pages_file_put_int. */
+static int
+saved_pages_file_get_int(gp_file *f, int64_t *pvalue, int size)
+{
+    byte data[8];
+    uint64_t v = 0;
+    int i, code = saved_pages_file_get(f, data, size);
+
+    if (code < 0)
+        return code;
+    for (i = 0; i < size; i++)
+        v = (v << 8) + data[i];
+    if (size < 8 && (data[0] & 0x80))
+        v -= (uint64_t)1 << (size * 8);	/* sign extend */
+    *pvalue = (int64_t)v;
+    return 0;
+}
+
+static int
+saved_pages_file_put_entry(gp_file *f, const saved_pages_file_entry *entry)
+{
+    const gx_device_color_info *ci = &entry->color_info;
+    int code = saved_pages_file_put(f, entry->dname, sizeof(entry->dname));
+
+    if (code >= 0)
+        code = saved_pages_file_put(f, entry->cm_name, sizeof(entry->cm_name));
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->num_components, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->max_components, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->depth, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->polarity, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->gray_index, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->max_gray, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, ci->max_color, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->tag, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->tile_cache_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->bfile_end_pos, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->BandWidth, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->BandHeight, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->BandBufferSpace, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->band_tile_cache_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->paramlist_len, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->num_separations, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->cfile_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, entry->bfile_size, 8);
+    return code;
+}
+
+/* Read an entry written by saved_pages_file_put_entry. */
+static int
+saved_pages_file_get_entry(gp_file *f, saved_pages_file_entry *entry)
+{
+    gx_device_color_info *ci = &entry->color_info;
+    int64_t v[8];
+    int i, code;
+
+    memset(entry, 0, sizeof(*entry));
+    code = saved_pages_file_get(f, entry->dname, sizeof(entry->dname));
+    if (code >= 0)
+        code = saved_pages_file_get(f, entry->cm_name, sizeof(entry->cm_name));
+    for (i = 0; i < countof(v) && code >= 0; i++)
+        code = saved_pages_file_get_int(f, &v[i], 4);
+    if (code < 0)
+        return code;
+    if (v[0] < 0 || v[0] > GX_DEVICE_COLOR_MAX_COMPONENTS ||
+        v[1] < 0 || v[1] > GX_DEVICE_COLOR_MAX_COMPONENTS ||
+        v[2] < 0 || v[2] > max_ushort ||
+        v[3] < GX_CINFO_POLARITY_UNKNOWN || v[3] > GX_CINFO_POLARITY_ADDITIVE ||
+        v[4] < 0 || v[4] > 0xff || v[5] < 0 || v[5] > max_uint ||
+        v[6] < 0 || v[6] > max_uint)
+        return_error(gs_error_rangecheck);
+    entry->dname[sizeof(entry->dname) - 1] = 0;
+    entry->cm_name[sizeof(entry->cm_name) - 1] = 0;
+    ci->cm_name = entry->cm_name;
+    ci->num_components = (uchar)v[0];
+    ci->max_components = (uchar)v[1];
+    ci->depth = (ushort)v[2];
+    ci->polarity = (gx_color_polarity_t)v[3];
+    ci->gray_index = (byte)v[4];
+    ci->max_gray = (uint)v[5];
+    ci->max_color = (uint)v[6];
+    entry->tag = (gs_graphics_type_tag_t)v[7];
+    code = saved_pages_file_get_int(f, &entry->tile_cache_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->bfile_end_pos, 8);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->BandWidth, 4);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->BandHeight, 4);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->BandBufferSpace, 8);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->band_tile_cache_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->paramlist_len, 4);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->num_separations, 4);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->cfile_size, 8);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &entry->bfile_size, 8);
+    return code;
+}
+
+/*
+ * Check the parts of an entry that the band list reader relies on. The
+ * buffer space holds the tile cache and at least one band, and the block
+ * file ends with the terminating cmd_block at bfile_end_pos.
+ */
+static bool
+saved_pages_file_entry_valid(const saved_pages_file_entry *entry)
+{
+    return entry->BandWidth > 0 && entry->BandHeight > 0 &&
+           entry->BandBufferSpace > 0 && entry->BandBufferSpace <= max_uint &&
+           entry->band_tile_cache_size >= 0 &&
+           entry->tile_cache_size > 0 &&
+           entry->tile_cache_size < entry->BandBufferSpace &&
+           entry->paramlist_len > 0 && entry->paramlist_len <= max_int &&
+           entry->num_separations >= 0 &&
+           entry->num_separations <= GX_DEVICE_MAX_SEPARATIONS &&
+           entry->cfile_size >= 0 && entry->bfile_size >= 0 &&
+           entry->bfile_end_pos >= (int64_t)sizeof(cmd_block) &&
+           entry->bfile_end_pos <= entry->bfile_size;
+}
+
+/* Return the size of one of the band list files of a saved page. */
+static int64_t
+saved_page_file_size(const gx_saved_page *page, char *fname, gs_memory_t *mem,
+                     clist_compression_t compression)
+{
+    clist_file_ptr cf;
+    int64_t size;
+    int code = page->io_procs->fopen(fname, gp_fmode_rb, &cf, mem, mem, compression);
+
+    if (code < 0)
+        return code;
+    code = page->io_procs->fseek(cf, 0, SEEK_END, fname);
+    size = page->io_procs->ftell(cf);
+    page->io_procs->fclose(cf, fname, false);
+    return (code < 0 ? code : size);
+}
+
+/* Copy one of the band list files of a saved page to f. */
+static int
+saved_page_file_copy_out(gp_file *f, const gx_saved_page *page, char *fname, int64_t size,
+                         byte *buf, gs_memory_t *mem, clist_compression_t compression)
+{
+    clist_file_ptr cf;
+    int code = page->io_procs->fopen(fname, gp_fmode_rb, &cf, mem, mem, compression);
+
+    if (code < 0)
+        return code;
+    /* A memory file that isn't open is reused as is, at its last position. */
+    code = page->io_procs->fseek(cf, 0, SEEK_SET, fname);
+    while (size > 0 && code >= 0) {
+        uint count = (uint)min(size, SAVED_PAGES_COPY_SIZE);
+
+        if (page->io_procs->fread_chars(buf, count, cf) != count)
+            code = gs_note_error(gs_error_ioerror);
+        else
+            code = saved_pages_file_put(f, buf, count);
+        size -= count;
+    }
+    page->io_procs->fclose(cf, fname, false);
+    return code;
+}
+
+/* Make a new band list file, with the next size bytes of f. */
+static int
+saved_page_file_copy_in(gp_file *f, gx_saved_page *page, char *fname, int64_t size,
+                        byte *buf, gs_memory_t *mem, clist_compression_t compression)
+{
+    clist_file_ptr cf;
+    char fmode[4];
+    int code;
+
+    strcpy(fmode, "w+");
+    strcat(fmode, gp_fmode_binary_suffix);
+    fname[0] = 0;		/* a new scratch file */
+    code = page->io_procs->fopen(fname, fmode, &cf, mem, mem, compression);
+    if (code < 0)
+        return code;
+    while (size > 0 && code >= 0) {
+        uint count = (uint)min(size, SAVED_PAGES_COPY_SIZE);
+
+        code = saved_pages_file_get(f, buf, count);
+        if (code >= 0 && page->io_procs->fwrite_chars(buf, count, cf) != count)
+            code = gs_note_error(gs_error_ioerror);
+        if (code >= 0)
+            code = page->io_procs->ferror_code(cf);
+        size -= count;
+    }
+    page->io_procs->fclose(cf, fname, code < 0);
+    if (code < 0)
+        fname[0] = 0;		/* deleted by fclose */
+    return code;
+}
+
+/*
+ * Write the pages of a list to a file, to be added to a list later by
+ * gx_saved_pages_list_read. The list is not changed.
+ */
+int
+gx_saved_pages_list_write(gx_device_printer *pdev, gx_saved_pages_list *list,
+                          const char *fname)
+{
+    gs_memory_t *mem = pdev->memory->non_gc_memory;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)pdev;
+    clist_compression_t compression = cdev->page_info.compression;
+    uint32_t byte_order = SAVED_PAGES_FILE_BYTE_ORDER;
+    gx_saved_pages_list_element *elem;
+    byte *buf;
+    gp_file *f;
+    int code = 0;
+
+    buf = gs_alloc_bytes(mem, SAVED_PAGES_COPY_SIZE, "gx_saved_pages_list_write");
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    f = gp_fopen(pdev->memory, fname, "wb");
+    if (f == NULL) {
+        gs_free_object(mem, buf, "gx_saved_pages_list_write");
+        return_error(gs_error_invalidfileaccess);
+    }
+    code = saved_pages_file_put(f, SAVED_PAGES_FILE_MAGIC, 8);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, SAVED_PAGES_FILE_VERSION, 4);
+    /* The band list data is native, so it needs the same byte order. */
+    if (code >= 0)
+        code = saved_pages_file_put(f, &byte_order, 4);
+    if (code >= 0)
+        code = saved_pages_file_put_int(f, list->count, 4);
+    for (elem = list->head; elem != NULL && code >= 0; elem = elem->next) {
+        gx_saved_page *page = elem->page;
+        saved_pages_file_entry entry;
+        int i;
+
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.dname, page->dname, sizeof(entry.dname));
+        if (page->color_info.cm_name != NULL)
+            strncpy(entry.cm_name, page->color_info.cm_name, sizeof(entry.cm_name) - 1);
+        entry.color_info = page->color_info;
+        entry.tag = page->tag;
+        entry.tile_cache_size = page->tile_cache_size;
+        entry.bfile_end_pos = page->bfile_end_pos;
+        entry.BandWidth = page->band_params.BandWidth;
+        entry.BandHeight = page->band_params.BandHeight;
+        entry.BandBufferSpace = page->band_params.BandBufferSpace;
+        entry.band_tile_cache_size = page->band_params.tile_cache_size;
+        entry.paramlist_len = page->paramlist_len;
+        entry.num_separations = page->num_separations;
+        entry.cfile_size = saved_page_file_size(page, page->cfname, mem, compression);
+        entry.bfile_size = saved_page_file_size(page, page->bfname, mem, compression);
+        if (entry.cfile_size < 0 || entry.bfile_size < 0) {
+            code = (int)min(entry.cfile_size, entry.bfile_size);
+            break;
+        }
+        code = saved_pages_file_put_entry(f, &entry);
+        if (code >= 0)
+            code = saved_pages_file_put(f, page->paramlist, page->paramlist_len);
+        for (i = 0; i < page->num_separations && code >= 0; i++) {
+            code = saved_pages_file_put_int(f, page->separation_name_sizes[i], 4);
+            if (code >= 0)
+                code = saved_pages_file_put(f, page->separation_names[i],
+                                            page->separation_name_sizes[i]);
+        }
+        if (code >= 0)
+            code = saved_page_file_copy_out(f, page, page->cfname, entry.cfile_size,
+                                            buf, mem, compression);
+        if (code >= 0)
+            code = saved_page_file_copy_out(f, page, page->bfname, entry.bfile_size,
+                                            buf, mem, compression);
+    }
+    if (gp_fclose(f) != 0 && code >= 0)
+        code = gs_note_error(gs_error_ioerror);
+    gs_free_object(mem, buf, "gx_saved_pages_list_write");
+    return code;
+}
+
+/*
+ * Check that a page from a file can be rendered by the device. The page's
+ * device parameters are put when it is printed, so we only need the color
+ * representation of the band list data to agree (some of the other members
+ * of color_info, e.g. opmode, are only set once a page is being drawn).
+ */
+static bool
+saved_page_color_compatible(const gx_device_color_info *p1, const gx_device_color_info *p2)
+{
+    return p1->num_components == p2->num_components &&
+           p1->max_components == p2->max_components &&
+           p1->depth == p2->depth &&
+           p1->polarity == p2->polarity &&
+           p1->gray_index == p2->gray_index &&
+           p1->max_gray == p2->max_gray &&
+           p1->max_color == p2->max_color &&
+           strcmp(p1->cm_name, p2->cm_name) == 0;
+}
+
+/* Free a saved page that was being read, and delete its files. */
+static void
+saved_page_free(gx_saved_page *page, gs_memory_t *mem)
+{
+    int i;
+
+    if (page->cfname[0] != 0)
+        page->io_procs->unlink(page->cfname);
+    if (page->bfname[0] != 0)
+        page->io_procs->unlink(page->bfname);
+    for (i = 0; i < page->num_separations; i++)
+        gs_free_object(page->mem, page->separation_names[i], "saved_page separation_names");
+    gs_free_object(page->mem, page->paramlist, "saved_page paramlist");
+    gs_free_object(mem, page, "gx_saved_pages_list_read");
+}
+
+/*
+ * Add the pages in a file written by gx_saved_pages_list_write to the end
+ * of a list. The pages get new band list files, in the device's band list
+ * storage.
+ */
+int
+gx_saved_pages_list_read(gx_device_printer *pdev, gx_saved_pages_list *list,
+                         const char *fname)
+{
+    gs_memory_t *mem = pdev->memory->non_gc_memory;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)pdev;
+    clist_compression_t compression = cdev->page_info.compression;
+    char magic[8];
+    uint32_t byte_order;
+    int64_t version, count = 0;
+    byte *buf;
+    gp_file *f;
+    int i, code;
+
+    buf = gs_alloc_bytes(mem, SAVED_PAGES_COPY_SIZE, "gx_saved_pages_list_read");
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    f = gp_fopen(pdev->memory, fname, "rb");
+    if (f == NULL) {
+        gs_free_object(mem, buf, "gx_saved_pages_list_read");
+        return_error(gs_error_undefinedfilename);
+    }
+    code = saved_pages_file_get(f, magic, sizeof(magic));
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &version, 4);
+    if (code >= 0)
+        code = saved_pages_file_get(f, &byte_order, 4);
+    if (code >= 0)
+        code = saved_pages_file_get_int(f, &count, 4);
+    if (code >= 0 &&
+        (memcmp(magic, SAVED_PAGES_FILE_MAGIC, sizeof(magic)) != 0 ||
+         version != SAVED_PAGES_FILE_VERSION ||
+         byte_order != SAVED_PAGES_FILE_BYTE_ORDER || count < 0)) {
+        emprintf1(pdev->memory, "gx_saved_pages_list_read: '%s' is not a saved pages file for this version.\n",
+                  fname);
+        code = gs_note_error(gs_error_ioerror);
+    }
+    for (i = 0; i < count && code >= 0; i++) {
+        saved_pages_file_entry entry;
+        gx_saved_page *page;
+        gx_saved_pages_list_element *elem = NULL;
+        int j;
+
+        code = saved_pages_file_get_entry(f, &entry);
+        if (code == gs_error_ioerror)
+            break;
+        if (code < 0 || !saved_pages_file_entry_valid(&entry) ||
+            !saved_page_color_compatible(&entry.color_info, &pdev->color_info)) {
+            emprintf2(pdev->memory, "gx_saved_pages_list_read: page %d of '%s' is invalid or doesn't match the device.\n",
+                      i + 1, fname);
+            code = gs_note_error(gs_error_rangecheck);
+            break;
+        }
+        page = (gx_saved_page *)gs_alloc_bytes(mem, sizeof(gx_saved_page), "gx_saved_pages_list_read");
+        if (page == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            break;
+        }
+        memset(page, 0, sizeof(*page));
+        memcpy(page->dname, entry.dname, sizeof(page->dname));
+        page->dname[sizeof(page->dname) - 1] = 0;
+        page->color_info = pdev->color_info;
+        page->tag = entry.tag;
+        page->io_procs = cdev->page_info.io_procs;
+        page->tile_cache_size = (uint)entry.tile_cache_size;
+        page->bfile_end_pos = entry.bfile_end_pos;
+        page->band_params.BandWidth = (int)entry.BandWidth;
+        page->band_params.BandHeight = (int)entry.BandHeight;
+        page->band_params.BandBufferSpace = (size_t)entry.BandBufferSpace;
+        page->band_params.tile_cache_size = (size_t)entry.band_tile_cache_size;
+        page->mem = mem;
+        page->use_device_output_file = true;
+        page->paramlist_len = (int)entry.paramlist_len;
+        page->paramlist = gs_alloc_bytes(mem, page->paramlist_len, "saved_page paramlist");
+        if (page->paramlist == NULL)
+            code = gs_note_error(gs_error_VMerror);
+        else
+            code = saved_pages_file_get(f, page->paramlist, page->paramlist_len);
+        for (j = 0; j < entry.num_separations && code >= 0; j++) {
+            int64_t size;
+
+            code = saved_pages_file_get_int(f, &size, 4);
+            if (code < 0)
+                break;
+            if (size < 0 || size > 1024) {
+                code = gs_note_error(gs_error_rangecheck);
+                break;
+            }
+            page->separation_names[j] = gs_alloc_bytes(mem, (uint)size, "saved_page separation_names");
+            if (page->separation_names[j] == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                break;
+            }
+            page->separation_name_sizes[j] = (int)size;
+            page->num_separations = j + 1;
+            code = saved_pages_file_get(f, page->separation_names[j], (uint)size);
+        }
+        if (code >= 0)
+            code = saved_page_file_copy_in(f, page, page->cfname, entry.cfile_size,
+                                           buf, mem, compression);
+        if (code >= 0)
+            code = saved_page_file_copy_in(f, page, page->bfname, entry.bfile_size,
+                                           buf, mem, compression);
+        if (code >= 0) {
+            elem = (gx_saved_pages_list_element *)gs_alloc_bytes(list->mem,
+                            sizeof(gx_saved_pages_list_element), "gx_saved_pages_list_read");
+            if (elem == NULL)
+                code = gs_note_error(gs_error_VMerror);
+        }
+        if (code < 0) {
+            saved_page_free(page, mem);
+            break;
+        }
+        saved_pages_list_append(list, elem, page);
+    }
+    gp_fclose(f);
+    gs_free_object(mem, buf, "gx_saved_pages_list_read");
+    return code;
+}
+
+
 /* This enum has to be in the same order as saved_pages_keys */
 typedef enum {
     PARAM_UNKNOWN = 0,
@@ -306,6 +854,8 @@ typedef enum {
     PARAM_EVEN,
     PARAM_EVEN0PAD,
     PARAM_ODD,
+    PARAM_WRITE,
+    PARAM_READ,
     /* any new keywords precede these */
     PARAM_NUMBER,
     PARAM_DASH,
@@ -317,7 +867,8 @@ param_find_key(byte *token, int token_size)
 {
     int i;
     static const char *saved_pages_keys[] = {
-        "begin", "end", "flush", "print", "copies", "normal", "reverse", "even", "even0pad", "odd"
+        "begin", "end", "flush", "print", "copies", "normal", "reverse", "even", "even0pad", "odd",
+        "write", "read"
     };
     saved_pages_key_enum found = PARAM_UNKNOWN;
 
@@ -385,6 +936,24 @@ param_parse_token(byte *param, int param_left, int *token_size)
     return token;
 }
 
+/* Find the file name following 'write' or 'read', which is the next   */
+/* run of characters other than white-space, updating 'token_size'.    */
+/* Returns NULL and token_size = 0 if there is no file name.            */
+static byte *
+param_parse_file_name(byte *param, int param_left, int *token_size)
+{
+    int token_len = 0;
+
+    while (param_left > 0 && isspace(*param)) {
+        param++;
+        param_left--;
+    }
+    while (token_len < param_left && !isspace(param[token_len]))
+        token_len++;
+    *token_size = token_len;
+    return (token_len == 0 ? NULL : param);
+}
+
 static int
 do_page_load(gx_device_printer *pdev, gx_saved_page *page, clist_file_ptr *save_files)
 {
@@ -397,6 +966,18 @@ do_page_load(gx_device_printer *pdev, gx_saved_page *page, clist_file_ptr *save_
     gs_c_param_list_write(&paramlist, pdev->memory);
     if ((code = gs_param_list_unserialize((gs_param_list *)&paramlist, page->paramlist)) < 0)
         goto out;
+    if (page->use_device_output_file) {
+        /* This is found before the saved OutputFile, which it overrides */
+        gs_param_string ofns;
+
+        ofns.data = (const byte *)pdev->fname;
+        ofns.size = strlen(pdev->fname);
+        ofns.persistent = false;
+        if ((code = param_write_string((gs_param_list *)&paramlist, "OutputFile", &ofns)) < 0) {
+            gs_c_param_list_release(&paramlist);
+            goto out;
+        }
+    }
     gs_c_param_list_read(&paramlist);
     code = gs_putdeviceparams((gx_device *)pdev, (gs_param_list *)&paramlist);
     gs_c_param_list_release(&paramlist);
@@ -455,6 +1036,13 @@ do_page_load(gx_device_printer *pdev, gx_saved_page *page, clist_file_ptr *save_
     crdev->num_pages = 1;		/* single page at a time */
     crdev->offset_map = NULL;
     crdev->render_threads = NULL;
+    crdev->reorder_slots = NULL;
+    crdev->num_reorder_slots = 0;
+    crdev->band_units = NULL;
+    crdev->num_band_units = 0;
+    crdev->band_first_unit = NULL;
+    crdev->split_band_buffer = NULL;
+    crdev->blank_band_state = 0;
     crdev->ymin = crdev->ymax = 0;      /* invalidate buffer contents to force rasterizing */
 
     /* We probably don't need to copy in the filenames, but do it in case something expects it */
@@ -482,11 +1070,11 @@ gx_saved_page_load(gx_device_printer *pdev, gx_saved_page *page)
     /* Now open this page's files */
     code = crdev->page_info.io_procs->fopen(crdev->page_info.cfname,
                gp_fmode_rb, &(crdev->page_info.cfile), crdev->bandlist_memory,
-               crdev->bandlist_memory, true);
+               crdev->bandlist_memory, crdev->page_info.compression);
     if (code >= 0) {
         code = crdev->page_info.io_procs->fopen(crdev->page_info.bfname,
                    gp_fmode_rb, &(crdev->page_info.bfile), crdev->bandlist_memory,
-                   crdev->bandlist_memory, false);
+                   crdev->bandlist_memory, crdev->page_info.compression);
     }
 
     return code;
@@ -740,6 +1328,8 @@ gx_saved_pages_list_print(gx_device_printer *pdev, gx_saved_pages_list *list,
               case PARAM_END:
               case PARAM_FLUSH:
               case PARAM_PRINT:
+              case PARAM_WRITE:
+              case PARAM_READ:
                 token_size = 0;			/* non-print range token seen */
             }
             if (end_page > 0) {
@@ -929,6 +1519,39 @@ gx_saved_pages_param_process(gx_device_printer *pdev, byte *param, int param_siz
             token_size += code;
             break;
 
+          case PARAM_WRITE:
+          case PARAM_READ:
+            {
+                bool write = (tolower(*token) == 'w');
+                char *fname;
+
+                /* make sure that we have a list */
+                if (pdev->saved_pages_list == NULL) {
+                    return_error(gs_error_rangecheck);	/* write/read not allowed before a 'begin' */
+                }
+                /* Move to past 'write' or 'read' token */
+                param_left -= token - param_scan + token_size;
+                param_scan = token + token_size;
+
+                if ((token = param_parse_file_name(param_scan, param_left, &token_size)) == NULL) {
+                    emprintf(pdev->memory, "gx_saved_pages_param_process: write or read not followed by a file name.\n");
+                    return_error(gs_error_typecheck);
+                }
+                fname = (char *)gs_alloc_bytes(pdev->memory, token_size + 1, "saved_pages_param_process");
+                if (fname == NULL)
+                    return_error(gs_error_VMerror);
+                memcpy(fname, token, token_size);
+                fname[token_size] = 0;
+                if (write)
+                    code = gx_saved_pages_list_write(pdev, pdev->saved_pages_list, fname);
+                else
+                    code = gx_saved_pages_list_read(pdev, pdev->saved_pages_list, fname);
+                gs_free_object(pdev->memory, fname, "saved_pages_param_process");
+                if (code < 0)
+                    return code;
+            }
+            break;
+
           /* We are expecting an action keyword, so other keywords and tokens */
           /* are not valid here (mostly the 'print' parameters).              */
           default:
@@ -90,6 +90,17 @@ int gx_saved_pages_list_add(gx_device_printer * pdev);
  */
 void gx_saved_pages_list_free(gx_saved_pages_list *list);
 
+/*
+ * Write the pages on a list to a file, with their band lists, so that a
+ * later run can add them to a list with gx_saved_pages_list_read and print
+ * them without interpreting the job again. The file can only be read by
+ * the same build, for a device with the same color representation.
+ */
+int gx_saved_pages_list_write(gx_device_printer *pdev, gx_saved_pages_list *list,
+                              const char *fname);
+int gx_saved_pages_list_read(gx_device_printer *pdev, gx_saved_pages_list *list,
+                             const char *fname);
+
 /*
  * Process the param control string.
  * Returns < 0 if an error, > 0 if OK, but erasepage is needed, otherwise 0.
@@ -122,6 +122,17 @@ cmd_put_drawing_color(gx_device_clist_writer * cldev, gx_clist_state * pcls,
     gs_id		       pattern_id = gs_no_id;
     bool		       all_bands = (pre == NULL);
 
+    /* Shadings, and patterns played back from their own band list, are */
+    /* rendered clipped to the band, so their pixels depend on it too.  */
+    if (gx_dc_is_pattern2_color(pdcolor) ||
+        gx_dc_is_pattern1_color_clist_based(pdcolor)) {
+        if (all_bands) {
+            for (di = 0; di < cldev->nbands; di++)
+                cldev->states[di].color_usage.clip_dependent = true;
+        } else
+            pcls->color_usage.clip_dependent = true;
+    }
+
     /* see if the halftone must be inserted in the command list */
     if ( pdht != NULL                          &&
          pdht->id != cldev->device_halftone_id   ) {
@@ -1582,6 +1593,8 @@ cmd_put_path(gx_device_clist_writer * cldev, gx_clist_state * pcls,
     struct { fixed vs[6]; } prev = { { 0 } };
 
     first.x = first.y = out.x = out.y = start.x = start.y = 0; /* Quiet gcc warning. */
+    /* Scan converting the path depends on where the band is clipped. */
+    pcls->color_usage.clip_dependent = true;
     if_debug4m('p', cldev->memory, "[p]initial (%g,%g), clip [%g..%g)\n",
                fixed2float(px), fixed2float(py),
                fixed2float(ymin), fixed2float(ymax));
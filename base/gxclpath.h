@@ -188,7 +188,11 @@ typedef enum {
     cmd_opv_ext_put_tile_devn_color0 = 0x07, /* Devn color0 for tile filling */
     cmd_opv_ext_put_tile_devn_color1 = 0x08, /* Devn color1 for tile filling */
     cmd_opv_ext_set_color_is_devn = 0x09,    /* Used for overload of copy_color_alpha */
-    cmd_opv_ext_unset_color_is_devn = 0x0a   /* Used for overload of copy_color_alpha */
+    cmd_opv_ext_unset_color_is_devn = 0x0a,  /* Used for overload of copy_color_alpha */
+    cmd_opv_ext_tile_dict = 0x0b             /* dictionary index#, the next
+                                              * set_bits or set_tile_bits
+                                              * has its bits in the
+                                              * tile dictionary */
 } gx_cmd_ext_op;
 
 #define cmd_segment_op_num_operands_values\
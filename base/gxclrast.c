@@ -244,7 +244,7 @@ typedef struct ht_buff_s {
  */
 static int read_set_tile_size(command_buf_t *pcb, tile_slot *bits, bool for_pattern);
 static int read_set_bits(command_buf_t *pcb, tile_slot *bits,
-                          int compress, gx_clist_state *pcls,
+                          int compress, int dict_index, gx_clist_state *pcls,
                           gx_strip_bitmap *tile, tile_slot **pslot,
                           gx_device_clist_reader *cdev, gs_memory_t *mem);
 static int read_set_misc2(command_buf_t *pcb, gs_gstate *pgs,
@@ -472,10 +472,80 @@ read_set_misc_map(byte cb, command_buf_t *pcb, gs_gstate *pgs, gs_memory_t *mem)
     return 0;
 }
 
+/* Classify a command for the playback statistics. */
+/* cbp points after the command byte. */
+static clist_prof_kind_t
+cmd_op_prof_kind(int op, const byte *cbp)
+{
+    switch (op >> 4) {
+        case cmd_op_fill_rect >> 4:
+        case cmd_op_fill_rect_short >> 4:
+        case cmd_op_fill_rect_tiny >> 4:
+        case cmd_op_tile_rect >> 4:
+        case cmd_op_tile_rect_short >> 4:
+        case cmd_op_tile_rect_tiny >> 4:
+            return clist_prof_fill;
+        case cmd_op_copy_mono_planes >> 4:
+        case cmd_op_copy_color_alpha >> 4:
+            return clist_prof_copy;
+        case cmd_op_misc2 >> 4:
+            switch (op) {
+                case cmd_op_fill_rect_hl:
+                    return clist_prof_fill;
+                case cmd_opv_begin_image_rect:
+                case cmd_opv_begin_image:
+                case cmd_opv_image_data:
+                case cmd_opv_image_plane_data:
+                    return clist_prof_image;
+                case cmd_opv_extend:
+                    if (*cbp == cmd_opv_ext_create_compositor)
+                        return clist_prof_compositor;
+                    if (*cbp == cmd_opv_ext_tile_rect_hl)
+                        return clist_prof_fill;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case cmd_op_path >> 4:
+            switch (op) {
+                case cmd_opv_fill:
+                case cmd_opv_eofill:
+                case cmd_opv_polyfill:
+                case cmd_opv_fill_trapezoid:
+                    return clist_prof_fill;
+                case cmd_opv_stroke:
+                case cmd_opv_fill_stroke:
+                case cmd_opv_eofill_stroke:
+                    return clist_prof_stroke;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+    return clist_prof_other;
+}
+
+/* Charge the time since the current command started to its kind. */
+static void
+clist_stats_tick(clist_band_stats_t *stats)
+{
+    long now[2];
+    int64_t t;
+
+    gp_get_realtime(now);
+    t = (int64_t)now[0] * 1000000 + now[1] / 1000;
+    stats->kind_us[stats->kind] += t - stats->last_us;
+    stats->last_us = t;
+}
+
 int
 clist_playback_band(clist_playback_action playback_action,
                     gx_device_clist_reader *cdev, stream *s,
-                    gx_device *target, int x0, int y0, gs_memory_t * mem)
+                    gx_device *target, int x0, int y0, gs_memory_t * mem,
+                    clist_band_stats_t *stats)
 {
     byte *cbuf_storage;
     command_buf_t cbuf;
@@ -494,6 +564,7 @@ clist_playback_band(clist_playback_action playback_action,
     tile_slot *state_slot;
     gx_strip_bitmap state_tile; /* parameters for reading tiles */
     tile_slot tile_bits;        /* parameters of current tile */
+    int tile_dict_index = -1;   /* tile dictionary entry for the next bits */
     gs_int_point tile_phase, color_phase;
     gx_path path;
     bool in_path;
@@ -707,6 +778,11 @@ in:                             /* Initialize for a new page. */
             }
         }
         op = *cbp++;
+        if (stats != NULL) {
+            clist_stats_tick(stats);
+            stats->op_counts[op]++;
+            stats->kind = cmd_op_prof_kind(op, cbp);
+        }
 #ifdef DEBUG
         if (gs_debug_c('L')) {
             const char *const *sub = cmd_sub_op_names[op >> 4];
@@ -746,8 +822,10 @@ in:                             /* Initialize for a new page. */
                       stb:
                         cbuf.ptr = cbp;
                         code = read_set_bits(&cbuf, &bits, compress,
+                                             tile_dict_index,
                                              &state, &state_tile, &state_slot,
                                              cdev, mem);
+                        tile_dict_index = -1;
                         cbp = cbuf.ptr;
                         if (code < 0)
                             goto out;
@@ -1523,6 +1601,8 @@ idata:                  data_size = 0;
                                 data_size += planes[plane].raster;
                         }
                         data_size *= data_height;
+                        if (stats != NULL)
+                            stats->image_bytes += data_size;
                         data_on_heap = 0;
                         if (cbuf.end - cbp < data_size) {
                             code = top_up_cbuf(&cbuf, &cbp);
@@ -1812,6 +1892,11 @@ idata:                  data_size = 0;
                                 if (code < 0)
                                     goto out;
                                 break;
+                            case cmd_opv_ext_tile_dict:
+                                cmd_getw(tile_dict_index, cbp);
+                                if_debug1m('L', mem, " ext_tile_dict %d\n",
+                                           tile_dict_index);
+                                break;
                             case cmd_opv_ext_set_color_is_devn:
                                 state.color_is_devn = true;
                                 if_debug0m('L', mem, " ext_set_color_is_devn\n");
@@ -2367,6 +2452,10 @@ idata:                  data_size = 0;
     }
     /* Clean up before we exit. */
   out:
+    if (stats != NULL) {
+        clist_stats_tick(stats);
+        stats->kind = clist_prof_other;
+    }
     if (ht_buff.pbuff != 0) {
         gs_free_object(mem, ht_buff.pbuff, "clist_playback_band(ht_buff)");
         ht_buff.pbuff = 0;
@@ -2512,7 +2601,7 @@ read_set_tile_size(command_buf_t *pcb, tile_slot *bits, bool for_pattern)
 
 static int
 read_set_bits(command_buf_t *pcb, tile_slot *bits, int compress,
-              gx_clist_state *pcls, gx_strip_bitmap *tile, tile_slot **pslot,
+              int dict_index, gx_clist_state *pcls, gx_strip_bitmap *tile, tile_slot **pslot,
               gx_device_clist_reader *cdev, gs_memory_t *mem)
 {
     const byte *cbp = pcb->ptr;
@@ -2552,7 +2641,28 @@ read_set_bits(command_buf_t *pcb, tile_slot *bits, int compress,
 #ifdef DEBUG
     slot->index = pcls->tile_index;
 #endif
-    if (compress == cmd_compress_const) {
+    if (dict_index >= 0) {
+        /* The bits are in the tile dictionary, unpadded. */
+        const clist_tile_dict_t *dict = cdev->tile_dict;
+        const clist_tile_dict_entry_t *pe;
+        uint rows = rep_height * bits->num_planes;
+        uint row_bytes = (width_bits + 7) >> 3;
+        uint y;
+
+        if (dict == NULL || dict_index >= dict->count)
+            return_error(gs_error_unregistered);
+        pe = &dict->entries[dict_index];
+        if (pe->data == NULL || pe->width_bits != width_bits || pe->height != rows ||
+            row_bytes > bits->cb_raster)
+            return_error(gs_error_unregistered);
+        if_debug1m('L', mem, " dict_index=%d\n", dict_index);
+        for (y = 0; y < rows; y++) {
+            memcpy(data + y * bits->cb_raster, pe->data + y * row_bytes, row_bytes);
+            if (row_bytes < bits->cb_raster)
+                memset(data + y * bits->cb_raster + row_bytes, 0,
+                       bits->cb_raster - row_bytes);
+        }
+    } else if (compress == cmd_compress_const) {
         cbp = cmd_read_data(pcb, data, 1, cbp);
         if (width_bytes > 0 && rep_height > 0)
             memset(data+1, *data, width_bytes * rep_height - 1);
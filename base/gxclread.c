@@ -31,6 +31,7 @@
 #include "gdevp14.h"
 #include "gsmemory.h"
 #include "gsicc_cache.h"
+#include "gslibctx.h"
 /*
  * We really don't like the fact that gdevprn.h is included here, since
  * command lists are supposed to be usable for purposes other than printer
@@ -38,6 +39,7 @@
  * currently only applicable to printer devices.
  */
 #include "gdevprn.h"
+#include "gxsync.h"
 #include "stream.h"
 #include "strimpl.h"
 
@@ -398,10 +400,10 @@ clist_find_pseudoband(gx_device_clist_reader *crdev, int band, cmd_block *cb)
         strncat(fmode, gp_fmode_binary_suffix, 1);
         if ((code=page_info->io_procs->fopen(page_info->cfname, fmode,
                       &page_info->cfile,
-                      crdev->memory, crdev->memory, true)) < 0 ||
+                      crdev->memory, crdev->memory, page_info->compression)) < 0 ||
                       (code=page_info->io_procs->fopen(page_info->bfname, fmode,
                       &page_info->bfile,
-                      crdev->memory, crdev->memory, false)) < 0) {
+                      crdev->memory, crdev->memory, page_info->compression)) < 0) {
             return code;
         }
         bfile = page_info->bfile;
@@ -565,6 +567,13 @@ clist_render_init(gx_device_clist *dev)
     crdev->icc_table = NULL;
     crdev->color_usage_array = NULL;
     crdev->render_threads = NULL;
+    crdev->reorder_slots = NULL;
+    crdev->num_reorder_slots = 0;
+    crdev->band_units = NULL;
+    crdev->num_band_units = 0;
+    crdev->band_first_unit = NULL;
+    crdev->split_band_buffer = NULL;
+    crdev->blank_band_state = 0;
 
     return 0;
 }
@@ -763,6 +772,96 @@ clist_rasterize_lines(gx_device *dev, int y, int line_count,
     return line_count;
 }
 
+/*
+ * Bands that have no commands of their own, only the ones for the whole
+ * page (normally just the fillpage), all render the same. Once one of them
+ * has been rendered to a single color, the rest are filled with it rather
+ * than being played back. This only applies to whole rows of a chunky
+ * memory device, when rendering the current page.
+ */
+static bool
+clist_blank_bands_ok(const gx_device_clist_reader *crdev, gx_device *bdev,
+                     const gs_int_rect *prect, int band_first, int band_last)
+{
+    int depth = bdev->color_info.depth;
+    int band;
+
+    if (crdev->pages != NULL || crdev->yplane.index >= 0 ||
+        crdev->color_usage_array == NULL || crdev->blank_band_state < 0 ||
+        !gs_device_is_memory(bdev) || bdev->is_planar ||
+        (depth < 8 ? 8 % depth != 0 : depth % 8 != 0 || depth > 64) ||
+        prect->p.x != 0 || prect->q.x != bdev->width ||
+        prect->q.y - prect->p.y > bdev->height)
+        return false;
+    for (band = band_first; band <= band_last; band++)
+        if (crdev->color_usage_array[band].band_cmd_bytes != 0)
+            return false;
+    return true;
+}
+
+/* Check whether a blank band just rendered is all one color, and remember it. */
+static void
+clist_blank_band_learn(gx_device_clist_reader *crdev, gx_device *bdev,
+                       int height, bool pdf14)
+{
+    gx_device_memory *mdev = (gx_device_memory *)bdev;
+    int depth = bdev->color_info.depth;
+    int bpp = (depth < 8 ? 1 : depth >> 3);
+    uint row_bits = bdev->width * depth;
+    uint full_bytes = row_bits >> 3;
+    int rem_bits = row_bits & 7;	/* only if depth < 8 */
+    const byte *pixel = scan_line_base(mdev, 0);
+    int y;
+    uint i;
+
+    crdev->blank_band_state = -1;
+    for (y = 0; y < height; y++) {
+        const byte *row = scan_line_base(mdev, y);
+
+        for (i = 0; i < full_bytes; i += bpp)
+            if (memcmp(row + i, pixel, bpp) != 0)
+                return;
+        if (rem_bits != 0) {
+            byte mask = (byte)(0xff << (8 - rem_bits));
+
+            if (((row[full_bytes] ^ pixel[0]) & mask) != 0)
+                return;
+        }
+    }
+    memcpy(crdev->blank_band_pixel, pixel, bpp);
+    crdev->blank_band_pdf14 = pdf14;
+    crdev->blank_band_state = 1;
+}
+
+/* Fill the rows of a blank band with the remembered color. */
+static void
+clist_blank_band_fill(const gx_device_clist_reader *crdev, gx_device *bdev, int height)
+{
+    gx_device_memory *mdev = (gx_device_memory *)bdev;
+    int depth = bdev->color_info.depth;
+    uint row_bytes = (bdev->width * depth + 7) >> 3;
+    byte *row0 = scan_line_base(mdev, 0);
+    int y;
+
+    if (depth <= 8)
+        memset(row0, crdev->blank_band_pixel[0], row_bytes);
+    else {
+        uint bpp = depth >> 3;
+        uint done = bpp;
+
+        /* Write one pixel, then keep doubling what we have written. */
+        memcpy(row0, crdev->blank_band_pixel, bpp);
+        while (done < row_bytes) {
+            uint n = min(done, row_bytes - done);
+
+            memcpy(row0 + done, row0, n);
+            done += n;
+        }
+    }
+    for (y = 1; y < height; y++)
+        memcpy(scan_line_base(mdev, y), row0, row_bytes);
+}
+
 /*
  * Render a rectangle to a client-supplied device.  There is no necessary
  * relationship between band boundaries and the region being rendered.
@@ -799,6 +898,7 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
 
     for (i = 0; i < num_pages && code >= 0; ++i) {
         bool pdf14_needed = false;
+        bool blank;
         int band;
 
         if (ppages == NULL) {
@@ -808,7 +908,7 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
                  * a gx_saved_page with non-zero cfile or bfile.
                  */
                 bdev->band_offset_x = 0;
-                bdev->band_offset_y = band_first * (long)band_height;
+                bdev->band_offset_y = prect->p.y;
                 pinfo = &(crdev->page_info);
         } else {
             const gx_placed_page *ppage = &ppages[i];
@@ -840,7 +940,7 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
              * master page.
              */
             bdev->band_offset_x = ppage->offset.x;
-            bdev->band_offset_y = ppage->offset.y + (band_first * band_height);
+            bdev->band_offset_y = ppage->offset.y + prect->p.y;
         }
         /* if any of the requested bands need transparency, use it for all of them   */
         /* The pdf14_ok_to_optimize checks if the target device (bdev) is compatible */
@@ -851,17 +951,218 @@ clist_render_rectangle(gx_device_clist *cldev, const gs_int_rect *prect,
             pdf14_needed |= (crdev->color_usage_array[band].trans_bbox.p.y <=
             crdev->color_usage_array[band].trans_bbox.q.y) ? true : false;
 
+        blank = ppages == NULL &&
+            clist_blank_bands_ok(crdev, bdev, prect, band_first, band_last);
+        if (blank && crdev->blank_band_state > 0 &&
+            crdev->blank_band_pdf14 == pdf14_needed) {
+            clist_blank_band_fill(crdev, bdev, prect->q.y - prect->p.y);
+            continue;
+        }
         code = clist_playback_file_bands(pdf14_needed ?
                                          playback_action_render : playback_action_render_no_pdf14,
                                          crdev, pinfo,
                                          bdev, band_first, band_last,
                                          prect->p.x - bdev->band_offset_x,
                                          prect->p.y);
+        if (code >= 0 && blank && crdev->blank_band_state == 0)
+            clist_blank_band_learn(crdev, bdev, prect->q.y - prect->p.y, pdf14_needed);
     }
     crdev->icc_struct->pageneutralcolor = save_pageneutralcolor;	/* restore it */
     return code;
 }
 
+/* ------ Playback statistics ------ */
+
+struct clist_band_profile_s {
+    gs_memory_t *memory;	/* thread safe, not GC'd */
+    gx_monitor_t *lock;		/* for appending from the rendering threads */
+    int64_t start_us;		/* when rendering of the page started */
+    int count, size;
+    clist_band_stats_t *stats;	/* one per clist_playback_band call */
+};
+
+static int64_t
+clist_band_profile_time(void)
+{
+    long now[2];
+
+    gp_get_realtime(now);
+    return (int64_t)now[0] * 1000000 + now[1] / 1000;
+}
+
+int
+clist_band_profile_begin(gx_device *dev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gs_memory_t *mem = dev->memory->thread_safe_memory;
+    clist_band_profile_t *prof = cdev->band_profile;
+
+    if (prof == NULL) {
+        prof = (clist_band_profile_t *)gs_alloc_bytes(mem, sizeof(*prof),
+                                                      "clist_band_profile_begin");
+        if (prof == NULL)
+            return_error(gs_error_VMerror);
+        memset(prof, 0, sizeof(*prof));
+        prof->memory = mem;
+        prof->lock = gx_monitor_label(gx_monitor_alloc(mem), "clist_band_profile");
+        if (prof->lock == NULL) {
+            gs_free_object(mem, prof, "clist_band_profile_begin");
+            return_error(gs_error_VMerror);
+        }
+    }
+    prof->count = 0;
+    prof->start_us = clist_band_profile_time();
+    cdev->band_profile = prof;
+    cdev->band_profile_thread = -1;
+    return 0;
+}
+
+/* Add the stats for a band. If we run out of memory, the stats are lost. */
+static void
+clist_band_profile_record(clist_band_profile_t *prof, clist_band_stats_t *stats)
+{
+    stats->start_us -= prof->start_us;
+    stats->time_us = clist_band_profile_time() - prof->start_us - stats->start_us;
+    gx_monitor_enter(prof->lock);
+    if (prof->count == prof->size) {
+        int size = max(prof->size * 2, 64);
+        clist_band_stats_t *nstats;
+
+        if (prof->stats == NULL)
+            nstats = (clist_band_stats_t *)
+                gs_alloc_byte_array(prof->memory, size, sizeof(*nstats),
+                                    "clist_band_profile_record");
+        else
+            nstats = (clist_band_stats_t *)
+                gs_resize_object(prof->memory, prof->stats, size * sizeof(*nstats),
+                                 "clist_band_profile_record");
+        if (nstats != NULL) {
+            prof->stats = nstats;
+            prof->size = size;
+        }
+    }
+    if (prof->count < prof->size)
+        prof->stats[prof->count++] = *stats;
+    gx_monitor_leave(prof->lock);
+}
+
+/* Write the JSON object mapping command names to counts. */
+static void
+clist_band_profile_write_ops(gp_file *f, const uint *op_counts)
+{
+    const char *sep = "";
+    int i, j;
+
+    gp_fprintf(f, "{");
+    for (i = 0; i < 16; i++) {
+        const char *const *sub = cmd_sub_op_names[i];
+        uint count = 0;
+
+        for (j = 0; j < 16; j++) {
+            if (sub != NULL && op_counts[i * 16 + j] != 0) {
+                gp_fprintf(f, "%s\"%s\":%u", sep, sub[j], op_counts[i * 16 + j]);
+                sep = ",";
+            }
+            count += op_counts[i * 16 + j];
+        }
+        if (sub == NULL && count != 0) {
+            gp_fprintf(f, "%s\"%s\":%u", sep, cmd_op_names[i], count);
+            sep = ",";
+        }
+    }
+    gp_fprintf(f, "}");
+}
+
+static void
+clist_band_profile_write_kinds(gp_file *f, const int64_t *kind_us)
+{
+    static const char *const kind_names[clist_prof_num_kinds] = {
+        clist_prof_kind_name_strings
+    };
+    int i;
+
+    gp_fprintf(f, "{");
+    for (i = 0; i < clist_prof_num_kinds; i++)
+        gp_fprintf(f, "%s\"%s\":%"PRId64, (i ? "," : ""), kind_names[i], kind_us[i]);
+    gp_fprintf(f, "}");
+}
+
+/*
+ * The line written for each page is a JSON object like:
+ *   {"page":1,"width":2550,"height":3300,"band_height":64,"num_bands":52,
+ *    "time_us":...,"image_bytes":...,"kind_us":{"fill":...,...},
+ *    "ops":{"fill_rect":...,...},
+ *    "bands":[{"band_first":0,"band_last":0,"thread":0,"start_us":...,
+ *              "time_us":...,"image_bytes":...,"kind_us":{...},"ops":{...}},...]}
+ * with an entry in "bands" for each call of clist_playback_band, in the order
+ * they finished. Times are in microseconds.
+ */
+int
+clist_band_profile_end(gx_device *dev, const char *fname)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    clist_band_profile_t *prof = cdev->band_profile;
+    clist_band_stats_t total;
+    int64_t page_us;
+    gp_file *f;
+    int i, j;
+    int code = 0;
+
+    if (prof == NULL)
+        return 0;
+    cdev->band_profile = NULL;
+    page_us = clist_band_profile_time() - prof->start_us;
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < prof->count; i++) {
+        const clist_band_stats_t *stats = &prof->stats[i];
+
+        total.image_bytes += stats->image_bytes;
+        for (j = 0; j < clist_prof_num_kinds; j++)
+            total.kind_us[j] += stats->kind_us[j];
+        for (j = 0; j < 256; j++)
+            total.op_counts[j] += stats->op_counts[j];
+    }
+    /* Under SAFER the file must be permitted, like any other file written. */
+    /* imainarg.c permits it when it is given on the command line.         */
+    f = gp_fopen(dev->memory, fname, "a");
+    if (f == NULL)
+        code = gs_note_error(gs_error_invalidfileaccess);
+    else {
+        gp_fprintf(f, "{\"page\":%ld,\"width\":%d,\"height\":%d,"
+                   "\"band_height\":%d,\"num_bands\":%d,"
+                   "\"time_us\":%"PRId64",\"image_bytes\":%"PRId64",\"kind_us\":",
+                   dev->PageCount + 1, dev->width, dev->height,
+                   cdev->page_info.band_params.BandHeight, cdev->nbands,
+                   page_us, total.image_bytes);
+        clist_band_profile_write_kinds(f, total.kind_us);
+        gp_fprintf(f, ",\"ops\":");
+        clist_band_profile_write_ops(f, total.op_counts);
+        gp_fprintf(f, ",\"bands\":[");
+        for (i = 0; i < prof->count; i++) {
+            const clist_band_stats_t *stats = &prof->stats[i];
+
+            gp_fprintf(f, "%s{\"band_first\":%d,\"band_last\":%d,\"thread\":%d,"
+                       "\"start_us\":%"PRId64",\"time_us\":%"PRId64","
+                       "\"image_bytes\":%"PRId64",\"kind_us\":",
+                       (i ? "," : ""), stats->band_first, stats->band_last,
+                       stats->thread, stats->start_us, stats->time_us,
+                       stats->image_bytes);
+            clist_band_profile_write_kinds(f, stats->kind_us);
+            gp_fprintf(f, ",\"ops\":");
+            clist_band_profile_write_ops(f, stats->op_counts);
+            gp_fprintf(f, "}");
+        }
+        gp_fprintf(f, "]}\n");
+        if (gp_ferror(f))
+            code = gs_note_error(gs_error_ioerror);
+        gp_fclose(f);
+    }
+    gx_monitor_free(prof->lock);
+    gs_free_object(prof->memory, prof->stats, "clist_band_profile_end");
+    gs_free_object(prof->memory, prof, "clist_band_profile_end");
+    return code;
+}
+
 /* Playback the band file, taking the indicated action w/ its contents. */
 int
 clist_playback_file_bands(clist_playback_action action,
@@ -890,13 +1191,13 @@ clist_playback_file_bands(clist_playback_action action,
     if (rs.page_cfile == 0) {
         code = crdev->page_info.io_procs->fopen(rs.page_cfname,
                            gp_fmode_rb, &rs.page_cfile, crdev->bandlist_memory,
-                           crdev->bandlist_memory, true);
+                           crdev->bandlist_memory, crdev->page_info.compression);
         opened_cfile = (code >= 0);
     }
     if (rs.page_bfile == 0 && code >= 0) {
         code = crdev->page_info.io_procs->fopen(rs.page_bfname,
                            gp_fmode_rb, &rs.page_bfile, crdev->bandlist_memory,
-                           crdev->bandlist_memory, false);
+                           crdev->bandlist_memory, crdev->page_info.compression);
         opened_bfile = (code >= 0);
     }
     if (rs.page_cfile != 0 && rs.page_bfile != 0) {
@@ -917,7 +1218,21 @@ clist_playback_file_bands(clist_playback_action action,
         s.foreign = 1;
         s.state = (stream_state *)&rs;
 
-        code = clist_playback_band(action, crdev, &s, target, x0, y0, mem);
+        if (crdev->band_profile != NULL && action != playback_action_setup) {
+            clist_band_stats_t stats;
+
+            memset(&stats, 0, sizeof(stats));
+            stats.band_first = band_first;
+            stats.band_last = band_last;
+            stats.thread = crdev->band_profile_thread;
+            stats.kind = clist_prof_other;
+            stats.start_us = stats.last_us = clist_band_profile_time();
+            code = clist_playback_band(action, crdev, &s, target, x0, y0, mem,
+                                       &stats);
+            clist_band_profile_record(crdev->band_profile, &stats);
+        } else
+            code = clist_playback_band(action, crdev, &s, target, x0, y0, mem,
+                                       NULL);
 #	ifdef DEBUG
         s_band_read_dnit_offset_map(crdev, (stream_state *)&rs);
 #	endif
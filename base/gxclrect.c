@@ -264,6 +264,7 @@ cmd_write_trapezoid_cmd(gx_device_clist_writer * cldev, gx_clist_state * pcls,
     code = set_cmd_put_op(&dp, cldev, pcls, op, rcsize);
     if (code < 0)
         return code;
+    pcls->color_usage.clip_dependent = true;
     dp++;
     cmd_putw(left->start.x, &dp);
     cmd_putw(left->start.y, &dp);
@@ -31,6 +31,7 @@
 #include "gdevppla.h"
 #include "gsmemory.h"
 #include "gsmchunk.h"
+#include "gsmalloc.h"
 #include "gxclthrd.h"
 #include "gdevdevn.h"
 #include "gsicc_cache.h"
@@ -38,9 +39,139 @@
 #include "gstrans.h"
 #include "gzht.h"		/* for gx_ht_cache_default_bits_size */
 
+/*
+ * A band that is expected to take much longer to render than the rest of
+ * the page is split into units of a few lines, so that several threads can
+ * share it rather than one thread holding up the page. The cost of a band
+ * is estimated from the statistics recorded by the writer: the bytes of
+ * commands it plays back, with image data (which has to be unpacked and
+ * color converted) weighted more heavily, plus the size of the transparency
+ * buffer it needs. A band costing more than CLIST_SPLIT_BAND_FACTOR times
+ * the average for the page gets one unit for each multiple of that, up to
+ * the number of threads, but no unit is smaller than
+ * CLIST_SPLIT_BAND_MIN_LINES lines.
+ *
+ * A unit is played back clipped to its own lines, so only bands whose
+ * pixels can't depend on where the clip falls are split: those with just
+ * rectangles, bitmaps, rectangular clips and unrotated, uninterpolated
+ * images. The writer marks any other band as clip_dependent (paths,
+ * shadings and the like are scan converted within the clip). That way the
+ * output is the same whatever the number of threads.
+ */
+#define CLIST_SPLIT_BAND_FACTOR 4
+#define CLIST_SPLIT_BAND_MIN_COST 65536	/* not worth splitting below this */
+#define CLIST_SPLIT_BAND_MIN_LINES 16
+#define CLIST_IMAGE_COST_WEIGHT 4
+
 /* Forward reference prototypes */
-static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
+static int clist_start_render_thread(gx_device *dev, int thread_index, int unit);
 static void clist_render_thread(void *param);
+static void clist_finish_render_thread(clist_render_thread_control_t *thread);
+
+/*
+ * A thread's memory is a chunk allocator on top of a thread cache, so
+ * that neither the small objects the chunk allocator sub-allocates nor
+ * the large ones it passes through (and frees) again band after band
+ * usually need the lock of the heap that all the threads share.
+ */
+static int
+clist_alloc_thread_memory(gs_memory_t **pmem, gs_memory_t *base_mem)
+{
+    gs_memory_t *cache_mem;
+    int code;
+
+    if ((code = gs_malloc_thread_cache_wrap(&cache_mem, base_mem)) < 0)
+        return code;
+    if ((code = gs_memory_chunk_wrap(pmem, cache_mem)) < 0)
+        gs_malloc_thread_cache_release(cache_mem);
+    return code;
+}
+
+static void
+clist_release_thread_memory(gs_memory_t *thread_mem)
+{
+    gs_malloc_thread_cache_release(gs_memory_chunk_unwrap(thread_mem));
+}
+
+/* Point a rendering thread's device at the clist files of the main device */
+/* and set it up for reading the current page. Used both for new thread    */
+/* devices and for ones kept from a previous page.                          */
+int
+clist_attach_thread_device(gx_device *dev, gx_device *ndev, bool bg_print, gsicc_link_cache_t **cachep)
+{
+    int code;
+    char fmode[4];
+    gs_memory_t *thread_mem = ndev->memory;
+    gx_device_clist *ncldev = (gx_device_clist *)ndev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_common *ncdev = (gx_device_clist_common *)ndev;
+
+    /* open the main thread's files for this thread */
+    strcpy(fmode, "r");                 /* read access for threads */
+    strncat(fmode, gp_fmode_binary_suffix, 1);
+    if ((code=cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &ncdev->page_info.cfile,
+                        thread_mem, thread_mem, cdev->page_info.compression)) < 0 ||
+         (code=cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &ncdev->page_info.bfile,
+                        thread_mem, thread_mem, cdev->page_info.compression)) < 0)
+        return code;
+
+    strcpy((ncdev->page_info.cfname), (cdev->page_info.cfname));
+    strcpy((ncdev->page_info.bfname), (cdev->page_info.bfname));
+    clist_render_init(ncldev);      /* Initialize clist device for reading */
+    ncdev->page_info.bfile_end_pos = cdev->page_info.bfile_end_pos;
+
+    /* The threads are maintained until clist_finish_page.  At which
+       point, the threads are torn down, the master clist reader device
+       is changed to writer, and the icc_table and the icc_cache_cl freed */
+    if (dev->icc_struct == ndev->icc_struct) {
+    /* safe to share the link cache */
+        ncdev->icc_cache_cl = cdev->icc_cache_cl;
+        rc_increment(cdev->icc_cache_cl);		/* FIXME: needs to be incdemented safely */
+    } else {
+        /* each thread needs its own link cache */
+        if (cachep != NULL) {
+            if (*cachep == NULL) {
+                /* We don't have one cached that we can reuse, so make one. */
+                if ((*cachep = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
+                    return_error(gs_error_VMerror);
+            }
+            rc_increment(*cachep);
+                ncdev->icc_cache_cl = *cachep;
+        } else if ((ncdev->icc_cache_cl = gsicc_cache_new(thread_mem)) == NULL)
+            return_error(gs_error_VMerror);
+    }
+    if (bg_print) {
+        gx_device_clist_reader *ncrdev = (gx_device_clist_reader *)ncdev;
+
+        if (cdev->icc_table != NULL) {
+            /* This is a background printing thread, so it cannot share the icc_table  */
+            /* since this probably was created with a GC'ed allocator and the bg_print */
+            /* thread can't deal with the relocation. Free the cdev->icc_table and get */
+            /* a new one from the clist.                                               */
+            clist_free_icc_table(cdev->icc_table, cdev->memory);
+            cdev->icc_table = NULL;
+            if ((code = clist_read_icctable((gx_device_clist_reader *)ncdev)) < 0)
+                return code;
+        }
+        /* Similarly for the color_usage_array, when the foreground device switches to */
+        /* writer mode, the foreground's array will be freed.                          */
+        if ((code = clist_read_color_usage_array(ncrdev)) < 0)
+            return code;
+    } else {
+    /* Use the same profile table and color usage array in each thread */
+        ncdev->icc_table = cdev->icc_table;		/* OK for multiple rendering threads */
+        ((gx_device_clist_reader *)ncdev)->color_usage_array =
+                ((gx_device_clist_reader *)cdev)->color_usage_array;
+    }
+    /* Needed for case when the target has cielab profile and pdf14 device
+       has a RGB profile stored in the profile list of the clist */
+    ncdev->trans_dev_icc_hash = cdev->trans_dev_icc_hash;
+    /* The pages may refer to bitmaps in the main device's tile dictionary */
+    ncdev->tile_dict = cdev->tile_dict;
+    ncdev->tile_dict_owned = false;
+
+    return 0;
+}
 
 /* clone a device and set params and its chunk memory                   */
 /* The chunk_base_mem MUST be thread safe                               */
@@ -51,13 +182,11 @@ gx_device *
 setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, bool bg_print, gsicc_link_cache_t **cachep)
 {
     int i, code;
-    char fmode[4];
     gs_memory_t *thread_mem;
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_printer *pdev = (gx_device_printer *)dev;
     gx_device_clist_common *cdev = (gx_device_clist_common *)cldev;
     gx_device *ndev;
-    gx_device_clist *ncldev;
     gx_device_clist_common *ncdev;
     gx_device_printer *npdev;
     gx_device *protodev;
@@ -71,7 +200,7 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
      * with the 'base' allocator which has 'mutex' (locking) protection.
      * This improves performance of the threads.
      */
-    if ((code = gs_memory_chunk_wrap(&(thread_mem), chunk_base_mem )) < 0) {
+    if ((code = clist_alloc_thread_memory(&(thread_mem), chunk_base_mem )) < 0) {
         emprintf1(dev->memory, "chunk_wrap returned error code: %d\n", code);
         return NULL;
     }
@@ -84,10 +213,9 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
     if (protodev == NULL ||
         (code = gs_copydevice((gx_device **) &ndev, protodev, thread_mem)) < 0 ||
         ndev == NULL) {				/* should only happen if copydevice failed */
-        gs_memory_chunk_release(thread_mem);
+        clist_release_thread_memory(thread_mem);
         return NULL;
     }
-    ncldev = (gx_device_clist *)ndev;
     ncdev = (gx_device_clist_common *)ndev;
     npdev = (gx_device_printer *)ndev;
     gx_device_fill_in_procs(ndev);
@@ -221,67 +349,9 @@ setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, boo
     ncdev->page_info.io_procs->fclose(ncdev->page_info.bfile, ncdev->page_info.bfname, true);
     ncdev->page_info.cfile = ncdev->page_info.bfile = NULL;
 
-    /* open the main thread's files for this thread */
-    strcpy(fmode, "r");                 /* read access for threads */
-    strncat(fmode, gp_fmode_binary_suffix, 1);
-    if ((code=cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &ncdev->page_info.cfile,
-                        thread_mem, thread_mem, true)) < 0 ||
-         (code=cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &ncdev->page_info.bfile,
-                        thread_mem, thread_mem, false)) < 0)
+    if ((code = clist_attach_thread_device(dev, ndev, bg_print, cachep)) < 0)
         goto out_cleanup;
 
-    strcpy((ncdev->page_info.cfname), (cdev->page_info.cfname));
-    strcpy((ncdev->page_info.bfname), (cdev->page_info.bfname));
-    clist_render_init(ncldev);      /* Initialize clist device for reading */
-    ncdev->page_info.bfile_end_pos = cdev->page_info.bfile_end_pos;
-
-    /* The threads are maintained until clist_finish_page.  At which
-       point, the threads are torn down, the master clist reader device
-       is changed to writer, and the icc_table and the icc_cache_cl freed */
-    if (dev->icc_struct == ndev->icc_struct) {
-    /* safe to share the link cache */
-        ncdev->icc_cache_cl = cdev->icc_cache_cl;
-        rc_increment(cdev->icc_cache_cl);		/* FIXME: needs to be incdemented safely */
-    } else {
-        /* each thread needs its own link cache */
-        if (cachep != NULL) {
-            if (*cachep == NULL) {
-                /* We don't have one cached that we can reuse, so make one. */
-                if ((*cachep = gsicc_cache_new(thread_mem->thread_safe_memory)) == NULL)
-                    goto out_cleanup;
-            }
-            rc_increment(*cachep);
-                ncdev->icc_cache_cl = *cachep;
-        } else if ((ncdev->icc_cache_cl = gsicc_cache_new(thread_mem)) == NULL)
-            goto out_cleanup;
-    }
-    if (bg_print) {
-        gx_device_clist_reader *ncrdev = (gx_device_clist_reader *)ncdev;
-
-        if (cdev->icc_table != NULL) {
-            /* This is a background printing thread, so it cannot share the icc_table  */
-            /* since this probably was created with a GC'ed allocator and the bg_print */
-            /* thread can't deal with the relocation. Free the cdev->icc_table and get */
-            /* a new one from the clist.                                               */
-            clist_free_icc_table(cdev->icc_table, cdev->memory);
-            cdev->icc_table = NULL;
-            if ((code = clist_read_icctable((gx_device_clist_reader *)ncdev)) < 0)
-                goto out_cleanup;
-        }
-        /* Similarly for the color_usage_array, when the foreground device switches to */
-        /* writer mode, the foreground's array will be freed.                          */
-        if ((code = clist_read_color_usage_array(ncrdev)) < 0)
-            goto out_cleanup;
-    } else {
-    /* Use the same profile table and color usage array in each thread */
-        ncdev->icc_table = cdev->icc_table;		/* OK for multiple rendering threads */
-        ((gx_device_clist_reader *)ncdev)->color_usage_array =
-                ((gx_device_clist_reader *)cdev)->color_usage_array;
-    }
-    /* Needed for case when the target has cielab profile and pdf14 device
-       has a RGB profile stored in the profile list of the clist */
-    ncdev->trans_dev_icc_hash = cdev->trans_dev_icc_hash;
-
     /* success */
     return ndev;
 
@@ -296,10 +366,359 @@ out_cleanup:
     /* we can't get here with ndev == NULL */
     gdev_prn_free_memory(ndev);
     gs_free_object(thread_mem, ndev, "setup_device_and_mem_for_thread");
-    gs_memory_chunk_release(thread_mem);
+    clist_release_thread_memory(thread_mem);
     return NULL;
 }
 
+/*
+ * Keep a rendering thread's device (and with it the thread's chunk
+ * allocator and band buffer) at the end of a page, so that the next page
+ * can reuse it rather than cloning and allocating a new one. We only keep
+ * devices that share the main device's icc_struct; the others hold cloned
+ * profiles that are simpler to rebuild. Returns false if the device was
+ * not kept, in which case the caller should tear it down as usual.
+ */
+static bool
+clist_cache_thread_device(gx_device *dev, gx_device *ndev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_common *ncdev = (gx_device_clist_common *)ndev;
+    gx_device_clist_reader *ncrdev = (gx_device_clist_reader *)ndev;
+    gs_memory_t *mem = cdev->memory->thread_safe_memory;
+    int i;
+
+    if (ndev->icc_struct != dev->icc_struct)
+        return false;
+    for (i = 0; i < cdev->thread_dev_cache_len; i++)
+        if (cdev->thread_dev_cache[i] == NULL)
+            break;
+    if (i == cdev->thread_dev_cache_len) {
+        gx_device **old = cdev->thread_dev_cache;
+
+        cdev->thread_dev_cache = (gx_device **)gs_alloc_byte_array(mem,
+                                    i + 1, sizeof(gx_device *), "clist_cache_thread_device");
+        if (cdev->thread_dev_cache == NULL) {
+            cdev->thread_dev_cache = old;
+            return false;
+        }
+        if (i > 0)
+            memcpy(cdev->thread_dev_cache, old, i * sizeof(gx_device *));
+        gs_free_object(mem, old, "clist_cache_thread_device");
+        cdev->thread_dev_cache_len = i + 1;
+    }
+    /* Close the file handles, but don't delete (unlink) the files */
+    if (ncdev->page_info.bfile != NULL)
+        ncdev->page_info.io_procs->fclose(ncdev->page_info.bfile, ncdev->page_info.bfname, false);
+    if (ncdev->page_info.cfile != NULL)
+        ncdev->page_info.io_procs->fclose(ncdev->page_info.cfile, ncdev->page_info.cfname, false);
+    ncdev->page_info.bfile = ncdev->page_info.cfile = NULL;
+    /* The data area we were left with may be another thread's, or a */
+    /* reorder slot's that is about to be freed, so take back our own */
+    ncdev->data = ((gx_device_printer *)ndev)->buf;
+    /* These all belong to the main device, and only last for the page */
+    ncrdev->color_usage_array = NULL;
+    ncdev->icc_table = NULL;
+    ncdev->tile_dict = NULL;
+    rc_decrement(ncdev->icc_cache_cl, "clist_cache_thread_device");
+    ncdev->icc_cache_cl = NULL;
+    cdev->thread_dev_cache[i] = ndev;
+    return true;
+}
+
+/*
+ * Take a device kept by clist_cache_thread_device and set it up to render
+ * the current page, if it is still compatible with the main device. The
+ * device parameters are copied over again in case they have changed, but
+ * with the device marked as closed so that doesn't reallocate the band
+ * buffer. Incompatible devices are freed. Returns NULL if there is no
+ * device to reuse.
+ */
+static gx_device *
+clist_reuse_thread_device(gx_device *dev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    int i;
+
+    for (i = cdev->thread_dev_cache_len - 1; i >= 0; i--) {
+        gx_device *ndev = cdev->thread_dev_cache[i];
+        gx_device_clist_common *ncdev = (gx_device_clist_common *)ndev;
+        gx_device_printer *npdev = (gx_device_printer *)ndev;
+        gdev_space_params save_sp;
+        bool save_is_open;
+        gs_c_param_list paramlist;
+        int code;
+
+        if (ndev == NULL)
+            continue;
+        cdev->thread_dev_cache[i] = NULL;
+        if (ndev->width != dev->width || ndev->height != dev->height ||
+            ndev->icc_struct != dev->icc_struct ||
+            ncdev->nbands != cdev->nbands ||
+            ncdev->page_info.tile_cache_size != cdev->page_info.tile_cache_size ||
+            ncdev->page_info.band_params.BandHeight != cdev->page_info.band_params.BandHeight ||
+            ncdev->page_info.band_params.BandWidth != cdev->page_info.band_params.BandWidth)
+            code = -1;
+        else {
+            save_sp = npdev->space_params;
+            save_is_open = ndev->is_open;
+            ndev->is_open = false;
+            gs_c_param_list_write(&paramlist, ndev->memory);
+            code = gs_getdeviceparams(dev, (gs_param_list *)&paramlist);
+            if (code >= 0) {
+                gs_c_param_list_read(&paramlist);
+                code = gs_putdeviceparams(ndev, (gs_param_list *)&paramlist);
+            }
+            gs_c_param_list_release(&paramlist);
+            ndev->is_open = save_is_open;
+            npdev->space_params = save_sp;
+            if (code >= 0 &&
+                (ndev->width != dev->width || ndev->height != dev->height ||
+                 memcmp(&ndev->color_info, &dev->color_info, sizeof(dev->color_info)) != 0))
+                code = -1;
+            if (code >= 0 && dev_proc(dev, ret_devn_params)(dev) != NULL)
+                code = devn_copy_params(dev, ndev);
+        }
+        if (code >= 0) {
+            ndev->PageCount = dev->PageCount;
+            npdev->file = ((gx_device_printer *)dev)->file;
+            strcpy(npdev->fname, ((gx_device_printer *)dev)->fname);
+            ncdev->page_uses_transparency = cdev->page_uses_transparency;
+            code = clist_attach_thread_device(dev, ndev, false, NULL);
+            if (code >= 0)
+                return ndev;
+            /* Close the file handles, but don't delete (unlink) the files */
+            if (ncdev->page_info.bfile != NULL)
+                ncdev->page_info.io_procs->fclose(ncdev->page_info.bfile, ncdev->page_info.bfname, false);
+            if (ncdev->page_info.cfile != NULL)
+                ncdev->page_info.io_procs->fclose(ncdev->page_info.cfile, ncdev->page_info.cfname, false);
+            ncdev->page_info.bfile = ncdev->page_info.cfile = NULL;
+        }
+        teardown_device_and_mem_for_thread(ndev, NULL, false);
+    }
+    return NULL;
+}
+
+/* Free the thread devices kept between pages. Called from clist_close */
+void
+clist_free_thread_dev_cache(gx_device *dev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    int i;
+
+    for (i = 0; i < cdev->thread_dev_cache_len; i++) {
+        if (cdev->thread_dev_cache[i] != NULL)
+            teardown_device_and_mem_for_thread(cdev->thread_dev_cache[i], NULL, false);
+    }
+    gs_free_object(cdev->memory->thread_safe_memory, cdev->thread_dev_cache,
+                   "clist_free_thread_dev_cache");
+    cdev->thread_dev_cache = NULL;
+    cdev->thread_dev_cache_len = 0;
+}
+
+/* Estimate the cost of rendering a band, see CLIST_SPLIT_BAND_FACTOR */
+static int64_t
+clist_band_cost(gx_device_clist_reader *crdev, int band)
+{
+    const gx_color_usage_t *pcu = &(crdev->color_usage_array[band]);
+    int64_t cost = pcu->cmd_bytes + pcu->image_bytes * CLIST_IMAGE_COST_WEIGHT;
+
+    if (pcu->trans_bbox.p.y <= pcu->trans_bbox.q.y && pcu->trans_bbox.p.x < pcu->trans_bbox.q.x) {
+        int lines = min(pcu->trans_bbox.q.y, crdev->page_band_height - 1) -
+                        max(pcu->trans_bbox.p.y, 0) + 1;
+
+        /* Roughly the pdf14 buffer, with its alpha, composited at least once */
+        cost += (int64_t)lines * (pcu->trans_bbox.q.x - pcu->trans_bbox.p.x) *
+                (crdev->color_info.num_components + 1);
+    }
+    return cost;
+}
+
+/*
+ * Divide the page into units of work for the threads: one for each band,
+ * except that expensive bands are split if allow_split is true. Splitting
+ * relies on the units of a band being rendered in place in copies of the
+ * same buffer, so we only do it with the default buffer device layout.
+ */
+static int
+clist_setup_band_units(gx_device *dev, bool allow_split)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    int band_count = cdev->nbands;
+    int band_height = crdev->page_band_height;
+    int64_t threshold = 0;
+    int band, count, i;
+
+    if (crdev->color_usage_array == NULL || crdev->num_render_threads < 2 ||
+        crdev->buf_procs.setup_buf_device != gx_default_setup_buf_device ||
+        dev->log2_align_mod > log2_align_bitmap_mod)
+        allow_split = false;
+    if (allow_split) {
+        int64_t total = 0;
+
+        for (band = 0; band < band_count; band++)
+            total += clist_band_cost(crdev, band);
+        threshold = max(total / band_count * CLIST_SPLIT_BAND_FACTOR, CLIST_SPLIT_BAND_MIN_COST);
+    }
+    crdev->band_first_unit = (int *)gs_alloc_byte_array(mem, band_count + 1, sizeof(int),
+                                                        "clist_setup_band_units");
+    if (crdev->band_first_unit == NULL)
+        return_error(gs_error_VMerror);
+    for (band = 0, count = 0; band < band_count; band++) {
+        int lines = min(band_height, dev->height - band * band_height);
+        int64_t n = 1;
+
+        if (allow_split && !crdev->color_usage_array[band].clip_dependent) {
+            n = clist_band_cost(crdev, band) / threshold + 1;
+            if (n > crdev->num_render_threads)
+                n = crdev->num_render_threads;
+            if (n > lines / CLIST_SPLIT_BAND_MIN_LINES)
+                n = max(lines / CLIST_SPLIT_BAND_MIN_LINES, 1);
+        }
+        crdev->band_first_unit[band] = count;
+        count += (int)n;
+    }
+    crdev->band_first_unit[band_count] = count;
+    crdev->band_units = (clist_band_unit_t *)gs_alloc_byte_array(mem, count,
+                                sizeof(clist_band_unit_t), "clist_setup_band_units");
+    if (crdev->band_units == NULL) {
+        gs_free_object(mem, crdev->band_first_unit, "clist_setup_band_units");
+        crdev->band_first_unit = NULL;
+        return_error(gs_error_VMerror);
+    }
+    crdev->num_band_units = count;
+    for (band = 0; band < band_count; band++) {
+        int lines = min(band_height, dev->height - band * band_height);
+        int first = crdev->band_first_unit[band];
+        int n = crdev->band_first_unit[band + 1] - first;
+
+        for (i = 0; i < n; i++) {
+            clist_band_unit_t *unit = &(crdev->band_units[first + i]);
+
+            unit->band = band;
+            unit->y = lines * i / n;
+            unit->height = lines * (i + 1) / n - unit->y;
+        }
+    }
+    if (gs_debug[':'] != 0 && count > band_count)
+        dmprintf2(mem, "%% Split expensive bands into %d units for %d bands\n", count, band_count);
+    return 0;
+}
+
+/* Free the units, and the buffer used for split bands in process_page mode */
+static void
+clist_free_band_units(gx_device *dev, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+
+    if (crdev->split_band_buffer != NULL && options && options->free_buffer_fn)
+        options->free_buffer_fn(options->arg, dev, mem->thread_safe_memory, crdev->split_band_buffer);
+    crdev->split_band_buffer = NULL;
+    gs_free_object(mem, crdev->band_units, "clist_free_band_units");
+    crdev->band_units = NULL;
+    gs_free_object(mem, crdev->band_first_unit, "clist_free_band_units");
+    crdev->band_first_unit = NULL;
+    crdev->num_band_units = 0;
+}
+
+/*
+ * Allocate the reorder buffer: spare data areas (and process_page buffers)
+ * into which a thread that has finished a band ahead of the consumer can
+ * move its result, leaving the thread free to render the next band rather
+ * than sitting idle behind a slow band. The buffer is bounded so that the
+ * threads can't run arbitrarily far ahead of the consumer. Failing to get
+ * the memory is not an error, we just have fewer (or no) slots.
+ */
+static void
+clist_setup_reorder_slots(gx_device *dev, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    int num_slots = crdev->num_render_threads;
+    uint data_size = cdev->data_size;
+    int i;
+
+    crdev->reorder_slots = NULL;
+    crdev->num_reorder_slots = 0;
+    if (num_slots > crdev->num_band_units - crdev->num_render_threads)
+        num_slots = crdev->num_band_units - crdev->num_render_threads;
+    if (num_slots <= 0)
+        return;
+    /* The data areas get swapped between devices, so make them the largest */
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        gx_device_clist_common *thread_cdev =
+            (gx_device_clist_common *)crdev->render_threads[i].cdev;
+
+        if (thread_cdev->data_size > data_size)
+            data_size = thread_cdev->data_size;
+    }
+    crdev->reorder_slots = (clist_band_reorder_slot_t *)
+              gs_alloc_byte_array(mem, num_slots, sizeof(clist_band_reorder_slot_t),
+                                  "clist_setup_reorder_slots");
+    if (crdev->reorder_slots == NULL)
+        return;
+    memset(crdev->reorder_slots, 0, num_slots * sizeof(clist_band_reorder_slot_t));
+    for (i = 0; i < num_slots; i++) {
+        clist_band_reorder_slot_t *slot = &(crdev->reorder_slots[i]);
+
+        slot->unit = -1;
+        slot->alloc_data = gs_alloc_bytes(mem, data_size, "clist_setup_reorder_slots");
+        if (slot->alloc_data == NULL)
+            break;
+        slot->data = slot->alloc_data;
+        if (options && options->init_buffer_fn) {
+            slot->buffer_memory = mem->thread_safe_memory;
+            if (options->init_buffer_fn(options->arg, dev, slot->buffer_memory,
+                                        dev->width, crdev->page_band_height,
+                                        &slot->buffer) < 0) {
+                gs_free_object(mem, slot->alloc_data, "clist_setup_reorder_slots");
+                slot->alloc_data = NULL;
+                break;
+            }
+        }
+        crdev->num_reorder_slots++;
+    }
+    if (crdev->num_reorder_slots == 0) {
+        gs_free_object(mem, crdev->reorder_slots, "clist_setup_reorder_slots");
+        crdev->reorder_slots = NULL;
+    }
+    if(gs_debug[':'] != 0)
+        dmprintf1(mem, "%% Using %d band reorder slots\n", crdev->num_reorder_slots);
+}
+
+/* Free the reorder buffer. Called once all the threads have finished. */
+static void
+clist_free_reorder_slots(gx_device *dev, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gs_memory_t *mem = cdev->bandlist_memory;
+    int i;
+
+    if (crdev->reorder_slots == NULL)
+        return;
+    for (i = 0; i < crdev->num_reorder_slots; i++) {
+        clist_band_reorder_slot_t *slot = &(crdev->reorder_slots[i]);
+
+        /* The data area may be in use by any device, so it is freed from */
+        /* the pointer we allocated; the buffer goes back where it came.  */
+        if (slot->buffer != NULL && options && options->free_buffer_fn)
+            options->free_buffer_fn(options->arg, dev, slot->buffer_memory, slot->buffer);
+        gs_free_object(mem, slot->alloc_data, "clist_free_reorder_slots");
+    }
+    gs_free_object(mem, crdev->reorder_slots, "clist_free_reorder_slots");
+    crdev->reorder_slots = NULL;
+    crdev->num_reorder_slots = 0;
+}
+
 /* Set up and start the render threads */
 static int
 clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *options)
@@ -311,9 +730,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     gs_memory_t *mem = cdev->bandlist_memory;
     gs_memory_t *chunk_base_mem = mem->thread_safe_memory;
     gs_memory_status_t mem_status;
-    int i, j, band;
+    int i, j, band, unit;
     int code = 0;
-    int band_count = cdev->nbands;
     int band_height = crdev->page_info.band_params.BandHeight;
     byte **reserve_memory_array = NULL;
     int reserve_pdf14_memory_size = 0;
@@ -340,11 +758,22 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             reserve_size += 2 * 1024 * 1024;		/* a worst case estimate */
         }
     }
-    if (crdev->num_render_threads > band_count)
-        crdev->num_render_threads = band_count; /* don't bother starting more threads than bands */
     /* don't exceed our limit (allow for BGPrint and main thread) */
     if (crdev->num_render_threads > MAX_THREADS - 2)
         crdev->num_render_threads = MAX_THREADS - 2;
+    if ((code = clist_setup_band_units(dev, true)) < 0)
+        return code;
+    /* Split bands are finished off by the main thread, which needs a buffer */
+    if (crdev->num_band_units > cdev->nbands && options && options->init_buffer_fn &&
+        options->init_buffer_fn(options->arg, dev, mem->thread_safe_memory, dev->width,
+                                band_height, &crdev->split_band_buffer) < 0) {
+        crdev->split_band_buffer = NULL;
+        clist_free_band_units(dev, options);
+        if ((code = clist_setup_band_units(dev, false)) < 0)
+            return code;
+    }
+    if (crdev->num_render_threads > crdev->num_band_units)
+        crdev->num_render_threads = crdev->num_band_units; /* don't bother starting more threads than units */
 
     /* Allocate and initialize an array of thread control structures */
     crdev->render_threads = (clist_render_thread_control_t *)
@@ -353,6 +782,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
                                   "clist_setup_render_threads");
     /* fallback to non-threaded if allocation fails */
     if (crdev->render_threads == NULL) {
+        clist_free_band_units(dev, options);
         emprintf(mem, " VMerror prevented threads from starting.\n");
         return_error(gs_error_VMerror);
     }
@@ -363,6 +793,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     if (reserve_memory_array == NULL) {
         gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
         crdev->render_threads = NULL;
+        clist_free_band_units(dev, options);
         emprintf(mem, " VMerror prevented threads from starting.\n");
         return_error(gs_error_VMerror);
     }
@@ -375,10 +806,13 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* Almost all devices go in increasing line order (except the bmp* devices ) */
     crdev->thread_lookahead_direction = (y < (cdev->height - 1)) ? 1 : -1;
     band = y / band_height;
+    unit = crdev->band_first_unit[crdev->thread_lookahead_direction > 0 ? band : band + 1] -
+           (crdev->thread_lookahead_direction > 0 ? 0 : 1);
 
     /* If the 'mem' is not thread safe, we need to wrap it in a locking memory */
     gs_memory_status(chunk_base_mem, &mem_status);
     if (mem_status.is_thread_safe == false) {
+            clist_free_band_units(dev, options);
             return_error(gs_error_VMerror);
     }
 
@@ -390,6 +824,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
                                     sizeof(void*), "clist_render_setup_threads");
         if (crdev->icc_cache_list == NULL) {
             crdev->icc_cache_list = NULL;
+            clist_free_band_units(dev, options);
             return_error(gs_error_VMerror);
         }
         if (crdev->icc_cache_list_len > 0)
@@ -401,8 +836,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     }
 
     /* Loop creating the devices and semaphores for each thread, then start them */
-    for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
-            i++, band += crdev->thread_lookahead_direction) {
+    for (i=0; (i < crdev->num_render_threads) && (unit >= 0) && (unit < crdev->num_band_units);
+            i++, unit += crdev->thread_lookahead_direction) {
         gx_device *ndev;
         clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
 
@@ -414,7 +849,9 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             code = gs_error_VMerror;	/* set code to an error for cleanup after the loop */
         break;
         }
-        ndev = setup_device_and_mem_for_thread(chunk_base_mem, dev, false, &crdev->icc_cache_list[i]);
+        ndev = clist_reuse_thread_device(dev);
+        if (ndev == NULL)
+            ndev = setup_device_and_mem_for_thread(chunk_base_mem, dev, false, &crdev->icc_cache_list[i]);
         if (ndev == NULL) {
             code = gs_error_VMerror;	/* set code to an error for cleanup after the loop */
             break;
@@ -422,7 +859,10 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
 
         thread->cdev = ndev;
         thread->memory = ndev->memory;
-        thread->band = -1;              /* a value that won't match any valid band */
+        /* Share the playback statistics for the page, if we are collecting them */
+        ((gx_device_clist_common *)ndev)->band_profile = cdev->band_profile;
+        ((gx_device_clist_common *)ndev)->band_profile_thread = i;
+        thread->unit = -1;              /* a value that won't match any valid unit */
         thread->options = options;
         thread->buffer = NULL;
         if (options && options->init_buffer_fn) {
@@ -430,27 +870,33 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             if (code < 0)
                 break;
         }
+        thread->buffer_memory = thread->memory;
 
         /* create the buf device for this thread, and allocate the semaphores */
         if ((code = gdev_create_buf_device(cdev->buf_procs.create_buf_device,
                                 &(thread->bdev), ndev,
-                                band*crdev->page_band_height, NULL,
+                                crdev->band_units[unit].band * crdev->page_band_height, NULL,
                                 thread->memory, &(crdev->color_usage_array[0]))) < 0)
             break;
+        /* All the threads share the first thread's 'group' semaphore, so */
+        /* that we can wait for whichever thread finishes first.         */
         if ((thread->sema_this = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Band")) == NULL ||
-            (thread->sema_group = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Group")) == NULL) {
+            (thread->sema_group = (i == 0 ?
+                gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Group") :
+                crdev->render_threads[0].sema_group)) == NULL) {
             code = gs_error_VMerror;
             break;
         }
         /* We don't start the threads yet until we  free up the */
         /* reserve memory we have allocated for that band. */
-        thread->band = band;
+        thread->unit = unit;
     }
     /* If the code < 0, the last thread creation failed -- clean it up */
     if (code < 0) {
-        /* NB: 'band' will be the one that failed, so will be the next_band needed to start */
+        /* NB: 'unit' will be the one that failed, so will be the next_unit needed to start */
         /* the following relies on 'free' ignoring NULL pointers */
-        gx_semaphore_free(crdev->render_threads[i].sema_group);
+        if (i == 0)
+            gx_semaphore_free(crdev->render_threads[i].sema_group);
         gx_semaphore_free(crdev->render_threads[i].sema_this);
         if (crdev->render_threads[i].bdev != NULL)
             cdev->buf_procs.destroy_buf_device(crdev->render_threads[i].bdev);
@@ -471,7 +917,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             crdev->render_threads[i].buffer = NULL;
         }
         if (crdev->render_threads[i].memory != NULL) {
-            gs_memory_chunk_release(crdev->render_threads[i].memory);
+            clist_release_thread_memory(crdev->render_threads[i].memory);
             crdev->render_threads[i].memory = NULL;
         }
     }
@@ -480,13 +926,14 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* machinery still works, so that's OK.                     */
     if (i == 0) {
         if (crdev->render_threads[0].memory != NULL) {
-            gs_memory_chunk_release(crdev->render_threads[0].memory);
+            clist_release_thread_memory(crdev->render_threads[0].memory);
             if (chunk_base_mem != mem) {
                 gs_free_object(mem, chunk_base_mem, "clist_setup_render_threads(locked allocator)");
             }
         }
         gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
         crdev->render_threads = NULL;
+        clist_free_band_units(dev, options);
         /* restore the file pointers */
         if (cdev->page_info.cfile == NULL) {
             char fmode[4];
@@ -494,28 +941,32 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
             strcpy(fmode, "a+");        /* file already exists and we want to re-use it */
             strncat(fmode, gp_fmode_binary_suffix, 1);
             cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &cdev->page_info.cfile,
-                                mem, cdev->bandlist_memory, true);
+                                mem, cdev->bandlist_memory, cdev->page_info.compression);
             cdev->page_info.io_procs->fseek(cdev->page_info.cfile, 0, SEEK_SET, cdev->page_info.cfname);
             cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &cdev->page_info.bfile,
-                                mem, cdev->bandlist_memory, false);
+                                mem, cdev->bandlist_memory, cdev->page_info.compression);
             cdev->page_info.io_procs->fseek(cdev->page_info.bfile, 0, SEEK_SET, cdev->page_info.bfname);
         }
         emprintf1(mem, "Rendering threads not started, code=%d.\n", code);
         return_error(code);
     }
+    /* Set up the reorder buffer while the reserve memory is still held, so  */
+    /* that the parked bands don't eat into what the threads need to render. */
+    j = crdev->num_render_threads;
+    crdev->num_render_threads = i;
+    clist_setup_reorder_slots(dev, options);
+
     /* Free up any "reserve" memory we may have allocated, and start the
      * threads since we deferred that in the thread setup loop above.
      * We know if we get here we can start at least 1 thread.
      */
-    for (j=0, code = 0; j<crdev->num_render_threads; j++) {
+    while (--j >= 0)
         gs_free_object(mem, reserve_memory_array[j], "clist_setup_render_threads");
-        if (code == 0 && j < i)
-            code = clist_start_render_thread(dev, j, crdev->render_threads[j].band);
-    }
     gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
-    crdev->num_render_threads = i;
+    for (j=0, code = 0; code == 0 && j < i; j++)
+        code = clist_start_render_thread(dev, j, crdev->render_threads[j].unit);
     crdev->curr_render_thread = 0;
-    crdev->next_band = band;
+    crdev->next_unit = unit;
 
     if(gs_debug[':'] != 0)
         dmprintf1(mem, "%% Using %d rendering threads\n", i);
@@ -578,12 +1029,14 @@ teardown_device_and_mem_for_thread(gx_device *dev, gp_thread_id thread_id, bool
        deviceN stuff if was allocated and copied earlier for the device
        will be freed with this call and the icc_struct ref count will be decremented. */
     gs_free_object(thread_memory, thread_cdev, "clist_teardown_render_threads");
+    if (gs_debug[':'] != 0)
+        gs_memory_chunk_dump_classes(thread_memory);
 #ifdef DEBUG
     dmprintf(thread_memory, "rendering thread ending memory state...\n");
     gs_memory_chunk_dump_memory(thread_memory);
     dmprintf(thread_memory, "                                    memory dump done.\n");
 #endif
-    gs_memory_chunk_release(thread_memory);
+    clist_release_thread_memory(thread_memory);
 }
 
 void
@@ -600,42 +1053,49 @@ clist_teardown_render_threads(gx_device *dev)
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
 
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
+            if (thread->thread != NULL)     /* started, but not yet collected */
+                clist_finish_render_thread(thread);
         }
+        /* The threads' options are still valid for freeing the parked buffers */
+        clist_free_reorder_slots(dev, crdev->render_threads[0].options);
+        clist_free_band_units(dev, crdev->render_threads[0].options);
         /* then free each thread's memory */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
             gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
 
-            /* Free control semaphores */
-            gx_semaphore_free(thread->sema_group);
+            /* Free control semaphores (thread 0 owns the shared 'group') */
+            if (i == 0)
+                gx_semaphore_free(thread->sema_group);
             gx_semaphore_free(thread->sema_this);
             /* destroy the thread's buffer device */
             thread_cdev->buf_procs.destroy_buf_device(thread->bdev);
 
             if (thread->options) {
                 if (thread->options->free_buffer_fn && thread->buffer) {
-                    thread->options->free_buffer_fn(thread->options->arg, dev, thread->memory, thread->buffer);
+                    thread->options->free_buffer_fn(thread->options->arg, dev, thread->buffer_memory, thread->buffer);
                     thread->buffer = NULL;
                 }
                 thread->options = NULL;
             }
 
-            /* before freeing this device's memory, swap with cdev if it was the main_thread_data */
-            if (thread_cdev->data == crdev->main_thread_data) {
-                thread_cdev->data = cdev->data;
-                cdev->data = crdev->main_thread_data;
-            }
 #ifdef DEBUG
             if (gs_debug[':'])
                 dmprintf2(thread->memory, "%% Thread %d total usertime=%ld msec\n", i, thread->cputime);
             dmprintf1(thread->memory, "\nThread %d ", i);
 #endif
-            teardown_device_and_mem_for_thread((gx_device *)thread_cdev, thread->thread, false);
+            /* Keep the device for the next page if we can */
+            if (thread->status == THREAD_ERROR ||
+                !clist_cache_thread_device(dev, (gx_device *)thread_cdev))
+                teardown_device_and_mem_for_thread((gx_device *)thread_cdev, NULL, false);
         }
         gs_free_object(mem, crdev->render_threads, "clist_teardown_render_threads");
         crdev->render_threads = NULL;
+        /* The data areas have been passed around the threads (and reorder */
+        /* slots) but each thread's own is freed via its 'buf', so all we  */
+        /* need is to give the main thread back the data area it started  */
+        /* with.                                                            */
+        cdev->data = crdev->main_thread_data;
 
         /* Now re-open the clist temp files so we can write to them */
         if (cdev->page_info.cfile == NULL) {
@@ -644,30 +1104,37 @@ clist_teardown_render_threads(gx_device *dev)
             strcpy(fmode, "a+");        /* file already exists and we want to re-use it */
             strncat(fmode, gp_fmode_binary_suffix, 1);
             cdev->page_info.io_procs->fopen(cdev->page_info.cfname, fmode, &cdev->page_info.cfile,
-                                mem, cdev->bandlist_memory, true);
+                                mem, cdev->bandlist_memory, cdev->page_info.compression);
             cdev->page_info.io_procs->fseek(cdev->page_info.cfile, 0, SEEK_SET, cdev->page_info.cfname);
             cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &cdev->page_info.bfile,
-                                mem, cdev->bandlist_memory, false);
+                                mem, cdev->bandlist_memory, cdev->page_info.compression);
             cdev->page_info.io_procs->fseek(cdev->page_info.bfile, 0, SEEK_SET, cdev->page_info.bfname);
         }
     }
 }
 
 static int
-clist_start_render_thread(gx_device *dev, int thread_index, int band)
+clist_start_render_thread(gx_device *dev, int thread_index, int unit)
 {
     gx_device_clist *cldev = (gx_device_clist *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
+    clist_render_thread_control_t *thread = &(crdev->render_threads[thread_index]);
     int code;
 
-    crdev->render_threads[thread_index].band = band;
-    crdev->render_threads[thread_index].status = THREAD_BUSY;
+    thread->unit = unit;
+    thread->band = crdev->band_units[unit].band;
+    thread->band_y = crdev->band_units[unit].y;
+    thread->band_lines = crdev->band_units[unit].height;
+    thread->status = THREAD_BUSY;
 
-    /* Finally, fire it up */
-    code = gp_thread_start(clist_render_thread,
-                           &(crdev->render_threads[thread_index]),
-                           &(crdev->render_threads[thread_index].thread));
-    gp_thread_label(crdev->render_threads[thread_index].thread, "Band");
+    /* Finally, fire it up on one of the library context's worker threads */
+    code = gs_lib_ctx_start_worker(dev->memory, clist_render_thread,
+                                   &(crdev->render_threads[thread_index]),
+                                   &(crdev->render_threads[thread_index].thread));
+    if (code < 0) {
+        thread->status = THREAD_IDLE;
+        thread->unit = -1;
+    }
 
     return code;
 }
@@ -699,16 +1166,20 @@ clist_render_thread(void *data)
         band_end_line = dev->height;
     band_num_lines = band_end_line - band_begin_line;
 
+    /* A unit that is only part of a band is rendered where it would be in */
+    /* the buffer for the whole band, so the consumer can put them together */
     code = crdev->buf_procs.setup_buf_device
-            (bdev, mdata, raster, (byte **)mlines, 0, band_num_lines, band_num_lines);
+            (bdev, mdata, raster, (byte **)mlines, thread->band_y, thread->band_lines, band_num_lines);
     band_rect.p.x = 0;
-    band_rect.p.y = band_begin_line;
+    band_rect.p.y = band_begin_line + thread->band_y;
     band_rect.q.x = dev->width;
-    band_rect.q.y = band_end_line;
+    band_rect.q.y = band_rect.p.y + thread->band_lines;
     if (code >= 0)
         code = clist_render_rectangle(cldev, &band_rect, bdev, NULL, true);
 
-    if (code >= 0 && thread->options && thread->options->process_fn)
+    /* The consumer processes split bands once they are complete */
+    if (code >= 0 && thread->options && thread->options->process_fn &&
+        thread->band_lines == band_num_lines)
         code = thread->options->process_fn(thread->options->arg, dev, bdev, &band_rect, thread->buffer);
 
     /* Reset the band boundaries now */
@@ -735,101 +1206,318 @@ clist_render_thread(void *data)
 }
 
 /*
- * Copy the raster data from the completed thread to the caller's
- * device (the main thread)
- * Return 0 if OK, < 0 is the error code from the thread
- *
- * After swapping the pointers, start up the completed thread with the
- * next band remaining to do (if any)
+ * Wait for a started thread to signal that it has finished its band, and
+ * reap the OS thread. The thread's status tells the caller how it went.
+ */
+static void
+clist_finish_render_thread(clist_render_thread_control_t *thread)
+{
+    gx_semaphore_wait(thread->sema_this);
+    gs_lib_ctx_finish_worker(thread->thread);
+    thread->thread = NULL;
+}
+
+/*
+ * Move the results of any threads that have finished a unit other than the
+ * one the consumer needs next into free reorder slots, and set those threads
+ * to work on the next units remaining. This keeps the threads busy while the
+ * consumer is held up by a slow band, rather than having them sit on their
+ * results until it is their turn to be collected.
  */
 static int
-clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_options_t *options)
+clist_park_finished_threads(gx_device *dev, int unit_needed)
 {
     gx_device_clist *cldev = (gx_device_clist *)dev;
-    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
     gx_device_clist_reader *crdev = &cldev->reader;
-    int i, code = 0;
-    int thread_index = crdev->curr_render_thread;
-    clist_render_thread_control_t *thread = &(crdev->render_threads[thread_index]);
-    gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
-    int band_height = crdev->page_info.band_params.BandHeight;
-    int band_count = cdev->nbands;
-    byte *tmp;                  /* for swapping data areas */
-
-    /* We expect that the thread needed will be the 'current' thread */
-    if (thread->band != band_needed) {
-        int band = band_needed;
+    int i, j = 0, code = 0;
 
-        emprintf3(thread->memory,
-                  "thread->band = %d, band_needed = %d, direction = %d, ",
-                  thread->band, band_needed, crdev->thread_lookahead_direction);
-
-        /* Probably we went in the wrong direction, so let the threads */
-        /* all complete, then restart them in the opposite direction   */
-        /* If the caller is 'bouncing around' we may end up back here, */
-        /* but that is a VERY rare case (we haven't seen it yet).      */
-        for (i=0; i < crdev->num_render_threads; i++) {
-            clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+    for (i = 0; i < crdev->num_render_threads; i++) {
+        clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+        gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
+        clist_band_reorder_slot_t *slot;
+        byte *tmp_data;
+        void *tmp_buffer;
+        gs_memory_t *tmp_memory;
+
+        /* Errors are left for the consumer to find when it wants the unit */
+        if (thread->status != THREAD_DONE || thread->unit == unit_needed)
+            continue;
+        while (j < crdev->num_reorder_slots && crdev->reorder_slots[j].unit >= 0)
+            j++;
+        if (j == crdev->num_reorder_slots)
+            break;		/* the reorder buffer is full */
+        slot = &(crdev->reorder_slots[j]);
+        clist_finish_render_thread(thread);
+
+        /* Swap the data areas (and buffers) to avoid the copy */
+        tmp_data = slot->data;
+        slot->data = thread_cdev->data;
+        thread_cdev->data = tmp_data;
+        tmp_buffer = slot->buffer;
+        slot->buffer = thread->buffer;
+        thread->buffer = tmp_buffer;
+        tmp_memory = slot->buffer_memory;
+        slot->buffer_memory = thread->buffer_memory;
+        thread->buffer_memory = tmp_memory;
+        slot->unit = thread->unit;
+        thread->status = THREAD_IDLE;
+        thread->unit = -1;
+
+        if (crdev->next_unit >= 0 && crdev->next_unit < crdev->num_band_units) {
+            code = clist_start_render_thread(dev, i, crdev->next_unit);
+            crdev->next_unit += crdev->thread_lookahead_direction;
+            if (code < 0)
+                break;
+        }
+    }
+    return code;
+}
 
-            if (thread->status == THREAD_BUSY)
-                gx_semaphore_wait(thread->sema_this);
+/*
+ * Wait until the unit needed has been rendered. It may already be waiting
+ * in the reorder buffer, in which case *pslot is set. Otherwise we wait for
+ * the thread rendering it, parking the results of any other threads that
+ * finish meanwhile so that they can carry on with the next units, and set
+ * *pthread. The caller must pass the slot or thread to clist_release_unit
+ * once it has taken the results.
+ */
+static int
+clist_wait_for_unit(gx_device *dev, int unit_needed, clist_band_reorder_slot_t **pslot,
+                    clist_render_thread_control_t **pthread)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int unit_count = crdev->num_band_units;
+    int i, code = 0;
+    int thread_index;
+    clist_render_thread_control_t *thread;
+
+    *pslot = NULL;
+    *pthread = NULL;
+    for (;;) {
+        /* It may have been rendered out of order and parked */
+        for (i = 0; i < crdev->num_reorder_slots; i++) {
+            if (crdev->reorder_slots[i].unit == unit_needed) {
+                *pslot = &(crdev->reorder_slots[i]);
+                return 0;
+            }
         }
-        crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
-        if (band_needed == band_count-1)
-            crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
-        if (band_needed == 0)
-            crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
-
-        dmprintf1(thread->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
-
-        /* Loop starting the threads in the new lookahead_direction */
-        for (i=0; (i < crdev->num_render_threads) && (band >= 0) && (band < band_count);
-                i++, band += crdev->thread_lookahead_direction) {
-            thread = &(crdev->render_threads[i]);
-            thread->band = -1;          /* a value that won't match any valid band */
-            /* Start thread 'i' to do band */
-            if ((code = clist_start_render_thread(dev, i, band)) < 0)
+        for (thread_index = 0; thread_index < crdev->num_render_threads; thread_index++)
+            if (crdev->render_threads[thread_index].unit == unit_needed)
                 break;
+        if (thread_index == crdev->num_render_threads) {
+            int unit = unit_needed;
+
+            emprintf2(crdev->memory,
+                      "band_needed = %d, direction = %d, ",
+                      crdev->band_units[unit_needed].band, crdev->thread_lookahead_direction);
+
+            /* Probably we went in the wrong direction, so let the threads */
+            /* all complete, then restart them in the opposite direction   */
+            /* If the caller is 'bouncing around' we may end up back here, */
+            /* but that is a VERY rare case (we haven't seen it yet).      */
+            for (i=0; i < crdev->num_render_threads; i++) {
+                thread = &(crdev->render_threads[i]);
+
+                if (thread->thread != NULL)     /* started, but not yet collected */
+                    clist_finish_render_thread(thread);
+                thread->status = THREAD_IDLE;
+                thread->unit = -1;          /* a value that won't match any valid unit */
+            }
+            for (i=0; i < crdev->num_reorder_slots; i++)
+                crdev->reorder_slots[i].unit = -1;
+            crdev->thread_lookahead_direction *= -1;      /* reverse direction (but may be overruled below) */
+            if (unit_needed == unit_count-1)
+                crdev->thread_lookahead_direction = -1;   /* assume backwards if we are asking for the last band */
+            if (unit_needed == 0)
+                crdev->thread_lookahead_direction = 1;    /* force forward if we are looking for band 0 */
+
+            dmprintf1(crdev->memory, "new_direction = %d\n", crdev->thread_lookahead_direction);
+
+            /* Loop starting the threads in the new lookahead_direction */
+            for (i=0; (i < crdev->num_render_threads) && (unit >= 0) && (unit < unit_count);
+                    i++, unit += crdev->thread_lookahead_direction) {
+                /* Start thread 'i' to do unit */
+                if ((code = clist_start_render_thread(dev, i, unit)) < 0)
+                    return code;
+            }
+            crdev->next_unit = unit;	/* may be < 0 or == unit_count, but that is handled later */
+            continue;
         }
-        crdev->next_band = i;			/* may be < 0 or == band_count, but that is handled later */
-        crdev->curr_render_thread = thread_index = 0;
-        thread = &(crdev->render_threads[0]);
-        thread_cdev = (gx_device_clist_common *)thread->cdev;
+        thread = &(crdev->render_threads[thread_index]);
+        if (thread->status != THREAD_BUSY)
+            break;
+        /* While we wait, let threads that are done get on with more units */
+        if ((code = clist_park_finished_threads(dev, unit_needed)) < 0)
+            return code;
+        /* Any thread finishing signals the group, so we may wake up early */
+        if (thread->status == THREAD_BUSY)
+            gx_semaphore_wait(thread->sema_group);
     }
+
     /* Wait for this thread */
-    gx_semaphore_wait(thread->sema_this);
-    gp_thread_finish(thread->thread);
-    thread->thread = NULL;
+    clist_finish_render_thread(thread);
     if (thread->status == THREAD_ERROR)
         return_error(gs_error_unknownerror);          /* FAIL */
+    *pthread = thread;
+    return 0;
+}
+
+/*
+ * Let the slot or thread that held a unit the consumer has finished with
+ * move on: a free slot may take a thread's finished unit, and a thread is
+ * started on the next unit remaining to do (if any).
+ */
+static int
+clist_release_unit(gx_device *dev, clist_band_reorder_slot_t *slot,
+                   clist_render_thread_control_t *thread)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int thread_index;
+    int code = 0;
+
+    if (slot != NULL) {
+        slot->unit = -1;
+        /* Now there is a free slot, a finished thread may move on */
+        return clist_park_finished_threads(dev, -1);
+    }
+    thread_index = thread - crdev->render_threads;
+    thread->status = THREAD_IDLE;        /* the data is no longer valid */
+    thread->unit = -1;
+    if (crdev->next_unit >= 0 && crdev->next_unit < crdev->num_band_units) {
+        code = clist_start_render_thread(dev, thread_index, crdev->next_unit);
+        crdev->next_unit += crdev->thread_lookahead_direction;
+    }
+    crdev->curr_render_thread = thread_index;
+    return code;
+}
+
+/*
+ * Put a band that was split into several units back together in the main
+ * thread's data area. Each unit was rendered in the position it has in the
+ * band, so we only need to copy its lines (of each plane) across. Then do
+ * the process_page processing that the threads left for the whole band.
+ */
+static int
+clist_get_split_band(gx_device *dev, int band_needed, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int band_height = crdev->page_band_height;
+    int lines = min(band_height, dev->height - band_needed * band_height);
+    int first = crdev->band_first_unit[band_needed];
+    int count = crdev->band_first_unit[band_needed + 1] - first;
+    uint raster = gx_device_raster_plane(dev, NULL);
+    int num_planes = (dev->is_planar ? dev->color_info.num_components : 1);
+    int i, plane, code;
+
+    for (i = 0; i < count; i++) {
+        /* Take the units in the order the threads were started on them */
+        int unit = (crdev->thread_lookahead_direction > 0 ? first + i : first + count - 1 - i);
+        const clist_band_unit_t *pu = &(crdev->band_units[unit]);
+        clist_band_reorder_slot_t *slot;
+        clist_render_thread_control_t *thread;
+        byte *src, *dst;
+
+        if ((code = clist_wait_for_unit(dev, unit, &slot, &thread)) < 0)
+            return code;
+        src = (slot != NULL ? slot->data : ((gx_device_clist_common *)thread->cdev)->data) +
+                crdev->page_tile_cache_size;
+        dst = cdev->data + crdev->page_tile_cache_size;
+        for (plane = 0; plane < num_planes; plane++) {
+            size_t offset = ((size_t)plane * lines + pu->y) * raster;
+
+            memcpy(dst + offset, src + offset, (size_t)pu->height * raster);
+        }
+        if ((code = clist_release_unit(dev, slot, thread)) < 0)
+            return code;
+    }
+    if (options && options->process_fn) {
+        gx_device *bdev;
+        gs_int_rect band_rect;
 
-    if (options && options->output_fn) {
-        code = options->output_fn(options->arg, dev, thread->buffer);
+        code = gdev_create_buf_device(cdev->buf_procs.create_buf_device,
+                                      &bdev, cdev->target, band_needed * band_height, NULL,
+                                      cdev->bandlist_memory, &(crdev->color_usage_array[band_needed]));
+        if (code < 0)
+            return code;
+        code = crdev->buf_procs.setup_buf_device(bdev, cdev->data + crdev->page_tile_cache_size,
+                                                 raster, NULL, 0, lines, lines);
+        band_rect.p.x = 0;
+        band_rect.p.y = band_needed * band_height;
+        band_rect.q.x = dev->width;
+        band_rect.q.y = band_rect.p.y + lines;
+        if (code >= 0)
+            code = options->process_fn(options->arg, dev, bdev, &band_rect, crdev->split_band_buffer);
+        cdev->buf_procs.destroy_buf_device(bdev);
         if (code < 0)
             return code;
     }
+    if (options && options->output_fn)
+        return options->output_fn(options->arg, dev, crdev->split_band_buffer);
+    return 0;
+}
 
-    /* Swap the data areas to avoid the copy */
-    tmp = cdev->data;
-    cdev->data = thread_cdev->data;
-    thread_cdev->data = tmp;
-    thread->status = THREAD_IDLE;        /* the data is no longer valid */
-    thread->band = -1;
+/*
+ * Copy the raster data for the band needed to the caller's device (the
+ * main thread), Return 0 if OK, < 0 is the error code from the thread.
+ *
+ * The band may already be waiting in the reorder buffer, otherwise we
+ * wait for the thread rendering it. After swapping the pointers, start up
+ * the completed thread with the next unit remaining to do (if any). Bands
+ * that were split are put together by clist_get_split_band.
+ */
+static int
+clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_options_t *options)
+{
+    gx_device_clist *cldev = (gx_device_clist *)dev;
+    gx_device_clist_common *cdev = (gx_device_clist_common *)dev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    int code = 0;
+    int unit;
+    clist_band_reorder_slot_t *slot;
+    clist_render_thread_control_t *thread;
+    int band_height = crdev->page_info.band_params.BandHeight;
+    int band_count = cdev->nbands;
+    byte **pdata;
+    byte *tmp;                  /* for swapping data areas */
+
+    if (band_needed < 0 || band_needed >= band_count)
+        return_error(gs_error_rangecheck);
+
+    unit = crdev->band_first_unit[band_needed];
+    if (crdev->band_first_unit[band_needed + 1] - unit > 1) {
+        code = clist_get_split_band(dev, band_needed, options);
+        slot = NULL;
+        thread = NULL;
+    } else {
+        if ((code = clist_wait_for_unit(dev, unit, &slot, &thread)) < 0)
+            return code;
+        if (options && options->output_fn) {
+            code = options->output_fn(options->arg, dev,
+                                      (slot != NULL ? slot->buffer : thread->buffer));
+            if (code < 0)
+                return code;
+        }
+        /* Swap the data areas to avoid the copy */
+        pdata = (slot != NULL ? &slot->data : &((gx_device_clist_common *)thread->cdev)->data);
+        tmp = cdev->data;
+        cdev->data = *pdata;
+        *pdata = tmp;
+    }
+    if (code < 0)
+        return code;
     /* Update the bounds for this band */
     cdev->ymin =  band_needed * band_height;
     cdev->ymax =  cdev->ymin + band_height;
     if (cdev->ymax > dev->height)
         cdev->ymax = dev->height;
 
-    if (crdev->next_band >= 0 && crdev->next_band < band_count) {
-        code = clist_start_render_thread(dev, thread_index, crdev->next_band);
-        crdev->next_band += crdev->thread_lookahead_direction;
-    }
-    /* bump the 'curr' to the next thread */
-    crdev->curr_render_thread = crdev->curr_render_thread == crdev->num_render_threads - 1 ?
-                0 : crdev->curr_render_thread + 1;
-
-    return code;
+    if (slot == NULL && thread == NULL)
+        return 0;		/* the units were released as they were copied */
+    return clist_release_unit(dev, slot, thread);
 }
 
 /* Copy a rasterized rectangle to the client, rasterizing if needed. */
@@ -32,6 +32,11 @@
 /* When called to setup for background printing, bg_print is true       */
 gx_device * setup_device_and_mem_for_thread(gs_memory_t *chunk_base_mem, gx_device *dev, bool bg_print, gsicc_link_cache_t **cachep);
 
+/* Open the main device's clist files for a copy of the device and set  */
+/* the copy up for reading the current page. Exported for use by the    */
+/* background printing of devices that are not printers (display).      */
+int clist_attach_thread_device(gx_device *dev, gx_device *ndev, bool bg_print, gsicc_link_cache_t **cachep);
+
 /* Close and free the thread's device, finish the thread, free up the   */
 /* thread's memory and its chunk allocator and close the clist files    */
 /* if 'unlink' is true, also delete the clist files (for bg printing)   */
@@ -51,18 +56,44 @@ struct clist_render_thread_control_s {
                                 /* values allow waiting until status < 2 */
     gs_memory_t *memory;	/* thread's 'chunk' memory allocator */
     gx_semaphore_t *sema_this;
-    gx_semaphore_t *sema_group;
+    gx_semaphore_t *sema_group;	/* shared by all the threads of a page */
     gx_device *cdev;	/* clist device copy */
     gx_device *bdev;	/* this thread's buffer device */
-    int band;
-    gp_thread_id thread;
+    int unit;			/* index of the unit being rendered, or -1 */
+    int band;			/* the band, lines and height of that unit */
+    int band_y;			/* (copied, as the thread can't see the */
+    int band_lines;		/*  reader's list of units) */
+    gs_lib_ctx_worker_t *thread;	/* pooled worker rendering the band */
 
     /* For process_page mode */
     gx_process_page_options_t *options;
     void *buffer;
+    gs_memory_t *buffer_memory;	/* allocator 'buffer' came from */
 #ifdef DEBUG
     ulong cputime;
 #endif
 };
 
+/* A piece of work for a rendering thread. This is normally a whole band,  */
+/* but bands that the writer's statistics show to be much more expensive  */
+/* than the rest of the page are split into ranges of lines, so that they */
+/* can be rendered by several threads at once.                            */
+struct clist_band_unit_s {
+    int band;
+    int y;			/* first line, relative to the top of the band */
+    int height;			/* number of lines */
+};
+
+/* A rendered unit that has been set aside so that its thread can take on */
+/* another unit before the consumer is ready for this one. The data area  */
+/* and process_page buffer are swapped in and out of the threads and the  */
+/* main device, so 'data' and 'buffer' are rarely the ones we allocated.  */
+struct clist_band_reorder_slot_s {
+    int unit;			/* unit held, or -1 if the slot is free */
+    byte *data;			/* band data area */
+    void *buffer;		/* process_page buffer, if any */
+    gs_memory_t *buffer_memory;	/* allocator 'buffer' came from */
+    byte *alloc_data;		/* the data area allocated for this slot */
+};
+
 #endif /* gxclthrd_INCLUDED */
@@ -32,7 +32,6 @@
 
 /* ---------------- Statistics ---------------- */
 
-#ifdef DEBUG
 const char *const cmd_op_names[16] =
 {cmd_op_name_strings};
 static const char *const cmd_misc_op_names[16] =
@@ -48,6 +47,8 @@ const char *const *const cmd_sub_op_names[16] =
  0, 0, 0, 0,
  0, cmd_misc2_op_names, cmd_segment_op_names, cmd_path_op_names
 };
+
+#ifdef DEBUG
 #ifndef GS_THREADSAFE
 struct stats_cmd_s {
     ulong op_counts[256];
@@ -184,6 +185,9 @@ cmd_write_band(gx_device_clist_writer * cldev, int band_min, int band_max,
                   band_min, band_max, cb.pos);
         cldev->page_info.io_procs->fwrite_chars(&cb, sizeof(cb), bfile);
         if (cp != 0) {
+            int64_t size = 0;
+            int band;
+
             pcl->tail->next = 0;	/* terminate the list */
             for (; cp != 0; cp = cp->next) {
 #ifdef DEBUG
@@ -198,8 +202,16 @@ cmd_write_band(gx_device_clist_writer * cldev, int band_min, int band_max,
                 if_debug2m('L', cldev->memory, "[L]Wrote cmd id=%ld at %"PRId64"\n",
                            cp->id, cldev->page_info.io_procs->ftell(cfile));
                 cldev->page_info.io_procs->fwrite_chars(cp + 1, cp->size, cfile);
+                size += cp->size;
             }
             pcl->head = pcl->tail = 0;
+            /* Every band in the range plays these commands back, so they */
+            /* all count them in their rendering cost estimate. */
+            for (band = max(band_min, 0); band <= min(band_max, cldev->nbands - 1); band++)
+                cldev->states[band].color_usage.cmd_bytes += size;
+            if (pcl != &cldev->band_range_list && band_min == band_max &&
+                band_min >= 0 && band_min < cldev->nbands)
+                cldev->states[band_min].color_usage.band_cmd_bytes += size;
         }
         cldev->page_info.io_procs->fwrite_chars(&end, 1, cfile);
         process_interrupts(cldev->memory);
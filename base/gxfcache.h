@@ -219,6 +219,7 @@ typedef struct char_cache_s {
     uint upper;			/* max size of a single cached char */
     gs_glyph_mark_proc_t mark_glyph;
     void *mark_glyph_data;	/* closure data */
+    gs_lib_ctx_budget_client_t *budget;	/* our share of the memory budget */
 } char_cache;
 
 /* ------ Font/character cache ------ */
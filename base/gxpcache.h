@@ -38,10 +38,12 @@ struct gx_pattern_cache_s {
     size_t bits_used;
     size_t max_bits;
     void (*free_all) (gx_pattern_cache *);
+    gs_lib_ctx_budget_client_t *budget;	/* our share of the memory budget */
 };
 
 #define private_st_pattern_cache() /* in gxpcmap.c */\
-  gs_private_st_ptrs1(st_pattern_cache, gx_pattern_cache,\
-    "gx_pattern_cache", pattern_cache_enum, pattern_cache_reloc, tiles)
+  gs_private_st_ptrs1_final(st_pattern_cache, gx_pattern_cache,\
+    "gx_pattern_cache", pattern_cache_enum, pattern_cache_reloc,\
+    pattern_cache_finalize, tiles)
 
 #endif /* gxpcache_INCLUDED */
@@ -79,6 +79,9 @@ gx_pat_cache_default_bits(void)
 #endif
 }
 
+static void pattern_cache_finalize(const gs_memory_t *, void *);
+static void gx_pattern_cache_free_entry(gx_pattern_cache *, gx_color_tile *);
+
 /* Define the structures for Pattern rendering and caching. */
 private_st_color_tile();
 private_st_color_tile_element();
@@ -811,13 +814,41 @@ pattern_cache_free_all(gx_pattern_cache * pcache)
     gx_pattern_cache_winnow(pcache, pattern_cache_choose_all, NULL);
 }
 
+/* Free entries, oldest first, to give memory back to the memory budget. */
+/* Like gx_pattern_cache_ensure_space, this leaves locked entries alone. */
+static size_t
+pattern_cache_evict(void *data, size_t wanted)
+{
+    gx_pattern_cache *pcache = (gx_pattern_cache *)data;
+    size_t start_used = pcache->bits_used;
+    uint start_free_id = pcache->next;
+
+    while (start_used - pcache->bits_used < wanted && pcache->bits_used != 0) {
+        pcache->next = (pcache->next + 1) % pcache->num_tiles;
+        gx_pattern_cache_free_entry(pcache, &pcache->tiles[pcache->next]);
+        if (pcache->next == start_free_id)
+            break;
+    }
+    return start_used - pcache->bits_used;
+}
+
+static void
+pattern_cache_finalize(const gs_memory_t *cmem, void *vptr)
+{
+    gx_pattern_cache *pcache = (gx_pattern_cache *)vptr;
+
+    gs_lib_ctx_budget_unregister(pcache->budget);
+    pcache->budget = NULL;
+}
+
 /* Allocate a Pattern cache. */
 gx_pattern_cache *
 gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
 {
+    /* Immovable, since the memory budget keeps a pointer to it. */
     gx_pattern_cache *pcache =
-    gs_alloc_struct(mem, gx_pattern_cache, &st_pattern_cache,
-                    "gx_pattern_alloc_cache(struct)");
+    gs_alloc_struct_immovable(mem, gx_pattern_cache, &st_pattern_cache,
+                              "gx_pattern_alloc_cache(struct)");
     gx_color_tile *tiles =
     gs_alloc_struct_array(mem, num_tiles, gx_color_tile,
                           &st_color_tile_element,
@@ -837,6 +868,9 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
     pcache->bits_used = 0;
     pcache->max_bits = max_bits;
     pcache->free_all = pattern_cache_free_all;
+    pcache->budget = gs_lib_ctx_budget_register(mem, "pattern cache",
+                                                GS_BUDGET_PRIORITY_PATTERN, false,
+                                                pattern_cache_evict, pcache);
     for (i = 0; i < num_tiles; tiles++, i++) {
         tiles->id = gx_no_bitmap_id;
         /* Clear the pointers to pacify the GC. */
@@ -982,6 +1016,7 @@ gx_pattern_cache_free_entry(gx_pattern_cache * pcache, gx_color_tile * ctile)
 
         pcache->tiles_used--;
         pcache->bits_used -= ctile->bits_used;
+        gs_lib_ctx_budget_set_used(pcache->budget, pcache->bits_used);
         ctile->id = gx_no_bitmap_id;
     }
 }
@@ -1000,6 +1035,9 @@ gx_pattern_cache_ensure_space(gs_gstate * pgs, size_t needed)
         return;                 /* no cache -- just exit */
 
     pcache = pgs->pattern_cache;
+    /* Make room in the memory budget (which may free some of our entries), */
+    /* even though we'll go ahead and cache the tile if it can't be had.    */
+    gs_lib_ctx_budget_reserve(pcache->budget, needed);
     start_free_id = pcache->next;	/* for scan wrap check */
     /* If too large then start freeing entries */
     /* By starting just after 'next', we attempt to first free the oldest entries */
@@ -1024,6 +1062,7 @@ gx_pattern_cache_update_used(gs_gstate *pgs, size_t used)
 
     pcache->bits_used += used;
     pcache->tiles_used++;
+    gs_lib_ctx_budget_set_used(pcache->budget, pcache->bits_used);
 }
 
 /*
@@ -183,6 +183,7 @@ gsmdebug_h=$(GLSRC)gsmdebug.h
 gsmemraw_h=$(GLSRC)gsmemraw.h
 gsmemory_h=$(GLSRC)gsmemory.h
 gsmemret_h=$(GLSRC)gsmemret.h
+gsmprof_h=$(GLSRC)gsmprof.h
 gsnogc_h=$(GLSRC)gsnogc.h
 gsrefct_h=$(GLSRC)gsrefct.h
 gsserial_h=$(GLSRC)gsserial.h
@@ -232,13 +233,13 @@ ramfs_h=$(GLSRC)ramfs.h
 
 $(GLOBJ)gsalloc.$(OBJ) : $(GLSRC)gsalloc.c $(AK) $(gx_h) $(gserrors_h)\
  $(memory__h) $(string__h) $(gsexit_h) $(gsmdebug_h) $(gsstruct_h) $(gxalloc_h)\
- $(stream_h) $(malloc__h) $(LIB_MAK) $(MAKEDIRS)
+ $(stream_h) $(malloc__h) $(gsmprof_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsalloc.$(OBJ) $(C_) $(GLSRC)gsalloc.c
 
-$(GLOBJ)gsmalloc.$(OBJ) : $(GLSRC)gsmalloc.c $(malloc__h)\
+$(GLOBJ)gsmalloc.$(OBJ) : $(GLSRC)gsmalloc.c $(malloc__h) $(memory__h)\
  $(gdebug_h)\
  $(gserrors_h)\
- $(gsmalloc_h) $(gsmdebug_h) $(gsmemret_h)\
+ $(gsmalloc_h) $(gsmdebug_h) $(gsmemret_h) $(gsmprof_h)\
  $(gsmemory_h) $(gsstruct_h) $(gstypes_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsmalloc.$(OBJ) $(C_) $(GLSRC)gsmalloc.c
 
@@ -282,6 +283,10 @@ $(GLOBJ)gsmemret.$(OBJ) : $(GLSRC)gsmemret.c $(AK) $(gx_h)\
  $(gserrors_h) $(gsmemret_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsmemret.$(OBJ) $(C_) $(GLSRC)gsmemret.c
 
+$(GLOBJ)gsmprof.$(OBJ) : $(GLSRC)gsmprof.c $(AK) $(malloc__h) $(memory__h)\
+ $(stdint__h) $(gx_h) $(gserrors_h) $(gsmprof_h) $(gxsync_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)gsmprof.$(OBJ) $(C_) $(GLSRC)gsmprof.c
+
 # gsnogc is not part of the base configuration.
 # We make it available as a .dev so it can be used in configurations that
 # don't include the garbage collector, as well as by the "async" logic.
@@ -357,12 +362,12 @@ $(AUX)gsmisc.$(OBJ) : $(GLSRC)gsmisc.c $(AK) $(gx_h) $(gpmisc_h) $(gserrors_h)\
 
 $(GLOBJ)gslibctx_1.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gsmemory_h)\
   $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) $(gserrors_h)\
-  $(gscdefs_h) $(gsstruct_h)
+  $(gscdefs_h) $(gsstruct_h) $(gxsync_h) $(gdebug_h) $(stdint__h) $(gsmprof_h)
 	$(GLCC) $(D_)WITH_CAL$(_D) $(I_)$(CALSRCDIR)$(_I) $(GLO_)gslibctx_1.$(OBJ) $(C_) $(GLSRC)gslibctx.c
 
 $(GLOBJ)gslibctx_0.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gpmisc_h) $(gsmemory_h)\
   $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) $(gserrors_h)\
-  $(gscdefs_h) $(gsstruct_h)
+  $(gscdefs_h) $(gsstruct_h) $(gxsync_h) $(gdebug_h) $(stdint__h) $(gsmprof_h)
 	$(GLCC) $(GLO_)gslibctx_0.$(OBJ) $(C_) $(GLSRC)gslibctx.c
 
 $(GLOBJ)gslibctx.$(OBJ) : $(GLOBJ)gslibctx_$(WITH_CAL).$(OBJ)  $(AK) $(gp_h)
@@ -370,7 +375,7 @@ $(GLOBJ)gslibctx.$(OBJ) : $(GLOBJ)gslibctx_$(WITH_CAL).$(OBJ)  $(AK) $(gp_h)
 
 $(AUX)gslibctx.$(OBJ) : $(GLSRC)gslibctx.c  $(AK) $(gp_h) $(gsmemory_h)\
   $(gslibctx_h) $(stdio__h) $(string__h) $(gsicc_manage_h) $(gserrors_h)\
-  $(gscdefs_h) $(gsstruct_h)
+  $(gscdefs_h) $(gsstruct_h) $(gdebug_h) $(stdint__h)
 	$(GLCCAUX) $(C_) $(AUXO_)gslibctx.$(OBJ) $(GLSRC)gslibctx.c
 
 $(GLOBJ)gsnotify.$(OBJ) : $(GLSRC)gsnotify.c $(AK) $(gx_h)\
@@ -590,6 +595,7 @@ shc_h=$(GLSRC)shc.h
 sisparam_h=$(GLSRC)sisparam.h
 sjpeg_h=$(GLSRC)sjpeg.h
 slzwx_h=$(GLSRC)slzwx.h
+slzbx_h=$(GLSRC)slzbx.h
 smd5_h=$(GLSRC)smd5.h
 sarc4_h=$(GLSRC)sarc4.h
 saes_h=$(GLSRC)saes.h
@@ -1055,10 +1061,11 @@ $(GLOBJ)gsmatrix.$(OBJ) : $(GLSRC)gsmatrix.c $(AK) $(gx_h)\
 	$(GLCC) $(GLO_)gsmatrix.$(OBJ) $(C_) $(GLSRC)gsmatrix.c
 
 $(GLOBJ)gspaint.$(OBJ) : $(GLSRC)gspaint.c $(AK) $(gx_h) $(gserrors_h)\
- $(math__h) $(gpcheck_h) $(gsropt_h) $(gxfixed_h) $(gxmatrix_h) $(gspaint_h)\
- $(gspath_h) $(gzpath_h) $(gxpaint_h) $(gzstate_h) $(gxdevice_h) $(gxdevmem_h)\
- $(gzcpath_h) $(gxhldevc_h) $(gsutil_h) $(gxdevsop_h) $(gsicc_cms_h)\
- $(gdevepo_h) $(gxscanc_h) $(gxpcolor_h) $(LIB_MAK) $(MAKEDIRS)
+ $(math__h) $(memory__h) $(gpcheck_h) $(gsropt_h) $(gxfixed_h) $(gxmatrix_h)\
+ $(gspaint_h) $(gspath_h) $(gzpath_h) $(gxpaint_h) $(gzstate_h) $(gxdevice_h)\
+ $(gxdevmem_h) $(gzcpath_h) $(gxhldevc_h) $(gsutil_h) $(gxdevsop_h) $(gsicc_cms_h)\
+ $(gdevepo_h) $(gxscanc_h) $(gxpcolor_h) $(gscoord_h) $(gxdcolor_h)\
+ $(gximask_h) $(gxclipm_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gspaint.$(OBJ) $(C_) $(GLSRC)gspaint.c
 
 $(GLOBJ)gsparam.$(OBJ) : $(GLSRC)gsparam.c $(AK) $(gx_h) $(gserrors_h)\
@@ -1425,7 +1432,7 @@ LIB7s=$(GLOBJ)gsht.$(OBJ) $(GLOBJ)gshtscr.$(OBJ) $(GLOBJ)gen_ordered.$(OBJ)
 LIB8s=$(GLOBJ)gsimage.$(OBJ) $(GLOBJ)gsimpath.$(OBJ) $(GLOBJ)gsinit.$(OBJ)
 LIB9s=$(GLOBJ)gsiodev.$(OBJ) $(GLOBJ)gsgstate.$(OBJ) $(GLOBJ)gsline.$(OBJ)
 LIB10s=$(GLOBJ)gsmalloc.$(OBJ) $(GLOBJ)memento.$(OBJ) $(GLOBJ)bobbin.$(OBJ) $(GLOBJ)gsmatrix.$(OBJ)
-LIB11s=$(GLOBJ)gsmemory.$(OBJ) $(GLOBJ)gsmemret.$(OBJ) $(GLOBJ)gsmisc.$(OBJ) $(GLOBJ)gsnotify.$(OBJ) $(GLOBJ)gslibctx.$(OBJ)
+LIB11s=$(GLOBJ)gsmemory.$(OBJ) $(GLOBJ)gsmemret.$(OBJ) $(GLOBJ)gsmprof.$(OBJ) $(GLOBJ)gsmisc.$(OBJ) $(GLOBJ)gsnotify.$(OBJ) $(GLOBJ)gslibctx.$(OBJ)
 LIB12s=$(GLOBJ)gspaint.$(OBJ) $(GLOBJ)gsparam.$(OBJ) $(GLOBJ)gspath.$(OBJ)
 LIB13s=$(GLOBJ)gsserial.$(OBJ) $(GLOBJ)gsstate.$(OBJ) $(GLOBJ)gstext.$(OBJ)\
   $(GLOBJ)gsutil.$(OBJ) $(GLOBJ)gssprintf.$(OBJ) $(GLOBJ)gsstrtok.$(OBJ) $(GLOBJ)gsstrl.$(OBJ)
@@ -2208,7 +2215,7 @@ $(GLOBJ)gxclist.$(OBJ) : $(GLSRC)gxclist.c $(AK) $(gx_h) $(gserrors_h)\
 
 $(GLOBJ)gxclbits.$(OBJ) : $(GLSRC)gxclbits.c $(AK) $(gx_h)\
  $(gserrors_h) $(memory__h) $(gpcheck_h) $(gdevprn_h) $(gxpcolor_h)\
- $(gsbitops_h) $(gxcldev_h) $(gxdevice_h) $(gxdevmem_h) $(gxfmap_h)\
+ $(gsbitops_h) $(gxcldev_h) $(gxclpath_h) $(gxdevice_h) $(gxdevmem_h) $(gxfmap_h)\
  $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxclbits.$(OBJ) $(C_) $(GLSRC)gxclbits.c
 
@@ -2236,7 +2243,7 @@ $(GLOBJ)gxclread.$(OBJ) : $(GLSRC)gxclread.c $(AK) $(gx_h) $(gserrors_h)\
  $(memory__h) $(gp_h) $(gpcheck_h) $(gdevplnx_h) $(gdevprn_h) $(gscoord_h)\
  $(gsdevice_h) $(gxcldev_h) $(gxdevice_h) $(gxdevmem_h) $(gxgetbit_h)\
  $(gxhttile_h) $(gsmemory_h) $(stream_h) $(strimpl_h) $(gsicc_cache_h)\
- $(gdevp14_h) $(LIB_MAK) $(MAKEDIRS)
+ $(gdevp14_h) $(gslibctx_h) $(gxsync_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxclread.$(OBJ) $(C_) $(GLSRC)gxclread.c
 
 $(GLOBJ)gxclrect.$(OBJ) : $(GLSRC)gxclrect.c $(AK) $(gx_h)\
@@ -2287,7 +2294,8 @@ $(GLOBJ)gxclfile.$(OBJ) : $(GLSRC)gxclfile.c $(stdio__h) $(string__h)\
 
 # Implement band lists in memory (RAM).
 
-clmemory_=$(GLOBJ)gxclmem.$(OBJ) $(GLOBJ)gxcl$(BAND_LIST_COMPRESSOR).$(OBJ)
+clmemory_=$(GLOBJ)gxclmem.$(OBJ) $(GLOBJ)gxcl$(BAND_LIST_COMPRESSOR).$(OBJ)\
+ $(GLOBJ)slzb.$(OBJ)
 $(GLD)clmemory.dev : $(LIB_MAK) $(ECHOGS_XE) $(clmemory_) $(GLD)s$(BAND_LIST_COMPRESSOR)e.dev \
   $(GLD)s$(BAND_LIST_COMPRESSOR)d.dev $(LIB_MAK) $(MAKEDIRS)
 	$(SETMOD) $(GLD)clmemory $(clmemory_)
@@ -2298,9 +2306,15 @@ $(GLD)clmemory.dev : $(LIB_MAK) $(ECHOGS_XE) $(clmemory_) $(GLD)s$(BAND_LIST_COM
 gxclmem_h=$(GLSRC)gxclmem.h
 
 $(GLOBJ)gxclmem.$(OBJ) : $(GLSRC)gxclmem.c $(AK) $(gx_h) $(gserrors_h)\
- $(LIB_MAK) $(memory__h) $(gxclmem_h) $(gssprintf_h) $(valgrind_h) $(LIB_MAK) $(MAKEDIRS)
+ $(LIB_MAK) $(memory__h) $(gxclmem_h) $(gssprintf_h) $(slzbx_h) $(valgrind_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxclmem.$(OBJ) $(C_) $(GLSRC)gxclmem.c
 
+# The fast LZ codec, which can be selected for RAM-based band lists
+# with BandListCompression.
+$(GLOBJ)slzb.$(OBJ) : $(GLSRC)slzb.c $(AK) $(stdio__h) $(memory__h)\
+ $(slzbx_h) $(strimpl_h) $(LIB_MAK) $(MAKEDIRS)
+	$(GLCC) $(GLO_)slzb.$(OBJ) $(C_) $(GLSRC)slzb.c
+
 # Implement the compression method for RAM-based band lists.
 
 $(GLOBJ)gxcllzw.$(OBJ) : $(GLSRC)gxcllzw.c $(std_h) $(AK)\
@@ -2316,14 +2330,15 @@ $(GLOBJ)gxclzlib.$(OBJ) : $(GLSRC)gxclzlib.c $(std_h) $(AK)\
 # memory allocator must implement the mutex (non-gc memory is usually gsmalloc)
 $(GLOBJ)gxclthrd.$(OBJ) :  $(GLSRC)gxclthrd.c $(gxsync_h) $(AK) $(gxclthrd_h)\
  $(gdevplnx_h) $(gdevprn_h) $(gp_h) $(gpcheck_h) $(gsdevice_h) $(gserrors_h)\
- $(gsmchunk_h) $(gsmemory_h) $(gx_h) $(gxcldev_h) $(gdevdevn_h)\
+ $(gsmchunk_h) $(gsmalloc_h) $(gsmemory_h) $(gx_h) $(gxcldev_h) $(gdevdevn_h)\
  $(gsicc_cache_h) $(gxdevice_h) $(gxdevmem_h) $(gxgetbit_h) $(memory__h)\
  $(gsicc_manage_h) $(gdevppla_h) $(gstrans_h) $(gzht_h) $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gxclthrd.$(OBJ) $(C_) $(GLSRC)gxclthrd.c
 
 $(GLOBJ)gsmchunk.$(OBJ) :  $(GLSRC)gsmchunk.c $(AK) $(gx_h) $(gsstype_h)\
  $(gserrors_h) $(gsmchunk_h) $(memory__h) $(gxsync_h) $(malloc__h)\
- $(gsstruct_h) $(gxobj_h) $(assert__h) $(gsmdebug_h) $(LIB_MAK) $(MAKEDIRS)
+ $(gsstruct_h) $(gxobj_h) $(assert__h) $(gsmdebug_h) $(gsmprof_h)\
+ $(LIB_MAK) $(MAKEDIRS)
 	$(GLCC) $(GLO_)gsmchunk.$(OBJ) $(C_) $(GLSRC)gsmchunk.c
 
 # ---------------- Vector devices ---------------- #
@@ -9352,6 +9367,18 @@ $(GLSRC)srlx.h:$(GLSRC)std.h
 $(GLSRC)srlx.h:$(GLSRC)stdpre.h
 $(GLSRC)srlx.h:$(GLGEN)arch.h
 $(GLSRC)srlx.h:$(GLSRC)gs_dll_call.h
+$(GLSRC)slzbx.h:$(GLSRC)scommon.h
+$(GLSRC)slzbx.h:$(GLSRC)gsstype.h
+$(GLSRC)slzbx.h:$(GLSRC)gsmemory.h
+$(GLSRC)slzbx.h:$(GLSRC)gslibctx.h
+$(GLSRC)slzbx.h:$(GLSRC)stdio_.h
+$(GLSRC)slzbx.h:$(GLSRC)stdint_.h
+$(GLSRC)slzbx.h:$(GLSRC)gssprintf.h
+$(GLSRC)slzbx.h:$(GLSRC)gstypes.h
+$(GLSRC)slzbx.h:$(GLSRC)std.h
+$(GLSRC)slzbx.h:$(GLSRC)stdpre.h
+$(GLSRC)slzbx.h:$(GLGEN)arch.h
+$(GLSRC)slzbx.h:$(GLSRC)gs_dll_call.h
 $(GLSRC)spwgx.h:$(GLSRC)scommon.h
 $(GLSRC)spwgx.h:$(GLSRC)gsstype.h
 $(GLSRC)spwgx.h:$(GLSRC)gsmemory.h
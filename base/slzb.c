@@ -0,0 +1,415 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Fast LZ block filters */
+#include "stdio_.h"		/* includes std.h */
+#include "memory_.h"
+#include "strimpl.h"
+#include "slzbx.h"
+
+/*
+ * The compressed data of a frame is a sequence of (literals, match) pairs.
+ * Each pair starts with a token byte, whose high 4 bits are the number of
+ * literals and low 4 bits the match length less LZB_MIN_MATCH. A value of
+ * 15 means that further length bytes follow, each of which is added in,
+ * up to one that isn't 255. Next come the literals, then the distance
+ * back to the match (2 bytes, low byte first). The last pair of a frame
+ * has only literals.
+ */
+#define LZB_MIN_MATCH 4
+/* Don't start a match in the last LZB_MF_LIMIT bytes of a frame... */
+#define LZB_MF_LIMIT 12
+/* ...or let one run into the last LZB_LAST_LITERALS */
+#define LZB_LAST_LITERALS 5
+/* Search more sparsely the longer we go without finding a match */
+#define LZB_SKIP_TRIGGER 6
+
+/* Frame header flags */
+#define LZB_STORED 1		/* data is not compressed */
+#define LZB_LAST 2		/* last frame of the data */
+
+#define LZB_LOAD32(p)\
+  ((uint)(p)[0] | ((uint)(p)[1] << 8) | ((uint)(p)[2] << 16) | ((uint)(p)[3] << 24))
+#define LZB_HASH(v)\
+  ((uint)(((v) * 2654435761U) & 0xffffffff) >> (32 - LZB_HASH_BITS))
+
+/* ------ LZBEncode ------ */
+
+private_st_LZBE_state();
+
+/* Reinitialize the encoder between independent pieces of data */
+static int
+s_LZBE_reinit(stream_state * st)
+{
+    stream_LZBE_state *const ss = (stream_LZBE_state *) st;
+
+    ss->in_count = 0;
+    ss->out_pos = ss->out_count = 0;
+    ss->eod = false;
+    return 0;
+}
+
+/* Initialize */
+static int
+s_LZBE_init(stream_state * st)
+{
+    stream_LZBE_state *const ss = (stream_LZBE_state *) st;
+
+    /*
+     * Matches are always checked against the data, so the table doesn't
+     * need clearing between frames, but it mustn't hold garbage offsets.
+     */
+    memset(ss->table, 0, sizeof(ss->table));
+    return s_LZBE_reinit(st);
+}
+
+static byte *
+lzb_put_length(byte *op, uint len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (byte)len;
+    return op;
+}
+
+static byte *
+lzb_put_literals(byte *op, const byte *lit, uint nlit)
+{
+    byte *token = op++;
+
+    if (nlit >= 15) {
+        *token = 15 << 4;
+        op = lzb_put_length(op, nlit - 15);
+    } else
+        *token = (byte)(nlit << 4);
+    memcpy(op, lit, nlit);
+    return op + nlit;
+}
+
+/* Compress len bytes (len <= LZB_BLOCK_SIZE) into dst, return the size. */
+static uint
+lzb_compress(stream_LZBE_state *ss, const byte *src, uint len, byte *dst)
+{
+    ushort *const table = ss->table;
+    const byte *const iend = src + len;
+    const byte *const mflimit = iend - LZB_MF_LIMIT;
+    const byte *const matchlimit = iend - LZB_LAST_LITERALS;
+    const byte *ip = src;
+    const byte *anchor = src;
+    byte *op = dst;
+
+    if (len <= LZB_MF_LIMIT)
+        return lzb_put_literals(op, anchor, len) - dst;
+    table[LZB_HASH(LZB_LOAD32(ip))] = 0;
+    ip++;
+    for (;;) {
+        const byte *ref;
+        byte *token;
+        uint searches = 1 << LZB_SKIP_TRIGGER;
+        uint mlen, dist;
+
+        /* Find a match */
+        for (;;) {
+            uint seq, h;
+
+            if (ip > mflimit)
+                return lzb_put_literals(op, anchor, iend - anchor) - dst;
+            seq = LZB_LOAD32(ip);
+            h = LZB_HASH(seq);
+            ref = src + table[h];
+            table[h] = (ushort)(ip - src);
+            if (ref < ip && LZB_LOAD32(ref) == seq)
+                break;
+            ip += searches++ >> LZB_SKIP_TRIGGER;
+        }
+        /* Extend it backwards over the pending literals, then forwards */
+        while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            ip--, ref--;
+        mlen = LZB_MIN_MATCH;
+        while (ip + mlen + 4 <= matchlimit &&
+               LZB_LOAD32(ip + mlen) == LZB_LOAD32(ref + mlen))
+            mlen += 4;
+        while (ip + mlen < matchlimit && ip[mlen] == ref[mlen])
+            mlen++;
+        /* Write the literals, then the match */
+        token = op;
+        op = lzb_put_literals(op, anchor, ip - anchor);
+        dist = ip - ref;
+        *op++ = (byte)dist;
+        *op++ = (byte)(dist >> 8);
+        if (mlen - LZB_MIN_MATCH >= 15) {
+            *token |= 15;
+            op = lzb_put_length(op, mlen - LZB_MIN_MATCH - 15);
+        } else
+            *token |= (byte)(mlen - LZB_MIN_MATCH);
+        ip += mlen;
+        anchor = ip;
+        if (ip > mflimit)
+            return lzb_put_literals(op, anchor, iend - anchor) - dst;
+        /* Seed the table with a position inside the match */
+        table[LZB_HASH(LZB_LOAD32(ip - 2))] = (ushort)(ip - 2 - src);
+    }
+}
+
+/* Write a frame for len bytes of src into dst, return its size. */
+static uint
+lzb_encode_frame(stream_LZBE_state *ss, const byte *src, uint len, byte *dst,
+                 bool last)
+{
+    uint size = lzb_compress(ss, src, len, dst + LZB_HEADER_SIZE);
+    byte flags = (last ? LZB_LAST : 0);
+
+    if (size >= len) {
+        memcpy(dst + LZB_HEADER_SIZE, src, len);
+        size = len;
+        flags |= LZB_STORED;
+    }
+    dst[0] = flags;
+    dst[1] = (byte)len;
+    dst[2] = (byte)(len >> 8);
+    dst[3] = (byte)size;
+    dst[4] = (byte)(size >> 8);
+    return LZB_HEADER_SIZE + size;
+}
+
+/* Process a buffer */
+static int
+s_LZBE_process(stream_state * st, stream_cursor_read * pr,
+               stream_cursor_write * pw, bool last)
+{
+    stream_LZBE_state *const ss = (stream_LZBE_state *) st;
+
+    for (;;) {
+        uint rcount = pr->limit - pr->ptr;
+        uint wcount = pw->limit - pw->ptr;
+        const byte *src;
+        uint len, size;
+        bool last_frame;
+
+        /* Write out what's left of the previous frame */
+        if (ss->out_pos < ss->out_count) {
+            uint count = min(ss->out_count - ss->out_pos, wcount);
+
+            memcpy(pw->ptr + 1, ss->out_buf + ss->out_pos, count);
+            pw->ptr += count;
+            ss->out_pos += count;
+            if (ss->out_pos < ss->out_count)
+                return 1;
+            wcount -= count;
+        }
+        if (ss->eod)
+            return 0;
+        if (ss->in_count == 0 && (rcount >= LZB_BLOCK_SIZE || (last && rcount > 0))) {
+            /* Compress straight from the caller's buffer */
+            len = min(rcount, LZB_BLOCK_SIZE);
+            src = pr->ptr + 1;
+            pr->ptr += len;
+        } else {
+            uint count = min(rcount, LZB_BLOCK_SIZE - ss->in_count);
+
+            memcpy(ss->in_buf + ss->in_count, pr->ptr + 1, count);
+            pr->ptr += count;
+            ss->in_count += count;
+            if (ss->in_count < LZB_BLOCK_SIZE && !last)
+                return 0;
+            len = ss->in_count;
+            src = ss->in_buf;
+            ss->in_count = 0;
+        }
+        last_frame = last && pr->ptr == pr->limit;
+        if (len == 0 && !last_frame)
+            return 0;
+        if (wcount >= LZB_MAX_FRAME) {
+            size = lzb_encode_frame(ss, src, len, pw->ptr + 1, last_frame);
+            pw->ptr += size;
+        } else {
+            ss->out_count = lzb_encode_frame(ss, src, len, ss->out_buf, last_frame);
+            ss->out_pos = 0;
+        }
+        ss->eod = last_frame;
+    }
+}
+
+/* Stream template */
+const stream_template s_LZBE_template = {
+    &st_LZBE_state, s_LZBE_init, s_LZBE_process, 1, 1, NULL,
+    NULL, s_LZBE_reinit
+};
+
+/* ------ LZBDecode ------ */
+
+private_st_LZBD_state();
+
+/* Reinitialize the decoder between independent pieces of data */
+static int
+s_LZBD_reinit(stream_state * st)
+{
+    stream_LZBD_state *const ss = (stream_LZBD_state *) st;
+
+    ss->in_count = 0;
+    ss->out_pos = ss->out_count = 0;
+    ss->eod = false;
+    return 0;
+}
+
+/* Decompress a frame's data, return 0 or ERRC if it is corrupt. */
+static int
+lzb_decompress(const byte *src, uint slen, byte *dst, uint dlen)
+{
+    const byte *ip = src;
+    const byte *const iend = src + slen;
+    byte *op = dst;
+    byte *const oend = dst + dlen;
+
+    for (;;) {
+        uint token, len, dist, b;
+        const byte *ref;
+
+        if (ip >= iend)
+            return ERRC;
+        token = *ip++;
+        len = token >> 4;
+        if (len == 15)
+            do {
+                if (ip >= iend)
+                    return ERRC;
+                len += (b = *ip++);
+            } while (b == 255);
+        if (len > iend - ip || len > oend - op)
+            return ERRC;
+        memcpy(op, ip, len);
+        op += len;
+        ip += len;
+        if (ip == iend)
+            break;		/* last pair, no match */
+        if (iend - ip < 2)
+            return ERRC;
+        dist = ip[0] | (ip[1] << 8);
+        ip += 2;
+        len = token & 15;
+        if (len == 15)
+            do {
+                if (ip >= iend)
+                    return ERRC;
+                len += (b = *ip++);
+            } while (b == 255);
+        len += LZB_MIN_MATCH;
+        if (dist == 0 || dist > op - dst || len > oend - op)
+            return ERRC;
+        ref = op - dist;
+        /* The match may overlap the output, in which case it repeats */
+        /* the last dist bytes, so copy in ever larger chunks. */
+        while (len > 0) {
+            uint count = min(len, op - ref);
+
+            memcpy(op, ref, count);
+            op += count;
+            len -= count;
+        }
+    }
+    return (op == oend ? 0 : ERRC);
+}
+
+/* Process a buffer */
+static int
+s_LZBD_process(stream_state * st, stream_cursor_read * pr,
+               stream_cursor_write * pw, bool last)
+{
+    stream_LZBD_state *const ss = (stream_LZBD_state *) st;
+
+    for (;;) {
+        uint rcount = pr->limit - pr->ptr;
+        uint wcount = pw->limit - pw->ptr;
+        const byte *frame;
+        uint flags, len, size;
+        int code;
+
+        /* Return what's left of the previous frame */
+        if (ss->out_pos < ss->out_count) {
+            uint count = min(ss->out_count - ss->out_pos, wcount);
+
+            memcpy(pw->ptr + 1, ss->out_buf + ss->out_pos, count);
+            pw->ptr += count;
+            ss->out_pos += count;
+            if (ss->out_pos < ss->out_count)
+                return 1;
+            wcount -= count;
+        }
+        if (ss->eod)
+            return EOFC;
+        if (ss->in_count == 0 && rcount >= LZB_HEADER_SIZE &&
+            rcount >= LZB_HEADER_SIZE + (pr->ptr[4] | (pr->ptr[5] << 8))) {
+            /* The whole frame is in the caller's buffer */
+            frame = pr->ptr + 1;
+        } else {
+            /* Collect the frame, header first. Note that the band list */
+            /* code passes last = true even if more data follows. */
+            uint count;
+
+            if (ss->in_count < LZB_HEADER_SIZE) {
+                count = min(rcount, LZB_HEADER_SIZE - ss->in_count);
+                memcpy(ss->in_buf + ss->in_count, pr->ptr + 1, count);
+                pr->ptr += count;
+                rcount -= count;
+                ss->in_count += count;
+                if (ss->in_count < LZB_HEADER_SIZE)
+                    return 0;
+            }
+            size = ss->in_buf[3] | (ss->in_buf[4] << 8);
+            if (size > LZB_BLOCK_SIZE)
+                return ERRC;
+            count = min(rcount, LZB_HEADER_SIZE + size - ss->in_count);
+            memcpy(ss->in_buf + ss->in_count, pr->ptr + 1, count);
+            pr->ptr += count;
+            ss->in_count += count;
+            if (ss->in_count < LZB_HEADER_SIZE + size)
+                return 0;
+            frame = ss->in_buf;
+        }
+        flags = frame[0];
+        len = frame[1] | (frame[2] << 8);
+        size = frame[3] | (frame[4] << 8);
+        if (len > LZB_BLOCK_SIZE ||
+            ((flags & LZB_STORED) ? size != len : size >= len))
+            return ERRC;
+        if (frame != ss->in_buf)
+            pr->ptr += LZB_HEADER_SIZE + size;
+        ss->in_count = 0;
+        if (wcount >= len) {
+            if (flags & LZB_STORED)
+                memcpy(pw->ptr + 1, frame + LZB_HEADER_SIZE, len);
+            else if ((code = lzb_decompress(frame + LZB_HEADER_SIZE, size, pw->ptr + 1, len)) < 0)
+                return code;
+            pw->ptr += len;
+        } else {
+            if (flags & LZB_STORED)
+                memcpy(ss->out_buf, frame + LZB_HEADER_SIZE, len);
+            else if ((code = lzb_decompress(frame + LZB_HEADER_SIZE, size, ss->out_buf, len)) < 0)
+                return code;
+            ss->out_count = len;
+            ss->out_pos = 0;
+        }
+        ss->eod = (flags & LZB_LAST) != 0;
+    }
+}
+
+/* Stream template */
+const stream_template s_LZBD_template = {
+    &st_LZBD_state, s_LZBD_reinit, s_LZBD_process, 1, 1, NULL,
+    NULL, s_LZBD_reinit
+};
@@ -0,0 +1,76 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Definitions for the fast LZ block filters */
+/* Requires scommon.h; strimpl.h if any templates are referenced */
+
+#ifndef slzbx_INCLUDED
+#  define slzbx_INCLUDED
+
+#include "scommon.h"
+
+/*
+ * These filters implement a byte oriented LZ77 codec, in the style of LZ4,
+ * that trades compression ratio for speed. They are intended for data that
+ * is compressed and decompressed repeatedly, like the RAM based band list,
+ * rather than for interchange, so the format is private to Ghostscript.
+ *
+ * The data is split into independent frames of at most LZB_BLOCK_SIZE
+ * bytes. Each frame starts with a 5 byte header: a flags byte, then the
+ * uncompressed and compressed sizes (2 bytes each, low byte first). A frame
+ * that doesn't compress is stored as is. The frame that ends the data is
+ * flagged, so that the decoder can return EOFC.
+ */
+#define LZB_BLOCK_SIZE 16384
+#define LZB_HEADER_SIZE 5
+/* The worst case size of the compressed data, before we fall back to storing */
+#define LZB_MAX_FRAME (LZB_HEADER_SIZE + LZB_BLOCK_SIZE + LZB_BLOCK_SIZE / 255 + 16)
+#define LZB_HASH_BITS 12
+
+/* LZBEncode */
+typedef struct stream_LZBE_state_s {
+    stream_state_common;
+    /* The following change dynamically. */
+    uint in_count;		/* # of bytes of the next frame in in_buf */
+    uint out_pos;		/* # of bytes of out_buf already written */
+    uint out_count;		/* # of bytes of the last frame in out_buf */
+    bool eod;			/* true if the last frame has been written */
+    ushort table[1 << LZB_HASH_BITS];	/* frame offsets, by hash of 4 bytes */
+    byte in_buf[LZB_BLOCK_SIZE];
+    byte out_buf[LZB_MAX_FRAME];
+} stream_LZBE_state;
+
+#define private_st_LZBE_state()	/* in slzb.c */\
+  gs_private_st_simple(st_LZBE_state, stream_LZBE_state, "LZBEncode state")
+extern const stream_template s_LZBE_template;
+
+/* LZBDecode */
+typedef struct stream_LZBD_state_s {
+    stream_state_common;
+    /* The following change dynamically. */
+    uint in_count;		/* # of bytes of the current frame in in_buf */
+    uint out_pos;		/* # of bytes of out_buf already read */
+    uint out_count;		/* # of bytes of the last frame in out_buf */
+    bool eod;			/* true if the last frame has been read */
+    byte in_buf[LZB_MAX_FRAME];
+    byte out_buf[LZB_BLOCK_SIZE];
+} stream_LZBD_state;
+
+#define private_st_LZBD_state()	/* in slzb.c */\
+  gs_private_st_simple(st_LZBD_state, stream_LZBD_state, "LZBDecode state")
+extern const stream_template s_LZBD_template;
+
+#endif /* slzbx_INCLUDED */
@@ -73,6 +73,8 @@ s_zlib_free_dynamic_state(stream_zlib_state *ss)
     if (ss->dynamic)
         gs_free_object(ss->dynamic->memory, ss->dynamic,
                        "s_zlib_free_dynamic_state");
+    /* The band list may release a state more than once */
+    ss->dynamic = 0;
 }
 
 /* Provide zlib-compatible allocation and freeing functions. */
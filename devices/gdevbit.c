@@ -367,6 +367,8 @@ const gx_device_bit gs_bitrgbtags_device =
         false, /* bg_print_requested */
         {0},   /* bg_print */
         0,     /* num_render_threads_requested */
+        clist_compression_default, /* BandListCompression */
+        { 0 },  /* BandProfileFile */
         NULL,  /* saved_pages_list */
         {0}    /* save_procs_while_delaying_erasepage */
     };
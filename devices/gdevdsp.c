@@ -60,6 +60,10 @@
 #include "gdevmpla.h"
 #include "gdevprn.h"           /* For gdev_create_buf_device */
 #include "gsicc_manage.h"
+#include "gsicc_cms.h"          /* for gscms_is_threadsafe */
+#include "gsmchunk.h"
+#include "gxsync.h"
+#include "gxclthrd.h"           /* for background printing */
 
 #include "gdevkrnlsclass.h" /* 'standard' built in subclasses, currently First/Last Page and obejct filter */
 
@@ -105,6 +109,8 @@ static dev_proc_ret_devn_params(display_ret_devn_params);
 static dev_proc_dev_spec_op(display_spec_op);
 static dev_proc_fill_rectangle_hl_color(display_fill_rectangle_hl_color);
 
+extern dev_proc_open_device(clist_open);
+
 static const gx_device_procs display_procs =
 {
     display_open,
@@ -234,6 +240,10 @@ static int display_alloc_bitmap(gx_device_display *, gx_device *);
 static int display_set_color_format(gx_device_display *dev, int nFormat);
 static int display_set_separations(gx_device_display *dev);
 static int display_raster(gx_device_display *dev);
+static int setup_as_clist(gx_device_display *ddev, gs_memory_t *buffer_memory);
+static int display_request_rectangles(gx_device_display *ddev, gx_device *dev);
+static int display_start_bg_print(gx_device_display *ddev, gx_device *dev);
+static void display_finish_bg_print(gx_device_display *ddev);
 
 /* Open the display driver. */
 static int
@@ -343,6 +353,7 @@ display_sync_output(gx_device * dev)
     gx_device_display *ddev = (gx_device_display *) dev;
     if (ddev->callback == NULL)
         return 0;	/* ignore the call */
+    display_finish_bg_print(ddev);
     display_set_separations(ddev);
 
     while(dev->parent)
@@ -359,12 +370,15 @@ display_output_page(gx_device * dev, int copies, int flush)
 {
     gx_device_display *ddev = (gx_device_display *) dev;
     int code;
-    int is_planar = (ddev->nFormat & (DISPLAY_PLANAR |
-                                     DISPLAY_PLANAR_INTERLEAVED)) &&
-                    (ddev->color_info.num_components > 1);
 
     if (ddev->callback == NULL)
         return gs_error_Fatal;
+    /* Finish the previous page, and report any error it had */
+    display_finish_bg_print(ddev);
+    code = ddev->bg_print.return_code;
+    ddev->bg_print.return_code = 0;
+    if (code < 0)
+        return code;
     display_set_separations(ddev);
 
     while(dev->parent)
@@ -372,65 +386,13 @@ display_output_page(gx_device * dev, int copies, int flush)
 
     if (CLIST_MUTATABLE_HAS_MUTATED(ddev)) {
         /* Rectangle request mode! */
-        gs_get_bits_options_t options;
-
-        options = GB_RETURN_COPY | GB_ALIGN_STANDARD |
-                  GB_OFFSET_SPECIFIED | GB_RASTER_SPECIFIED |
-                  GB_COLORS_NATIVE;
-        switch (ddev->nFormat & DISPLAY_ALPHA_MASK) {
-            default:
-            case DISPLAY_ALPHA_NONE:
-                break;
-            case DISPLAY_ALPHA_FIRST:
-            case DISPLAY_UNUSED_FIRST:
-                options |=  GB_ALPHA_FIRST;
-                break;
-            case DISPLAY_ALPHA_LAST:
-            case DISPLAY_UNUSED_LAST:
-                options |=  GB_ALPHA_LAST;
-                break;
-        }
-        if (is_planar)
-            options |= GB_PACKING_PLANAR;
-        else
-            options |= GB_PACKING_CHUNKY;
-
-        while (1) {
-            void *mem = NULL;
-            int ox, oy, x, y, w, h, i, raster, plane_raster;
-            gs_int_rect rect;
-            gs_get_bits_params_t params;
-
-            code = ddev->callback->display_rectangle_request
-                                                (ddev->pHandle, dev,
-                                                 &mem, &ox, &oy,
-                                                 &raster, &plane_raster,
-                                                 &x, &y, &w, &h);
-            if (w == 0 || h == 0)
-                break;
-            if (mem == NULL) {
-                code = gs_note_error(gs_error_VMerror);
-                break;
-            }
-            rect.p.x = x;
-            rect.p.y = y;
-            rect.q.x = x + w;
-            rect.q.y = y + h;
-            params.options = options;
-            if (is_planar) {
-                for (i = 0; i < ddev->color_info.num_components; i++)
-                    params.data[i] = (byte *)mem + i * plane_raster;
-            } else {
-                params.data[0] = (byte *)mem;
-            }
-            params.x_offset = ox;
-            params.original_y = oy;
-            params.raster = raster;
-            code = dev_proc(ddev, get_bits_rectangle)((gx_device *)ddev,
-                                                      &rect, &params, NULL);
-            if (code < 0)
-                break;
-        }
+        code = 0;
+        if (ddev->bg_print_requested)
+            code = display_start_bg_print(ddev, dev);
+        if (code == 0)
+            code = display_request_rectangles(ddev, dev);
+        else if (code > 0)
+            code = 0;	/* the page is being rendered in the background */
     } else {
         /* Full page mode. Just claim completion! */
         code = (*(ddev->callback->display_page))
@@ -442,6 +404,309 @@ display_output_page(gx_device * dev, int copies, int flush)
     return code;
 }
 
+/*
+ * Render the page held in the clist of ddev by asking the caller for
+ * rectangles until it returns an empty one. dev is the device passed to
+ * the callback.
+ */
+static int
+display_request_rectangles(gx_device_display *ddev, gx_device *dev)
+{
+    gs_get_bits_options_t options;
+    int is_planar = (ddev->nFormat & (DISPLAY_PLANAR |
+                                     DISPLAY_PLANAR_INTERLEAVED)) &&
+                    (ddev->color_info.num_components > 1);
+    int code = 0;
+
+    options = GB_RETURN_COPY | GB_ALIGN_STANDARD |
+              GB_OFFSET_SPECIFIED | GB_RASTER_SPECIFIED |
+              GB_COLORS_NATIVE;
+    switch (ddev->nFormat & DISPLAY_ALPHA_MASK) {
+        default:
+        case DISPLAY_ALPHA_NONE:
+            break;
+        case DISPLAY_ALPHA_FIRST:
+        case DISPLAY_UNUSED_FIRST:
+            options |=  GB_ALPHA_FIRST;
+            break;
+        case DISPLAY_ALPHA_LAST:
+        case DISPLAY_UNUSED_LAST:
+            options |=  GB_ALPHA_LAST;
+            break;
+    }
+    if (is_planar)
+        options |= GB_PACKING_PLANAR;
+    else
+        options |= GB_PACKING_CHUNKY;
+
+    while (1) {
+        void *mem = NULL;
+        int ox, oy, x, y, w, h, i, raster, plane_raster;
+        gs_int_rect rect;
+        gs_get_bits_params_t params;
+
+        code = ddev->callback->display_rectangle_request
+                                            (ddev->pHandle, dev,
+                                             &mem, &ox, &oy,
+                                             &raster, &plane_raster,
+                                             &x, &y, &w, &h);
+        if (w == 0 || h == 0)
+            break;
+        if (mem == NULL) {
+            code = gs_note_error(gs_error_VMerror);
+            break;
+        }
+        rect.p.x = x;
+        rect.p.y = y;
+        rect.q.x = x + w;
+        rect.q.y = y + h;
+        params.options = options;
+        if (is_planar) {
+            for (i = 0; i < ddev->color_info.num_components; i++)
+                params.data[i] = (byte *)mem + i * plane_raster;
+        } else {
+            params.data[0] = (byte *)mem;
+        }
+        params.x_offset = ox;
+        params.original_y = oy;
+        params.raster = raster;
+        code = dev_proc(ddev, get_bits_rectangle)((gx_device *)ddev,
+                                                  &rect, &params, NULL);
+        if (code < 0)
+            break;
+    }
+    return code;
+}
+
+/* ------ Background printing ------ */
+
+/*
+ * With BGPrint in rectangle request mode, output_page hands the clist
+ * files of the page to a copy of the device and returns, so that the
+ * next page can be interpreted while a background thread plays the
+ * page back through display_rectangle_request. This is the display
+ * device's version of what gdev_prn_output_page_aux does for printers.
+ */
+
+/* This is run in the background thread. */
+static void
+display_print_page_in_background(void *data)
+{
+    gx_device_display *ddev = (gx_device_display *)data;
+
+    ddev->bg_print.return_code =
+        display_request_rectangles((gx_device_display *)ddev->bg_print.device,
+                                   ddev->bg_print_top);
+    /* Release the foreground that may be waiting */
+    gx_semaphore_signal(ddev->bg_print.sema);
+}
+
+/* Free a background copy of the device and its allocator. */
+static void
+display_free_bg_device(gx_device_display *bgdev)
+{
+    gx_device_clist_common *bgcdev = (gx_device_clist_common *)bgdev;
+    gx_device_clist_reader *bgcrdev = (gx_device_clist_reader *)bgdev;
+    gs_memory_t *thread_mem = bgdev->memory;
+
+    clist_free_icc_table(bgcrdev->icc_table, thread_mem);
+    bgcrdev->icc_table = NULL;
+    rc_decrement(bgcdev->icc_cache_cl, "display_free_bg_device");
+    bgcdev->icc_cache_cl = NULL;
+    /* Only close our instance of the files, the originals are in bg_print */
+    if (bgcdev->page_info.bfile != NULL)
+        bgcdev->page_info.io_procs->fclose(bgcdev->page_info.bfile, bgcdev->page_info.bfname, false);
+    if (bgcdev->page_info.cfile != NULL)
+        bgcdev->page_info.io_procs->fclose(bgcdev->page_info.cfile, bgcdev->page_info.cfname, false);
+    bgcdev->page_info.bfile = bgcdev->page_info.cfile = NULL;
+    bgcdev->do_not_open_or_close_bandfiles = true;
+    display_free_bitmap(bgdev);
+    gs_free_object(thread_mem, bgdev, "display_free_bg_device");
+    gs_memory_chunk_release(thread_mem);
+}
+
+/*
+ * Make a copy of the device, with its own allocator, that reads the page
+ * in the clist of ddev. Returns NULL if this isn't possible, in which
+ * case the page is rendered in the foreground.
+ */
+static gx_device_display *
+display_make_bg_device(gx_device_display *ddev)
+{
+    gx_device_clist_common *cdev = (gx_device_clist_common *)ddev;
+    gs_memory_t *thread_mem;
+    gx_device *ndev;
+    gx_device_display *bgdev;
+    gx_device_clist_common *bgcdev;
+    gs_c_param_list paramlist;
+    int code;
+
+    if (gs_memory_chunk_wrap(&thread_mem, ddev->memory->thread_safe_memory) < 0)
+        return NULL;
+    if (gs_copydevice(&ndev, (const gx_device *)&gs_display_device, thread_mem) < 0) {
+        gs_memory_chunk_release(thread_mem);
+        return NULL;
+    }
+    bgdev = (gx_device_display *)ndev;
+    bgcdev = (gx_device_clist_common *)ndev;
+    gx_device_fill_in_procs(ndev);
+    bgdev->bandlist_memory = bgdev->buffer_memory = thread_mem;
+    bgdev->callback = ddev->callback;
+    bgdev->pHandle = ddev->pHandle;
+    bgdev->pHandle_set = ddev->pHandle_set;
+    ndev->icc_struct = ddev->icc_struct;	/* set before put params */
+    rc_increment(ndev->icc_struct);
+
+    /* get the current device parameters to put into the copy */
+    gs_c_param_list_write(&paramlist, thread_mem);
+    code = gs_getdeviceparams((gx_device *)ddev, (gs_param_list *)&paramlist);
+    if (code >= 0) {
+        gs_c_param_list_read(&paramlist);
+        code = gs_putdeviceparams(ndev, (gs_param_list *)&paramlist);
+    }
+    gs_c_param_list_release(&paramlist);
+    if (code >= 0 &&
+        (ddev->nFormat & DISPLAY_COLORS_MASK) == DISPLAY_COLORS_SEPARATION)
+        code = devn_copy_params((gx_device *)ddev, ndev);
+    if (code < 0)
+        goto out;
+    bgdev->page_uses_transparency = ddev->page_uses_transparency;
+
+    /* The copy must use the band layout that the page was written with */
+    bgdev->space_params = ddev->space_params;
+    bgdev->space_params.band = cdev->page_info.band_params;
+    bgdev->space_params.band.tile_cache_size = cdev->page_info.tile_cache_size;
+    bgdev->space_params.banding_type = BandingAlways;
+    memset(bgdev->skip, 0, sizeof(bgdev->skip));
+    if (setup_as_clist(bgdev, thread_mem) < 0)
+        goto out;
+    bgdev->procs = ddev->procs;
+    bgdev->orig_procs = ddev->orig_procs;
+
+    /* close and unlink the files just created, and read ours instead */
+    bgcdev->page_info.io_procs->fclose(bgcdev->page_info.cfile, bgcdev->page_info.cfname, true);
+    bgcdev->page_info.io_procs->fclose(bgcdev->page_info.bfile, bgcdev->page_info.bfname, true);
+    bgcdev->page_info.cfile = bgcdev->page_info.bfile = NULL;
+    if (bgcdev->page_info.tile_cache_size != cdev->page_info.tile_cache_size ||
+        bgcdev->page_info.band_params.BandHeight !=
+            cdev->page_info.band_params.BandHeight ||
+        clist_attach_thread_device((gx_device *)ddev, ndev, true, NULL) < 0)
+        goto out_close;
+    return bgdev;
+
+out_close:
+    display_free_bg_device(bgdev);
+    return NULL;
+out:
+    gs_free_object(thread_mem, ndev, "display_make_bg_device");
+    gs_memory_chunk_release(thread_mem);
+    return NULL;
+}
+
+/*
+ * Start rendering the page in the background. Returns 1 if the page was
+ * started, 0 if it should be rendered in the foreground instead, or an
+ * error if the clist could not be reopened for the next page.
+ */
+static int
+display_start_bg_print(gx_device_display *ddev, gx_device *dev)
+{
+    gx_device_clist *cldev = (gx_device_clist *)ddev;
+    gx_device_clist_reader *crdev = &cldev->reader;
+    gx_device_display *bgdev;
+    int code;
+
+    if (!gscms_is_threadsafe())
+        return 0;
+    if (ddev->bg_print.sema == NULL) {
+        ddev->bg_print.sema = gx_semaphore_label(gx_semaphore_alloc(ddev->memory->non_gc_memory), "BGPrint");
+        if (ddev->bg_print.sema == NULL)
+            return 0;
+    }
+    if ((code = clist_close_writer_and_init_reader(cldev)) < 0)
+        return 0;	/* leave the error to the foreground */
+    bgdev = display_make_bg_device(ddev);
+    if (bgdev == NULL)
+        return 0;
+
+    /* Hang onto the page's files, so that they can be deleted when the */
+    /* background thread has finished with them.                        */
+    ddev->bg_print.ocfname =
+        (char *)gs_alloc_bytes(ddev->memory->non_gc_memory,
+                               strlen(crdev->page_info.cfname) + 1,
+                               "display_start_bg_print(ocfname)");
+    ddev->bg_print.obfname =
+        (char *)gs_alloc_bytes(ddev->memory->non_gc_memory,
+                               strlen(crdev->page_info.bfname) + 1,
+                               "display_start_bg_print(obfname)");
+    if (ddev->bg_print.ocfname == NULL || ddev->bg_print.obfname == NULL) {
+        gs_free_object(ddev->memory->non_gc_memory, ddev->bg_print.ocfname,
+                       "display_start_bg_print(ocfname)");
+        gs_free_object(ddev->memory->non_gc_memory, ddev->bg_print.obfname,
+                       "display_start_bg_print(obfname)");
+        ddev->bg_print.ocfname = ddev->bg_print.obfname = NULL;
+        display_free_bg_device(bgdev);
+        return 0;
+    }
+    strcpy(ddev->bg_print.ocfname, crdev->page_info.cfname);
+    strcpy(ddev->bg_print.obfname, crdev->page_info.bfname);
+    ddev->bg_print.ocfile = crdev->page_info.cfile;
+    ddev->bg_print.obfile = crdev->page_info.bfile;
+    ddev->bg_print.oio_procs = crdev->page_info.io_procs;
+    crdev->page_info.cfile = crdev->page_info.bfile = NULL;
+    gs_free_object(crdev->memory, crdev->color_usage_array, "clist_color_usage_array");
+    crdev->color_usage_array = NULL;
+
+    ddev->bg_print.device = (gx_device *)bgdev;
+    ddev->bg_print.return_code = 0;
+    ddev->bg_print_top = dev;
+    if (gp_thread_start(display_print_page_in_background, (void *)ddev,
+                        &ddev->bg_print.thread_id) < 0) {
+        /* No threads: render the page now, from the copy */
+        ddev->bg_print.thread_id = NULL;
+        display_print_page_in_background((void *)ddev);
+    } else
+        gp_thread_label(ddev->bg_print.thread_id, "BG print thread");
+
+    /* Now set up the next page so it will use new clist files */
+    gs_free_object(ddev->memory->non_gc_memory, cldev->common.cache_chunk,
+                   "free tile cache for clist");
+    cldev->common.cache_chunk = NULL;
+    return (code = clist_open((gx_device *)ddev)) < 0 ? code : 1;
+}
+
+/* Wait for any page being rendered in the background, then free the */
+/* device copy it used and delete the page's clist files. An error   */
+/* from that page is left in bg_print.return_code.                    */
+static void
+display_finish_bg_print(gx_device_display *ddev)
+{
+    int code;
+
+    if (ddev->bg_print.device == NULL)
+        return;
+    gx_semaphore_wait(ddev->bg_print.sema);
+    gp_thread_finish(ddev->bg_print.thread_id);
+    ddev->bg_print.thread_id = NULL;
+    display_free_bg_device((gx_device_display *)ddev->bg_print.device);
+    ddev->bg_print.device = NULL;
+    ddev->bg_print_top = NULL;
+    if (ddev->bg_print.ocfile) {
+        code = ddev->bg_print.oio_procs->fclose(ddev->bg_print.ocfile, ddev->bg_print.ocfname, true);
+        if (ddev->bg_print.return_code == 0)
+            ddev->bg_print.return_code = code;
+    }
+    if (ddev->bg_print.obfile) {
+        code = ddev->bg_print.oio_procs->fclose(ddev->bg_print.obfile, ddev->bg_print.obfname, true);
+        if (ddev->bg_print.return_code == 0)
+            ddev->bg_print.return_code = code;
+    }
+    gs_free_object(ddev->memory->non_gc_memory, ddev->bg_print.ocfname, "display_finish_bg_print(ocfname)");
+    gs_free_object(ddev->memory->non_gc_memory, ddev->bg_print.obfname, "display_finish_bg_print(obfname)");
+    ddev->bg_print.ocfile = ddev->bg_print.obfile = NULL;
+    ddev->bg_print.ocfname = ddev->bg_print.obfname = NULL;
+}
+
 /* Close the display driver */
 static int
 display_close(gx_device * dev)
@@ -450,6 +715,12 @@ display_close(gx_device * dev)
     if (ddev->callback == NULL)
         return 0;	/* ignore the call since we were never properly opened */
 
+    display_finish_bg_print(ddev);
+    if (ddev->bg_print.sema != NULL) {
+        gx_semaphore_free(ddev->bg_print.sema);
+        ddev->bg_print.sema = NULL;		/* prevent double free */
+    }
+
     while(dev->parent)
         dev = dev->parent;
 
@@ -927,7 +1198,9 @@ display_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_int(plist,
             "DisplayFormat", &ddev->nFormat)) < 0 ||
         (code = param_write_float(plist,
-            "DisplayResolution", &ddev->HWResolution[1])) < 0);
+            "DisplayResolution", &ddev->HWResolution[1])) < 0 ||
+        (code = param_write_bool(plist,
+            "BGPrint", &ddev->bg_print_requested)) < 0);
     if (code >= 0 &&
         (ddev->nFormat & DISPLAY_COLORS_MASK) == DISPLAY_COLORS_SEPARATION)
         code = devn_get_params(dev, plist, &ddev->devn_params,
@@ -962,6 +1235,7 @@ display_put_params(gx_device * dev, gs_param_list * plist)
     void *handle;
     int found_string_handle = 0;
     gs_param_string dh = { 0 };
+    bool bg_print_requested = ddev->bg_print_requested;
 
     /* Handle extra parameters */
 
@@ -1108,6 +1382,15 @@ display_put_params(gx_device * dev, gs_param_list * plist)
             break;
     }
 
+    switch (code = param_read_bool(plist, "BGPrint", &bg_print_requested)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, "BGPrint", ecode);
+        case 0:
+        case 1:
+            break;
+    }
+
     if (ecode >= 0 &&
             (ddev->nFormat & DISPLAY_COLORS_MASK) == DISPLAY_COLORS_SEPARATION) {
         /* Use utility routine to handle devn parameters */
@@ -1138,12 +1421,19 @@ display_put_params(gx_device * dev, gs_param_list * plist)
         return ecode;
     }
 
+    if (ddev->bg_print_requested && !bg_print_requested)
+        display_finish_bg_print(ddev);
+    ddev->bg_print_requested = bg_print_requested;
+
     if ( is_open && ddev->callback &&
         ((old_width != dev->width) || (old_height != dev->height)) ) {
         /* We can resize this device while it is open, but we cannot
          * change the color format or handle.
          */
 
+        /* The page in the background still uses the old size */
+        display_finish_bg_print(ddev);
+
         while(dev->parent) {
             dev = dev->parent;
             gx_update_from_subclass(dev);
@@ -1223,6 +1513,8 @@ display_finish_copydevice(gx_device *dev, const gx_device *from_dev)
     /* Clear pointers */
     ddev->pBitmap = NULL;
     ddev->zBitmapSize = 0;
+    memset(&ddev->bg_print, 0, sizeof(ddev->bg_print));
+    ddev->bg_print_top = NULL;
 
     return 0;
 }
@@ -1715,7 +2007,8 @@ open_c:
     ddev->buf = base;
     ddev->buffer_space = space;
     pclist_dev->common.orig_spec_op = ddev->orig_procs.dev_spec_op;
-    clist_init_io_procs(pclist_dev, ddev->BLS_force_memory);
+    clist_init_io_procs(pclist_dev, ddev->BLS_force_memory,
+                        clist_compression_default);
     clist_init_params(pclist_dev, base, space, target,
                       display_buf_procs,
                       space_params.band,
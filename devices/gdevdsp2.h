@@ -21,6 +21,7 @@
 #include "gdevdevn.h"
 #include "gdevdsp.h"
 #include "gxclist.h"
+#include "gdevprn.h"		/* for bg_print_t */
 
 typedef struct gx_device_display_s gx_device_display;
 
@@ -34,7 +35,10 @@ typedef struct gx_device_display_s gx_device_display;
         int HWResolution_set;\
         gs_devn_params devn_params;\
         equivalent_cmyk_color_params equiv_cmyk_colors;\
-        gx_device_procs mutated_procs
+        gx_device_procs mutated_procs;\
+        bool bg_print_requested;	/* BGPrint: request rectangles in a thread */\
+        bg_print_t bg_print;\
+        gx_device *bg_print_top	/* device passed to the callbacks by the thread */
 
 /* The device descriptor */
 struct gx_device_display_s {
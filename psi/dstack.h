@@ -68,6 +68,8 @@
 #define dict_find_name(pnref) dict_find_name_by_index(name_index(imemory, pnref))
 #define dict_find_name_by_index_inline(nidx, htemp)\
   dstack_find_name_by_index_inline(&idict_stack, nidx, htemp)
+#define dict_find_name_by_site_inline(psite, nidx, gen, htemp, pce)\
+  dstack_find_name_by_site_inline(&idict_stack, psite, nidx, gen, htemp, pce)
 #define if_dict_find_name_by_index_top(nidx, htemp, pvslot)\
   if_dstack_find_name_by_index_top(&idict_stack, nidx, htemp, pvslot)
 
@@ -20,6 +20,7 @@
 #include "gsexit.h"
 #include "ierrors.h"
 #include "gsstruct.h"
+#include "gsmprof.h"
 #include "iref.h"		/* must precede iastate.h */
 #include "iastate.h"
 #include "igc.h"		/* for gs_gc_reclaim */
@@ -206,6 +207,8 @@ gs_alloc_ref_array(gs_ref_memory_t * mem, ref * parr, uint attrs,
         end = (ref *) (mem->cc->rtop = mem->cc->cbot +=
                        num_refs * sizeof(ref));
         make_mark(end - 1);
+        gs_memory_profile_alloc((gs_memory_t *)mem, gs_memory_profile_gc, NULL,
+                                num_refs * sizeof(ref), cname);
     } else {
         /*
          * Allocate a new run.  We have to distinguish 3 cases:
@@ -247,6 +250,7 @@ gs_alloc_ref_array(gs_ref_memory_t * mem, ref * parr, uint attrs,
             /* clump_locate_ptr() should *never* fail here */
             if (clump_locate_ptr(obj, &cl)) {
                 cl.cp->has_refs = true;
+                alloc_dirty_clump(mem, cl.cp);
             }
             else {
                 gs_abort((gs_memory_t *) mem);
@@ -393,6 +393,14 @@ gsapi_run_fileA(void       *instance,
 }
 #endif
 
+/* Return the interpreter to its post-initialization state */
+GSDLLEXPORT int GSDLLAPI
+gsapi_reset_job(void *instance, int *pexit_code)
+{
+    gs_lib_ctx_t *ctx = (gs_lib_ctx_t *)instance;
+    return psapi_reset_job(ctx, pexit_code);
+}
+
 /* Exit the interpreter */
 GSDLLEXPORT int GSDLLAPI
 gsapi_exit(void *instance)
@@ -362,6 +362,17 @@ gsapi_run_fileW(void *instance,
     const wchar_t *file_name, int user_errors, int *pexit_code);
 #endif
 
+/* Return the interpreter to the state it was in just after
+ * gsapi_init_with_args(), ready for another job, without
+ * re-running the initialization files.  Fonts, cached characters,
+ * ICC links and halftones set up during initialization are kept;
+ * everything the previous job defined is discarded.  This cannot
+ * be called between gsapi_run_string_begin() and
+ * gsapi_run_string_end().
+ */
+GSDLLEXPORT int GSDLLAPI
+gsapi_reset_job(void *instance, int *pexit_code);
+
 /* Exit the interpreter.
  * This must be called on shutdown if gsapi_init_with_args()
  * has been called, and just before gsapi_delete_instance().
@@ -551,6 +562,8 @@ typedef int (GSDLLAPIPTR PFN_gsapi_run_fileA)(void *instance,
 typedef int (GSDLLAPIPTR PFN_gsapi_run_fileW)(void *instance,
     const wchar_t *file_name, int user_errors, int *pexit_code);
 #endif
+typedef int (GSDLLAPIPTR PFN_gsapi_reset_job)(void *instance,
+    int *pexit_code);
 typedef int (GSDLLAPIPTR PFN_gsapi_exit)(void *instance);
 typedef int (GSDLLAPIPTR PFN_gsapi_set_param)(void *instance, const char *param, const void *value, gs_set_param_type type);
 
@@ -15,6 +15,7 @@
 
 
 /* Context state operations */
+#include "memory_.h"
 #include "ghost.h"
 #include "gsstruct.h"		/* for gxalloc.h */
 #include "gxalloc.h"
@@ -134,6 +135,7 @@ context_state_alloc(gs_context_state_t ** ppcst,
     pcst->dict_stack.system_dict = *psystem_dict;
     pcst->dict_stack.min_size = 0;
     pcst->dict_stack.userdict_index = 0;
+    memset(pcst->dict_stack.site_cache, 0, sizeof(pcst->dict_stack.site_cache));
     pcst->pgs = int_gstate_alloc(dmem);
     if (pcst->pgs == 0) {
         code = gs_note_error(gs_error_VMerror);
@@ -146,6 +148,8 @@ context_state_alloc(gs_context_state_t ** ppcst,
     pcst->rand_state = rand_state_initial;
     pcst->usertime_inited = false;
     pcst->plugin_list = 0;
+    pcst->upath_cache = 0;
+    pcst->form_cache = 0;
     make_t(&pcst->error_object, t__invalid);
     {	/*
          * Create an empty userparams dictionary of the right size.
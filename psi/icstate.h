@@ -55,6 +55,8 @@ struct gs_context_state_s {
     op_array_table op_array_table_local;  /* Local operator table */
     int time_slice_ticks;                 /* Ticks before next slice */
     gs_offset_t uel_position;   /* The file position at which we last hit UEL */
+    struct upath_cache_s *upath_cache; /* user path cache (non-GC), see zupath.c */
+    struct form_cache_s *form_cache; /* form cache (non-GC), see zform.c */
 
     /* Put the stacks at the end to minimize other offsets. */
     dict_stack_t dict_stack;
@@ -25,13 +25,33 @@
 typedef struct dict_stack_s dict_stack_t;
 
 /*
- * Reset the cached top values.  Every routine that alters the
- * dictionary stack (including changing the protection or size of the
- * top dictionary on the stack) must call this.
+ * Reset the cached top values, and invalidate the inline caches for name
+ * lookup.  Every routine that alters the dictionary stack (including
+ * changing the protection or size of the top dictionary on the stack)
+ * must call this.
  */
 void dstack_set_top(dict_stack_t *);
 
 /* Check whether a dictionary is one of the permanent ones on the d-stack. */
 bool dstack_dict_is_permanent(const dict_stack_t *, const ref *);
 
+/*
+ * Each dictionary counts the d-stack entries that refer to it, so that
+ * dict_put and dict_undef can tell whether a change may affect name lookup
+ * without searching the d-stack.  Every routine that pushes a dictionary
+ * onto the d-stack, pops one, or replaces an entry must keep the count up
+ * to date.  The count covers the d-stacks of all contexts.
+ */
+#define dstack_dict_pushed(pdref)\
+  ((pdref)->value.pdict->dstack_count.value.intval++)
+#define dstack_dict_popped(pdref)\
+  ((pdref)->value.pdict->dstack_count.value.intval--)
+
+/* Note that the top count entries of the d-stack are about to be popped. */
+void dstack_note_pop(dict_stack_t *, uint);
+
+/* Check whether a dictionary is anywhere on the d-stack. */
+#define dstack_dict_is_on_stack(pdref)\
+  ((pdref)->value.pdict->dstack_count.value.intval > 0)
+
 #endif /* iddstack_INCLUDED */
@@ -150,6 +150,7 @@ dict_alloc(gs_ref_memory_t * mem, uint size, ref * pdref)
              r_space(&arr) | imemory_new_mask(mem) | a_all,
              pdict, pdict);
     make_struct(&pdict->memory, avm_foreign, mem);
+    make_tav(&pdict->dstack_count, t_integer, imemory_new_mask(mem), intval, 0);
     code = dict_create_contents(size, &dref, dict_default_pack);
     if (code < 0) {
         gs_free_ref_array(mem, &arr, "dict_alloc");
@@ -514,6 +515,9 @@ dict_put(ref * pdref /* t_dictionary */ , const ref * pkey, const ref * pvalue,
         if (r_has_type(pkey, t_name)) {
             name *pname = pkey->value.pname;
 
+            /* The name may now hide a definition further down the stack. */
+            if (pds == 0 || dstack_dict_is_on_stack(pdref))
+                name_invalidate_lookup_caches(pmem);
             if (pname->pvalue == pv_no_defn &&
                 CAN_SET_PVALUE_CACHE(pds, pdref, mem)
                 ) {		/* Set the cache. */
@@ -655,6 +659,9 @@ dict_undef(ref * pdref, const ref * pkey, dict_stack_t *pds)
     if (r_has_type(pkey, t_name)) {
         name *pname = pkey->value.pname;
 
+        /* A definition further down the stack may now be visible. */
+        if (pds == 0 || dstack_dict_is_on_stack(pdref))
+            name_invalidate_lookup_caches(mem);
         if (pv_valid(pname->pvalue)) {
 #ifdef DEBUG
             /* Check the the cache is correct. */
@@ -776,6 +783,7 @@ dict_resize(ref * pdref, uint new_size, dict_stack_t *pds)
     make_tav(&drto, t_dictionary, r_space(pdref) | a_all | new_mask,
              pdict, &dnew);
     dnew.memory = pdict->memory;
+    make_int(&dnew.dstack_count, 0);
     if ((code = dict_create_contents(new_size, &drto, dict_is_packed(pdict))) < 0)
         return code;
     /*
@@ -817,6 +825,8 @@ dict_resize(ref * pdref, uint new_size, dict_stack_t *pds)
     ref_save_in(dict_memory(pdict), pdref, &pdict->maxlength,
                 "dict_resize(maxlength)");
     d_set_maxlength(pdict, new_size);
+    /* The values have moved, wherever the dictionary is. */
+    name_invalidate_lookup_caches(dict_mem(pdict));
     if (pds)
         dstack_set_top(pds);	/* just in case this is the top dict */
     return 0;
@@ -37,6 +37,8 @@ struct dict_s {
     ref maxlength;		/* t_integer, maxlength as seen by client. */
     ref memory;			/* foreign t_struct, the allocator that */
     /* created this dictionary */
+    ref dstack_count;		/* t_integer, # of d-stack entries that */
+    /* refer to this dictionary (see iddstack.h) */
 #define dict_memory(pdict) r_ptr(&(pdict)->memory, gs_ref_memory_t)
 #define dict_mem(pdict) r_ptr(&(pdict)->memory, gs_memory_t)
 };
@@ -22,6 +22,23 @@
 #include "isdata.h"
 #include "iddstack.h"
 
+/*
+ * Define an entry of the inline caches for names executed from packed
+ * procedures.  Each call site (the address of the packed element) hashes
+ * to one entry, which remembers where the name was last found on the
+ * stack.  An entry is only valid while the lookup generation of the name
+ * table (see inamedef.h) is the one it was filled in with, since any
+ * change that could make the lookup give a different result, including
+ * a garbage collection or a restore, changes the generation.
+ */
+typedef struct dstack_site_cache_s {
+    const ref_packed *site;
+    ref *pvalue;
+    int64_t generation;
+    uint key;			/* the name index */
+} dstack_site_cache_t;
+#define DSTACK_SITE_CACHE_SIZE 512	/* must be a power of 2 */
+
 /* Define the dictionary stack structure. */
 struct dict_stack_s {
 
@@ -66,11 +83,18 @@ struct dict_stack_s {
  */
     ref system_dict;
 
+/*
+ * The inline caches for names executed from packed procedures.  The
+ * value pointers aren't traced by the garbage collector, which changes
+ * the lookup generation.
+ */
+    dstack_site_cache_t site_cache[DSTACK_SITE_CACHE_SIZE];
+
 };
 
 /*
- * The top-entry pointers are recomputed after garbage collection, so we
- * don't declare them as pointers.
+ * The top-entry pointers are recomputed after garbage collection, and the
+ * inline caches are invalidated by it, so we don't declare them as pointers.
  */
 #define public_st_dict_stack()	/* in interp.c */\
   gs_public_st_suffix_add0(st_dict_stack, dict_stack_t, "dict_stack_t",\
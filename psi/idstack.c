@@ -96,6 +96,16 @@ dstack_dict_is_permanent(const dict_stack_t * pds, const ref * pdref)
     return false;
 }
 
+/* Note that the top count entries of the d-stack are about to be popped. */
+void
+dstack_note_pop(dict_stack_t * pds, uint count)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i)
+        dstack_dict_popped(ref_stack_index(&pds->stack, i));
+}
+
 /*
  * Look up a name on the dictionary stack.
  * Return the pointer to the value if found, 0 if not.
@@ -198,6 +208,27 @@ dstack_find_name_by_index(dict_stack_t * pds, uint nidx)
 #undef hash
 }
 
+/*
+ * Look up a name executed from a packed procedure on the dictionary stack,
+ * and remember where it was found in the call site's inline cache.
+ */
+ref *
+dstack_find_name_by_site(dict_stack_t * pds, const ref_packed * site,
+                         uint nidx, int64_t generation)
+{
+    ref *pvalue = dstack_find_name_by_index(pds, nidx);
+
+    if (pvalue != 0) {
+        dstack_site_cache_t *pce = dstack_site_cache_entry(pds, site);
+
+        pce->site = site;
+        pce->pvalue = pvalue;
+        pce->generation = generation;
+        pce->key = nidx;
+    }
+    return pvalue;
+}
+
 /* Set the cached values computed from the top entry on the dstack. */
 /* See idstack.h for details. */
 static const ref_packed no_packed_keys[2] =
@@ -224,6 +255,7 @@ dstack_set_top(dict_stack_t * pds)
         pds->def_space = -1;
     else
         pds->def_space = r_space(dsp);
+    name_invalidate_lookup_caches(pds->stack.memory);
 }
 
 /* After a garbage collection, scan the permanent dictionaries and */
@@ -49,6 +49,24 @@ ref *dstack_find_name_by_index(dict_stack_t *, uint);
   ((pds)->top_keys[htemp = dict_hash_mod_inline(dict_name_index_hash(nidx),\
      (pds)->top_npairs) + 1] == pt_tag(pt_literal_name) + (nidx) ?\
    (pds)->top_values + htemp : dstack_find_name_by_index(pds, nidx))
+/*
+ * Define a variant of the above for names executed from packed procedures,
+ * which falls back on the call site's inline cache (see idsdata.h) rather
+ * than searching the whole stack.  gen is the lookup generation of the
+ * name table, pce a temporary.
+ */
+ref *dstack_find_name_by_site(dict_stack_t *, const ref_packed *, uint, int64_t);
+#define dstack_site_cache_entry(pds,psite)\
+  (&(pds)->site_cache[(((uintptr_t)(psite) >> 1) ^ ((uintptr_t)(psite) >> 10)) &\
+                      (DSTACK_SITE_CACHE_SIZE - 1)])
+#define dstack_find_name_by_site_inline(pds,psite,nidx,gen,htemp,pce)\
+  ((pds)->top_keys[htemp = dict_hash_mod_inline(dict_name_index_hash(nidx),\
+     (pds)->top_npairs) + 1] == pt_tag(pt_literal_name) + (nidx) ?\
+   (pds)->top_values + htemp :\
+   ((pce = dstack_site_cache_entry(pds, psite))->site == (psite) &&\
+    (pce)->key == (nidx) && (pce)->generation == (gen) ?\
+    (pce)->pvalue : dstack_find_name_by_site(pds, psite, nidx, gen)))
+
 /*
  * Define a similar macro that only checks the top dictionary on the stack.
  */
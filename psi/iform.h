@@ -0,0 +1,40 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Form cache interface */
+
+#ifndef iform_INCLUDED
+#  define iform_INCLUDED
+
+#include "stdpre.h"
+#include "iref.h"
+#include "isave.h"
+
+/*
+ * These procedures are exported by zform.c, for the MaxFormItem user
+ * parameter and the MaxFormCache and CurFormCache system parameters
+ * (zusparam.c), to drop the forms that a restore frees (zvmem.c), and to
+ * free the cache at exit (imain.c).
+ */
+long form_cache_max_item(i_ctx_t *i_ctx_p);
+int form_cache_set_max_item(i_ctx_t *i_ctx_p, long val);
+long form_cache_max_size(i_ctx_t *i_ctx_p);
+int form_cache_set_max_size(i_ctx_t *i_ctx_p, long val);
+long form_cache_cur_size(i_ctx_t *i_ctx_p);
+void form_cache_restore(i_ctx_t *i_ctx_p, const alloc_save_t *asave);
+void form_cache_release(i_ctx_t *i_ctx_p);
+
+#endif /* iform_INCLUDED */
@@ -19,6 +19,7 @@
 #include "ghost.h"
 #include "ierrors.h"
 #include "gsexit.h"
+#include "gp.h"			/* for gp_get_realtime */
 #include "gsmdebug.h"
 #include "gsstruct.h"
 #include "iastate.h"
@@ -165,6 +166,9 @@ gs_gc_reclaim(vm_spaces * pspaces, bool global)
     int max_trace;		/* max space_ to trace */
     int min_collect;		/* min space_ to collect */
     int min_collect_vm_space;	/* min VM space to collect */
+#ifdef DEBUG
+    long start_time[2], end_time[2];
+#endif
     int ispace;
     gs_ref_memory_t *mem;
     clump_t *cp;
@@ -205,6 +209,11 @@ gs_gc_reclaim(vm_spaces * pspaces, bool global)
     if (global)
         min_collect = min_collect_vm_space = 1;
 
+#ifdef DEBUG
+    /* Time the whole collection, for -Z0. */
+    gp_get_realtime(start_time);
+#endif
+
 #define for_spaces(i, n)\
   for (i = 1; i <= n; ++i)
 #define for_collected_spaces(i)\
@@ -547,6 +556,14 @@ gs_gc_reclaim(vm_spaces * pspaces, bool global)
 
   no_collect:
 
+#ifdef DEBUG
+    gp_get_realtime(end_time);
+    if_debug2m('0', state.heap, "[0]GC done, %s, %ld us\n",
+               (global ? "global" : "local"),
+               (end_time[0] - start_time[0]) * 1000000L +
+               (end_time[1] - start_time[1]) / 1000);
+#endif
+
     /* Unregister the allocator roots. */
 
     for_spaces(ispace, max_trace)
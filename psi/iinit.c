@@ -283,11 +283,13 @@ obj_init(i_ctx_t **pi_ctx_p, gs_dual_memory_t *idmem)
              * For the moment, let globaldict be an alias for systemdict.
              */
             dsp[-1] = system_dict;
+            dstack_dict_pushed(dsp - 1);
             min_dstack_size++;
         } else {
             ++dsp;
         }
         *dsp = system_dict;
+        dstack_dict_pushed(dsp);
 
         /* Create dictionaries which are to be homes for operators. */
         for (tptr = op_defs_all; *tptr != 0; tptr++) {
@@ -312,6 +314,7 @@ obj_init(i_ctx_t **pi_ctx_p, gs_dual_memory_t *idmem)
             if (r == NULL)
                 return_error(gs_error_VMerror);
             ref_assign(dsp, r);
+            dstack_dict_pushed(dsp);
         }
 
         /* Enter names of referenced initial dictionaries into systemdict. */
@@ -57,6 +57,8 @@
 #include "ivmspace.h"
 #include "idisp.h"              /* for setting display device callback */
 #include "iplugin.h"
+#include "iupath.h"
+#include "iform.h"
 #include "zfile.h"
 
 #include "valgrind.h"
@@ -116,6 +118,8 @@ get_local_op_array(const gs_memory_t *mem)
 /* ------ Forward references ------ */
 
 static int gs_run_init_file(gs_main_instance *, int *, ref *);
+static int push_value(gs_main_instance *, ref *);
+static int pop_value(i_ctx_t *, ref *);
 void print_resource_usage(const gs_main_instance *,
                                   gs_dual_memory_t *, const char *);
 
@@ -316,10 +320,17 @@ int gs_main_init2aux(gs_main_instance * minst) {
         if ((code = gs_main_run_string(minst,
                 "JOBSERVER "
                 " { false 0 .startnewjob } "
-                " { NOOUTERSAVE not { save pop } if } "
+                " { NOOUTERSAVE not { save } if } "
                 "ifelse", 0, &exit_code,
                 &error_object)) < 0)
            return code;
+        /* Remember the outer save, for gs_main_reset_job. */
+        i_ctx_p = minst->i_ctx_p;
+        if (ref_stack_count(&o_stack) > 0 &&
+            r_has_type(ref_stack_index(&o_stack, 0L), t_save)) {
+            minst->outer_save_id = ref_stack_index(&o_stack, 0L)->value.saveid;
+            ref_stack_pop(&o_stack, 1);
+        }
     }
     return 0;
 }
@@ -946,6 +957,58 @@ gs_main_run_string_end(gs_main_instance * minst, int user_errors,
                              perror_object);
 }
 
+/*
+ * Return to the post-initialization state.  Nothing we execute here may
+ * be allocated since the save we restore, so the PostScript is kept to
+ * straight-line code and the decisions are made in C.
+ */
+int
+gs_main_reset_job(gs_main_instance * minst, int *pexit_code,
+                  ref * perror_object)
+{
+    i_ctx_t *i_ctx_p = minst->i_ctx_p;
+    ref *psd, *pjobsave;
+    ref vref;
+    int code;
+
+    if (minst->init_done < 2)
+        return 0;               /* nothing has run yet */
+    if (dict_find_string(systemdict, "serverdict", &psd) > 0 &&
+        r_has_type(psd, t_dictionary) &&
+        dict_find_string(psd, ".jobsave", &pjobsave) > 0 &&
+        r_has_type(pjobsave, t_save)
+        ) {
+        /* Under a job server: the same as ^D. */
+        return gs_main_run_string(minst,
+                    "clear cleardictstack false 0 .startnewjob",
+                    0, pexit_code, perror_object);
+    }
+    if (minst->outer_save_id == 0)
+        return_error(gs_error_invalidrestore);
+    code = gs_main_run_string(minst, "clear cleardictstack", 0,
+                              pexit_code, perror_object);
+    if (code < 0)
+        return code;
+    i_ctx_p = minst->i_ctx_p;
+    make_tav(&vref, t_save, 0, saveid, minst->outer_save_id);
+    code = push_value(minst, &vref);
+    if (code < 0)
+        return code;
+    code = gs_main_run_string(minst, "restore save", 0,
+                              pexit_code, perror_object);
+    if (code < 0)
+        return code;
+    i_ctx_p = minst->i_ctx_p;
+    code = pop_value(i_ctx_p, &vref);
+    if (code < 0)
+        return code;
+    check_type_only(vref, t_save);
+    minst->outer_save_id = vref.value.saveid;
+    ref_stack_pop(&o_stack, 1);
+    return gs_main_run_string(minst, "initgraphics false setglobal", 0,
+                              pexit_code, perror_object);
+}
+
 gs_memory_t *
 gs_main_get_device_memory(gs_main_instance * minst)
 {
@@ -1223,6 +1286,7 @@ gs_finit_push_systemdict(i_ctx_t *i_ctx_p)
     }
     dsp++;
     ref_assign(dsp, systemdict);
+    dstack_dict_pushed(dsp);
 }
 
 /* Free all resources and return. */
@@ -1388,6 +1452,8 @@ gs_main_finit(gs_main_instance * minst, int exit_status, int env_code)
         i_plugin_holder *h = i_ctx_p->plugin_list;
 
         dmem = *idmemory;
+        upath_cache_release(i_ctx_p);
+        form_cache_release(i_ctx_p);
         env_code = alloc_restore_all(i_ctx_p);
         if (env_code < 0)
             emprintf1(mem_raw,
@@ -208,6 +208,20 @@ int gs_main_run_string_continue(gs_main_instance * minst,
 int gs_main_run_string_end(gs_main_instance * minst, int user_errors,
                            int *pexit_code, ref * perror_object);
 
+/*
+ * Return the interpreter to the state it was in at the end of
+ * initialization, so that it can run another job.  This restores the
+ * job server save (JOBSERVER) or the outer save made after the
+ * initialization files have run, then re-establishes it.  Fonts,
+ * cached characters, ICC links and halftones set up during
+ * initialization survive; anything the job added is discarded.  Fails
+ * with invalidrestore if the instance was started with NOOUTERSAVE and
+ * not under a job server.  Must not be called between
+ * run_string_begin and run_string_end.
+ */
+int gs_main_reset_job(gs_main_instance * minst, int *pexit_code,
+                      ref * perror_object);
+
 /* This procedure returns the offset at which the last UEL was
  * encountered during parsing. This is only defined after
  * a gs_error_InterpreterExit has been returned (and in particular
@@ -27,6 +27,7 @@
 #include "gscdefs.h"
 #include "gsmalloc.h"           /* for gs_malloc_limit */
 #include "gsmdebug.h"
+#include "gsmprof.h"
 #include "gspaint.h"		/* for gs_erasepage */
 #include "gxdevice.h"
 #include "gxdevmem.h"
@@ -474,6 +475,11 @@ run_stdin:
                 code = gs_add_explicit_control_path(minst->heap, arg, gs_permit_file_control);
                 if (code < 0) return code;
                 break;
+            } else if (strcmp(arg, "memory-profile") == 0) {
+                code = gs_memory_profile_enable(minst->heap);
+                if (code < 0)
+                    return code;
+                break;
             }
             if (*arg != 0) {
                 /* Unmatched switch. */
@@ -835,6 +841,13 @@ run_stdin:
                         code = gs_add_outputfile_control_path(minst->heap, eqp);
                         if (code < 0) return code;
                     }
+                    /* BandProfileFile is appended to, which needs both. */
+                    if (strcmp(adef, "BandProfileFile") == 0 && strlen(eqp) > 0) {
+                        code = gs_add_control_path(minst->heap, gs_permit_file_reading, eqp);
+                        if (code < 0) return code;
+                        code = gs_add_control_path(minst->heap, gs_permit_file_writing, eqp);
+                        if (code < 0) return code;
+                    }
 
                     ialloc_set_space(idmemory, avm_system);
                     if (isd) {
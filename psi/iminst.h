@@ -89,6 +89,9 @@ struct gs_main_instance_s {
     gs_c_param_list *param_list;
     int mid_run_string;
 
+    /* The save made at the end of initialization (0 if none). */
+    ulong outer_save_id;
+
     /* The state for gsapi param enumeration in the gs (not gpdl) case. */
     gs_c_param_list enum_params;
     gs_param_enumerator_t enum_iter;
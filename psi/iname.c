@@ -96,6 +96,7 @@ names_init(ulong count, gs_ref_memory_t *imem)
         ((count - 1) | nt_sub_index_mask) >> nt_log2_sub_size;
     nt->name_string_attrs = imemory_space(imem) | a_readonly;
     nt->memory = mem;
+    nt->lookup_generation = 1;	/* never valid for an empty cache entry */
     /* Initialize the one-character names. */
     /* Start by creating the necessary sub-tables. */
     for (i = 0; i < NT_1CHAR_FIRST + NT_1CHAR_SIZE; i += nt_sub_size) {
@@ -283,6 +284,13 @@ names_invalidate_value_cache(name_table * nt, const ref * pnref)
     pnref->value.pname->pvalue = pv_other;
 }
 
+/* Invalidate the inline caches for name lookup on the dictionary stack. */
+void
+names_invalidate_lookup_caches(name_table * nt)
+{
+    nt->lookup_generation++;
+}
+
 /* Convert between names and indices. */
 #undef names_index
 name_index_t
@@ -61,6 +61,10 @@
 #define name_invalidate_value_cache(mem, pnref)\
   names_invalidate_value_cache(mem->gs_lib_ctx->gs_name_table, pnref)
 
+/* Invalidate the inline caches for name lookup on the dictionary stack. */
+#define name_invalidate_lookup_caches(mem)\
+  names_invalidate_lookup_caches(mem->gs_lib_ctx->gs_name_table)
+
 /* Convert between names and indices. */
 #define name_index(mem, pnref)		/* ref => index */\
   names_index(mem->gs_lib_ctx->gs_name_table, pnref)
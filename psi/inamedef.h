@@ -104,6 +104,12 @@ struct name_table_s {
     uint max_sub_count;		/* max allowable value of sub_count */
     uint name_string_attrs;	/* imemory_space(memory) | a_readonly */
     gs_memory_t *memory;
+    /*
+     * The lookup generation changes whenever looking up a name on a
+     * dictionary stack might give a different result.  The interpreter's
+     * inline caches (see idsdata.h) are only valid for one generation.
+     */
+    int64_t lookup_generation;
     uint hash[NT_HASH_SIZE];
     struct sub_ {		/* both ptrs are 0 or both are non-0 */
         name_sub_table *names;
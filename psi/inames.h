@@ -84,6 +84,9 @@ int names_from_string(name_table * nt, const ref * psref, ref * pnref);
 /* Invalidate the value cache for a name. */
 void names_invalidate_value_cache(name_table * nt, const ref * pnref);
 
+/* Invalidate the inline caches for name lookup on the dictionary stack. */
+void names_invalidate_lookup_caches(name_table * nt);
+
 /* Convert between names and indices. */
 name_index_t names_index(const name_table * nt, const ref * pnref);		/* ref => index */
 name *names_index_ptr(const name_table * nt, name_index_t nidx);	/* index => name */
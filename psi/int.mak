@@ -97,7 +97,7 @@ $(PSD)isupport.dev : $(ECHOGS_XE) $(isupport_) $(INT_MAK) $(MAKEDIRS)
 	$(ADDMOD) $(PSD)isupport -obj $(isupport2_)
 
 $(PSOBJ)ialloc.$(OBJ) : $(PSSRC)ialloc.c $(AK) $(memory__h) $(gx_h)\
- $(ierrors_h) $(gsstruct_h)\
+ $(ierrors_h) $(gsstruct_h) $(gsmprof_h)\
  $(iastate_h) $(igc_h) $(ipacked_h) $(iref_h) $(iutil_h) $(ivmspace_h)\
  $(store_h) $(gsexit_h) $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)ialloc.$(OBJ) $(C_) $(PSSRC)ialloc.c
@@ -106,7 +106,7 @@ $(PSOBJ)ialloc.$(OBJ) : $(PSSRC)ialloc.c $(AK) $(memory__h) $(gx_h)\
 # but since all the GC enumeration and relocation routines refer to them,
 # it's too hard to separate them out from the Level 1 base.
 $(PSOBJ)igc.$(OBJ) : $(PSSRC)igc.c $(GH) $(memory__h)\
- $(ierrors_h) $(gsexit_h) $(gsmdebug_h) $(gsstruct_h)\
+ $(ierrors_h) $(gp_h) $(gsexit_h) $(gsmdebug_h) $(gsstruct_h)\
  $(iastate_h) $(idict_h) $(igc_h) $(igcstr_h) $(inamedef_h)\
  $(ipacked_h) $(isave_h) $(isstate_h) $(istruct_h) $(opdef_h) \
  $(INT_MAK) $(MAKEDIRS)
@@ -269,6 +269,8 @@ sbhc_h=$(PSSRC)sbhc.h $(shc_h)
 zfile_h=$(PSSRC)zfile.h
 # Include files for optional features
 ibnum_h=$(PSSRC)ibnum.h
+iupath_h=$(PSSRC)iupath.h
+iform_h=$(PSSRC)iform.h
 zcolor_h=$(PSSRC)zcolor.h
 zcie_h=$(PSSRC)zcie.h
 zicc_h=$(PSSRC)zicc.h
@@ -441,7 +443,7 @@ $(PSOBJ)ztype.$(OBJ) : $(PSSRC)ztype.c $(OP)\
 	$(PSCC) $(PSO_)ztype.$(OBJ) $(C_) $(PSSRC)ztype.c
 
 $(PSOBJ)zvmem.$(OBJ) : $(PSSRC)zvmem.c $(OP) $(stat__h)\
- $(dstack_h) $(estack_h) $(files_h)\
+ $(dstack_h) $(estack_h) $(files_h) $(iform_h)\
  $(ialloc_h) $(idict_h) $(igstate_h) $(isave_h) $(store_h) $(stream_h)\
  $(gsmalloc_h) $(gsmatrix_h) $(gsstate_h) $(gsstruct_h) $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)zvmem.$(OBJ) $(C_) $(PSSRC)zvmem.c
@@ -1037,7 +1039,7 @@ $(PSOBJ)zusparam.$(OBJ) : $(PSSRC)zusparam.c $(OP) $(memory__h) $(string__h)\
  $(ialloc_h) $(icontext_h) $(idict_h) $(idparam_h) $(iparam_h)\
  $(iname_h) $(itoken_h) $(iutil2_h) $(ivmem2_h)\
  $(dstack_h) $(estack_h) $(store_h) $(gsnamecl_h) $(gslibctx_h)\
- $(INT_MAK) $(MAKEDIRS)
+ $(iupath_h) $(iform_h) $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)zusparam.$(OBJ) $(C_) $(PSSRC)zusparam.c
 
 # Define full Level 2 support.
@@ -1339,7 +1341,9 @@ $(PSOBJ)zupath.$(OBJ) : $(PSSRC)zupath.c $(OP)\
  $(dstack_h) $(oparc_h) $(store_h)\
  $(ibnum_h) $(idict_h) $(igstate_h) $(iname_h) $(iutil_h) $(stream_h)\
  $(gscoord_h) $(gsmatrix_h) $(gspaint_h) $(gspath_h) $(gsstate_h)\
- $(gxfixed_h) $(gxdevice_h) $(gzpath_h) $(gzstate_h) $(INT_MAK) $(MAKEDIRS)
+ $(gxfixed_h) $(gxdevice_h) $(gzpath_h) $(gzstate_h) $(gsutil_h)\
+ $(gxbitmap_h) $(gslibctx_h) $(memory__h) $(math__h) $(icstate_h) $(iupath_h)\
+ $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)zupath.$(OBJ) $(C_) $(PSSRC)zupath.c
 
 # -------- Additions common to Display PostScript and Level 2 -------- #
@@ -1754,7 +1758,11 @@ $(GLD)form.dev : $(LIB_MAK) $(ECHOGS_XE) $(form_) $(INT_MAK) $(MAKEDIRS)
 $(PSOBJ)zform.$(OBJ) : $(PSSRC)zform.c $(OP) $(ghost_h) $(oper_h)\
   $(gxdevice_h) $(ialloc_h) $(idict_h) $(idparam_h) $(igstate_h)\
   $(gxdevsop_h) $(gscoord_h) $(gsform1_h) $(gspath_h) $(gxpath_h)\
-  $(gzstate_h) $(INT_MAK) $(MAKEDIRS)
+  $(gzstate_h) $(math__h) $(memory__h) $(gspath2_h) $(gsutil_h)\
+  $(gslibctx_h) $(gspaint_h) $(gsptype1_h) $(gxcolor2_h) $(gxpcolor_h)\
+  $(gxdevmem_h) $(gxfont_h) $(estack_h) $(icstate_h) $(iform_h)\
+  $(isave_h) $(store_h)\
+  $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)zform.$(OBJ) $(C_) $(PSSRC)zform.c
 
 # ================================ PDF ================================ #
@@ -1831,16 +1839,22 @@ $(PSOBJ)zncdummy.$(OBJ) : $(PSSRC)zncdummy.c $(OP) $(GX) $(math_h)\
 
 # ---------------- Custom operators for PDF interpreter ---------------- #
 
-zpdfops_=$(PSOBJ)zpdfops.$(OBJ)
+zpdfops_=$(PSOBJ)zpdfops.$(OBJ) $(PSOBJ)zpdfxref.$(OBJ)
 $(PSD)pdfops.dev : $(ECHOGS_XE) $(zpdfops_) $(INT_MAK) $(MAKEDIRS)
 	$(SETMOD) $(PSD)pdfops $(zpdfops_)
-	$(ADDMOD) $(PSD)pdfops -oper zpdfops
+	$(ADDMOD) $(PSD)pdfops -oper zpdfops zpdfxref
 
 $(PSOBJ)zpdfops.$(OBJ) : $(PSSRC)zpdfops.c $(OP) $(MAKEFILE)\
  $(igstate_h) $(istack_h) $(iutil_h) $(gspath_h) $(math__h) $(ialloc_h)\
  $(string__h) $(store_h) $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)zpdfops.$(OBJ) $(C_) $(PSSRC)zpdfops.c
 
+$(PSOBJ)zpdfxref.$(OBJ) : $(PSSRC)zpdfxref.c $(OP) $(MAKEFILE)\
+ $(memory__h) $(gsstruct_h) $(stream_h) $(strimpl_h) $(sfilter_h) $(files_h)\
+ $(ialloc_h) $(iddict_h) $(iname_h) $(iparray_h) $(iscan_h) $(istack_h)\
+ $(store_h) $(INT_MAK) $(MAKEDIRS)
+	$(PSCC) $(PSO_)zpdfxref.$(OBJ) $(C_) $(PSSRC)zpdfxref.c
+
 zutf8_=$(PSOBJ)zutf8.$(OBJ)
 $(PSD)utf8.dev : $(ECHOGS_XE) $(zutf8_) $(INT_MAK) $(MAKEDIRS)
 	$(SETMOD) $(PSD)utf8 $(zutf8_)
@@ -1885,7 +1899,7 @@ $(PSOBJ)psapi.$(OBJ) : $(PSSRC)psapi.c $(AK)\
  $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)psapi.$(OBJ) $(C_) $(PSSRC)psapi.c
 
-$(PSOBJ)icontext.$(OBJ) : $(PSSRC)icontext.c $(GH)\
+$(PSOBJ)icontext.$(OBJ) : $(PSSRC)icontext.c $(GH) $(memory__h)\
  $(gsstruct_h) $(gxalloc_h)\
  $(dstack_h) $(ierrors_h) $(estack_h) $(files_h)\
  $(icontext_h) $(idict_h) $(igstate_h) $(interp_h) $(isave_h) $(store_h)\
@@ -1906,7 +1920,7 @@ $(PSOBJ)idisp.$(OBJ) : $(PSSRC)idisp.c $(OP) $(stdio__h) $(gp_h)\
 $(PSOBJ)imainarg.$(OBJ) : $(PSSRC)imainarg.c $(GH)\
  $(ctype__h) $(memory__h) $(string__h)\
  $(gp_h)\
- $(gsargs_h) $(gscdefs_h) $(gsdevice_h) $(gsmalloc_h) $(gsmdebug_h)\
+ $(gsargs_h) $(gscdefs_h) $(gsdevice_h) $(gsmalloc_h) $(gsmdebug_h) $(gsmprof_h)\
  $(gspaint_h) $(gxclpage_h) $(gdevprn_h) $(gxdevice_h) $(gxdevmem_h)\
  $(ierrors_h) $(estack_h) $(files_h)\
  $(iapi_h) $(ialloc_h) $(iconf_h) $(imain_h) $(imainarg_h) $(iminst_h)\
@@ -1921,7 +1935,7 @@ $(PSOBJ)imain.$(OBJ) : $(PSSRC)imain.c $(GH) $(memory__h) $(string__h)\
  $(dstack_h) $(ierrors_h) $(estack_h) $(files_h)\
  $(ialloc_h) $(iconf_h) $(idebug_h) $(iddict_h) $(idisp_h) $(iinit_h)\
  $(iname_h) $(interp_h) $(iplugin_h) $(isave_h) $(iscan_h) $(ivmspace_h)\
- $(iinit_h) $(main_h) $(oper_h) $(ostack_h)\
+ $(iinit_h) $(iupath_h) $(iform_h) $(main_h) $(oper_h) $(ostack_h)\
  $(sfilter_h) $(store_h) $(stream_h) $(strimpl_h) $(zfile_h)\
  $(INT_MAK) $(MAKEDIRS)
 	$(PSCC) $(PSO_)imain.$(OBJ) $(C_) $(PSSRC)imain.c
@@ -6358,6 +6372,7 @@ $(GLSRC)gsform1.h:$(GLSRC)stdpre.h
 $(GLSRC)gsform1.h:$(GLGEN)arch.h
 $(GLSRC)gsform1.h:$(GLSRC)gs_dll_call.h
 $(DEVSRC)gdevdsp2.h:$(GLSRC)gxclist.h
+$(DEVSRC)gdevdsp2.h:$(GLSRC)gdevprn.h
 $(DEVSRC)gdevdsp2.h:$(GLSRC)gxgstate.h
 $(DEVSRC)gdevdsp2.h:$(GLSRC)gstrans.h
 $(DEVSRC)gdevdsp2.h:$(GLSRC)gdevp14.h
@@ -57,6 +57,24 @@
  */
 #define PACKED_SPECIAL_OPS 1
 
+#if PACKED_SPECIAL_OPS
+/*
+ * The packed representation of a special operator (see iinit.c), used to
+ * recognize the short sequences that the interpreter executes as a single
+ * superinstruction.
+ */
+#  define packed_xop(xop)\
+  (pt_tag(pt_executable_operator) + (xop) - (int)tx_op + 1)
+/*
+ * An integer operand that can have a packed integer added to or
+ * subtracted from it without overflowing, even in CPSI mode: the
+ * superinstructions leave anything else to the regular operator.
+ */
+#  define packed_int_operand_ok(op)\
+  ((op) >= osbot && r_has_type(op, t_integer) &&\
+   (ps_uint)(op)->value.intval + 0x40000000 < 0x80000000)
+#endif
+
 /*
  * Pseudo-operators (procedures of type t_oparray) record
  * the operand and dictionary stack pointers, and restore them if an error
@@ -125,6 +143,7 @@ struct stats_interp_s {
     long find_name, name_lit, name_proc, name_oparray, name_operator;
     long p_full, p_exec_operator, p_exec_oparray, p_exec_non_x_operator,
         p_integer, p_lit_name, p_exec_name;
+    long p_integer_add, p_integer_sub, p_integer_index, p_lit_name_exch_def;
     long p_find_name, p_name_lit, p_name_proc;
 } stats_interp;
 # define INCR(v) (++(stats_interp.v))
@@ -401,6 +420,7 @@ gs_interp_reset(i_ctx_t *i_ctx_p)
     ref_stack_clear(&e_stack);
     esp++;
     make_oper(esp, 0, interp_exit);
+    dstack_note_pop(&idict_stack, ref_stack_count(&d_stack) - min_dstack_size);
     ref_stack_pop_to(&d_stack, min_dstack_size);
     dict_set_top();
 }
@@ -585,6 +605,8 @@ again:
             ccode = copy_stack(i_ctx_p, &d_stack, min_dstack_size, &saref);
             if (ccode < 0)
                 return ccode;
+            dstack_note_pop(&idict_stack,
+                            ref_stack_count(&d_stack) - min_dstack_size);
             ref_stack_pop_to(&d_stack, min_dstack_size);
             dict_set_top();
             *++osp = saref;
@@ -998,6 +1020,11 @@ interp(i_ctx_t **pi_ctx_p /* context for execution, updated if resched */,
 #define next_either()\
   if ( --icount <= 0 ) { if ( icount < 0 ) goto up; iesp--; }\
   iref_packed = IREF_NEXT_EITHER(iref_packed); goto top
+/* Step over a packed element that a superinstruction has absorbed. */
+/* The caller guarantees that icount > 0. */
+#define skip_short()\
+  if ( --icount == 0 ) iesp--;\
+  ++iref_packed
 
 #if !PACKED_SPECIAL_OPS
 #  undef next_either
@@ -1701,6 +1728,45 @@ remap:              if (iesp + 2 >= estop) {
                         make_int(iosp,
                                  ((int)*iref_packed & packed_int_mask) +
                                  packed_min_intval);
+#if PACKED_SPECIAL_OPS
+                        /*
+                         * Superinstructions: a packed integer followed by
+                         * add, sub or index is executed as one step.  We
+                         * advance to the operator first, so that any case
+                         * the fast path doesn't handle (including all
+                         * errors) simply continues with the ordinary code
+                         * for that operator.
+                         */
+                        if (icount > 0) {
+                            switch (iref_packed[1]) {
+                                case packed_xop(tx_op_add):
+                                    INCR(p_integer_add);
+                                    skip_short();
+                                    if (!packed_int_operand_ok(iosp - 1))
+                                        goto x_add;
+                                    iosp[-1].value.intval += iosp->value.intval;
+                                    iosp--;
+                                    next_short();
+                                case packed_xop(tx_op_sub):
+                                    INCR(p_integer_sub);
+                                    skip_short();
+                                    if (!packed_int_operand_ok(iosp - 1))
+                                        goto x_sub;
+                                    iosp[-1].value.intval -= iosp->value.intval;
+                                    iosp--;
+                                    next_short();
+                                case packed_xop(tx_op_index):
+                                    INCR(p_integer_index);
+                                    skip_short();
+                                    if ((ulong)iosp->value.intval >= (ulong)(iosp - osbot))
+                                        goto x_index;
+                                    ref_assign_inline(iosp, iosp + ~(int)iosp->value.intval);
+                                    next_short();
+                                default:
+                                    ;
+                            }
+                        }
+#endif
                         next_short();
                     case pt_literal_name:
                         INCR(p_lit_name);
@@ -1711,6 +1777,25 @@ remap:              if (iesp + 2 >= estop) {
                                 return_with_stackoverflow_iref();
                             ++iosp;
                             name_index_ref_inline(int_nt, nidx, iosp);
+#if PACKED_SPECIAL_OPS
+                            /*
+                             * /name exch def stores the value on the top of
+                             * the stack: build the key/value pair in place
+                             * and go straight to def.
+                             */
+                            if (icount > 1 &&
+                                iref_packed[1] == packed_xop(tx_op_exch) &&
+                                iref_packed[2] == packed_xop(tx_op_def) &&
+                                iosp > osbot
+                                ) {
+                                INCR(p_lit_name_exch_def);
+                                ref_assign_inline(iosp, iosp - 1);
+                                name_index_ref_inline(int_nt, nidx, iosp - 1);
+                                skip_short();
+                                skip_short();
+                                goto x_def;
+                            }
+#endif
                             next_short();
                         }
                     case pt_executable_name:
@@ -1721,9 +1806,11 @@ remap:              if (iesp + 2 >= estop) {
                             pvalue = name_index_ptr_inline(int_nt, nidx)->pvalue;
                             if (!pv_valid(pvalue)) {
                                 uint htemp = 0;
+                                dstack_site_cache_t *pce;
 
                                 INCR(p_find_name);
-                                if ((pvalue = dict_find_name_by_index_inline(nidx, htemp)) == 0) {
+                                if ((pvalue = dict_find_name_by_site_inline(iref_packed, nidx,
+                                                  int_nt->lookup_generation, htemp, pce)) == 0) {
                                     names_index_ref(int_nt, nidx, &token);
                                     return_with_error(gs_error_undefined, &token);
                                 }
@@ -1889,6 +1976,7 @@ oparray_cleanup(i_ctx_t *i_ctx_p)
     if (ocount > ocount_old)
         ref_stack_pop(&o_stack, ocount - ocount_old);
     if (dcount > dcount_old) {
+        dstack_note_pop(&idict_stack, dcount - dcount_old);
         ref_stack_pop(&d_stack, dcount - dcount_old);
         dict_set_top();
     }
@@ -405,9 +405,7 @@ alloc_save_space(gs_ref_memory_t * mem, gs_dual_memory_t * dmem, ulong sid)
 {
     gs_ref_memory_t save_mem;
     alloc_save_t *save;
-    clump_t *cp;
     clump_t *new_cc = NULL;
-    clump_splay_walker sw;
 
     save_mem = *mem;
     alloc_close_clump(mem);
@@ -416,8 +414,9 @@ alloc_save_space(gs_ref_memory_t * mem, gs_dual_memory_t * dmem, ulong sid)
     ialloc_reset(mem);
 
     /* Create inner clumps wherever it's worthwhile. */
+    /* Clean clumps never have enough space to be worth it. */
 
-    for (cp = clump_splay_walk_init(&sw, &save_mem); cp != 0; cp = clump_splay_walk_fwd(&sw)) {
+    SCAN_MEM_DIRTY_CLUMPS(&save_mem, cp) {
         if (cp->ctop - cp->cbot > min_inner_clump_space) {
             /* Create an inner clump to cover only the unallocated part. */
             clump_t *inner =
@@ -434,6 +433,7 @@ alloc_save_space(gs_ref_memory_t * mem, gs_dual_memory_t * dmem, ulong sid)
                 new_cc = inner;
         }
     }
+    END_CLUMPS_SCAN
     mem->cc = new_cc;
     alloc_open_clump(mem);
 
@@ -1062,6 +1062,7 @@ combine_space(gs_ref_memory_t * mem)
     clump_splay_walker sw;
 
     alloc_close_clump(mem);
+    alloc_forget_clean(omem);
     for (cp = clump_splay_walk_init(&sw, mem); cp != 0; cp = clump_splay_walk_fwd(&sw)) {
         if (cp->outer == 0)
             alloc_link_clump(cp, omem);
@@ -1129,6 +1130,8 @@ combine_space(gs_ref_memory_t * mem)
             mem->largest_free_size = omem->largest_free_size;
     }
     gs_free_object((gs_memory_t *) mem, saved, "combine_space(saved)");
+    /* The merged clumps must all be looked at again by the next save. */
+    alloc_forget_clean(mem);
     alloc_open_clump(mem);
 }
 /* Free the changes chain for a level 0 .forgetsave, */
@@ -1259,20 +1262,34 @@ check_l_mark(void *obj)
 /* Set or reset the l_new attribute in every relevant slot. */
 /* This includes every slot on the current change chain, */
 /* and every (ref) slot allocated at this save level. */
+/* Also rebuild the allocator's list of dirty clumps. */
 /* Return the number of bytes of data scanned. */
 static int
 save_set_new(gs_ref_memory_t * mem, bool to_new, bool set_limit, ulong *pscanned)
 {
     ulong scanned = 0;
     int code;
+    clump_t *cp, *next;
+    clump_splay_walker sw;
+    bool dirty_only;
 
     /* Handle the change chain. */
     code = save_set_new_changes(mem, to_new, set_limit);
     if (code < 0)
         return code;
 
-    /* Handle newly allocated ref objects. */
-    SCAN_MEM_CLUMPS(mem, cp) {
+    /* Handle newly allocated ref objects.  Only dirty clumps can */
+    /* have any; afterwards, the ones that the next save or restore */
+    /* won't need to look at become clean. */
+    dirty_only = mem->clean_valid;
+    cp = (dirty_only ? mem->dirty : clump_splay_walk_init(&sw, mem));
+    mem->dirty = 0;
+    mem->clean_valid = true;
+    if (!dirty_only)
+        mem->clean_unused = mem->clean_inner = 0;
+    for (; cp != 0; cp = next) {
+        next = (dirty_only ? cp->dirty_next : clump_splay_walk_fwd(&sw));
+        cp->c_dirty = false;
         if (cp->has_refs) {
             bool has_refs = false;
 
@@ -1286,16 +1303,25 @@ save_set_new(gs_ref_memory_t * mem, bool to_new, bool set_limit, ulong *pscanned
                 uint size;
                 has_refs = true && to_new;
                 code = mark_allocated(prp, to_new, &size);
-                if (code < 0)
+                if (code < 0) {
+                    alloc_forget_clean(mem);
                     return code;
+                }
                 scanned += size;
             } else
                 scanned += sizeof(obj_header_t);
             END_OBJECTS_SCAN
                 cp->has_refs = has_refs;
         }
+        if (cp->has_refs || cp == mem->cc ||
+            cp->ctop - cp->cbot > min_inner_clump_space)
+            alloc_dirty_clump(mem, cp);
+        else {
+            mem->clean_unused += cp->ctop - cp->cbot;
+            if (cp->outer)
+                mem->clean_inner += cp->cend - (byte *) cp->chead;
+        }
     }
-    END_CLUMPS_SCAN
     if_debug2m('u', (gs_memory_t *)mem, "[u]set_new (%s) scanned %ld\n",
                (to_new ? "restore" : "save"), scanned);
     *pscanned = scanned;
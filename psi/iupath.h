@@ -0,0 +1,37 @@
+/* Copyright (C) 2001-2020 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* User path cache interface */
+
+#ifndef iupath_INCLUDED
+#  define iupath_INCLUDED
+
+#include "stdpre.h"
+#include "iref.h"
+
+/*
+ * These procedures are exported by zupath.c, for the MaxUPathItem user
+ * parameter and the MaxUPathCache and CurUPathCache system parameters
+ * (zusparam.c), and to free the cache at exit (imain.c).
+ */
+long upath_cache_max_item(i_ctx_t *i_ctx_p);
+int upath_cache_set_max_item(i_ctx_t *i_ctx_p, long val);
+long upath_cache_max_size(i_ctx_t *i_ctx_p);
+int upath_cache_set_max_size(i_ctx_t *i_ctx_p, long val);
+long upath_cache_cur_size(i_ctx_t *i_ctx_p);
+void upath_cache_release(i_ctx_t *i_ctx_p);
+
+#endif /* iupath_INCLUDED */
@@ -488,6 +488,22 @@ psapi_run_file(gs_lib_ctx_t *ctx,
     return code;
 }
 
+int
+psapi_reset_job(gs_lib_ctx_t *ctx,
+                int          *pexit_code)
+{
+    gs_main_instance *minst;
+
+    if (ctx == NULL)
+        return gs_error_Fatal;
+    minst = get_minst_from_memory(ctx->memory);
+
+    if (minst->mid_run_string == 1)
+        return -1;
+
+    return gs_main_reset_job(minst, pexit_code, &minst->error_object);
+}
+
 /* Retrieve the memory allocator for the interpreter instance */
 gs_memory_t *
 psapi_get_device_memory(gs_lib_ctx_t *ctx)
@@ -112,6 +112,10 @@ psapi_run_file(gs_lib_ctx_t *instance,
                int           user_errors,
                int          *pexit_code);
 
+int
+psapi_reset_job(gs_lib_ctx_t *instance,
+                int          *pexit_code);
+
 gs_memory_t *
 psapi_get_device_memory(gs_lib_ctx_t *instance);
 
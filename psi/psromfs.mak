@@ -34,9 +34,11 @@ PS_RESOURCE_LIST=SubstCID$(D)* CIDFSubst$(D)* CIDFont$(D)* -C $(PDF_RESOURCE_LIS
 PS_FONT_RESOURCE_LIST=-B -b Font$(D)*
 
 #	Notes: gs_cet.ps is only needed to match Adobe CPSI defaults
-PS_ROMFS_ARGS=-c \
+#	The combined gs_init.ps is read in full at every startup, so (as mkromfs
+#	recommends) we store it uncompressed; everything else is compressed.
+PS_ROMFS_ARGS=-b \
   -d Resource/Init/ -P $(PSRESDIR)$(D)Init$(D) -g gs_init.ps $(iconfig_h) \
-  -d Resource/ -P $(PSRESDIR)$(D) $(PS_RESOURCE_LIST) \
+  -c -d Resource/ -P $(PSRESDIR)$(D) $(PS_RESOURCE_LIST) \
   -d lib/ -P $(PSLIBDIR)$(D) $(EXTRA_INIT_FILES)
 
 PS_FONT_ROMFS_ARGS=-d Resource/ -P $(PSRESDIR)$(D) $(PS_FONT_RESOURCE_LIST)
@@ -72,6 +72,7 @@ zbegin(i_ctx_t *i_ctx_p)
     }
     ++dsp;
     ref_assign(dsp, op);
+    dstack_dict_pushed(dsp);
     dict_set_top();
     pop(1);
     return 0;
@@ -89,6 +90,7 @@ zend(i_ctx_t *i_ctx_p)
         /* We would underflow the current block. */
         ref_stack_pop_block(&d_stack);
     }
+    dstack_dict_popped(dsp);
     dsp--;
     dict_set_top();
     return 0;
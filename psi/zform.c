@@ -14,7 +14,9 @@
 */
 
 
-/* Simple high level forms */
+/* Simple high level forms, and the form cache */
+#include "math_.h"
+#include "memory_.h"
 #include "ghost.h"
 #include "oper.h"
 #include "gxdevice.h"
@@ -26,10 +28,25 @@
 #include "gscoord.h"
 #include "gsform1.h"
 #include "gspath.h"
+#include "gspath2.h"
 #include "gxpath.h"
 #include "gzstate.h"
+#include "gsutil.h"
+#include "gslibctx.h"
+#include "gspaint.h"
+#include "gsptype1.h"
+#include "gxcolor2.h"
+#include "gxpcolor.h"
+#include "gxdevmem.h"
+#include "gxfont.h"
+#include "estack.h"
+#include "icstate.h"
+#include "iform.h"
+#include "isave.h"
 #include "store.h"
 
+extern_st(st_pattern1_instance);
+
 /* support for high level formss */
 
 /* [CTM before Form Matrix applied] <<Form dictionary>> .beginform -
@@ -224,11 +241,749 @@ static int zrepeatform(i_ctx_t *i_ctx_p)
     return code;
 }
 
+/* ---------------- Form cache ---------------- */
+
+/*
+ * On raster devices, execform keeps the device pixels that a form paints,
+ * as a bitmap in the device's own format together with a mask of the
+ * pixels that were marked, and paints later uses of the form from the
+ * cache, as the PLRM allows. The form is rendered into a pattern
+ * accumulator, so the mask is made in the same way as for a colored
+ * Pattern. The key is the form dictionary and the parts of the graphics
+ * state that its PaintProc can see: the linear part of the CTM (the
+ * translation is rounded to a whole device pixel so that one rendering
+ * serves every placement), the colors, the line parameters, the font and
+ * the color rendering state. Forms are only cached where the bitmap
+ * reproduces what painting the form directly would do: not for high
+ * level, halftoned, antialiased, planar or tagged devices, nor with
+ * overprint or a RasterOp, nor inside a Pattern or a BuildChar.
+ * MaxFormItem limits the size of one entry and MaxFormCache the total;
+ * the cache also gives memory back to the memory budget when asked.
+ *
+ * Entries live in non-GC memory so that they survive a restore, keeping
+ * the form dictionary alive through a GC root; a restore that frees the
+ * dictionary drops the entry (form_cache_restore).
+ */
+
+/* Default values of MaxFormItem and MaxFormCache, in bytes. */
+#define FORM_CACHE_MAX_ITEM 4000000
+#define FORM_CACHE_MAX_SIZE 20000000
+
+typedef struct form_entry_s form_entry_t;
+struct form_entry_s {
+    form_entry_t *more_recent, *less_recent;
+    ref form;			/* the form dictionary */
+    ref *pform;			/* &form, for the GC root */
+    gs_gc_root_t root;
+    uint key_size;
+    size_t size;		/* of the whole entry */
+    gs_id id;
+    int x, y;			/* origin relative to the translation */
+    int width, height;
+    uint raster, mask_raster;
+    /* The key, and then the bits and the mask, follow. */
+};
+#define form_entry_key(pe) ((byte *)((pe) + 1))
+#define form_entry_bits(pe)\
+  ((byte *)(pe) + ROUND_UP(sizeof(form_entry_t) + (pe)->key_size, align_bitmap_mod))
+#define form_entry_mask(pe)\
+  (form_entry_bits(pe) + (size_t)(pe)->raster * (pe)->height)
+
+typedef struct form_cache_s {
+    gs_memory_t *memory;	/* non-GC */
+    gs_memory_t *root_memory;	/* system VM, which holds the GC roots */
+    form_entry_t *most_recent, *least_recent;
+    form_entry_t *pending;	/* being rendered, not yet in the list */
+    int pending_tx, pending_ty;	/* where to paint it when it's done */
+    uint count;
+    size_t used;
+    long max_item;		/* MaxFormItem */
+    long max_size;		/* MaxFormCache */
+    gs_lib_ctx_budget_client_t *budget;
+    byte *key;			/* the key being built */
+    uint key_size, key_max;
+} form_cache_t;
+
+/* The graphics state part of the key. */
+typedef struct form_key_state_s {
+    const gx_device *dev;
+    int depth, num_components, polarity;
+    float mat[4];
+    struct {
+        gs_id space_id;
+        float values[GS_CLIENT_COLOR_MAX_COMPONENTS];
+    } color[2];
+    fixed fill_adjust_x, fill_adjust_y;
+    float flatness, smoothness;
+    int accurate_curves;
+    int stroke_adjust;
+    float half_width;
+    int start_cap, end_cap, dash_cap, join, curve_join;
+    float miter_limit;
+    float dot_length;
+    int dot_length_absolute;
+    float dot_orientation[4];
+    float dash_offset;
+    int dash_adapt;
+    gs_id font_id;
+    uint text_rendering_mode;
+    int renderingintent, blackptcomp;
+    gs_id transfer_ids[6];
+    uint dash_size;		/* the dash pattern follows */
+} form_key_state_t;
+
+/* Where the form is to be painted, in device space. */
+typedef struct form_place_s {
+    gs_matrix mat;		/* Matrix x CTM, translation removed */
+    gs_rect bbox;		/* the form's BBox */
+    int tx, ty;			/* the rounded translation */
+    int x, y, width, height;	/* the device box, relative to (tx, ty) */
+    uint raster, mask_raster;
+    size_t data_size;		/* of the bits and the mask */
+} form_place_t;
+
+static size_t form_cache_evict(void *, size_t);
+
+static form_cache_t *
+form_cache(i_ctx_t *i_ctx_p)
+{
+    form_cache_t *pfc = i_ctx_p->form_cache;
+
+    if (pfc == NULL) {
+        gs_memory_t *mem = imemory->non_gc_memory;
+
+        pfc = (form_cache_t *)gs_alloc_bytes(mem, sizeof(*pfc), "form_cache");
+        if (pfc == NULL)
+            return NULL;
+        memset(pfc, 0, sizeof(*pfc));
+        pfc->memory = mem;
+        pfc->root_memory = imemory_system;
+        pfc->max_item = FORM_CACHE_MAX_ITEM;
+        pfc->max_size = FORM_CACHE_MAX_SIZE;
+        pfc->budget = gs_lib_ctx_budget_register(mem, "form cache",
+                                                 GS_BUDGET_PRIORITY_FORM, false,
+                                                 form_cache_evict, pfc);
+        i_ctx_p->form_cache = pfc;
+    }
+    return pfc;
+}
+
+static void
+form_cache_free_entry(form_cache_t *pfc, form_entry_t *pe)
+{
+    if (pe->more_recent)
+        pe->more_recent->less_recent = pe->less_recent;
+    else
+        pfc->most_recent = pe->less_recent;
+    if (pe->less_recent)
+        pe->less_recent->more_recent = pe->more_recent;
+    else
+        pfc->least_recent = pe->more_recent;
+    gs_unregister_root(pfc->root_memory, &pe->root, "form_cache_free_entry");
+    pfc->used -= pe->size;
+    pfc->count--;
+    gs_free_object(pfc->memory, pe, "form_cache_free_entry");
+}
+
+/* Free entries, least recently used first, until at most 'size' is used. */
+static void
+form_cache_trim(form_cache_t *pfc, size_t size)
+{
+    while (pfc->used > size && pfc->least_recent != NULL)
+        form_cache_free_entry(pfc, pfc->least_recent);
+    gs_lib_ctx_budget_set_used(pfc->budget, pfc->used);
+}
+
+static size_t
+form_cache_evict(void *data, size_t wanted)
+{
+    form_cache_t *pfc = (form_cache_t *)data;
+    size_t start_used = pfc->used;
+
+    form_cache_trim(pfc, (wanted >= start_used ? 0 : start_used - wanted));
+    return start_used - pfc->used;
+}
+
+/* Drop the entries for forms that a restore is about to free. */
+void
+form_cache_restore(i_ctx_t *i_ctx_p, const alloc_save_t *asave)
+{
+    form_cache_t *pfc = i_ctx_p->form_cache;
+    form_entry_t *pe, *next;
+
+    if (pfc == NULL || pfc->count == 0)
+        return;
+    for (pe = pfc->most_recent; pe != NULL; pe = next) {
+        next = pe->less_recent;
+        if (alloc_is_since_save(pe->form.value.pdict, asave))
+            form_cache_free_entry(pfc, pe);
+    }
+    gs_lib_ctx_budget_set_used(pfc->budget, pfc->used);
+}
+
+void
+form_cache_release(i_ctx_t *i_ctx_p)
+{
+    form_cache_t *pfc = i_ctx_p->form_cache;
+
+    if (pfc == NULL)
+        return;
+    form_cache_trim(pfc, 0);
+    gs_lib_ctx_budget_unregister(pfc->budget);
+    gs_free_object(pfc->memory, pfc->pending, "form_cache_release(pending)");
+    gs_free_object(pfc->memory, pfc->key, "form_cache_release(key)");
+    gs_free_object(pfc->memory, pfc, "form_cache_release");
+    i_ctx_p->form_cache = NULL;
+}
+
+long
+form_cache_max_item(i_ctx_t *i_ctx_p)
+{
+    form_cache_t *pfc = form_cache(i_ctx_p);
+
+    return (pfc == NULL ? 0 : pfc->max_item);
+}
+int
+form_cache_set_max_item(i_ctx_t *i_ctx_p, long val)
+{
+    form_cache_t *pfc = form_cache(i_ctx_p);
+
+    if (pfc == NULL)
+        return_error(gs_error_VMerror);
+    pfc->max_item = val;
+    return 0;
+}
+long
+form_cache_max_size(i_ctx_t *i_ctx_p)
+{
+    form_cache_t *pfc = form_cache(i_ctx_p);
+
+    return (pfc == NULL ? 0 : pfc->max_size);
+}
+int
+form_cache_set_max_size(i_ctx_t *i_ctx_p, long val)
+{
+    form_cache_t *pfc = form_cache(i_ctx_p);
+
+    if (pfc == NULL)
+        return_error(gs_error_VMerror);
+    pfc->max_size = val;
+    form_cache_trim(pfc, (size_t)val);
+    return 0;
+}
+long
+form_cache_cur_size(i_ctx_t *i_ctx_p)
+{
+    form_cache_t *pfc = i_ctx_p->form_cache;
+
+    return (pfc == NULL ? 0 : (long)min(pfc->used, max_long));
+}
+
+/*
+ * Check whether painting the form through the cache would give the same
+ * result as running its PaintProc, and work out where it goes. Return 1 if
+ * it can be cached, 0 if not (including if the form is invalid: running
+ * the PaintProc in the usual way will report the error).
+ */
+static int
+form_cache_place(i_ctx_t *i_ctx_p, form_cache_t *pfc, const ref *pform,
+                 form_place_t *pfp)
+{
+    gs_gstate *pgs = igs;
+    gx_device *dev = gs_currentdevice_inline(pgs);
+    float BBox[4], Matrix[6];
+    gs_matrix fmat, ctm;
+    gs_rect dbox;
+    double tx, ty, x0, y0, x1, y1;
+    int depth = dev->color_info.depth;
+    size_t max_bitmap = (dev->MaxPatternBitmap == 0 ? MaxPatternBitmap_DEFAULT :
+                         dev->MaxPatternBitmap);
+    size_t bits_size, mask_size;
+    int i;
+
+    if (pfc->max_item <= 0 || pfc->max_size <= 0)
+        return 0;
+    if (!r_has_type(pform, t_dictionary) || !r_has_attr(dict_access_ref(pform), a_read))
+        return 0;
+    if (pgs->overprint || pgs->stroke_overprint || pgs->log_op != lop_default)
+        return 0;
+    for (i = 0; i < 2; i++)
+        if (pgs->color[i].ccolor == NULL || pgs->color[i].ccolor->pattern != NULL)
+            return 0;		/* Patterns are anchored to the page, not the form. */
+    if (dev->is_planar || device_encodes_tags(dev) ||
+        gx_device_must_halftone(dev) || dev->color_info.anti_alias.text_bits > 1 ||
+        dev_proc(dev, dev_spec_op)(dev, gxdso_in_pattern_accumulator, NULL, 0) > 0 ||
+        !gs_paint_mask_ok(pgs))
+        return 0;
+    if (dict_floats_param(imemory, pform, "BBox", 4, BBox, NULL) <= 0 ||
+        dict_floats_param(imemory, pform, "Matrix", 6, Matrix, NULL) <= 0)
+        return 0;
+    fmat.xx = Matrix[0];
+    fmat.xy = Matrix[1];
+    fmat.yx = Matrix[2];
+    fmat.yy = Matrix[3];
+    fmat.tx = Matrix[4];
+    fmat.ty = Matrix[5];
+    gs_currentmatrix(pgs, &ctm);
+    if (gs_matrix_multiply(&fmat, &ctm, &pfp->mat) < 0)
+        return 0;
+    /* Round the translation, keeping well within the fixed range. */
+    tx = floor(pfp->mat.tx + 0.5);
+    ty = floor(pfp->mat.ty + 0.5);
+    if (fabs(tx) > max_int_in_fixed / 2 || fabs(ty) > max_int_in_fixed / 2)
+        return 0;
+    pfp->mat.tx = pfp->mat.ty = 0;
+    pfp->bbox.p.x = min(BBox[0], BBox[2]);
+    pfp->bbox.p.y = min(BBox[1], BBox[3]);
+    pfp->bbox.q.x = max(BBox[0], BBox[2]);
+    pfp->bbox.q.y = max(BBox[1], BBox[3]);
+    if (gs_bbox_transform(&pfp->bbox, &pfp->mat, &dbox) < 0)
+        return 0;
+    /* Allow a pixel's margin for fill adjustment. */
+    x0 = floor(dbox.p.x) - 1;
+    y0 = floor(dbox.p.y) - 1;
+    x1 = ceil(dbox.q.x) + 1;
+    y1 = ceil(dbox.q.y) + 1;
+    if (x0 < -max_int_in_fixed / 2 || y0 < -max_int_in_fixed / 2 ||
+        x1 > max_int_in_fixed / 2 || y1 > max_int_in_fixed / 2 ||
+        (x1 - x0) * depth > pfc->max_item * 8.0 || y1 - y0 > pfc->max_item)
+        return 0;
+    pfp->tx = (int)tx;
+    pfp->ty = (int)ty;
+    pfp->x = (int)x0;
+    pfp->y = (int)y0;
+    pfp->width = (int)(x1 - x0);
+    pfp->height = (int)(y1 - y0);
+    pfp->raster = bitmap_raster(pfp->width * depth);
+    pfp->mask_raster = bitmap_raster(pfp->width);
+    bits_size = (size_t)pfp->raster * pfp->height;
+    mask_size = (size_t)pfp->mask_raster * pfp->height;
+    pfp->data_size = bits_size + mask_size;
+    /* The pattern accumulator must keep a bitmap, not a command list. */
+    if (pfp->data_size > (size_t)pfc->max_item || bits_size >= max_bitmap)
+        return 0;
+    return 1;
+}
+
+/* Build the key for the current graphics state. */
+static int
+form_cache_key(i_ctx_t *i_ctx_p, form_cache_t *pfc, const gs_matrix *pmat)
+{
+    gs_gstate *pgs = igs;
+    gx_device *dev = gs_currentdevice_inline(pgs);
+    const gx_line_params *plp = &pgs->line_params;
+    form_key_state_t ks;
+    uint dash_bytes, size;
+    int i;
+
+    memset(&ks, 0, sizeof(ks));
+    ks.dev = dev;
+    ks.depth = dev->color_info.depth;
+    ks.num_components = dev->color_info.num_components;
+    ks.polarity = dev->color_info.polarity;
+    ks.mat[0] = pmat->xx;
+    ks.mat[1] = pmat->xy;
+    ks.mat[2] = pmat->yx;
+    ks.mat[3] = pmat->yy;
+    for (i = 0; i < 2; i++) {
+        const gs_color_space *pcs = pgs->color[i].color_space;
+        const gs_client_color *pcc = pgs->color[i].ccolor;
+        int n = cs_num_components(pcs);
+
+        /* Only the components that the space uses have been set. */
+        if (n < 0)
+            n = -n - 1;
+        if (n > GS_CLIENT_COLOR_MAX_COMPONENTS)
+            n = GS_CLIENT_COLOR_MAX_COMPONENTS;
+        ks.color[i].space_id = pcs->id;
+        memcpy(ks.color[i].values, pcc->paint.values, n * sizeof(float));
+    }
+    ks.fill_adjust_x = pgs->fill_adjust.x;
+    ks.fill_adjust_y = pgs->fill_adjust.y;
+    ks.flatness = pgs->flatness;
+    ks.smoothness = pgs->smoothness;
+    ks.accurate_curves = pgs->accurate_curves;
+    ks.stroke_adjust = pgs->stroke_adjust;
+    ks.half_width = plp->half_width;
+    ks.start_cap = plp->start_cap;
+    ks.end_cap = plp->end_cap;
+    ks.dash_cap = plp->dash_cap;
+    ks.join = plp->join;
+    ks.curve_join = plp->curve_join;
+    ks.miter_limit = plp->miter_limit;
+    ks.dot_length = plp->dot_length;
+    ks.dot_length_absolute = plp->dot_length_absolute;
+    ks.dot_orientation[0] = plp->dot_orientation.xx;
+    ks.dot_orientation[1] = plp->dot_orientation.xy;
+    ks.dot_orientation[2] = plp->dot_orientation.yx;
+    ks.dot_orientation[3] = plp->dot_orientation.yy;
+    ks.dash_offset = plp->dash.offset;
+    ks.dash_adapt = plp->dash.adapt;
+    ks.font_id = (pgs->font == NULL ? gs_no_id : pgs->font->id);
+    ks.text_rendering_mode = pgs->text_rendering_mode;
+    ks.renderingintent = pgs->renderingintent;
+    ks.blackptcomp = pgs->blackptcomp;
+#define MAP_ID(map) ((map) == NULL ? gs_no_id : (map)->id)
+    ks.transfer_ids[0] = MAP_ID(pgs->set_transfer.gray);
+    ks.transfer_ids[1] = MAP_ID(pgs->set_transfer.red);
+    ks.transfer_ids[2] = MAP_ID(pgs->set_transfer.green);
+    ks.transfer_ids[3] = MAP_ID(pgs->set_transfer.blue);
+    ks.transfer_ids[4] = MAP_ID(pgs->black_generation);
+    ks.transfer_ids[5] = MAP_ID(pgs->undercolor_removal);
+#undef MAP_ID
+    ks.dash_size = plp->dash.pattern_size;
+    if (ks.dash_size > (max_uint - sizeof(ks)) / sizeof(float))
+        return_error(gs_error_limitcheck);
+    dash_bytes = ks.dash_size * sizeof(float);
+    size = sizeof(ks) + dash_bytes;
+    if (size > pfc->key_max) {
+        byte *new_key = gs_alloc_bytes(pfc->memory, size, "form_cache_key");
+
+        if (new_key == NULL)
+            return_error(gs_error_VMerror);
+        gs_free_object(pfc->memory, pfc->key, "form_cache_key");
+        pfc->key = new_key;
+        pfc->key_max = size;
+    }
+    memcpy(pfc->key, &ks, sizeof(ks));
+    if (dash_bytes != 0)
+        memcpy(pfc->key + sizeof(ks), plp->dash.pattern, dash_bytes);
+    pfc->key_size = size;
+    return 0;
+}
+
+static form_entry_t *
+form_cache_lookup(form_cache_t *pfc, const ref *pform)
+{
+    form_entry_t *pe;
+
+    for (pe = pfc->most_recent; pe != NULL; pe = pe->less_recent)
+        if (pe->form.value.pdict == pform->value.pdict &&
+            pe->key_size == pfc->key_size &&
+            !memcmp(form_entry_key(pe), pfc->key, pfc->key_size))
+            break;
+    if (pe != NULL && pe != pfc->most_recent) {
+        /* Move it to the front of the LRU list. */
+        pe->more_recent->less_recent = pe->less_recent;
+        if (pe->less_recent)
+            pe->less_recent->more_recent = pe->more_recent;
+        else
+            pfc->least_recent = pe->more_recent;
+        pe->more_recent = NULL;
+        pe->less_recent = pfc->most_recent;
+        pfc->most_recent->more_recent = pe;
+        pfc->most_recent = pe;
+    }
+    return pe;
+}
+
+/* Paint a cached form, with its origin at (tx, ty). */
+static int
+form_cache_paint(i_ctx_t *i_ctx_p, const form_entry_t *pe, int tx, int ty)
+{
+    return gs_paint_masked_bits(igs, form_entry_bits(pe), pe->raster,
+                                form_entry_mask(pe), pe->mask_raster, pe->id,
+                                tx + pe->x, ty + pe->y,
+                                pe->width, pe->height);
+}
+
+static int form_cache_finish(i_ctx_t *);
+static int form_cache_cleanup(i_ctx_t *);
+
+/*
+ * <form> .formcache true
+ * <form> .formcache <form> false
+ *
+ * Paint the form through the cache, rendering it first if need be. If
+ * the form can't be cached, leave it on the stack for the caller to paint
+ * in the usual way. A PaintProc that does an unmatched grestore paints
+ * some of the form on the device directly; we return true for that too,
+ * since running it again would paint it twice.
+ */
+static int
+zformcache(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    form_cache_t *pfc = form_cache(i_ctx_p);
+    gs_gstate *pgs = igs;
+    form_place_t place;
+    form_entry_t *pe;
+    gs_pattern1_instance_t *pinst;
+    gx_device_forward *pdev;
+    gs_fixed_rect cbox;
+    gs_matrix mat;
+    ref form, *ppp;
+    size_t size;
+    int level, code;
+
+    check_op(1);
+    if (pfc == NULL || pfc->pending != NULL ||
+        form_cache_place(i_ctx_p, pfc, op, &place) <= 0 ||
+        form_cache_key(i_ctx_p, pfc, &place.mat) < 0)
+        goto no_cache;
+    size = ROUND_UP(sizeof(form_entry_t) + pfc->key_size, align_bitmap_mod) +
+        place.data_size;
+    pe = form_cache_lookup(pfc, op);
+    if (pe != NULL) {
+        code = form_cache_paint(i_ctx_p, pe, place.tx, place.ty);
+        if (code < 0)
+            return code;
+        make_true(op);
+        return 0;
+    }
+    if (size > (size_t)pfc->max_item || size > (size_t)pfc->max_size ||
+        dict_find_string(op, "PaintProc", &ppp) <= 0)
+        goto no_cache;
+    check_estack(8);
+
+    /* Make room, in the memory budget and then within MaxFormCache. */
+    /* If the other caches can't give enough back, paint it uncached. */
+    if (!gs_lib_ctx_budget_reserve(pfc->budget, size))
+        goto no_cache;
+    form_cache_trim(pfc, (size_t)pfc->max_size - size);
+    pe = (form_entry_t *)gs_alloc_bytes(pfc->memory, size, "zformcache");
+    if (pe == NULL)
+        goto no_cache;
+    memset(pe, 0, sizeof(*pe));
+    pe->key_size = pfc->key_size;
+    pe->size = size;
+    pe->x = place.x;
+    pe->y = place.y;
+    pe->width = place.width;
+    pe->height = place.height;
+    pe->raster = place.raster;
+    pe->mask_raster = place.mask_raster;
+    memcpy(form_entry_key(pe), pfc->key, pfc->key_size);
+
+    /* Render the form into a pattern accumulator, as for a colored Pattern. */
+    pinst = gs_alloc_struct(imemory, gs_pattern1_instance_t, &st_pattern1_instance,
+                            "zformcache");
+    if (pinst == NULL) {
+        gs_free_object(pfc->memory, pe, "zformcache");
+        return_error(gs_error_VMerror);
+    }
+    memset(pinst, 0, sizeof(*pinst));
+    gs_pattern1_init(&pinst->templat);
+    pinst->type = pinst->templat.type;
+    pinst->templat.PaintType = 1;
+    pinst->templat.TilingType = 1;
+    pinst->saved = pgs;
+    pinst->uses_mask = true;
+    pinst->is_clist = false;
+    pinst->size.x = place.width;
+    pinst->size.y = place.height;
+    pinst->id = gs_next_ids(imemory, 1);
+    pdev = gx_pattern_accum_alloc(imemory, imemory, pinst, "zformcache");
+    if (pdev == NULL) {
+        gs_free_object(pfc->memory, pe, "zformcache");
+        return_error(gs_error_VMerror);
+    }
+    if (pinst->is_clist) {
+        /* Shouldn't happen, since we checked MaxPatternBitmap. */
+        gs_free_object(pfc->memory, pe, "zformcache");
+        goto no_cache;
+    }
+    code = (*dev_proc(pdev, open_device)) ((gx_device *)pdev);
+    if (code < 0) {
+        ifree_object(pdev, "zformcache");
+        gs_free_object(pfc->memory, pe, "zformcache");
+        return code;
+    }
+    level = pgs->level;
+    code = gs_gsave(pgs);
+    if (code < 0) {
+        (*dev_proc(pdev, close_device)) ((gx_device *)pdev);
+        gs_free_object(pfc->memory, pe, "zformcache");
+        return code;
+    }
+    gs_setdevice_no_init(pgs, (gx_device *)pdev);
+    mat = place.mat;
+    mat.tx = (float)-place.x;
+    mat.ty = (float)-place.y;
+    cbox.p.x = cbox.p.y = 0;
+    cbox.q.x = int2fixed(place.width);
+    cbox.q.y = int2fixed(place.height);
+    if ((code = gs_setmatrix(pgs, &mat)) < 0 ||
+        (code = gx_clip_to_rectangle(pgs, &cbox)) < 0 ||
+        (code = gs_rectclip(pgs, &place.bbox, 1)) < 0
+        ) {
+        (*dev_proc(pdev, close_device)) ((gx_device *)pdev);
+        gs_grestore(pgs);
+        gx_unset_dev_color(pgs);
+        gs_free_object(pfc->memory, pe, "zformcache");
+        return code;
+    }
+    pfc->pending = pe;
+    pfc->pending_tx = place.tx;
+    pfc->pending_ty = place.ty;
+    ref_assign(&form, op);
+    pop(1);
+    push_mark_estack(es_other, form_cache_cleanup);
+    ++esp;
+    make_istruct(esp, 0, pdev);
+    ++esp;
+    ref_assign(esp, &form);
+    ++esp;
+    make_int(esp, level);
+    ++esp;
+    /* Save operator stack depth in case PaintProc leaves junk on ostack. */
+    make_int(esp, ref_stack_count(&o_stack));
+    push_op_estack(form_cache_finish);
+    *++esp = *ppp;
+    *++esp = form;		/* (push on ostack) */
+    return o_push_estack;
+
+no_cache:
+    push(1);
+    make_false(op);
+    return 0;
+}
+
+/*
+ * Finish with the accumulator, putting the graphics state back as it was
+ * before the form was rendered.
+ */
+static int
+form_cache_end(i_ctx_t *i_ctx_p, gx_device *pdev, int level)
+{
+    int code = 0;
+
+    /* grestore will free the device, so close it first. */
+    (*dev_proc(pdev, close_device)) (pdev);
+    while (igs->level > level && igs->saved != NULL && code >= 0)
+        code = gs_grestore(igs);
+    gx_unset_dev_color(igs);	/* dev_color may need updating if GC ran */
+    return code;
+}
+
+/* Save the rendered form and paint it. */
+static int
+form_cache_finish(i_ctx_t *i_ctx_p)
+{
+    int o_stack_adjust = ref_stack_count(&o_stack) - esp->value.intval;
+    int level = (int)esp[-1].value.intval;
+    gx_device_pattern_accum *padev = r_ptr(esp - 3, gx_device_pattern_accum);
+    form_cache_t *pfc = i_ctx_p->form_cache;
+    form_entry_t *pe = pfc->pending;
+    ref form;
+    os_ptr op;
+    bool painted;
+    int code, y;
+
+    ref_assign(&form, esp - 2);
+    if (o_stack_adjust > 0)
+        pop(o_stack_adjust);
+    op = osp;
+    pfc->pending = NULL;
+    /*
+     * If the PaintProc did an unmatched grestore (or set another device),
+     * some of the form has gone to the real device already, so we can't
+     * cache it, and mustn't run it again either.
+     */
+    painted = igs->level <= level || gs_currentdevice_inline(igs) != (gx_device *)padev;
+    if (!painted && padev->bits != NULL && padev->mask != NULL) {
+        for (y = 0; y < pe->height; y++) {
+            memcpy(form_entry_bits(pe) + (size_t)y * pe->raster,
+                   scan_line_base(padev->bits, y), min(pe->raster, padev->bits->raster));
+            memcpy(form_entry_mask(pe) + (size_t)y * pe->mask_raster,
+                   scan_line_base(padev->mask, y), min(pe->mask_raster, padev->mask->raster));
+        }
+    } else {
+        /*
+         * After an unmatched grestore, whatever was drawn before it is
+         * still in the accumulator: put that on the real device too.
+         * It ends up on top of what was drawn after the grestore, but
+         * that's better than losing it.
+         */
+        if (igs->level <= level && padev->bits != NULL && padev->mask != NULL &&
+            gs_currentdevice_inline(igs) == padev->bits->target) {
+            code = gs_paint_masked_bits(igs, scan_line_base(padev->bits, 0),
+                                        padev->bits->raster,
+                                        scan_line_base(padev->mask, 0),
+                                        padev->mask->raster, gs_no_id,
+                                        pfc->pending_tx + pe->x,
+                                        pfc->pending_ty + pe->y,
+                                        pe->width, pe->height);
+            if (code < 0) {
+                gs_free_object(pfc->memory, pe, "form_cache_finish");
+                esp -= 5;
+                form_cache_end(i_ctx_p, (gx_device *)padev, level);
+                return code;
+            }
+        }
+        gs_free_object(pfc->memory, pe, "form_cache_finish");
+        pe = NULL;
+    }
+    esp -= 5;
+    code = form_cache_end(i_ctx_p, (gx_device *)padev, level);
+    if (code < 0 || pe == NULL) {
+        gs_free_object(pfc->memory, pe, "form_cache_finish");
+        if (code < 0)
+            return code;
+        if (painted) {
+            push(1);
+            make_true(op);
+        } else {
+            push(2);
+            ref_assign(op - 1, &form);
+            make_false(op);
+        }
+        return o_pop_estack;
+    }
+    /* Keep the form dictionary alive for as long as the entry. */
+    pe->form = form;
+    pe->pform = &pe->form;
+    {
+        gs_gc_root_t *proot = &pe->root;
+
+        code = gs_register_ref_root(pfc->root_memory, &proot,
+                                    (void **)&pe->pform, "form_cache_finish");
+    }
+    if (code < 0) {
+        gs_free_object(pfc->memory, pe, "form_cache_finish");
+        return code;
+    }
+    pe->id = gs_next_ids(imemory, 1);
+    pe->more_recent = NULL;
+    pe->less_recent = pfc->most_recent;
+    if (pfc->most_recent)
+        pfc->most_recent->more_recent = pe;
+    else
+        pfc->least_recent = pe;
+    pfc->most_recent = pe;
+    pfc->used += pe->size;
+    pfc->count++;
+    gs_lib_ctx_budget_set_used(pfc->budget, pfc->used);
+    code = form_cache_paint(i_ctx_p, pe, pfc->pending_tx, pfc->pending_ty);
+    if (code < 0)
+        return code;
+    push(1);
+    make_true(op);
+    return o_pop_estack;
+}
+
+/* Clean up after an error while rendering a form. */
+static int
+form_cache_cleanup(i_ctx_t *i_ctx_p)
+{
+    gx_device *pdev = r_ptr(esp + 2, gx_device);
+    int level = (int)esp[4].value.intval;
+    form_cache_t *pfc = i_ctx_p->form_cache;
+
+    if (pfc != NULL) {
+        gs_free_object(pfc->memory, pfc->pending, "form_cache_cleanup");
+        pfc->pending = NULL;
+    }
+    return form_cache_end(i_ctx_p, pdev, level);
+}
+
 const op_def zform_op_defs[] =
 {
     {"0.beginform", zbeginform},
     {"0.endform", zendform},
     {"0.get_form_id", zget_form_id},
     {"3.repeatform", zrepeatform},
+    {"1.formcache", zformcache},
+    {"0%form_cache_finish", form_cache_finish},
 op_def_end(0)
 };
@@ -121,7 +121,9 @@ set_language_level(i_ctx_t *i_ctx_p, int new_level)
                 if (code > 0) {
                     if (!r_has_type(pdict, t_dictionary))
                         return_error(gs_error_typecheck);
+                    dstack_dict_popped(pgdict);
                     *pgdict = *pdict;
+                    dstack_dict_pushed(pgdict);
                 }
                 /* Set other flags for Level 2 operation. */
                 imemory->gs_lib_ctx->dict_auto_expand = true;
@@ -154,7 +156,9 @@ set_language_level(i_ctx_t *i_ctx_p, int new_level)
                     if (r_has_type(&elt[0], t_name))
                         name_invalidate_value_cache(imemory, &elt[0]);
                 /* Overwrite globaldict in the dictionary stack. */
+                dstack_dict_popped(pgdict);
                 *pgdict = *systemdict;
+                dstack_dict_pushed(pgdict);
                 /* Set other flags for Level 1 operation. */
                 imemory->gs_lib_ctx->dict_auto_expand = false;
                 }
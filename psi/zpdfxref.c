@@ -0,0 +1,541 @@
+/* Copyright (C) 2001-2021 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Cross-reference and object reading operators for the PDF interpreter */
+#include "memory_.h"
+#include "ghost.h"
+#include "oper.h"
+#include "gsstruct.h"		/* for iscan.h */
+#include "stream.h"
+#include "strimpl.h"		/* for sfilter.h */
+#include "sfilter.h"		/* for iscan.h */
+#include "files.h"
+#include "ialloc.h"
+#include "iddict.h"
+#include "iname.h"
+#include "iparray.h"
+#include "iscan.h"
+#include "istack.h"
+#include "store.h"
+
+/*
+ * The PDF interpreter (pdf_base.ps, pdf_main.ps) keeps the cross-reference
+ * table in three PostScript objects, Objects, Generations and ObjectStream,
+ * which are described in pdf_base.ps.  The operators here fill those tables
+ * and read objects much faster than the equivalent PostScript procedures,
+ * but only for input that is well formed.  Whenever they meet something
+ * unusual they hand the work back to the PostScript code, which still
+ * does all the error reporting and recovery.
+ */
+
+/* ------ Cross-reference tables ------ */
+
+/* Check the Objects, Generations and ObjectStream operands. */
+static int
+pdf_check_xref_tables(const ref *ptables)
+{
+    check_write_type(ptables[0], t_array);
+    if (r_has_type(&ptables[1], t_string))
+        check_write(ptables[1]);
+    else
+        check_write_type(ptables[1], t_array);
+    check_write_type(ptables[2], t_array);
+    return 0;
+}
+
+/*
+ * Enter an xref entry the way setxrefentry in pdf_rbld.ps does when it is
+ * not rebuilding the table: the entry is only stored if the object has no
+ * entry yet, so entries from newer sections take precedence.  Return 1,
+ * storing nothing, if the entry needs the PostScript code (to report an
+ * error, or to turn the Generations string into an array).
+ */
+static int
+pdf_set_xref_entry(i_ctx_t *i_ctx_p, ref *ptables, ps_int num, ps_int strm,
+                   ps_int loc, ps_int gen)
+{
+    ref *pobjs = &ptables[0], *pgens = &ptables[1], *pstrms = &ptables[2];
+    ref value;
+
+    if (num < 0 || num >= r_size(pobjs) || num >= r_size(pgens) ||
+        num >= r_size(pstrms))
+        return 1;
+    if (gen < 0 || gen > 65535 ||
+        (r_has_type(pgens, t_string) && gen + 1 > 255))
+        return 1;
+    if (!r_has_type(&pobjs->value.refs[num], t_null))
+        return 0;
+    make_int(&value, strm);
+    r_set_attrs(&value, a_executable);
+    ref_assign_old(pstrms, &pstrms->value.refs[num], &value,
+                   "pdf_set_xref_entry");
+    make_int(&value, loc);
+    r_set_attrs(&value, a_executable);
+    ref_assign_old(pobjs, &pobjs->value.refs[num], &value,
+                   "pdf_set_xref_entry");
+    if (r_has_type(pgens, t_string))
+        pgens->value.bytes[num] = (byte)(gen + 1);
+    else {
+        make_int(&value, gen + 1);
+        ref_assign_old(pgens, &pgens->value.refs[num], &value,
+                       "pdf_set_xref_entry");
+    }
+    return 0;
+}
+
+/* Return the value of a field of decimal digits. */
+static ps_int
+pdf_xref_digits(const byte *p, int n)
+{
+    ps_int v = 0;
+
+    for (; n > 0; p++, n--)
+        v = v * 10 + (*p - '0');
+    return v;
+}
+
+/*
+ * Check that an entry in an original (pre PDF 1.5) xref table has exactly
+ * the form the specification requires: nnnnnnnnnn ggggg n|f followed by
+ * two white space characters.
+ */
+static bool
+pdf_xref_line_ok(const byte *line)
+{
+    int i;
+
+    for (i = 0; i < 18; i++) {
+        byte c = line[i];
+
+        if (i == 10 || i == 16) {
+            if (c != ' ')
+                return false;
+        } else if (i == 17) {
+            if (c != 'n' && c != 'f')
+                return false;
+        } else if (c < '0' || c > '9')
+            return false;
+    }
+    return line[18] <= ' ' && line[19] <= ' ';
+}
+
+/*
+ * <file> <obj#> <count> <Objects> <Generations> <ObjectStream>
+ *   .pdfreadxref <obj#'> <count'>
+ *
+ * Read the entries of an original xref table subsection into the xref
+ * tables.  We stop early, leaving the file positioned at the start of the
+ * entry, if the entry is not exactly 20 bytes long or is anything other
+ * than an ordinary in use or free entry; readxrefentry in pdf_main.ps
+ * deals with that entry, and then calls us again for the rest.
+ */
+static int
+zpdfreadxref(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    stream *s;
+    ps_int num, count;
+    int code;
+
+    check_read_file(i_ctx_p, s, op - 5);
+    check_type(op[-4], t_integer);
+    check_type(op[-3], t_integer);
+    code = pdf_check_xref_tables(op - 2);
+    if (code < 0)
+        return code;
+    num = op[-4].value.intval;
+    count = op[-3].value.intval;
+    if (count < 0)
+        return_error(gs_error_rangecheck);
+    if (sseekable(s)) {
+        while (count > 0) {
+            gs_offset_t pos = stell(s);
+            byte line[20];
+            uint n;
+
+            sgets(s, line, 20, &n);
+            if (n < 20 || !pdf_xref_line_ok(line)) {
+                sseek(s, pos);
+                break;
+            }
+            if (line[17] == 'n') {
+                ps_int loc = pdf_xref_digits(line, 10);
+
+                if (loc == 0 ||
+                    pdf_set_xref_entry(i_ctx_p, op - 2, num, 0, loc,
+                                       pdf_xref_digits(line + 11, 5))) {
+                    sseek(s, pos);
+                    break;
+                }
+            }
+            num++;
+            count--;
+        }
+    }
+    make_int(op - 5, num);
+    make_int(op - 4, count);
+    pop(4);
+    return 0;
+}
+
+/* Read a big-endian field of an xref stream entry. */
+static int
+pdf_xref_field(stream *s, ps_int width, ps_int *pvalue)
+{
+    ps_uint v = 0;
+
+    for (; width > 0; width--) {
+        int c = sgetc(s);
+
+        if (c < 0)
+            return_error(gs_error_ioerror);
+        v = (v << 8) + c;
+    }
+    *pvalue = (ps_int)v;
+    return 0;
+}
+
+/*
+ * <file> <W> <obj#> <count> <Objects> <Generations> <ObjectStream>
+ *   .pdfreadxrefstm <obj#'> <count'> true
+ * <file> <W> <obj#> <count> <Objects> <Generations> <ObjectStream>
+ *   .pdfreadxrefstm <obj#'> <count'> <type> <field 2> <field 3> false
+ *
+ * Read the entries of one Index range of a PDF 1.5 xref stream into the
+ * xref tables.  An entry we can't store ourselves is returned instead,
+ * with the number of entries that follow it, for the procedures in
+ * xref15entryhandlers in pdf_main.ps.
+ */
+static int
+zpdfreadxrefstm(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    stream *s;
+    ps_int w[3], num, count, type, f2, f3;
+    int i, code;
+
+    check_read_file(i_ctx_p, s, op - 6);
+    check_read_type(op[-5], t_array);
+    if (r_size(op - 5) != 3)
+        return_error(gs_error_rangecheck);
+    for (i = 0; i < 3; i++) {
+        const ref *pw = op[-5].value.const_refs + i;
+
+        check_type(*pw, t_integer);
+        w[i] = pw->value.intval;
+    }
+    check_type(op[-4], t_integer);
+    check_type(op[-3], t_integer);
+    code = pdf_check_xref_tables(op - 2);
+    if (code < 0)
+        return code;
+    num = op[-4].value.intval;
+    count = op[-3].value.intval;
+    for (; count > 0; num++, count--) {
+        /* If the type field is omitted, the type is 1. */
+        type = 1;
+        if (w[0] > 0 && (code = pdf_xref_field(s, w[0], &type)) < 0)
+            return code;
+        if ((code = pdf_xref_field(s, w[1], &f2)) < 0 ||
+            (code = pdf_xref_field(s, w[2], &f3)) < 0)
+            return code;
+        switch (type) {
+            case 0:		/* free */
+                continue;
+            case 1:		/* in use: offset, generation */
+                if (pdf_set_xref_entry(i_ctx_p, op - 2, num, 0, f2, f3))
+                    break;
+                continue;
+            case 2:		/* compressed: object stream, index */
+                if (pdf_set_xref_entry(i_ctx_p, op - 2, num, f2, f3, 0))
+                    break;
+                continue;
+        }
+        make_int(op - 6, num);
+        make_int(op - 5, count - 1);
+        make_int(op - 4, type);
+        make_int(op - 3, f2);
+        make_int(op - 2, f3);
+        make_false(op - 1);
+        pop(1);
+        return 0;
+    }
+    make_int(op - 6, num);
+    make_int(op - 5, count);
+    make_true(op - 4);
+    pop(4);
+    return 0;
+}
+
+/* ------ Objects ------ */
+
+/* Push a ref on the operand stack, extending it if necessary. */
+static int
+pdf_push(i_ctx_t *i_ctx_p, const ref *pref)
+{
+    int code = ref_stack_push(&o_stack, 1);
+
+    if (code < 0)
+        return code;
+    ref_assign(osp, pref);
+    return 0;
+}
+
+/* Handle a scan_Refill from the scanner.  Return 0 to carry on. */
+static int
+pdf_scan_refill(stream *s)
+{
+    uint avail = sbufavailable(s);
+    int status;
+
+    if (s->end_status == EOFC)
+        return -1;
+    status = s_process_read_buf(s);
+    if (sbufavailable(s) > avail)
+        return 0;
+    if (status == 0)
+        status = s->end_status;
+    return (status == 0 || status == EOFC ? 0 : -1);
+}
+
+/* Check whether the string of an executable name is a given keyword. */
+static bool
+pdf_keyword_is(const ref *pstr, const char *keyword)
+{
+    uint size = strlen(keyword);
+
+    return r_size(pstr) == size && !memcmp(pstr->value.const_bytes, keyword, size);
+}
+
+/*
+ * Read objects from a file, doing what .pdfrun does with resolveopdict
+ * (if objstm is false) or resolveobjstreamopdict (if objstm is true) for
+ * the ordinary PDF syntax: numbers, strings, names, arrays, dictionaries,
+ * indirect references, true, false and null.  We stop at 'endobj' after a
+ * single object, or at the end of the data of an object stream.  Anything
+ * else (a stream, a name with a # escape, a missing or extra token, a
+ * syntax error) makes us put the file back where it was and return 0, so
+ * that the PostScript code can read the data itself and report whatever
+ * is wrong with it.  Otherwise return 1, with the objects pushed on the
+ * operand stack.
+ */
+static int
+pdf_read_objects(i_ctx_t *i_ctx_p, const ref *pfile, stream *s, bool objstm)
+{
+    uint base = ref_stack_count(&o_stack);
+    int options = i_ctx_p->scanner_options;
+    gs_offset_t pos;
+    scanner_state state;
+    ref token, nstr;
+    uint depth, count, i;
+    int code;
+
+    if (!sseekable(s))
+        return 0;
+    pos = stell(s);
+    i_ctx_p->scanner_options |= SCAN_PDF_RULES;
+    gs_scanner_init(&state, pfile);
+    for (;;) {
+        code = gs_scan_token(i_ctx_p, &token, &state);
+        if (code == scan_Refill) {
+            if (pdf_scan_refill(s) < 0)
+                goto fail;
+            continue;
+        }
+        depth = ref_stack_count(&o_stack) - base;
+        if (code == scan_EOF) {
+            if (!objstm)
+                goto fail;
+            for (i = 0; i < depth; i++)
+                if (r_has_type(ref_stack_index(&o_stack, i), t_mark))
+                    goto fail;
+            break;
+        }
+        if (code != 0)
+            goto fail;
+        switch (r_type(&token)) {
+            case t_integer:
+            case t_real:
+            case t_string:
+                break;
+            case t_name:
+                name_string_ref(imemory, &token, &nstr);
+                if (!r_has_attr(&token, a_executable)) {
+                    /* Leave #nn escapes to .pdffixname. */
+                    if (memchr(nstr.value.const_bytes, '#', r_size(&nstr)))
+                        goto fail;
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "<<") || pdf_keyword_is(&nstr, "[")) {
+                    make_mark(&token);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "true")) {
+                    make_true(&token);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "false")) {
+                    make_false(&token);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "null")) {
+                    make_null(&token);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "R")) {
+                    /* <obj#> <gen#> R => {<obj#> <gen#> resolveR} */
+                    if (depth < 2 ||
+                        !r_has_type(ref_stack_index(&o_stack, 0), t_integer) ||
+                        !r_has_type(ref_stack_index(&o_stack, 1), t_integer))
+                        goto fail;
+                    code = name_ref(imemory, (const byte *)"resolveR", 8,
+                                    &token, 1);
+                    if (code < 0)
+                        goto fail;
+                    r_set_attrs(&token, a_executable);
+                    if (pdf_push(i_ctx_p, &token) < 0 ||
+                        make_packed_array(&token, &o_stack, 3, idmemory,
+                                          "pdf_read_objects") < 0)
+                        goto fail;
+                    r_set_attrs(&token, a_executable);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, "]")) {
+                    /* counttomark array astore exch pop */
+                    count = ref_stack_counttomark(&o_stack);
+                    if (count == 0 || count > depth)
+                        goto fail;
+                    count--;
+                    if (ialloc_ref_array(&token, a_all, count,
+                                         "pdf_read_objects") < 0 ||
+                        ref_stack_store(&o_stack, &token, count, 0, 1, true,
+                                        idmemory, "pdf_read_objects") < 0)
+                        goto fail;
+                    ref_stack_pop(&o_stack, count + 1);
+                    break;
+                }
+                if (pdf_keyword_is(&nstr, ">>")) {
+                    /* .dicttomark, with later keys taking precedence */
+                    count = ref_stack_counttomark(&o_stack);
+                    if (count == 0 || count > depth || (count & 1) == 0)
+                        goto fail;
+                    count--;
+                    if (dict_create(count >> 1, &token) < 0)
+                        goto fail;
+                    for (i = count; i > 0; i -= 2)
+                        if (idict_put(&token, ref_stack_index(&o_stack, i - 1),
+                                      ref_stack_index(&o_stack, i - 2)) < 0)
+                            goto fail;
+                    ref_stack_pop(&o_stack, count + 1);
+                    break;
+                }
+                if (!objstm && pdf_keyword_is(&nstr, "endobj")) {
+                    if (depth != 1 ||
+                        r_has_type(ref_stack_index(&o_stack, 0), t_mark))
+                        goto fail;
+                    goto done;
+                }
+                goto fail;
+            default:
+                goto fail;
+        }
+        if (pdf_push(i_ctx_p, &token) < 0)
+            goto fail;
+    }
+done:
+    i_ctx_p->scanner_options = options;
+    return 1;
+fail:
+    i_ctx_p->scanner_options = options;
+    ref_stack_pop_to(&o_stack, base);
+    sseek(s, pos);
+    return 0;
+}
+
+/*
+ * <file> .pdfreadobj <object> true
+ * <file> .pdfreadobj <file> false
+ *
+ * Read an indirect object up to its 'endobj', the file being positioned
+ * just after 'obj'.  If we return false the file is where it was, ready
+ * for resolveopdict .pdfrun.
+ */
+static int
+zpdfreadobj(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    stream *s;
+    ref file;
+
+    check_read_file(i_ctx_p, s, op);
+    ref_assign(&file, op);
+    if (pdf_read_objects(i_ctx_p, &file, s, false)) {
+        ref_assign(ref_stack_index(&o_stack, 1), ref_stack_index(&o_stack, 0));
+        make_true(ref_stack_index(&o_stack, 0));
+    } else {
+        ref rfalse;
+
+        make_false(&rfalse);
+        return pdf_push(i_ctx_p, &rfalse);
+    }
+    return 0;
+}
+
+/*
+ * <file> .pdfreadobjstm <object_1> ... <object_n> true
+ * <file> .pdfreadobjstm <file> false
+ *
+ * Read the objects of a decoded object stream, the file being positioned
+ * at the first of them.  If we return false the file is where it was,
+ * ready for resolveobjstreamopdict .pdfrun.
+ */
+static int
+zpdfreadobjstm(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    stream *s;
+    ref file;
+    uint count, i;
+
+    check_read_file(i_ctx_p, s, op);
+    ref_assign(&file, op);
+    count = ref_stack_count(&o_stack);
+    if (pdf_read_objects(i_ctx_p, &file, s, true)) {
+        /* Slide the objects down over the file. */
+        count = ref_stack_count(&o_stack) - count;
+        for (i = count; i > 0; i--)
+            ref_assign(ref_stack_index(&o_stack, i),
+                       ref_stack_index(&o_stack, i - 1));
+        make_true(ref_stack_index(&o_stack, 0));
+    } else {
+        ref rfalse;
+
+        make_false(&rfalse);
+        return pdf_push(i_ctx_p, &rfalse);
+    }
+    return 0;
+}
+
+/* ------ Initialization procedure ------ */
+
+const op_def zpdfxref_op_defs[] =
+{
+    {"1.pdfreadobj", zpdfreadobj},
+    {"1.pdfreadobjstm", zpdfreadobjstm},
+    {"6.pdfreadxref", zpdfreadxref},
+    {"7.pdfreadxrefstm", zpdfreadxrefstm},
+    op_def_end(0)
+};
@@ -15,6 +15,8 @@
 
 
 /* Operators related to user paths */
+#include "math_.h"
+#include "memory_.h"
 #include "ghost.h"
 #include "oper.h"
 #include "oparc.h"
@@ -35,6 +37,11 @@
 #include "gspath.h"
 #include "gzpath.h"		/* for saving path */
 #include "gzstate.h"		/* for accessing path */
+#include "gsutil.h"
+#include "gxbitmap.h"
+#include "gslibctx.h"
+#include "icstate.h"
+#include "iupath.h"
 
 /* Imported data */
 extern const gx_device gs_hit_device;
@@ -54,6 +61,7 @@ extern const int gs_hit_detected;
 /* Forward references */
 static int upath_append(os_ptr, i_ctx_t *, bool);
 static int upath_stroke(i_ctx_t *, gs_matrix *, bool);
+static int upath_cache_paint(i_ctx_t *, os_ptr, const gs_matrix *, int);
 
 /* ---------------- Insideness testing ---------------- */
 
@@ -374,7 +382,9 @@ zueofill(i_ctx_t *i_ctx_p)
 
     if (code < 0)
         return code;
-    if ((code = upath_append(op, i_ctx_p, gs_currentcpsimode(imemory))) >= 0)
+    code = upath_cache_paint(i_ctx_p, op, NULL, gx_rule_even_odd);
+    if (code == 0 &&
+        (code = upath_append(op, i_ctx_p, gs_currentcpsimode(imemory))) >= 0)
         code = gs_eofill(igs);
     gs_grestore(igs);
     if (code < 0)
@@ -392,7 +402,9 @@ zufill(i_ctx_t *i_ctx_p)
 
     if (code < 0)
         return code;
-    if ((code = upath_append(op, i_ctx_p, gs_currentcpsimode(imemory))) >= 0)
+    code = upath_cache_paint(i_ctx_p, op, NULL, gx_rule_winding_number);
+    if (code == 0 &&
+        (code = upath_append(op, i_ctx_p, gs_currentcpsimode(imemory))) >= 0)
         code = gs_fill(igs);
     gs_grestore(igs);
     if (code < 0)
@@ -408,10 +420,15 @@ zustroke(i_ctx_t *i_ctx_p)
 {
     int code = gs_gsave(igs);
     int npop;
+    gs_matrix mat;
 
     if (code < 0)
         return code;
-    if ((code = npop = upath_stroke(i_ctx_p, NULL, gs_currentcpsimode(imemory))) >= 0)
+    npop = (read_matrix(imemory, osp, &mat) >= 0 ? 2 : 1);
+    code = upath_cache_paint(i_ctx_p, osp - (npop - 1),
+                             (npop > 1 ? &mat : NULL), 0);
+    if (code == 0 &&
+        (code = npop = upath_stroke(i_ctx_p, NULL, gs_currentcpsimode(imemory))) >= 0)
         code = gs_stroke(igs);
     gs_grestore(igs);
     if (code < 0)
@@ -869,6 +886,584 @@ upath_stroke(i_ctx_t *i_ctx_p, gs_matrix *pmat, bool upath_compat)
     return (code < 0 ? code : npop);
 }
 
+/* ---------------- User path cache ---------------- */
+
+/*
+ * User paths that begin with ucache are cached by ufill, ueofill and
+ * ustroke, as the monobit mask that painting them produces, much as the
+ * character cache keeps glyphs. The key is the contents of the user path
+ * and the parts of the graphics state that shape the mask: the linear part
+ * of the CTM, the fill rule or the stroke parameters, and the flatness and
+ * fill adjustment. So that one mask serves every placement, cached user
+ * paths are painted with the CTM translation rounded to a whole device
+ * pixel, as the PLRM allows. MaxUPathItem limits the size of one entry and
+ * MaxUPathCache the total, and at most UPATH_CACHE_MAX_COUNT entries are
+ * kept; the cache also gives memory back to the memory budget when asked.
+ * Paths that aren't cached are painted as before.
+ */
+
+/* Default values of MaxUPathItem and MaxUPathCache, in bytes. */
+#define UPATH_CACHE_MAX_ITEM 20000
+#define UPATH_CACHE_MAX_SIZE 4000000
+/* The most entries the cache holds (rmax in ucachestatus). */
+#define UPATH_CACHE_MAX_COUNT 1000
+#define UPATH_CACHE_HASH_SIZE 1024	/* must be a power of 2 */
+
+typedef struct upath_entry_s upath_entry_t;
+struct upath_entry_s {
+    upath_entry_t *next;	/* in hash chain */
+    upath_entry_t *more_recent, *less_recent;
+    uint hash;
+    uint key_size;
+    size_t size;		/* of the whole entry */
+    gs_id id;
+    int x, y;			/* mask origin relative to the translation */
+    int width, height;
+    uint raster;
+    /* The key and then the mask follow. */
+};
+#define upath_entry_key(pe) ((byte *)((pe) + 1))
+#define upath_entry_bits(pe)\
+  (upath_entry_key(pe) + ROUND_UP((pe)->key_size, align_bitmap_mod))
+
+typedef struct upath_cache_s {
+    gs_memory_t *memory;	/* non-GC */
+    upath_entry_t **table;	/* allocated when first needed */
+    upath_entry_t *most_recent, *least_recent;
+    uint count;
+    size_t used;
+    long max_item;		/* MaxUPathItem */
+    long max_size;		/* MaxUPathCache */
+    uint max_count;		/* entries */
+    gs_lib_ctx_budget_client_t *budget;
+    byte *key;			/* the key being built */
+    uint key_size, key_max;
+} upath_cache_t;
+
+/* The graphics state part of the key (all zero where it doesn't apply). */
+typedef struct upath_key_state_s {
+    int rule;			/* 0 for ustroke */
+    int compat;
+    float ctm[4];
+    float mat[6];		/* ustroke matrix, or zero */
+    fixed fill_adjust_x, fill_adjust_y;
+    float flatness;
+    int accurate_curves;
+    int stroke_adjust;
+    float half_width;
+    int start_cap, end_cap, dash_cap, join, curve_join;
+    float miter_limit;
+    float dot_length;
+    int dot_length_absolute;
+    float dot_orientation[4];
+    float dash_offset;
+    int dash_adapt;
+    uint dash_size;		/* the dash pattern follows */
+} upath_key_state_t;
+
+static size_t upath_cache_evict(void *, size_t);
+
+static upath_cache_t *
+upath_cache(i_ctx_t *i_ctx_p)
+{
+    upath_cache_t *puc = i_ctx_p->upath_cache;
+
+    if (puc == NULL) {
+        gs_memory_t *mem = imemory->non_gc_memory;
+
+        puc = (upath_cache_t *)gs_alloc_bytes(mem, sizeof(*puc), "upath_cache");
+        if (puc == NULL)
+            return NULL;
+        memset(puc, 0, sizeof(*puc));
+        puc->memory = mem;
+        puc->max_item = UPATH_CACHE_MAX_ITEM;
+        puc->max_size = UPATH_CACHE_MAX_SIZE;
+        puc->max_count = UPATH_CACHE_MAX_COUNT;
+        puc->budget = gs_lib_ctx_budget_register(mem, "user path cache",
+                                                 GS_BUDGET_PRIORITY_UPATH, false,
+                                                 upath_cache_evict, puc);
+        i_ctx_p->upath_cache = puc;
+    }
+    return puc;
+}
+
+static void
+upath_cache_free_entry(upath_cache_t *puc, upath_entry_t *pe)
+{
+    upath_entry_t **ppe = &puc->table[pe->hash & (UPATH_CACHE_HASH_SIZE - 1)];
+
+    while (*ppe != pe)
+        ppe = &(*ppe)->next;
+    *ppe = pe->next;
+    if (pe->more_recent)
+        pe->more_recent->less_recent = pe->less_recent;
+    else
+        puc->most_recent = pe->less_recent;
+    if (pe->less_recent)
+        pe->less_recent->more_recent = pe->more_recent;
+    else
+        puc->least_recent = pe->more_recent;
+    puc->used -= pe->size;
+    puc->count--;
+    gs_free_object(puc->memory, pe, "upath_cache_free_entry");
+}
+
+/*
+ * Free entries, least recently used first, until at most 'size' is used
+ * and at most 'count' entries are left.
+ */
+static void
+upath_cache_trim(upath_cache_t *puc, size_t size, uint count)
+{
+    while ((puc->used > size || puc->count > count) &&
+           puc->least_recent != NULL)
+        upath_cache_free_entry(puc, puc->least_recent);
+    gs_lib_ctx_budget_set_used(puc->budget, puc->used);
+}
+
+static size_t
+upath_cache_evict(void *data, size_t wanted)
+{
+    upath_cache_t *puc = (upath_cache_t *)data;
+    size_t start_used = puc->used;
+
+    upath_cache_trim(puc, (wanted >= start_used ? 0 : start_used - wanted),
+                     puc->count);
+    return start_used - puc->used;
+}
+
+void
+upath_cache_release(i_ctx_t *i_ctx_p)
+{
+    upath_cache_t *puc = i_ctx_p->upath_cache;
+
+    if (puc == NULL)
+        return;
+    upath_cache_trim(puc, 0, 0);
+    gs_lib_ctx_budget_unregister(puc->budget);
+    gs_free_object(puc->memory, puc->table, "upath_cache_release(table)");
+    gs_free_object(puc->memory, puc->key, "upath_cache_release(key)");
+    gs_free_object(puc->memory, puc, "upath_cache_release");
+    i_ctx_p->upath_cache = NULL;
+}
+
+long
+upath_cache_max_item(i_ctx_t *i_ctx_p)
+{
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+
+    return (puc == NULL ? 0 : puc->max_item);
+}
+int
+upath_cache_set_max_item(i_ctx_t *i_ctx_p, long val)
+{
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+
+    if (puc == NULL)
+        return_error(gs_error_VMerror);
+    puc->max_item = val;
+    return 0;
+}
+long
+upath_cache_max_size(i_ctx_t *i_ctx_p)
+{
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+
+    return (puc == NULL ? 0 : puc->max_size);
+}
+int
+upath_cache_set_max_size(i_ctx_t *i_ctx_p, long val)
+{
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+
+    if (puc == NULL)
+        return_error(gs_error_VMerror);
+    puc->max_size = val;
+    upath_cache_trim(puc, (size_t)val, puc->max_count);
+    return 0;
+}
+long
+upath_cache_cur_size(i_ctx_t *i_ctx_p)
+{
+    upath_cache_t *puc = i_ctx_p->upath_cache;
+
+    return (puc == NULL ? 0 : (long)min(puc->used, max_long));
+}
+
+/* - ucachestatus <mark> <bsize> <bmax> <rsize> <rmax> <blimit> */
+static int
+zucachestatus(i_ctx_t *i_ctx_p)
+{
+    os_ptr op = osp;
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+
+    push(6);
+    make_mark(op - 5);
+    make_int(op - 4, (puc == NULL ? 0 : puc->used));
+    make_int(op - 3, (puc == NULL ? 0 : puc->max_size));
+    make_int(op - 2, (puc == NULL ? 0 : puc->count));
+    make_int(op - 1, (puc == NULL ? 0 : puc->max_count));
+    make_int(op, (puc == NULL ? 0 : puc->max_item));
+    return 0;
+}
+
+/* Append to the key being built. */
+static int
+upath_key_put(upath_cache_t *puc, const void *data, uint size)
+{
+    if (size > puc->key_max - puc->key_size) {
+        uint new_max = max(puc->key_max * 2, puc->key_size + size);
+        byte *new_key;
+
+        if (new_max < puc->key_size + size)
+            return_error(gs_error_limitcheck);
+        new_key = gs_alloc_bytes(puc->memory, new_max, "upath_key_put");
+        if (new_key == NULL)
+            return_error(gs_error_VMerror);
+        if (puc->key_size != 0)
+            memcpy(new_key, puc->key, puc->key_size);
+        gs_free_object(puc->memory, puc->key, "upath_key_put");
+        puc->key = new_key;
+        puc->key_max = new_max;
+    }
+    memcpy(puc->key + puc->key_size, data, size);
+    puc->key_size += size;
+    return 0;
+}
+
+/* Append a number from a user path to the key. */
+static int
+upath_key_put_number(upath_cache_t *puc, const ref *pnum)
+{
+    byte tag = (byte)r_type(pnum);
+
+    switch (r_type(pnum)) {
+        case t_integer: {
+            int code = upath_key_put(puc, &tag, 1);
+
+            return (code < 0 ? code :
+                    upath_key_put(puc, &pnum->value.intval, sizeof(pnum->value.intval)));
+        }
+        case t_real: {
+            int code = upath_key_put(puc, &tag, 1);
+
+            return (code < 0 ? code :
+                    upath_key_put(puc, &pnum->value.realval, sizeof(pnum->value.realval)));
+        }
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Build the key for painting a user path. Return 1 if the path should be
+ * cached, 0 if not (including if it isn't a valid user path: painting it
+ * directly will report the error), or an error.
+ */
+static int
+upath_cache_key(i_ctx_t *i_ctx_p, upath_cache_t *puc, const ref *oppath,
+                const gs_matrix *pmat, int rule, bool upath_compat)
+{
+    gs_gstate *pgs = igs;
+    upath_key_state_t ks;
+    ref opcodes, elt;
+    uint i, size;
+    int code;
+
+    if (!r_is_array(oppath) || !r_has_attr(oppath, a_read) || r_size(oppath) == 0)
+        return 0;
+    memset(&ks, 0, sizeof(ks));
+    ks.rule = rule;
+    ks.compat = upath_compat;
+    ks.ctm[0] = pgs->ctm.xx;
+    ks.ctm[1] = pgs->ctm.xy;
+    ks.ctm[2] = pgs->ctm.yx;
+    ks.ctm[3] = pgs->ctm.yy;
+    if (pmat != NULL) {
+        ks.mat[0] = pmat->xx;
+        ks.mat[1] = pmat->xy;
+        ks.mat[2] = pmat->yx;
+        ks.mat[3] = pmat->yy;
+        ks.mat[4] = pmat->tx;
+        ks.mat[5] = pmat->ty;
+    }
+    ks.fill_adjust_x = pgs->fill_adjust.x;
+    ks.fill_adjust_y = pgs->fill_adjust.y;
+    ks.flatness = pgs->flatness;
+    ks.accurate_curves = pgs->accurate_curves;
+    if (rule == 0) {
+        const gx_line_params *plp = &pgs->line_params;
+
+        ks.stroke_adjust = pgs->stroke_adjust;
+        ks.half_width = plp->half_width;
+        ks.start_cap = plp->start_cap;
+        ks.end_cap = plp->end_cap;
+        ks.dash_cap = plp->dash_cap;
+        ks.join = plp->join;
+        ks.curve_join = plp->curve_join;
+        ks.miter_limit = plp->miter_limit;
+        ks.dot_length = plp->dot_length;
+        ks.dot_length_absolute = plp->dot_length_absolute;
+        ks.dot_orientation[0] = plp->dot_orientation.xx;
+        ks.dot_orientation[1] = plp->dot_orientation.xy;
+        ks.dot_orientation[2] = plp->dot_orientation.yx;
+        ks.dot_orientation[3] = plp->dot_orientation.yy;
+        ks.dash_offset = plp->dash.offset;
+        ks.dash_adapt = plp->dash.adapt;
+        ks.dash_size = plp->dash.pattern_size;
+    }
+    puc->key_size = 0;
+    code = upath_key_put(puc, &ks, sizeof(ks));
+    if (code >= 0 && ks.dash_size != 0)
+        code = upath_key_put(puc, pgs->line_params.dash.pattern,
+                             ks.dash_size * sizeof(float));
+    if (code < 0)
+        return code;
+
+    if (r_size(oppath) == 2 &&
+        array_get(imemory, oppath, 1, &opcodes) >= 0 &&
+        r_has_type(&opcodes, t_string)
+        ) {			/* 1st element is operands, 2nd is operators */
+        ref operands;
+        int format;
+
+        if (!r_has_attr(&opcodes, a_read) || r_size(&opcodes) == 0 ||
+            opcodes.value.bytes[0] != upath_op_ucache)
+            return 0;
+        array_get(imemory, oppath, 0, &operands);
+        format = num_array_format(&operands);
+        if (format < 0)
+            return 0;
+        size = r_size(&opcodes);
+        code = upath_key_put(puc, &size, sizeof(size));
+        if (code >= 0)
+            code = upath_key_put(puc, opcodes.value.bytes, size);
+        size = num_array_size(&operands, format);
+        for (i = 0; code >= 0 && i < size; i++) {
+            if (num_array_get(imemory, &operands, format, i, &elt) < 0)
+                return 0;
+            code = upath_key_put_number(puc, &elt);
+        }
+        return (code < 0 ? code : 1);
+    }
+    /* Ordinary executable array. */
+    size = r_size(oppath);
+    for (i = 0; i < size; i++) {
+        byte tag;
+
+        array_get(imemory, oppath, i, &elt);
+        switch (r_type(&elt)) {
+            case t_integer:
+            case t_real:
+                code = upath_key_put_number(puc, &elt);
+                break;
+            case t_name:
+                if (i == 0) {
+                    ref *defp;
+
+                    if (dict_find(systemdict, &elt, &defp) <= 0 ||
+                        r_btype(defp) != t_operator ||
+                        real_opproc(defp) != zucache)
+                        return 0;
+                }
+                tag = t_name;
+                code = upath_key_put(puc, &tag, 1);
+                if (code >= 0) {
+                    uint nidx = name_index(imemory, &elt);
+
+                    code = upath_key_put(puc, &nidx, sizeof(nidx));
+                }
+                break;
+            case t_operator: {
+                op_proc_t proc = real_opproc(&elt);
+
+                if (i == 0 && proc != zucache)
+                    return 0;
+                tag = t_operator;
+                code = upath_key_put(puc, &tag, 1);
+                if (code >= 0)
+                    code = upath_key_put(puc, &proc, sizeof(proc));
+                break;
+            }
+            default:
+                return 0;
+        }
+        if (code < 0)
+            return code;
+    }
+    return 1;
+}
+
+static uint
+upath_key_hash(const byte *key, uint size)
+{
+    uint hash = 2166136261u;
+
+    while (size--)
+        hash = (hash ^ *key++) * 16777619u;
+    return hash;
+}
+
+/*
+ * Make a cache entry for the path that has just been built in the graphics
+ * state. If it is too large to cache, set *ppe to NULL.
+ */
+static int
+upath_cache_add(i_ctx_t *i_ctx_p, upath_cache_t *puc, uint hash, int rule,
+                int tx, int ty, upath_entry_t **ppe)
+{
+    gs_gstate *pgs = igs;
+    gs_int_rect box;
+    uint raster;
+    size_t bits_size, size;
+    upath_entry_t *pe, **ppchain;
+    int code;
+
+    *ppe = NULL;
+    code = gs_paint_mask_box(pgs, rule, &box);
+    if (code < 0)
+        return (code == gs_error_limitcheck ? 0 : code);
+    if (box.q.x <= box.p.x || box.q.y <= box.p.y)
+        box.q.x = box.p.x, box.q.y = box.p.y;
+    if (box.q.x - box.p.x > puc->max_item * 8 || box.q.y - box.p.y > puc->max_item)
+        return 0;
+    raster = bitmap_raster(box.q.x - box.p.x);
+    bits_size = (size_t)raster * (box.q.y - box.p.y);
+    size = sizeof(upath_entry_t) + ROUND_UP(puc->key_size, align_bitmap_mod) +
+        bits_size;
+    if (size > (size_t)puc->max_item || size > (size_t)puc->max_size)
+        return 0;
+    if (puc->table == NULL) {
+        puc->table = (upath_entry_t **)
+            gs_alloc_byte_array(puc->memory, UPATH_CACHE_HASH_SIZE,
+                                sizeof(upath_entry_t *), "upath_cache_add(table)");
+        if (puc->table == NULL)
+            return 0;
+        memset(puc->table, 0, UPATH_CACHE_HASH_SIZE * sizeof(upath_entry_t *));
+    }
+    /* Make room, in the memory budget and then within the cache limits. */
+    gs_lib_ctx_budget_reserve(puc->budget, size);
+    upath_cache_trim(puc, (size_t)puc->max_size - size, puc->max_count - 1);
+    pe = (upath_entry_t *)gs_alloc_bytes(puc->memory, size, "upath_cache_add");
+    if (pe == NULL)
+        return 0;
+    pe->hash = hash;
+    pe->key_size = puc->key_size;
+    pe->size = size;
+    pe->x = box.p.x - tx;
+    pe->y = box.p.y - ty;
+    pe->width = box.q.x - box.p.x;
+    pe->height = box.q.y - box.p.y;
+    pe->raster = raster;
+    memcpy(upath_entry_key(pe), puc->key, puc->key_size);
+    if (bits_size != 0) {
+        memset(upath_entry_bits(pe), 0, bits_size);
+        code = gs_paint_mask_render(pgs, rule, &box, upath_entry_bits(pe), raster);
+        if (code < 0) {
+            gs_free_object(puc->memory, pe, "upath_cache_add");
+            return code;
+        }
+    }
+    pe->id = gs_next_ids(imemory, 1);
+    ppchain = &puc->table[hash & (UPATH_CACHE_HASH_SIZE - 1)];
+    pe->next = *ppchain;
+    *ppchain = pe;
+    pe->more_recent = NULL;
+    pe->less_recent = puc->most_recent;
+    if (puc->most_recent)
+        puc->most_recent->more_recent = pe;
+    else
+        puc->least_recent = pe;
+    puc->most_recent = pe;
+    puc->used += size;
+    puc->count++;
+    gs_lib_ctx_budget_set_used(puc->budget, puc->used);
+    *ppe = pe;
+    return 0;
+}
+
+static upath_entry_t *
+upath_cache_lookup(upath_cache_t *puc, uint hash)
+{
+    upath_entry_t *pe;
+
+    if (puc->table == NULL)
+        return NULL;
+    for (pe = puc->table[hash & (UPATH_CACHE_HASH_SIZE - 1)]; pe; pe = pe->next)
+        if (pe->hash == hash && pe->key_size == puc->key_size &&
+            !memcmp(upath_entry_key(pe), puc->key, puc->key_size))
+            break;
+    if (pe != NULL && pe != puc->most_recent) {
+        /* Move it to the front of the LRU list. */
+        pe->more_recent->less_recent = pe->less_recent;
+        if (pe->less_recent)
+            pe->less_recent->more_recent = pe->more_recent;
+        else
+            puc->least_recent = pe->more_recent;
+        pe->more_recent = NULL;
+        pe->less_recent = puc->most_recent;
+        puc->most_recent->more_recent = pe;
+        puc->most_recent = pe;
+    }
+    return pe;
+}
+
+/*
+ * Paint a user path through the cache, for ufill and ueofill ('rule' is
+ * the fill rule) and ustroke ('rule' is 0, and pmat is the matrix operand
+ * if any). Return 1 if the path was painted, 0 if the caller should paint
+ * it in the usual way, or an error. This is called inside the operator's
+ * gsave, and may change the CTM and the current path.
+ */
+static int
+upath_cache_paint(i_ctx_t *i_ctx_p, os_ptr oppath, const gs_matrix *pmat, int rule)
+{
+    upath_cache_t *puc = upath_cache(i_ctx_p);
+    gs_gstate *pgs = igs;
+    bool upath_compat = gs_currentcpsimode(imemory);
+    upath_entry_t *pe;
+    gs_matrix ctm;
+    double tx, ty;
+    uint hash;
+    int code;
+
+    if (puc == NULL || puc->max_item <= 0 || puc->max_size <= 0)
+        return 0;
+    /* Round the translation, keeping well within the fixed range. */
+    gs_currentmatrix(pgs, &ctm);
+    tx = floor(ctm.tx + 0.5);
+    ty = floor(ctm.ty + 0.5);
+    if (fabs(tx) > max_int_in_fixed / 2 || fabs(ty) > max_int_in_fixed / 2)
+        return 0;
+    code = upath_cache_key(i_ctx_p, puc, oppath, pmat, rule, upath_compat);
+    if (code <= 0)
+        return code;
+    if (puc->key_size > (ulong)puc->max_item || !gs_paint_mask_ok(pgs))
+        return 0;
+    hash = upath_key_hash(puc->key, puc->key_size);
+    pe = upath_cache_lookup(puc, hash);
+    if (pe == NULL) {
+        ctm.tx = tx;
+        ctm.ty = ty;
+        if ((code = gs_setmatrix(pgs, &ctm)) < 0 ||
+            (code = upath_append(oppath, i_ctx_p, upath_compat)) < 0 ||
+            (pmat != NULL && (code = gs_concat(pgs, pmat)) < 0) ||
+            (code = upath_cache_add(i_ctx_p, puc, hash, rule,
+                                    (int)tx, (int)ty, &pe)) < 0)
+            return code;
+        if (pe == NULL) {
+            /* Too large to cache: just paint it (still rounded). */
+            code = (rule == 0 ? gs_stroke(pgs) :
+                    rule == gx_rule_even_odd ? gs_eofill(pgs) : gs_fill(pgs));
+            return (code < 0 ? code : 1);
+        }
+    }
+    code = gs_paint_mask(pgs, rule, upath_entry_bits(pe), pe->raster, pe->id,
+                         (int)tx + pe->x, (int)ty + pe->y,
+                         pe->width, pe->height);
+    return (code < 0 ? code : 1);
+}
+
 /* ---------------- Initialization procedure ---------------- */
 
 const op_def zupath_l2_op_defs[] =
@@ -884,6 +1479,7 @@ const op_def zupath_l2_op_defs[] =
                 /* User paths */
     {"1uappend", zuappend},
     {"0ucache", zucache},
+    {"0ucachestatus", zucachestatus},
     {"1ueofill", zueofill},
     {"1ufill", zufill},
     {"1upath", zupath},
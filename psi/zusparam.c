@@ -35,6 +35,8 @@
 #include "itoken.h"
 #include "iutil2.h"
 #include "ivmem2.h"
+#include "iupath.h"
+#include "iform.h"
 #include "store.h"
 #include "gsnamecl.h"
 #include "igstate.h"
@@ -184,6 +186,37 @@ current_CurFontCache(i_ctx_t *i_ctx_p)
     return cstat[0];
 }
 
+static long
+current_MaxUPathCache(i_ctx_t *i_ctx_p)
+{
+    return upath_cache_max_size(i_ctx_p);
+}
+static int
+set_MaxUPathCache(i_ctx_t *i_ctx_p, long val)
+{
+    return upath_cache_set_max_size(i_ctx_p, val);
+}
+static long
+current_CurUPathCache(i_ctx_t *i_ctx_p)
+{
+    return upath_cache_cur_size(i_ctx_p);
+}
+static long
+current_MaxFormCache(i_ctx_t *i_ctx_p)
+{
+    return form_cache_max_size(i_ctx_p);
+}
+static int
+set_MaxFormCache(i_ctx_t *i_ctx_p, long val)
+{
+    return form_cache_set_max_size(i_ctx_p, val);
+}
+static long
+current_CurFormCache(i_ctx_t *i_ctx_p)
+{
+    return form_cache_cur_size(i_ctx_p);
+}
+
 /* Even though size_t is unsigned, PostScript limits this to signed range */
 static size_t
 current_MaxGlobalVM(i_ctx_t *i_ctx_p)
@@ -214,6 +247,19 @@ set_MaxGlobalVM(i_ctx_t *i_ctx_p, size_t val)
     gs_memory_set_gc_status(iimemory_global, &stat);
     return 0;
 }
+/* The limit shared by the pattern, character and ICC link caches, and */
+/* the clist buffers. 0 means no limit. */
+static size_t
+current_MemoryBudget(i_ctx_t *i_ctx_p)
+{
+    return min(gs_lib_ctx_get_memory_budget(imemory), MAX_VM_THRESHOLD);
+}
+
+static int
+set_MemoryBudget(i_ctx_t *i_ctx_p, size_t val)
+{
+    return gs_lib_ctx_set_memory_budget(imemory, val);
+}
 static long
 current_Revision(i_ctx_t *i_ctx_p)
 {
@@ -234,7 +280,8 @@ current_PageCount(i_ctx_t *i_ctx_p)
 static const size_t_param_def_t system_size_t_params[] =
 {
     /* Extensions */
-    {"MaxGlobalVM", MIN_VM_THRESHOLD, MAX_VM_THRESHOLD, current_MaxGlobalVM, set_MaxGlobalVM}
+    {"MaxGlobalVM", MIN_VM_THRESHOLD, MAX_VM_THRESHOLD, current_MaxGlobalVM, set_MaxGlobalVM},
+    {"MemoryBudget", 0, MAX_VM_THRESHOLD, current_MemoryBudget, set_MemoryBudget}
 };
 
 static const long_param_def_t system_long_params[] =
@@ -242,6 +289,10 @@ static const long_param_def_t system_long_params[] =
     {"BuildTime", min_long, max_long, current_BuildTime, NULL},
     {"MaxFontCache", 0, MAX_UINT_PARAM, current_MaxFontCache, set_MaxFontCache},
     {"CurFontCache", 0, MAX_UINT_PARAM, current_CurFontCache, NULL},
+    {"MaxUPathCache", 0, MAX_UINT_PARAM, current_MaxUPathCache, set_MaxUPathCache},
+    {"CurUPathCache", 0, MAX_UINT_PARAM, current_CurUPathCache, NULL},
+    {"MaxFormCache", 0, MAX_UINT_PARAM, current_MaxFormCache, set_MaxFormCache},
+    {"CurFormCache", 0, MAX_UINT_PARAM, current_CurFormCache, NULL},
     {"Revision", min_long, max_long, current_Revision, NULL},
     {"PageCount", min_long, max_long, current_PageCount, NULL}
 };
@@ -384,6 +435,26 @@ set_MaxFontItem(i_ctx_t *i_ctx_p, long val)
     return gs_setcacheupper(ifont_dir, val);
 }
 static long
+current_MaxUPathItem(i_ctx_t *i_ctx_p)
+{
+    return upath_cache_max_item(i_ctx_p);
+}
+static int
+set_MaxUPathItem(i_ctx_t *i_ctx_p, long val)
+{
+    return upath_cache_set_max_item(i_ctx_p, val);
+}
+static long
+current_MaxFormItem(i_ctx_t *i_ctx_p)
+{
+    return form_cache_max_item(i_ctx_p);
+}
+static int
+set_MaxFormItem(i_ctx_t *i_ctx_p, long val)
+{
+    return form_cache_set_max_item(i_ctx_p, val);
+}
+static long
 current_MinFontCompress(i_ctx_t *i_ctx_p)
 {
     return gs_currentcachelower(ifont_dir);
@@ -628,6 +699,10 @@ static const long_param_def_t user_long_params[] =
      current_MaxFontItem, set_MaxFontItem},
     {"MinFontCompress", MIN_INT_PARAM, MAX_UINT_PARAM,
      current_MinFontCompress, set_MinFontCompress},
+    {"MaxUPathItem", 0, MAX_UINT_PARAM,
+     current_MaxUPathItem, set_MaxUPathItem},
+    {"MaxFormItem", 0, MAX_UINT_PARAM,
+     current_MaxFormItem, set_MaxFormItem},
     {"MaxOpStack", -1, max_long,
      current_MaxOpStack, set_MaxOpStack},
     {"MaxDictStack", -1, max_long,
@@ -24,6 +24,7 @@
 #include "idict.h"		/* ditto */
 #include "igstate.h"
 #include "isave.h"
+#include "iform.h"		/* for form_cache_restore */
 #include "dstack.h"
 #include "stream.h"		/* for files.h */
 #include "files.h"		/* for e-stack processing */
@@ -146,6 +147,8 @@ dorestore(i_ctx_t *i_ctx_p, alloc_save_t *asave)
 
     osp--;
 
+    /* Drop any cached forms that are about to be freed. */
+    form_cache_restore(i_ctx_p, asave);
     /* Reset l_new in all stack entries if the new save level is zero. */
     /* Also do some special fixing on the e-stack. */
     restore_fix_stack(i_ctx_p, &o_stack, asave, false);